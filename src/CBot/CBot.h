@@ -23,9 +23,11 @@
  * that should be included by any Colobot files outside of the CBot module.
  */
 
+#include "CBot/CBotExecutionContext.h"
 #include "CBot/CBotFileUtils.h"
 #include "CBot/CBotClass.h"
 #include "CBot/CBotToken.h"
+#include "CBot/CBotProfiler.h"
 #include "CBot/CBotProgram.h"
 #include "CBot/CBotTypResult.h"
 
@@ -0,0 +1,781 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "CBot/CBotBytecode.h"
+
+#include "CBot/CBotStack.h"
+
+#include "CBot/CBotInstr/CBotInstr.h"
+#include "CBot/CBotInstr/CBotLeftExprVar.h"
+
+#include "CBot/CBotVar/CBotVar.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CBot
+{
+
+////////////////////////////////////////////////////////////////////////////////
+CBotBytecode::CBotBytecode()
+{
+    m_root      = nullptr;
+    m_depth     = 0;
+    m_maxDepth  = 0;
+    m_bOverflow = false;
+    m_bDisabled = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotBytecode::~CBotBytecode()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotBytecode* CBotBytecode::Compile(CBotInstr* expr)
+{
+    CBotBytecode* code = new CBotBytecode();
+    if (!expr->GenerateBytecode(*code, 0) || code->m_bOverflow)
+    {
+        delete code;
+        return nullptr;
+    }
+    return code;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotBytecode* CBotBytecode::CompileLoop(CBotInstr* loop)
+{
+    CBotBytecode* code = new CBotBytecode();
+    code->m_root = loop;
+    loop->GenerateStatementBytecode(*code);
+    if (code->m_bOverflow || code->m_maxDepth > MAX_BLOCKS || code->GetPosition() >= MAX_CODE)
+    {
+        delete code;
+        return nullptr;
+    }
+    return code;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::Emit(Opcode op, int dst, int src, int steps)
+{
+    if (dst < 0 || dst >= MAX_REGISTERS || src < 0 || src >= MAX_REGISTERS)
+    {
+        m_bOverflow = true;
+        return -1;
+    }
+
+    Instruction instr;
+    instr.op     = op;
+    instr.dst    = static_cast<unsigned char>(dst);
+    instr.src    = static_cast<unsigned char>(src);
+    instr.steps  = static_cast<unsigned char>(steps);
+    instr.instr  = nullptr;
+    instr.ident  = 0;
+    m_code.push_back(instr);
+    return static_cast<int>(m_code.size()) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitInt(int dst, int val)
+{
+    int i = Emit(Opcode::LoadInt, dst);
+    if (i >= 0) m_code[i].valInt = val;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitFloat(int dst, float val)
+{
+    int i = Emit(Opcode::LoadFloat, dst);
+    if (i >= 0) m_code[i].valFloat = val;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitBool(int dst, bool val)
+{
+    int i = Emit(Opcode::LoadBool, dst);
+    if (i >= 0) m_code[i].valInt = val ? 1 : 0;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitVar(int dst, long ident, int steps)
+{
+    int i = Emit(Opcode::LoadVar, dst, 0, steps);
+    if (i >= 0) m_code[i].ident = ident;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotBytecode::PatchJump(int index)
+{
+    if (index < 0) return;
+    m_code[index].target = static_cast<int>(m_code.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::GetPosition()
+{
+    return static_cast<int>(m_code.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::IsRoot(CBotInstr* loop)
+{
+    return loop == m_root;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::BeginStatement(CBotInstr* instr, int steps)
+{
+    int i = Emit(Opcode::Statement, 0, 0, steps);
+    m_code[i].instr = instr;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotBytecode::EndStatement(int index)
+{
+    PatchJump(index);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::BeginBlock(CBotInstr* instr)
+{
+    int i = Emit(Opcode::BeginBlock, 0);
+    m_code[i].instr = instr;
+    m_maxDepth = std::max(m_maxDepth, ++m_depth);
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotBytecode::EndBlock(int index)
+{
+    m_code[index].target = GetPosition();
+    Emit(Opcode::EndBlock, 0);
+    m_depth--;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::BeginLoop(const std::string& label)
+{
+    LoopInfo loop;
+    loop.label = label;
+    loop.begin = GetPosition();
+    loop.end   = loop.begin;
+    loop.cont  = loop.begin;
+    loop.depth = m_depth;
+    m_loops.push_back(loop);
+    return static_cast<int>(m_loops.size()) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotBytecode::SetContinue(int loop)
+{
+    m_loops[loop].cont = GetPosition();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotBytecode::EndLoop(int loop)
+{
+    m_loops[loop].end = GetPosition();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::BeginExpression(CBotInstr* instr, bool bResult, int steps)
+{
+    int i = Emit(Opcode::Expr, bResult ? 1 : 0, 1, steps);
+    m_code[i].instr = instr;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::EndExpression(int index, bool ok)
+{
+    if (!ok || m_bOverflow)
+    {
+        // the tree walker always does it
+        m_code.resize(index + 1);
+        m_code[index].src = 0;
+        m_bOverflow = false;
+        ok = false;
+    }
+    PatchJump(index);
+    return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotBytecode::EmitCondition(CBotInstr* expr)
+{
+    int i = BeginExpression(expr, true, 0);
+    if (EndExpression(i, expr->GenerateBytecode(*this, 0))) expr->DropBytecode();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitStore(int reg, long ident, bool bSameType)
+{
+    int i = Emit(Opcode::Store, reg, bSameType ? 1 : 0);
+    if (i >= 0) m_code[i].ident = ident;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitDeclare(CBotInstr* var, int reg, bool bValue)
+{
+    int i = Emit(Opcode::Declare, reg, bValue ? 1 : 0, 1);     // see CBotDefInt::Execute()
+    if (i >= 0) m_code[i].instr = var;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitExec(CBotInstr* instr)
+{
+    int i = Emit(Opcode::Exec, 0);
+    m_code[i].instr = instr;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitBranch(int steps, bool bAlways)
+{
+    return Emit(Opcode::Branch, 0, bAlways ? 1 : 0, steps);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitJump()
+{
+    return Emit(Opcode::Jump, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitCheck(int steps)
+{
+    return Emit(Opcode::Check, 0, 0, steps);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitEndBody()
+{
+    return Emit(Opcode::EndBody, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotBytecode::EmitLoop(int target, int steps, int state)
+{
+    int i = Emit(Opcode::Loop, 0, state, steps);
+    m_code[i].target = target;
+    return i;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Execute(CBotStack* pStack, CBotValue& result, int& steps)
+{
+    CBotValue reg[MAX_REGISTERS];
+    const int size = static_cast<int>(m_code.size());
+
+    steps = 0;
+    int pc = 0;
+    while (pc < size)
+    {
+        const Instruction& instr = m_code[pc++];
+        steps += instr.steps;
+        if (!Evaluate(instr, reg, pStack, pc)) return false;
+    }
+
+    result = reg[0];
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Evaluate(const Instruction& instr, CBotValue* reg, CBotStack* pStack, int& pc)
+{
+    CBotValue& val = reg[instr.dst];
+
+    switch (instr.op)
+    {
+    case Opcode::LoadInt:
+        val.type = CBotTypInt;
+        val.valInt = instr.valInt;
+        return true;
+    case Opcode::LoadFloat:
+        val.type = CBotTypFloat;
+        val.valFloat = instr.valFloat;
+        return true;
+    case Opcode::LoadBool:
+        val.type = CBotTypBoolean;
+        val.valInt = instr.valInt;
+        return true;
+    case Opcode::LoadVar:
+    {
+        CBotVar* var = pStack->FindVar(instr.ident, false);
+        if (var == nullptr) return false;
+        val.type = var->GetType();
+        if (val.type != CBotTypInt && val.type != CBotTypFloat && val.type != CBotTypBoolean)
+        {
+            m_bDisabled.store(true, std::memory_order_relaxed);     // will never work here
+            return false;
+        }
+        if (var->GetInit() != CBotVar::InitType::DEF) return false;   // let the tree report it
+        if (val.type == CBotTypFloat) val.valFloat = var->GetValFloat();
+        else                          val.valInt = var->GetValInt();
+        return true;
+    }
+    case Opcode::JumpIfFalse:
+    case Opcode::JumpIfTrue:
+    {
+        bool cond = val.GetValInt() != 0;
+        if (cond == (instr.op == Opcode::JumpIfTrue))
+        {
+            val.type = CBotTypBoolean;
+            val.valInt = cond ? 1 : 0;
+            pc = instr.target;
+        }
+        return true;
+    }
+    case Opcode::Neg:
+    case Opcode::Not:
+        return Unary(instr.op, val);
+    default:
+        return Binary(instr.op, val, reg[instr.src]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Run(CBotStack* &pj, CBotStack* pile)
+{
+    CBotValue   reg[MAX_REGISTERS];
+    CBotStack*  frames[MAX_BLOCKS + 1];             // levels of the blocks being executed
+    const int   size = static_cast<int>(m_code.size());
+
+    int     pc = 0;
+    int     depth = 0;
+    bool    bResume = false;                        // something executed by the tree is in progress at pc
+    frames[0] = pile;
+
+    if (pile->GetState() < 0)
+    {
+        int state = -1 - pile->GetState();
+        pc = state >> 1;
+        bResume = (state & 1) != 0;
+
+        // finds the levels of the blocks around pc
+        for (int i = 0; i < pc; i++)
+        {
+            const Instruction& instr = m_code[i];
+            if (instr.op != Opcode::BeginBlock) continue;
+            if (instr.target < pc) i = instr.target;        // block already ended
+            else
+            {
+                frames[depth + 1] = frames[depth]->AddStack(instr.instr, CBotStack::BlockVisibilityType::BLOCK);
+                depth++;
+            }
+        }
+    }
+
+    int steps = 0;                                  // timer steps not charged yet
+    int guard = 0;                                  // beginning of the expression being evaluated
+    int guardSteps = 0;
+
+    while (pc < size)
+    {
+        const Instruction& instr = m_code[pc];
+        CBotStack* frame = frames[depth];
+        bool ok = true;
+
+        switch (instr.op)
+        {
+        case Opcode::Statement:
+            steps += instr.steps;
+            if (!bResume && pile->GetTimer() > 0)
+            {
+                pc++;
+                break;
+            }
+            // step by step, the whole statement is executed by the tree walker, which stops where it does
+
+        case Opcode::Exec:
+            pile->ConsumeTimer(steps);
+            steps = 0;
+            bResume = false;
+            if (!instr.instr->Execute(frame))
+            {
+                if (pile->IsOk()) return Suspend(pile, pc, true);     // interrupted here
+                if (!Break(frames, depth, pc)) return false;
+                break;
+            }
+            pc = instr.op == Opcode::Statement ? instr.target : pc + 1;
+            break;
+
+        case Opcode::Expr:
+            guard = pc;
+            guardSteps = steps;
+            steps += instr.steps;
+            ok = !bResume && instr.src != 0 && pile->GetTimer() > 0;     // step by step, done by the tree walker
+            pc++;
+            break;
+
+        case Opcode::Store:
+        {
+            CBotVar* var = frame->FindVar(instr.ident, false);
+            const CBotValue& val = reg[instr.dst];
+            ok = var != nullptr &&
+                 (var->GetType() == CBotTypInt || var->GetType() == CBotTypFloat || var->GetType() == CBotTypBoolean) &&
+                 (instr.src == 0 || var->GetType() == val.type);
+            if (ok) var->SetValue(val);
+            pc++;
+            break;
+        }
+
+        case Opcode::Declare:
+        {
+            CBotLeftExprVar* left = static_cast<CBotLeftExprVar*>(instr.instr);
+            CBotVar* var = CBotVar::Create(left->GetToken()->GetString(), left->m_typevar);
+            var->SetUniqNum(left->m_nIdent);
+            frame->AddVar(var);
+            if (instr.src != 0) var->SetValue(reg[instr.dst]);
+
+            steps += instr.steps;
+            pc++;
+            if (!pile->ConsumeTimer(steps)) return Suspend(pile, pc, false);
+            steps = 0;
+            break;
+        }
+
+        case Opcode::Branch:
+            if (reg[0].GetValInt() != 0) pc++;
+            else
+            {
+                pc = instr.target;
+                if (instr.src == 0) break;          // a loop ends without SetState()
+            }
+            if (instr.steps == 0) break;
+
+            steps += instr.steps;
+            if (!pile->ConsumeTimer(steps)) return Suspend(pile, pc, false);
+            steps = 0;
+            break;
+
+        case Opcode::Jump:
+            pc = instr.target;
+            break;
+
+        case Opcode::Check:
+            steps += instr.steps;
+            pc++;
+            if (!pile->ConsumeTimer(steps)) return Suspend(pile, pc, false);
+            steps = 0;
+            break;
+
+        case Opcode::EndBody:
+            // terminates if the loop used up the memory, the error ends the loops around it too
+            if (frame->MemoryOver()) return pj->Return(pile);
+            pc++;
+            break;
+
+        case Opcode::Loop:
+            steps += instr.steps;
+            if (!pile->ConsumeTimer(steps, 0))
+            {
+                // step by step, the tree walker continues the loop from the same state
+                if (pile->GetTimer() <= 0 && pc == m_loops[0].end - 1)
+                {
+                    pile->SetStateOnly(instr.src);
+                    return false;
+                }
+                return Suspend(pile, instr.target, false);
+            }
+            steps = 0;
+            pc = instr.target;
+            break;
+
+        case Opcode::BeginBlock:
+        {
+            CBotStack* pStk = frame->AddStack(instr.instr, CBotStack::BlockVisibilityType::BLOCK);
+            if (pStk->StackOver() || pStk->MemoryOver()) return frame->Return(pStk);
+            frames[++depth] = pStk;
+            pc++;
+            break;
+        }
+
+        case Opcode::EndBlock:
+            frames[depth - 1]->Return(frame);
+            depth--;
+            pc++;
+            break;
+
+        default:
+            steps += instr.steps;
+            pc++;
+            ok = Evaluate(instr, reg, frame, pc);
+        }
+
+        if (!ok)
+        {
+            // the tree walker does the expression (or the whole statement) again
+            const Instruction& expr = m_code[guard];
+            pile->ConsumeTimer(guardSteps);
+            steps = 0;
+            bResume = false;
+            if (!expr.instr->Execute(frame))
+            {
+                if (pile->IsOk()) return Suspend(pile, guard, true);  // interrupted here
+                return false;
+            }
+            if (expr.dst != 0)
+            {
+                reg[0].type = CBotTypBoolean;
+                reg[0].valInt = frame->GetVal() == true ? 1 : 0;
+            }
+            pc = expr.target;
+        }
+    }
+
+    pile->ConsumeTimer(steps);
+    return pj->Return(pile);                        // sends the results and releases the stack
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Break(CBotStack** frames, int& depth, int& pc)
+{
+    // from the innermost loop, as CBotWhile::Execute() and the others do
+    for (int i = static_cast<int>(m_loops.size()) - 1; i >= 0; i--)
+    {
+        const LoopInfo& loop = m_loops[i];
+        if (pc < loop.begin || pc >= loop.end) continue;
+
+        CBotStack* pile = frames[loop.depth];
+        if (pile->IfContinue(0, loop.label))
+        {
+            pc = loop.cont;
+            depth = loop.depth;
+            return true;
+        }
+        if (pile->BreakReturn(pile, loop.label))
+        {
+            pile->Return(pile->AddStack());         // releases the levels above
+            pc = loop.end;
+            depth = loop.depth;
+            return true;
+        }
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Suspend(CBotStack* pile, int pc, bool bInProgress)
+{
+    pile->SetStateOnly(-1 - (pc * 2 + (bInProgress ? 1 : 0)));
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotBytecode::RestoreState(CBotStack* pile)
+{
+    int state = -1 - pile->GetState();
+    int pc = state >> 1;
+    const int size = static_cast<int>(m_code.size());
+    if (pc >= size) return;
+
+    CBotStack* frame = pile;
+    for (int i = 0; i < pc; i++)
+    {
+        const Instruction& instr = m_code[i];
+        if (instr.op == Opcode::BeginBlock)
+        {
+            if (instr.target < pc) i = instr.target;        // block already ended
+            else
+            {
+                frame = frame->RestoreStack(instr.instr);
+                if (frame == nullptr) return;
+            }
+        }
+        else if (instr.op == Opcode::Statement && instr.target <= pc)
+        {
+            // statement already executed, restores the variables it declared
+            CBotStack* pStk = frame;
+            instr.instr->RestoreState(pStk, false);
+            i = instr.target - 1;
+        }
+    }
+
+    if ((state & 1) == 0) return;
+
+    // interrupted in the tree walker
+    CBotStack* pStk = frame;
+    m_code[pc].instr->RestoreState(pStk, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Unary(Opcode op, CBotValue& val)
+{
+    switch (op)
+    {
+    case Opcode::Neg:
+        if (val.type == CBotTypInt)         val.valInt = -val.valInt;
+        else if (val.type == CBotTypFloat)  val.valFloat = -val.valFloat;
+        else return false;
+        return true;
+    case Opcode::Not:
+        if (val.type == CBotTypInt)             val.valInt = ~val.valInt;
+        else if (val.type == CBotTypBoolean)    val.valInt = val.valInt ? 0 : 1;
+        else return false;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// stores the result of a comparison
+static bool SetBool(CBotValue& result, bool res)
+{
+    result.type = CBotTypBoolean;
+    result.valInt = res ? 1 : 0;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::Binary(Opcode op, CBotValue& left, const CBotValue& right)
+{
+    // type in which the operation is done, as in CBotTwoOpExpr::Execute
+    switch (std::max(left.type, right.type))
+    {
+    case CBotTypInt:
+        return BinaryInt(op, left.GetValInt(), right.GetValInt(), left);
+    case CBotTypFloat:
+        return BinaryFloat(op, left.GetValFloat(), right.GetValFloat(), left);
+    case CBotTypBoolean:
+        return BinaryBool(op, left.GetValInt(), right.GetValInt(), left);
+    default:
+        break;
+    }
+
+    // null pointers can only be compared
+    switch (op)
+    {
+    case Opcode::Eq:        return SetBool(left, left.GetValInt() == right.GetValInt());
+    case Opcode::Ne:        return SetBool(left, left.GetValInt() != right.GetValInt());
+    case Opcode::LogAnd:    return SetBool(left, left.GetValInt() && right.GetValInt());
+    case Opcode::LogOr:     return SetBool(left, left.GetValInt() || right.GetValInt());
+    default:
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::BinaryInt(Opcode op, int left, int right, CBotValue& result)
+{
+    bool res;
+    switch (op)
+    {
+    case Opcode::Add:       result.valInt = left + right;   break;
+    case Opcode::Sub:       result.valInt = left - right;   break;
+    case Opcode::Mul:       result.valInt = left * right;   break;
+    case Opcode::Power:
+        result.valInt = static_cast<int>( pow( static_cast<double>(left) , static_cast<double>(right) ));
+        break;
+    case Opcode::Div:
+        // the result of a division is at least a float
+        return BinaryFloat(op, static_cast<float>(left), static_cast<float>(right), result);
+    case Opcode::Modulo:
+        if (right == 0) return false;               // division by zero
+        result.valInt = left % right;
+        break;
+    case Opcode::And:       result.valInt = left & right;   break;
+    case Opcode::Or:        result.valInt = left | right;   break;
+    case Opcode::XOr:       result.valInt = left ^ right;   break;
+    case Opcode::SL:        result.valInt = left << right;  break;
+    case Opcode::ASR:       result.valInt = left >> right;  break;
+    case Opcode::SR:
+        result.valInt = (right >= 1 ? (left & 0x7fffffff) : left) >> right;
+        break;
+
+    case Opcode::Lo:        res = left <  right;    return SetBool(result, res);
+    case Opcode::Hi:        res = left >  right;    return SetBool(result, res);
+    case Opcode::Ls:        res = left <= right;    return SetBool(result, res);
+    case Opcode::Hs:        res = left >= right;    return SetBool(result, res);
+    case Opcode::Eq:        res = left == right;    return SetBool(result, res);
+    case Opcode::Ne:        res = left != right;    return SetBool(result, res);
+    case Opcode::LogAnd:    res = left && right;    return SetBool(result, res);
+    case Opcode::LogOr:     res = left || right;    return SetBool(result, res);
+
+    default:
+        return false;
+    }
+    result.type = CBotTypInt;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::BinaryFloat(Opcode op, float left, float right, CBotValue& result)
+{
+    bool res;
+    switch (op)
+    {
+    case Opcode::Add:       result.valFloat = left + right;     break;
+    case Opcode::Sub:       result.valFloat = left - right;     break;
+    case Opcode::Mul:       result.valFloat = left * right;     break;
+    case Opcode::Power:     result.valFloat = static_cast<float>(pow( left , right ));  break;
+    case Opcode::Div:
+        if (right == 0) return false;               // division by zero
+        result.valFloat = left / right;
+        break;
+    case Opcode::Modulo:
+        if (right == 0) return false;
+        result.valFloat = static_cast<float>(fmod( left , right ));
+        break;
+
+    case Opcode::Lo:        res = left <  right;    return SetBool(result, res);
+    case Opcode::Hi:        res = left >  right;    return SetBool(result, res);
+    case Opcode::Ls:        res = left <= right;    return SetBool(result, res);
+    case Opcode::Hs:        res = left >= right;    return SetBool(result, res);
+    case Opcode::Eq:        res = left == right;    return SetBool(result, res);
+    case Opcode::Ne:        res = left != right;    return SetBool(result, res);
+    case Opcode::LogAnd:    res = static_cast<int>(left) && static_cast<int>(right);  return SetBool(result, res);
+    case Opcode::LogOr:     res = static_cast<int>(left) || static_cast<int>(right);  return SetBool(result, res);
+
+    default:
+        return false;
+    }
+    result.type = CBotTypFloat;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotBytecode::BinaryBool(Opcode op, int left, int right, CBotValue& result)
+{
+    bool res;
+    switch (op)
+    {
+    case Opcode::Eq:        res = left == right;    break;
+    case Opcode::Ne:        res = left != right;    break;
+    case Opcode::And:
+    case Opcode::LogAnd:    res = left && right;    break;
+    case Opcode::Or:
+    case Opcode::LogOr:     res = left || right;    break;
+    case Opcode::XOr:       res = (left ^ right) != 0;  break;
+    default:
+        return false;
+    }
+    return SetBool(result, res);
+}
+
+} // namespace CBot
@@ -0,0 +1,425 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include "CBot/CBotEnums.h"
+#include "CBot/CBotValue.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace CBot
+{
+
+class CBotInstr;
+class CBotStack;
+class CBotVar;
+
+/**
+ * \brief Register based bytecode for primitive expressions and loops
+ *
+ * Expression trees made only of numeric and boolean literals, reads of local
+ * variables and operators (CBotTwoOpExpr, CBotExprUnaire) are lowered into
+ * a flat list of instructions working on a small register file, so that they
+ * can be evaluated in one loop instead of pushing a CBotStack level per node.
+ *
+ * Such expressions have no side effects and can't be suspended in the middle
+ * (the timer is only checked between statements), so the whole evaluation is
+ * atomic. The timer is still charged with the number of steps the tree walker
+ * would have used. Whenever something unusual happens (a variable that is not
+ * initialized or NAN, a division by zero, a non-primitive variable...), the
+ * evaluation is abandoned and the instruction falls back to the tree walker,
+ * which then reports the error exactly as before.
+ *
+ * Loops (CBotWhile, CBotDo, CBotFor) are lowered as a whole with the statements
+ * in them, see CompileLoop() and CBotInstr::GenerateStatementBytecode(). Blocks,
+ * "if", nested loops, assignments, increments and declarations of primitive
+ * local variables become instructions of the same list, run by Run(). Any other
+ * statement (calls, "break", "switch", strings...) is executed by the tree walker
+ * from the middle of the bytecode, on the level of the block it is in. Each
+ * assignment or declaration is also done again by the tree if its expression
+ * fails, before anything has been changed.
+ *
+ * The bytecode keeps the levels of the blocks on the CBotStack, and is suspended
+ * where the tree walker would be (conditions of loops and "if", declarations,
+ * end of each iteration, and inside the statements executed by the tree). The
+ * position in the bytecode is then stored as a negative state of the level of
+ * the loop, so that SaveState() and RestoreState() work as usual. Step by step,
+ * the statements and conditions are executed by the tree walker, which stops
+ * where it always does, and the next iterations are left to the tree walker. A
+ * loop started step by step is executed by the tree walker until it ends.
+ *
+ * Lowering is enabled with CBotProgram::SetBytecodeEnabled().
+ *
+ * \see CBotInstr::GenerateBytecode()
+ */
+class CBotBytecode
+{
+public:
+    //! Operation codes
+    enum class Opcode : unsigned char
+    {
+        LoadInt,        //!< dst = integer constant
+        LoadFloat,      //!< dst = float constant
+        LoadBool,       //!< dst = boolean constant
+        LoadVar,        //!< dst = value of a local variable
+        Neg,            //!< dst = -dst
+        Not,            //!< dst = ~dst for integers, !dst for booleans
+        Add,            //!< dst = dst + src
+        Sub,            //!< dst = dst - src
+        Mul,            //!< dst = dst * src
+        Div,            //!< dst = dst / src
+        Modulo,         //!< dst = dst % src
+        Power,          //!< dst = dst ** src
+        Lo,             //!< dst = dst < src
+        Hi,             //!< dst = dst > src
+        Ls,             //!< dst = dst <= src
+        Hs,             //!< dst = dst >= src
+        Eq,             //!< dst = dst == src
+        Ne,             //!< dst = dst != src
+        And,            //!< dst = dst & src
+        Or,             //!< dst = dst | src
+        XOr,            //!< dst = dst ^ src
+        LogAnd,         //!< dst = dst && src (both evaluated)
+        LogOr,          //!< dst = dst || src (both evaluated)
+        SL,             //!< dst = dst << src
+        SR,             //!< dst = dst >>> src
+        ASR,            //!< dst = dst >> src
+        JumpIfFalse,    //!< if dst is false, dst = false and jump to target
+        JumpIfTrue,     //!< if dst is true, dst = true and jump to target
+
+        // statements, see CompileLoop()
+        Statement,      //!< start of a statement of a block, up to target (executed by the tree step by step)
+        Expr,           //!< start of an expression, executed by the tree up to target if something fails after it
+        Store,          //!< local variable = dst, of the same type if src
+        Declare,        //!< creates a local variable, = dst if src
+        Exec,           //!< executes a statement with the tree walker
+        Branch,         //!< if register 0 is false, jump to target; the steps are charged if it is true, or always if src
+        Jump,           //!< jump to target
+        Check,          //!< charges the steps, the execution may be suspended after it
+        EndBody,        //!< end of the body of a loop, stops if the memory is used up
+        Loop,           //!< end of an iteration, jump to target (src is the state of the tree walker there)
+        BeginBlock,     //!< adds the level of a block, ended at target
+        EndBlock,       //!< removes the level of the block
+    };
+
+    //! Number of available registers, deeper expressions are not lowered
+    static const int MAX_REGISTERS = 16;
+    //! Number of nested blocks in a loop, deeper loops are not lowered
+    static const int MAX_BLOCKS = 32;
+    //! Number of instructions of a loop, larger loops are not lowered (the position must fit in the state)
+    static const int MAX_CODE = 16384;
+
+    CBotBytecode();
+    ~CBotBytecode();
+
+    /**
+     * \brief Lowers the given expression
+     * \param expr Root of the expression tree
+     * \return New bytecode, or nullptr if the expression can't be lowered
+     */
+    static CBotBytecode* Compile(CBotInstr* expr);
+
+    /**
+     * \brief Lowers the given loop with all the statements in it
+     * \param loop CBotWhile, CBotDo or CBotFor
+     * \return New bytecode, or nullptr if the loop can't be lowered
+     */
+    static CBotBytecode* CompileLoop(CBotInstr* loop);
+
+    /**
+     * \brief Appends an instruction
+     * \param op Operation code
+     * \param dst Destination register
+     * \param src Source register (binary operations only)
+     * \param steps Number of timer steps the tree walker would use for this operation
+     * \return Index of the instruction, or -1 if a register is out of range
+     */
+    int Emit(Opcode op, int dst, int src = 0, int steps = 0);
+
+    /**
+     * \brief Appends an instruction loading an integer constant
+     */
+    int EmitInt(int dst, int val);
+
+    /**
+     * \brief Appends an instruction loading a float constant
+     */
+    int EmitFloat(int dst, float val);
+
+    /**
+     * \brief Appends an instruction loading a boolean constant
+     */
+    int EmitBool(int dst, bool val);
+
+    /**
+     * \brief Appends an instruction reading a local variable
+     * \param dst Destination register
+     * \param ident Unique identifier of the variable, see CBotVar::GetUniqNum()
+     * \param steps Number of timer steps the tree walker would use to read it
+     */
+    int EmitVar(int dst, long ident, int steps);
+
+    /**
+     * \brief Sets the target of a jump to the next instruction that will be emitted
+     * \param index Index of the jump instruction, as returned by Emit()
+     */
+    void PatchJump(int index);
+
+    //! \name Lowering of statements, see CBotInstr::GenerateStatementBytecode()
+    //@{
+
+    /**
+     * \brief Tells if this is the loop given to CompileLoop(), the others are part of it
+     */
+    bool IsRoot(CBotInstr* loop);
+
+    /**
+     * \brief Gives the index of the next instruction that will be emitted
+     */
+    int GetPosition();
+
+    /**
+     * \brief Begins a statement of a block, used to find the variables it declared in RestoreState()
+     * \param instr The statement
+     * \param steps Number of timer steps the tree walker would use before it (never checked)
+     * \return Index to give to EndStatement()
+     */
+    int BeginStatement(CBotInstr* instr, int steps);
+
+    /**
+     * \brief Ends a statement begun with BeginStatement()
+     */
+    void EndStatement(int index);
+
+    /**
+     * \brief Begins a block, which has its own level on the stack
+     * \param instr Instruction of the level (CBotListInstr or CBotFor)
+     * \return Index to give to EndBlock()
+     */
+    int BeginBlock(CBotInstr* instr);
+
+    /**
+     * \brief Ends a block begun with BeginBlock()
+     */
+    void EndBlock(int index);
+
+    /**
+     * \brief Begins a loop, where "break" and "continue" can go
+     * \param label Label of the loop, if any
+     * \return Index to give to SetContinue() and EndLoop()
+     */
+    int BeginLoop(const std::string& label);
+
+    /**
+     * \brief Sets where "continue" goes to the next instruction that will be emitted (the beginning of the loop by default)
+     */
+    void SetContinue(int loop);
+
+    /**
+     * \brief Ends a loop, "break" goes to the next instruction that will be emitted
+     */
+    void EndLoop(int loop);
+
+    /**
+     * \brief Begins an expression that the tree walker does instead if the bytecode fails
+     * \param instr Instruction executed by the tree walker, the whole statement if the bytecode has side effects at its end
+     * \param bResult Whether the result is needed in register 0
+     * \param steps Number of timer steps the tree walker would use for the instruction itself
+     * \return Index to give to EndExpression()
+     */
+    int BeginExpression(CBotInstr* instr, bool bResult, int steps);
+
+    /**
+     * \brief Ends an expression begun with BeginExpression()
+     * \param index Index returned by BeginExpression()
+     * \param ok false if the expression could not be lowered, the tree walker always does it then
+     * \return true if the expression has been lowered
+     */
+    bool EndExpression(int index, bool ok);
+
+    /**
+     * \brief Appends a condition, executed by the tree walker if it can't be lowered
+     * \param expr The condition, its result goes in register 0
+     */
+    void EmitCondition(CBotInstr* expr);
+
+    /**
+     * \brief Appends an instruction storing a register in a local variable of a primitive type
+     * \param reg Register to store
+     * \param ident Unique identifier of the variable, see CBotVar::GetUniqNum()
+     * \param bSameType Whether the value must already have the type of the variable
+     */
+    int EmitStore(int reg, long ident, bool bSameType);
+
+    /**
+     * \brief Appends an instruction declaring a local variable
+     * \param var CBotLeftExprVar of the declaration
+     * \param reg Register holding the initial value
+     * \param bValue false if the variable is not initialized
+     */
+    int EmitDeclare(CBotInstr* var, int reg, bool bValue);
+
+    /**
+     * \brief Appends an instruction executing a statement with the tree walker
+     */
+    int EmitExec(CBotInstr* instr);
+
+    /**
+     * \brief Appends a jump taken if the condition in register 0 is false
+     * \param steps Number of timer steps the tree walker would use for it, the execution may be suspended after them
+     * \param bAlways false if they are only used when the condition is true (loops), true if always (CBotIf)
+     * \return Index to give to PatchJump()
+     */
+    int EmitBranch(int steps, bool bAlways);
+
+    /**
+     * \brief Appends a jump
+     * \return Index to give to PatchJump()
+     */
+    int EmitJump();
+
+    /**
+     * \brief Appends a check of the timer, like a SetState() of the tree walker
+     * \param steps Number of timer steps the tree walker would use for it
+     */
+    int EmitCheck(int steps);
+
+    /**
+     * \brief Appends the end of the body of a loop, which stops if the loop used up the memory
+     */
+    int EmitEndBody();
+
+    /**
+     * \brief Appends the end of an iteration of a loop
+     * \param target Beginning of the next iteration
+     * \param steps Number of timer steps the tree walker would use for it
+     * \param state State of the loop in the tree walker at the beginning of the next iteration,
+     * used to continue the loop given to CompileLoop() with the tree walker step by step
+     */
+    int EmitLoop(int target, int steps, int state);
+
+    //@}
+
+    /**
+     * \brief Evaluates the expression
+     * \param pStack Stack used to find local variables
+     * \param[out] result The result
+     * \param[out] steps Number of timer steps to charge
+     * \return false if the evaluation has been abandoned, the tree walker must be used instead
+     */
+    bool Execute(CBotStack* pStack, CBotValue& result, int& steps);
+
+    /**
+     * \brief Executes the loop, or resumes it
+     * \param pj Stack of the level above the loop
+     * \param pile Level of the loop, its state is the position in the bytecode (negative) if suspended
+     * \return false if interrupted, like CBotInstr::Execute()
+     */
+    bool Run(CBotStack* &pj, CBotStack* pile);
+
+    /**
+     * \brief Restores the levels of the stack used by the loop, after CBotStack::RestoreState()
+     * \param pile Level of the loop, with a negative state
+     */
+    void RestoreState(CBotStack* pile);
+
+    /**
+     * \brief Tells if this code can't ever be used, because a variable it reads is not of a primitive type
+     */
+    bool IsDisabled() { return m_bDisabled.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Applies a unary operation (Neg or Not)
+     * \return false if the operation is not defined for this type
+     */
+    static bool Unary(Opcode op, CBotValue& val);
+    /**
+     * \brief Applies a binary operation, the same way as CBotTwoOpExpr
+     * \param op Operation
+     * \param[in,out] left Left operand, replaced by the result
+     * \param right Right operand
+     * \return false if the operation is not defined for these types, or in case of a division by zero
+     */
+    static bool Binary(Opcode op, CBotValue& left, const CBotValue& right);
+
+    //! \name Binary operations on operands of known types
+    //! Used by Binary(), and directly by CBotTwoOpExpr when the types are known when compiling.
+    //! Operations not defined for the type, and divisions by zero, return false.
+    //@{
+    static bool BinaryInt(Opcode op, int left, int right, CBotValue& result);
+    static bool BinaryFloat(Opcode op, float left, float right, CBotValue& result);
+    static bool BinaryBool(Opcode op, int left, int right, CBotValue& result);
+    //@}
+
+private:
+    struct Instruction;
+
+    //! Evaluates an operation of an expression
+    bool Evaluate(const Instruction& instr, CBotValue* reg, CBotStack* pStack, int& pc);
+    //! Executes a "break" or "continue" left by the tree walker, if it is for one of the loops
+    bool Break(CBotStack** frames, int& depth, int& pc);
+    //! Stores the position in the state of the level of the loop
+    static bool Suspend(CBotStack* pile, int pc, bool bInProgress);
+
+    //! One instruction
+
+    struct Instruction
+    {
+        Opcode          op;
+        unsigned char   dst;
+        unsigned char   src;
+        unsigned char   steps;
+        //! Statement or expression executed by the tree walker
+        CBotInstr*      instr;
+        union
+        {
+            int     valInt;
+            float   valFloat;
+            long    ident;
+            int     target;
+        };
+    };
+
+    //! A loop, for "break" and "continue"
+    struct LoopInfo
+    {
+        std::string label;
+        int         begin;
+        int         end;
+        int         cont;
+        int         depth;
+    };
+
+    std::vector<Instruction> m_code;
+    std::vector<LoopInfo> m_loops;
+    //! Loop given to CompileLoop()
+    CBotInstr* m_root;
+    //! Blocks opened while lowering
+    int m_depth;
+    int m_maxDepth;
+    //! Set by Emit() if the expression needs too many registers
+    bool m_bOverflow;
+    //! Set when a variable turns out not to be of a primitive type, by any of the programs sharing the expression
+    std::atomic<bool> m_bDisabled;
+};
+
+} // namespace CBot
@@ -0,0 +1,158 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#include "CBot/CBotCallCache.h"
+
+#include "CBot/CBotVar/CBotVar.h"
+
+#include <mutex>
+
+namespace CBot
+{
+
+namespace
+{
+std::atomic<long> g_generation{0};
+std::mutex g_storeMutex;
+
+CBotCallArgType GetArgType(CBotVar* var)
+{
+    CBotCallArgType arg;
+    arg.type = var->GetType(CBotVar::GetTypeMode::CLASS_AS_INTRINSIC);
+    arg.pClass = var->GetType() >= CBotTypPointer ? var->GetClass() : nullptr;
+    return arg;
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotCallTarget::Reset(CBotVar** ppVars)
+{
+    *this = CBotCallTarget();
+    generation = CBotCallCache::GetGeneration();
+    signature = CBotCallCache::GetSignature(ppVars);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotCallCache::CBotCallCache()
+{
+    for (int i = 0; i < MAX_ARGS; i++)
+    {
+        m_argTypes[i].store(0, std::memory_order_relaxed);
+        m_argClasses[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotCallCache::Load(CBotVar** ppVars, CBotCallTarget& target) const
+{
+    unsigned sequence = m_sequence.load(std::memory_order_acquire);
+    if ((sequence & 1) != 0) return false;                  // being written
+
+    if (m_generation.load(std::memory_order_relaxed) != GetGeneration()) return false;
+
+    int count = m_argCount.load(std::memory_order_relaxed);
+    if (count < 0) return false;
+    for (int i = 0; i < count; i++)
+    {
+        if (ppVars == nullptr || ppVars[i] == nullptr) return false;
+        CBotCallArgType arg = GetArgType(ppVars[i]);
+        if (arg.type != m_argTypes[i].load(std::memory_order_relaxed) ||
+            arg.pClass != m_argClasses[i].load(std::memory_order_relaxed)) return false;
+    }
+    if (ppVars != nullptr && ppVars[count] != nullptr) return false;
+
+    target.ident            = m_ident.load(std::memory_order_relaxed);
+    target.pClass           = m_pClass.load(std::memory_order_relaxed);
+    target.function         = m_function.load(std::memory_order_relaxed);
+    target.functionClass    = m_functionClass.load(std::memory_order_relaxed);
+    target.method           = m_method.load(std::memory_order_relaxed);
+    target.external         = m_external.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotClass* CBotCallCache::LoadClass() const
+{
+    unsigned sequence = m_sequence.load(std::memory_order_acquire);
+    if ((sequence & 1) != 0) return nullptr;
+
+    bool current = m_argCount.load(std::memory_order_relaxed) >= 0 &&
+                   m_generation.load(std::memory_order_relaxed) == GetGeneration();
+    CBotClass* pClass = m_pClass.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_sequence.load(std::memory_order_relaxed) != sequence) return nullptr;
+    return current ? pClass : nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotCallCache::Store(const CBotCallTarget& found)
+{
+    if (found.signature.size() > MAX_ARGS) return;
+
+    std::lock_guard<std::mutex> lock(g_storeMutex);
+
+    unsigned sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_generation.store(found.generation, std::memory_order_relaxed);
+    m_argCount.store(static_cast<int>(found.signature.size()), std::memory_order_relaxed);
+    for (std::size_t i = 0; i < found.signature.size(); i++)
+    {
+        m_argTypes[i].store(found.signature[i].type, std::memory_order_relaxed);
+        m_argClasses[i].store(found.signature[i].pClass, std::memory_order_relaxed);
+    }
+    m_ident.store(found.ident, std::memory_order_relaxed);
+    m_pClass.store(found.pClass, std::memory_order_relaxed);
+    m_function.store(found.function, std::memory_order_relaxed);
+    m_functionClass.store(found.functionClass, std::memory_order_relaxed);
+    m_method.store(found.method, std::memory_order_relaxed);
+    m_external.store(found.external, std::memory_order_relaxed);
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotCallSignature CBotCallCache::GetSignature(CBotVar** ppVars)
+{
+    CBotCallSignature signature;
+    if (ppVars == nullptr) return signature;
+
+    for (int i = 0; ppVars[i] != nullptr; i++)
+        signature.push_back(GetArgType(ppVars[i]));
+    return signature;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+long CBotCallCache::GetGeneration()
+{
+    return g_generation.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotCallCache::Invalidate()
+{
+    g_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace CBot
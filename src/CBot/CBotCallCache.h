@@ -0,0 +1,171 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+namespace CBot
+{
+
+class CBotClass;
+class CBotCallMethode;
+class CBotExternalCall;
+class CBotFunction;
+class CBotVar;
+
+/**
+ * \brief Type of one argument of a call, as compared by the call caches
+ */
+struct CBotCallArgType
+{
+    //! Type of the argument, CBotVar::GetType() with classes as intrinsic
+    int type;
+    //! Class of the argument if it is a pointer or an instance, nullptr otherwise
+    CBotClass* pClass;
+
+    bool operator==(const CBotCallArgType& other) const
+    {
+        return type == other.type && pClass == other.pClass;
+    }
+
+    bool operator<(const CBotCallArgType& other) const
+    {
+        return type != other.type ? type < other.type : pClass < other.pClass;
+    }
+};
+
+//! Types of all the arguments of a call, see CBotCallCache::GetSignature()
+using CBotCallSignature = std::vector<CBotCallArgType>;
+
+/**
+ * \brief What a call was resolved to
+ *
+ * \see CBotCallCache
+ */
+struct CBotCallTarget
+{
+    //! Value of CBotCallCache::GetGeneration() when the target was found, -1 if there is none
+    long generation = -1;
+    //! Types of the arguments the target was found for
+    CBotCallSignature signature;
+    //! Identifier of the function, as updated by CBotFunction::FindLocalOrPublic()
+    long ident = 0;
+    //! Class the method was looked up in
+    CBotClass* pClass = nullptr;
+    //! Function or method written in CBot
+    CBotFunction* function = nullptr;
+    //! Class owning the method in function
+    CBotClass* functionClass = nullptr;
+    //! Method added with CBotClass::AddFunction()
+    CBotCallMethode* method = nullptr;
+    //! Function added with CBotProgram::AddFunction()
+    CBotExternalCall* external = nullptr;
+
+    /**
+     * \brief Forget the target, and remember the arguments it will be found for
+     * \param ppVars nullptr-terminated list of arguments
+     */
+    void Reset(CBotVar** ppVars);
+};
+
+/**
+ * \brief What a call site resolved its call to
+ *
+ * Finding the target of a call walks the lists of functions and compares
+ * names and signatures. Call sites keep the result here and use it again as
+ * long as the arguments have exactly the same types and no function, method
+ * or class has been created or destroyed since (see Invalidate()).
+ *
+ * Programs with the same source share their instructions (see
+ * CBotProgram::Compile()) and may run on several threads. The fields are
+ * written by Store() under a lock, and read by Load() as a sequence lock:
+ * a read that overlaps a write is discarded, as if nothing was cached.
+ * Calls with more than MAX_ARGS arguments are not cached.
+ *
+ * \see CBotStack::ExecuteCall()
+ * \see CBotClass::ExecuteMethode()
+ */
+class CBotCallCache
+{
+public:
+    //! Maximum number of arguments of a cached call
+    static const int MAX_ARGS = 8;
+
+    CBotCallCache();
+    CBotCallCache(const CBotCallCache&) = delete;
+    CBotCallCache& operator=(const CBotCallCache&) = delete;
+
+    /**
+     * \brief Get the target stored for these arguments
+     * \param ppVars nullptr-terminated list of arguments
+     * \param[out] target Target of the call, without its signature
+     * \return false if there is no current target for these arguments
+     */
+    bool Load(CBotVar** ppVars, CBotCallTarget& target) const;
+
+    /**
+     * \brief Get the class the stored method was looked up in
+     * \return nullptr if there is no current target
+     */
+    CBotClass* LoadClass() const;
+
+    /**
+     * \brief Fill this call site with a target found for it
+     * \param found Target, filled after CBotCallTarget::Reset()
+     */
+    void Store(const CBotCallTarget& found);
+
+    /**
+     * \brief Types (and classes) of the arguments
+     * \param ppVars nullptr-terminated list of arguments
+     */
+    static CBotCallSignature GetSignature(CBotVar** ppVars);
+
+    /**
+     * \brief Current generation of functions, methods and classes
+     */
+    static long GetGeneration();
+
+    /**
+     * \brief Makes all the call sites look up their targets again
+     *
+     * Called when a function, method or class is created or destroyed.
+     */
+    static void Invalidate();
+
+private:
+    //! Odd while Store() is writing the fields
+    std::atomic<unsigned> m_sequence{0};
+    std::atomic<long> m_generation{-1};
+    //! Number of arguments, -1 if there is no target
+    std::atomic<int> m_argCount{-1};
+    std::atomic<int> m_argTypes[MAX_ARGS];
+    std::atomic<CBotClass*> m_argClasses[MAX_ARGS];
+    std::atomic<long> m_ident{0};
+    std::atomic<CBotClass*> m_pClass{nullptr};
+    std::atomic<CBotFunction*> m_function{nullptr};
+    std::atomic<CBotClass*> m_functionClass{nullptr};
+    std::atomic<CBotCallMethode*> m_method{nullptr};
+    std::atomic<CBotExternalCall*> m_external{nullptr};
+};
+
+} // namespace CBot
@@ -19,6 +19,7 @@
 
 #include "CBot/CBotCallMethode.h"
 
+#include "CBot/CBotCallCache.h"
 #include "CBot/CBotUtils.h"
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
@@ -37,11 +38,13 @@ CBotCallMethode::CBotCallMethode(const std::string& name,
     m_name       = name;
     m_rExec      = rExec;
     m_rComp      = rCompile;
+    CBotCallCache::Invalidate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotCallMethode::~CBotCallMethode()
 {
+    CBotCallCache::Invalidate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -71,8 +74,7 @@ CBotTypResult CBotCallMethode::CompileCall(const std::string& name, CBotVar* pTh
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-int CBotCallMethode::DoCall(const std::string& name, CBotVar* pThis, CBotVar** ppVars, CBotVar*& pResult,
-                            CBotStack* pStack, CBotToken* pToken)
+CBotCallMethode* CBotCallMethode::Find(const std::string& name)
 {
     CBotCallMethode*    pt = this;
 
@@ -80,34 +82,53 @@ int CBotCallMethode::DoCall(const std::string& name, CBotVar* pThis, CBotVar** p
 
     while ( pt != nullptr )
     {
-        if ( pt->m_name == name )
-        {
-            // lists the parameters depending on the contents of the stack (pStackVar)
+        if ( pt->m_name == name ) return pt;
+        pt = pt->m_next;
+    }
+    return nullptr;
+}
 
-            CBotVar*    pVar = MakeListVars(ppVars, true);
-            CBotVar*    pVarToDelete = pVar;
+////////////////////////////////////////////////////////////////////////////////
+int CBotCallMethode::DoCall(const std::string& name, CBotVar* pThis, CBotVar** ppVars, CBotVar*& pResult,
+                            CBotStack* pStack, CBotToken* pToken)
+{
+    CBotCallMethode*    pt = Find(name);
+    if ( pt == nullptr ) return -1;
 
-            int         Exception = 0; // TODO: Change this to CBotError
-            int res = pt->m_rExec(pThis, pVar, pResult, Exception, pStack->GetUserPtr());
-            pStack->SetVar(pResult);
+    return pt->Call(pThis, ppVars, pResult, pStack, pToken);
+}
 
-            if (res == false)
-            {
-                if (Exception!=0)
-                {
-//                  pStack->SetError(Exception, pVar->GetToken());
-                    pStack->SetError(static_cast<CBotError>(Exception), pToken);
-                }
-                delete pVarToDelete;
-                return false;
-            }
-            delete pVarToDelete;
-            return true;
-        }
-        pt = pt->m_next;
+////////////////////////////////////////////////////////////////////////////////
+int CBotCallMethode::Call(CBotVar* pThis, CBotVar** ppVars, CBotVar*& pResult, CBotStack* pStack, CBotToken* pToken)
+{
+    // methods of classes defined outside of CBot may touch the game state
+    if (pStack->IfMainThreadOnly())
+    {
+        pStack->SetVar(pResult);
+        return false;
     }
 
-    return -1;
+    // lists the parameters depending on the contents of the stack (pStackVar)
+
+    CBotVar*    pVar = MakeListVars(ppVars, true);
+    CBotVar*    pVarToDelete = pVar;
+
+    int         Exception = 0; // TODO: Change this to CBotError
+    int res = m_rExec(pThis, pVar, pResult, Exception, pStack->GetUserPtr());
+    pStack->SetVar(pResult);
+
+    if (res == false)
+    {
+        if (Exception!=0)
+        {
+//          pStack->SetError(Exception, pVar->GetToken());
+            pStack->SetError(static_cast<CBotError>(Exception), pToken);
+        }
+        delete pVarToDelete;
+        return false;
+    }
+    delete pVarToDelete;
+    return true;
 }
 
 } // namespace CBot
@@ -78,6 +78,24 @@ public:
     int DoCall(const std::string& name, CBotVar* pThis, CBotVar** ppVars, CBotVar*& pResult,
                CBotStack* pStack, CBotToken* pFunc);
 
+    /*!
+     * \brief Find Finds a method by name in this list.
+     * \param name
+     * \return The method, nullptr if there is none.
+     */
+    CBotCallMethode* Find(const std::string& name);
+
+    /*!
+     * \brief Call Calls this method, see DoCall().
+     * \param pThis
+     * \param ppVars
+     * \param pResult
+     * \param pStack
+     * \param pFunc
+     * \return
+     */
+    int Call(CBotVar* pThis, CBotVar** ppVars, CBotVar*& pResult, CBotStack* pStack, CBotToken* pFunc);
+
 private:
     std::string m_name;
     bool (*m_rExec) (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, void* user);
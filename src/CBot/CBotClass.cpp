@@ -35,8 +35,10 @@
 #include "CBot/CBotUtils.h"
 #include "CBot/CBotFileUtils.h"
 #include "CBot/CBotCallMethode.h"
+#include "CBot/CBotCallCache.h"
 
 #include <algorithm>
+#include <functional>
 
 namespace CBot
 {
@@ -58,14 +60,18 @@ CBotClass::CBotClass(const std::string& name,
     m_IsDef     = true;
     m_bIntrinsic= bIntrinsic;
     m_nbVar     = m_parent == nullptr ? 0 : m_parent->m_nbVar;
+    m_inlineCount = m_bIntrinsic && m_parent == nullptr ? 0 : -1;
+    m_methodTableGeneration = -1;
 
     m_publicClasses.insert(this);
+    CBotCallCache::Invalidate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotClass::~CBotClass()
 {
     m_publicClasses.erase(this);
+    CBotCallCache::Invalidate();
 
     delete  m_pVar;
     delete  m_pCalls;
@@ -100,6 +106,7 @@ void CBotClass::Purge()
     m_IsDef     = false;
 
     m_nbVar     = m_parent == nullptr ? 0 : m_parent->m_nbVar;
+    m_inlineCount = m_bIntrinsic && m_parent == nullptr ? 0 : -1;
 
     m_next->Purge();
     m_next = nullptr;          // no longer belongs to this chain
@@ -187,6 +194,14 @@ bool CBotClass::AddItem(CBotVar* pVar)
 {
     pVar->SetUniqNum(++m_nbVar);
 
+    // the value is held inline only with a few primitive members
+    if ( m_inlineCount >= 0 )
+    {
+        int type = pVar->GetType();
+        bool bPrimitive = !pVar->IsStatic() && (type == CBotTypInt || type == CBotTypFloat || type == CBotTypBoolean);
+        m_inlineCount = bPrimitive && m_inlineCount < CBotInlineValue::MAX_FIELDS ? m_inlineCount + 1 : -1;
+    }
+
     if ( m_pVar == nullptr ) m_pVar = pVar;
     else m_pVar->AddNext(pVar);
 
@@ -258,6 +273,12 @@ bool CBotClass::IsIntrinsic()
     return  m_bIntrinsic;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::IsInline()
+{
+    return m_inlineCount > 0 && m_rUpdate == nullptr && m_itemUpdates.empty();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotClass* CBotClass::Find(CBotToken* &pToken)
 {
@@ -312,6 +333,16 @@ bool CBotClass::SetUpdateFunc(void rUpdate(CBotVar* thisVar, void* user))
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::SetUpdateFunc(const std::string& name, void rUpdate(CBotVar* thisVar, CBotVar* item, void* user))
+{
+    CBotVar*    pVar = GetItem(name);
+    if ( pVar == nullptr ) return false;
+
+    m_itemUpdates[pVar->GetUniqNum()] = rUpdate;
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotTypResult CBotClass::CompileMethode(const std::string& name,
                                         CBotVar* pThis,
@@ -335,31 +366,80 @@ CBotTypResult CBotClass::CompileMethode(const std::string& name,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotClass::ExecuteMethode(long& nIdent,
+bool CBotClass::ExecuteMethode(long nIdent,
                                const std::string& name,
                                CBotVar* pThis,
                                CBotVar** ppParams,
                                CBotVar*& pResult,
                                CBotStack*& pStack,
-                               CBotToken* pToken)
+                               CBotToken* pToken,
+                               CBotCallCache* cache)
+{
+    CBotCallTarget      found;
+    const CBotCallTarget* target = &found;
+
+    if ( cache == nullptr || !cache->Load(ppParams, found) || found.pClass != this )
+    {
+        FindMethode(nIdent, name, ppParams, found);
+        if ( cache != nullptr ) cache->Store(found);
+    }
+
+    if ( target->method != nullptr )
+        return target->method->Call(pThis, ppParams, pResult, pStack, pToken);
+
+    if ( target->function != nullptr )
+        return target->function->Call(pThis, ppParams, pStack, pToken, target->functionClass);
+
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotClass::FindMethode(long nIdent, const std::string& name, CBotVar** ppParams, CBotCallTarget& target)
 {
-    int ret = m_pCalls->DoCall(name, pThis, ppParams, pResult, pStack, pToken);
-    if (ret>=0) return ret;
+    target.Reset(ppParams);
+    target.pClass = this;
 
-    ret = m_pMethod->DoCall(nIdent, name, pThis, ppParams, pStack, pToken, this);
-    if (ret >= 0) return ret;
+    std::lock_guard<std::mutex> lock(m_methodTableMutex);
+    if ( m_methodTableGeneration != target.generation )
+    {
+        m_methodTable.clear();
+        m_methodTableGeneration = target.generation;
+    }
 
-    if (m_parent != nullptr)
+    auto key = std::make_tuple(nIdent, name, target.signature);
+    auto it = m_methodTable.find(key);
+    if ( it != m_methodTable.end() )
     {
-        ret = m_parent->m_pCalls->DoCall(name, pThis, ppParams, pResult, pStack, pToken);
-        if (ret >= 0) return ret;
-        ret = m_parent->m_pMethod->DoCall(nIdent, name, pThis, ppParams, pStack, pToken, m_parent);
+        target = it->second;
+        return;
     }
-    return ret;
+
+    // same order as the lists were searched before: methods declared by AddFunction,
+    // methods declared by user, then the same for the parent class
+
+    CBotTypResult   type;
+    target.ident = nIdent;
+    target.method = m_pCalls->Find(name);
+    if ( target.method == nullptr )
+    {
+        target.function = m_pMethod->FindLocalOrPublic(target.ident, name, ppParams, type, false);
+        target.functionClass = this;
+    }
+    if ( target.method == nullptr && target.function == nullptr && m_parent != nullptr )
+    {
+        target.method = m_parent->m_pCalls->Find(name);
+        if ( target.method == nullptr )
+        {
+            target.function = m_parent->m_pMethod->FindLocalOrPublic(target.ident, name, ppParams, type, false);
+            target.functionClass = m_parent;
+        }
+    }
+
+    m_methodTable[key] = target;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotClass::RestoreMethode(long& nIdent,
+void CBotClass::RestoreMethode(long nIdent,
                                const std::string& name,
                                CBotVar* pThis,
                                CBotVar** ppParams,
@@ -369,69 +449,69 @@ void CBotClass::RestoreMethode(long& nIdent,
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotClass::SaveStaticState(FILE* pf)
+bool CBotClass::SaveStaticState(CBotWriter& ostr)
 {
-    if (!WriteWord( pf, CBOTVERSION*2)) return false;
+    if (!WriteWord( ostr, CBOTVERSION*2)) return false;
 
     // saves the state of static variables in classes
     for (CBotClass* p : m_publicClasses)
     {
-        if (!WriteWord( pf, 1 )) return false;
+        if (!WriteWord( ostr, 1 )) return false;
         // save the name of the class
-        if (!WriteString( pf, p->GetName() )) return false;
+        if (!WriteString( ostr, p->GetName() )) return false;
 
         CBotVar*    pv = p->GetVar();
         while( pv != nullptr )
         {
             if ( pv->IsStatic() )
             {
-                if (!WriteWord( pf, 1 )) return false;
-                if (!WriteString( pf, pv->GetName() )) return false;
+                if (!WriteWord( ostr, 1 )) return false;
+                if (!WriteString( ostr, pv->GetName() )) return false;
 
-                if ( !pv->Save0State(pf) ) return false;             // common header
-                if ( !pv->Save1State(pf) ) return false;                // saves as the child class
-                if ( !WriteWord( pf, 0 ) ) return false;
+                if ( !pv->Save0State(ostr) ) return false;             // common header
+                if ( !pv->Save1State(ostr) ) return false;                // saves as the child class
+                if ( !WriteWord( ostr, 0 ) ) return false;
             }
             pv = pv->GetNext();
         }
 
-        if (!WriteWord( pf, 0 )) return false;
+        if (!WriteWord( ostr, 0 )) return false;
     }
 
-    if (!WriteWord( pf, 0 )) return false;
+    if (!WriteWord( ostr, 0 )) return false;
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotClass::RestoreStaticState(FILE* pf)
+bool CBotClass::RestoreStaticState(CBotReader& istr)
 {
     std::string      ClassName, VarName;
     CBotClass*      pClass;
     unsigned short  w;
 
-    if (!ReadWord( pf, w )) return false;
+    if (!ReadWord( istr, w )) return false;
     if ( w != CBOTVERSION*2 ) return false;
 
     while (true)
     {
-        if (!ReadWord( pf, w )) return false;
+        if (!ReadWord( istr, w )) return false;
         if ( w == 0 ) return true;
 
-        if (!ReadString( pf, ClassName )) return false;
+        if (!ReadString( istr, ClassName )) return false;
         pClass = Find(ClassName);
 
         while (true)
         {
-            if (!ReadWord( pf, w )) return false;
+            if (!ReadWord( istr, w )) return false;
             if ( w == 0 ) break;
 
             CBotVar*    pVar = nullptr;
             CBotVar*    pv = nullptr;
 
-            if (!ReadString( pf, VarName )) return false;
+            if (!ReadString( istr, VarName )) return false;
             if ( pClass != nullptr ) pVar = pClass->GetItem(VarName);
 
-            if (!CBotVar::RestoreState(pf, pv)) return false;   // the temp variable
+            if (!CBotVar::RestoreState(istr, pv)) return false;   // the temp variable
 
             if ( pVar != nullptr ) pVar->Copy(pv);
             delete pv;
@@ -500,6 +580,7 @@ CBotClass* CBotClass::Compile1(CBotToken* &p, CBotCStack* pStack)
         CBotClass* classe = (pOld == nullptr) ? new CBotClass(name, pPapa) : pOld;
         classe->Purge();                            // empty the old definitions // TODO: Doesn't this remove all classes of the current program?
         classe->m_IsDef = false;                    // current definition
+        classe->m_bUserDefined = true;
 
         if ( !IsOfType( p, ID_OPBLK) )
         {
@@ -615,7 +696,7 @@ bool CBotClass::CompileDefItem(CBotToken* &p, CBotCStack* pStack, bool bSecond)
                     CBotCStack* pile = pStack->TokenStack(nullptr, true);
 
                     // make "this" known
-                    CBotToken TokenThis(std::string("this"), std::string());
+                    CBotToken TokenThis(std::string("this"));
                     CBotVar* pThis = CBotVar::Create(TokenThis, CBotTypResult( CBotTypClass, this ) );
                     pThis->SetUniqNum(-2);
                     pile->AddVar(pThis);
@@ -623,7 +704,7 @@ bool CBotClass::CompileDefItem(CBotToken* &p, CBotCStack* pStack, bool bSecond)
                     if (m_parent)
                     {
                         // makes "super" known
-                        CBotToken TokenSuper(std::string("super"), std::string());
+                        CBotToken TokenSuper(std::string("super"));
                         CBotVar* pThis = CBotVar::Create(TokenSuper, CBotTypResult(CBotTypClass, m_parent) );
                         pThis->SetUniqNum(-3);
                         pile->AddVar(pThis);
@@ -759,6 +840,7 @@ CBotClass* CBotClass::Compile(CBotToken* &p, CBotCStack* pStack)
                 pOld->m_parent = nullptr;
             }
         }
+        CBotCallCache::Invalidate();    // methods of the parent class may have changed
         IsOfType( p, ID_OPBLK); // necessarily
 
         while ( pStack->IsOk() && !IsOfType( p, ID_CLBLK ) )
@@ -778,4 +860,57 @@ void CBotClass::Update(CBotVar* var, void* user)
     m_rUpdate(var, user);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotClass::UpdateItem(CBotVar* var, CBotVar* item, void* user)
+{
+    auto it = m_itemUpdates.find(item->GetUniqNum());
+    if ( it != m_itemUpdates.end() ) it->second(var, item, user);
+    else if ( m_rUpdate != nullptr ) m_rUpdate(var, user);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::HasUpdateFunc()
+{
+    return m_rUpdate != nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::HasItemUpdateFuncs()
+{
+    return !m_itemUpdates.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::HasDestructor()
+{
+    std::string name = std::string("~") + m_name;
+    for (CBotFunction* pp = m_pMethod; pp != nullptr; pp = pp->Next())
+    {
+        if (pp->GetName() == name) return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotClass::HasUserDefinedClasses()
+{
+    for (CBotClass* p : m_publicClasses)
+    {
+        if (p->m_bUserDefined && p->m_IsDef) return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotClass::GetHash()
+{
+    std::size_t hash = 0;
+    for (CBotClass* p : m_publicClasses)
+    {
+        if (p->m_bUserDefined) continue;
+        hash += std::hash<std::string>()(p->m_name) ^ std::hash<CBotClass*>()(p);   // the set is ordered by address
+    }
+    return hash;
+}
+
 } // namespace CBot
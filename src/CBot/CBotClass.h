@@ -23,9 +23,14 @@
 #include "CBot/CBotTypResult.h"
 #include "CBot/CBotVar/CBotVar.h"
 
+#include "CBot/CBotCallCache.h"
+
 #include <string>
 #include <deque>
+#include <map>
+#include <mutex>
 #include <set>
+#include <tuple>
 
 namespace CBot
 {
@@ -152,6 +157,22 @@ public:
      * \return
      */
     bool SetUpdateFunc(void rUpdate(CBotVar* thisVar, void* user));
+
+    /*!
+     * \brief SetUpdateFunc Defines routine to be called to update one element
+     * of the class.
+     *
+     * Once an element has its own routine, reading a field of an instance
+     * only calls the routine of that field, instead of the one updating all
+     * the elements. Fields without their own routine, and the instance itself
+     * (e.g. passed to a function or converted to a string), still update the
+     * whole instance when they are read.
+     *
+     * \param name Name of the element, added with AddItem()
+     * \param rUpdate Routine updating item, an element of thisVar
+     * \return false if the class has no such element
+     */
+    bool SetUpdateFunc(const std::string& name, void rUpdate(CBotVar* thisVar, CBotVar* item, void* user));
     //
 
     /*!
@@ -249,15 +270,18 @@ public:
      * \param pResult
      * \param pStack
      * \param pToken
+     * \param cache Method found by the previous execution of the call, nullptr
+     * to look it up in the method table of the class.
      * \return
      */
-    bool ExecuteMethode(long& nIdent,
+    bool ExecuteMethode(long nIdent,
                         const std::string& name,
                         CBotVar* pThis,
                         CBotVar** ppParams,
                         CBotVar*& pResult,
                         CBotStack*& pStack,
-                        CBotToken* pToken);
+                        CBotToken* pToken,
+                        CBotCallCache* cache = nullptr);
 
     /*!
      * \brief RestoreMethode Restored the execution stack.
@@ -267,7 +291,7 @@ public:
      * \param ppParams
      * \param pStack
      */
-    void RestoreMethode(long& nIdent,
+    void RestoreMethode(long nIdent,
                         const std::string& name,
                         CBotVar* pThis,
                         CBotVar** ppParams,
@@ -308,6 +332,15 @@ public:
      */
     bool IsIntrinsic();
 
+    /**
+     * \brief Check if the values of this class are held inline, without creating a
+     * CBotVar, when they are copied (see CBotInlineValue)
+     *
+     * Only for an intrinsic class without parent nor update functions, with at most
+     * CBotInlineValue::MAX_FIELDS members which are all int, float or bool.
+     */
+    bool IsInline();
+
     /*!
      * \brief Purge
      */
@@ -320,17 +353,17 @@ public:
 
     /*!
      * \brief SaveStaticState
-     * \param pf
+     * \param ostr
      * \return
      */
-    static bool SaveStaticState(FILE* pf);
+    static bool SaveStaticState(CBotWriter& ostr);
 
     /*!
      * \brief RestoreStaticState
-     * \param pf
+     * \param istr
      * \return
      */
-    static bool RestoreStaticState(FILE* pf);
+    static bool RestoreStaticState(CBotReader& istr);
 
     /**
      * \brief Request a lock on this class (for "synchronized" keyword)
@@ -362,6 +395,42 @@ public:
 
     void Update(CBotVar* var, void* user);
 
+    /*!
+     * \brief UpdateItem Updates one element of an instance, with its own
+     * routine if it has one, or else the whole instance
+     * \param var The instance
+     * \param item The element
+     * \param user User pointer
+     */
+    void UpdateItem(CBotVar* var, CBotVar* item, void* user);
+
+    /**
+     * \brief Check if an update function has been set with SetUpdateFunc()
+     */
+    bool HasUpdateFunc();
+
+    /**
+     * \brief Check if some elements have their own update function, see SetUpdateFunc(const std::string&, ...)
+     */
+    bool HasItemUpdateFuncs();
+
+    /**
+     * \brief Check if the class defines a destructor, which is called when the last reference to an instance is released
+     */
+    bool HasDestructor();
+
+    /**
+     * \brief Check if there is any class defined by a CBot program (as opposed to Create())
+     *
+     * Such classes can share static fields and instances between programs, see CBotProgram::Compile()
+     */
+    static bool HasUserDefinedClasses();
+
+    /**
+     * \brief Hash of the classes not defined by a CBot program, see CBotProgram::Compile()
+     */
+    static std::size_t GetHash();
+
 private:
     //! List of all public classes
     static std::set<CBotClass*> m_publicClasses;
@@ -377,6 +446,10 @@ private:
     int m_nbVar;
     //! Intrinsic class
     bool m_bIntrinsic;
+    //! Number of members of an intrinsic class held inline, -1 if not possible (see IsInline())
+    int m_inlineCount;
+    //! true if defined by a CBot program
+    bool m_bUserDefined = false;
     //! Linked list of all class fields
     CBotVar* m_pVar;
     //! Linked list of all class external calls
@@ -384,11 +457,30 @@ private:
     //! Linked list of all class methods
     CBotFunction* m_pMethod;
     void (*m_rUpdate)(CBotVar* thisVar, void* user);
+    //! Update functions of single elements, by unique identifier of the element
+    std::map<long, void (*)(CBotVar* thisVar, CBotVar* item, void* user)> m_itemUpdates;
 
     //! How many times the program currently holding the lock called Lock()
     int m_lockCurrentCount = 0;
     //! Programs waiting for lock. m_lockProg[0] is the program currently holding the lock, if any
     std::deque<CBotProgram*> m_lockProg{};
+
+    /*!
+     * \brief FindMethode Finds the method called by ExecuteMethode(), in
+     * m_methodTable or else in the lists of this class and its parent.
+     * \param nIdent
+     * \param name
+     * \param ppParams
+     * \param[out] target
+     */
+    void FindMethode(long nIdent, const std::string& name, CBotVar** ppParams, CBotCallTarget& target);
+
+    //! Methods already found by FindMethode(), by identifier, name and signature of the arguments
+    std::map<std::tuple<long, std::string, CBotCallSignature>, CBotCallTarget> m_methodTable;
+    //! CBotCallCache::GetGeneration() when m_methodTable was filled
+    long m_methodTableGeneration;
+    //! Protects m_methodTable, methods of classes defined outside of CBot are called from several threads
+    std::mutex m_methodTableMutex;
 };
 
 } // namespace CBot
@@ -189,4 +189,13 @@ std::string CBotDefParam::GetParamString()
     return param;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotDefParam::ShiftPosition(int delta)
+{
+    for (CBotDefParam* p = this; p != nullptr; p = p->m_next)
+    {
+        p->m_token.SetPos(p->m_token.GetStart() + delta, p->m_token.GetEnd() + delta);
+    }
+}
+
 } // namespace CBot
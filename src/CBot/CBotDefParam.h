@@ -88,6 +88,14 @@ public:
      */
     std::string GetParamString();
 
+    /*!
+     * \brief ShiftPosition Moves the tokens of this parameter and of the
+     * following ones.
+     * \param delta
+     * \see CBotInstr::ShiftPosition
+     */
+    void ShiftPosition(int delta);
+
 private:
     //! Name of the parameter.
     CBotToken m_token;
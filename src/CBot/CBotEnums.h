@@ -253,6 +253,7 @@ enum CBotError : int
     CBotErrNotOpen       = 6013, //!< channel not open
     CBotErrRead          = 6014, //!< error while reading
     CBotErrWrite         = 6015, //!< writing error
+    CBotErrMemory        = 6016, //!< memory limit of the program exceeded
 
     CBotErrMAX, //!< Max errors
 };
@@ -0,0 +1,134 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "CBot/CBotExecutionContext.h"
+
+#include "CBot/CBotStack.h"
+
+#include "CBot/CBotVar/CBotVar.h"
+
+#include <cstdlib>
+
+namespace CBot
+{
+
+const int DEFAULT_TIMER = 100;
+
+int CBotExecutionContext::m_defaultTimer = DEFAULT_TIMER;
+
+namespace
+{
+thread_local CBotExecutionContext* g_currentContext = nullptr;
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+CBotExecutionContext::Scope::Scope(CBotExecutionContext* context)
+{
+    m_previous = g_currentContext;
+    g_currentContext = context;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotExecutionContext::Scope::~Scope()
+{
+    g_currentContext = m_previous;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotExecutionContext::CBotExecutionContext()
+{
+    m_error     = CBotNoErr;
+    m_start     = 0;
+    m_end       = 0;
+    m_retvar    = nullptr;
+    m_retinline.pClass = nullptr;
+    m_initimer  = m_defaultTimer;
+    m_timer     = 0;
+    m_overdraft = 0;
+    m_pUser     = nullptr;
+    m_bParallel = false;
+    m_bYielded  = false;
+    m_bMainThread = false;
+    m_frames    = 0;
+    m_peakFrames = 0;
+    m_steps     = 0;
+    m_usage     = std::make_shared<CBotUsageCounters>();
+    m_memoryLimit = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotExecutionContext::~CBotExecutionContext()
+{
+    delete m_retvar;
+
+    for (CBotStack* block : m_freeBlocks)
+    {
+        free(block);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotExecutionContext* CBotExecutionContext::GetCurrent()
+{
+    if (g_currentContext != nullptr) return g_currentContext;
+
+    // used when nothing is being executed on this thread
+    static thread_local CBotExecutionContext threadContext;
+    return &threadContext;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+long CBotExecutionContext::GetMemoryUsage()
+{
+    return m_usage->bytes.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+long CBotExecutionContext::GetPeakMemoryUsage()
+{
+    return m_usage->peakBytes.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotExecutionContext::FrameAdded()
+{
+    if (++m_frames > m_peakFrames) m_peakFrames = m_frames;
+    m_usage->AddBytes(sizeof(CBotStack));     // counted with the variables, for a single peak
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotExecutionContext::FrameRemoved()
+{
+    m_frames--;
+    m_usage->RemoveBytes(sizeof(CBotStack));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotExecutionContext::SetDefaultTimer(int n)
+{
+    m_defaultTimer = n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotExecutionContext::GetDefaultTimer()
+{
+    return m_defaultTimer;
+}
+
+} // namespace CBot
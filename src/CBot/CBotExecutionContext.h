@@ -0,0 +1,234 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include "CBot/CBotEnums.h"
+#include "CBot/CBotValue.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CBot
+{
+
+class CBotVar;
+class CBotStack;
+
+/**
+ * \brief Class instances and memory of the variables created by the executions in one context
+ *
+ * Each variable keeps a reference to it (see CBotVar::operator new()), so that
+ * variables and instances that outlive their program are still counted when
+ * they are destroyed.
+ */
+struct CBotUsageCounters
+{
+    //! Instances created so far
+    std::atomic<long> created{0};
+    //! Instances not destroyed yet
+    std::atomic<long> live{0};
+    //! Bytes used by the variables and stack levels not destroyed yet
+    std::atomic<long> bytes{0};
+    //! Highest value of bytes so far
+    std::atomic<long> peakBytes{0};
+
+    void AddBytes(long n)
+    {
+        long now = bytes.fetch_add(n, std::memory_order_relaxed) + n;
+        long peak = peakBytes.load(std::memory_order_relaxed);
+        while (now > peak && !peakBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+    }
+
+    void RemoveBytes(long n)
+    {
+        bytes.fetch_sub(n, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * \brief Execution state shared by all levels of one execution stack
+ *
+ * This holds what used to be static members of CBotStack: the current error
+ * and its position, the timer, the pending break label, the value of a pending
+ * return and the user pointer for external calls. Each CBotProgram owns its
+ * own context, so that several programs can be executed at the same time
+ * from different threads.
+ *
+ * Every CBotStack level keeps a pointer to the context it was created in.
+ * Independent stacks allocated during execution (destructors, field
+ * initializers, see CBotStack::AllocateStack()) use the current context of
+ * the thread, which is the one of the program being executed.
+ *
+ * The context also keeps the stack blocks released by CBotStack::Delete(), so
+ * that the next CBotStack::AllocateStack() doesn't need to allocate and clear
+ * a new one.
+ *
+ * \note Compilation still uses static state (see CBotCStack) and must not be
+ * done from several threads at once.
+ */
+class CBotExecutionContext
+{
+public:
+    /**
+     * \brief Makes a context current for the calling thread for the lifetime of this object
+     */
+    class Scope
+    {
+    public:
+        Scope(CBotExecutionContext* context);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        CBotExecutionContext* m_previous;
+    };
+
+    CBotExecutionContext();
+    ~CBotExecutionContext();
+
+    CBotExecutionContext(const CBotExecutionContext&) = delete;
+    CBotExecutionContext& operator=(const CBotExecutionContext&) = delete;
+
+    /**
+     * \brief Returns the context current for the calling thread
+     *
+     * If no context has been made current with Scope, a context private to the thread is returned
+     */
+    static CBotExecutionContext* GetCurrent();
+
+    /**
+     * \brief Get last error
+     * \param[out] start Starting position in code of the error
+     * \param[out] end Ending position in code of the error
+     * \return Error number
+     */
+    CBotError GetError(int& start, int& end) { start = m_start; end = m_end; return m_error; }
+
+    /**
+     * \brief Sets the number of timer ticks that new contexts start with
+     * \see CBotProgram::SetTimer()
+     */
+    static void SetDefaultTimer(int n);
+    /**
+     * \brief Returns the number of timer ticks that new contexts start with
+     */
+    static int GetDefaultTimer();
+
+    /**
+     * \brief Returns the number of stack levels currently used in this context
+     */
+    int GetFrameCount() { return m_frames; }
+    /**
+     * \brief Returns the highest number of stack levels used at once in this context
+     */
+    int GetPeakFrameCount() { return m_peakFrames; }
+    /**
+     * \brief Returns the number of timer ticks used by the executions in this context
+     */
+    long GetStepCount() { return m_steps; }
+    /**
+     * \brief Returns the number of class instances created in this context which still exist
+     *
+     * Instances that are still alive after the program has finished and all
+     * its variables have been released are leaked, usually in a reference cycle.
+     */
+    long GetInstanceCount() { return m_usage->live; }
+    /**
+     * \brief Returns the number of class instances created in this context so far
+     */
+    long GetCreatedInstanceCount() { return m_usage->created; }
+    /**
+     * \brief Returns the counters of the variables created in this context, for CBotVar
+     */
+    const std::shared_ptr<CBotUsageCounters>& GetUsageCounters() { return m_usage; }
+
+    /**
+     * \brief Returns the number of bytes used by the variables created in this context and by its stack levels
+     *
+     * A string buffer shared by several strings counts once, see CBotVarString.
+     */
+    long GetMemoryUsage();
+    /**
+     * \brief Returns the highest value of GetMemoryUsage() so far
+     */
+    long GetPeakMemoryUsage();
+    /**
+     * \brief Sets the memory usage beyond which the execution stops with ::CBotErrMemory
+     * \param bytes Limit in bytes, 0 for no limit
+     */
+    void SetMemoryLimit(long bytes) { m_memoryLimit = bytes; }
+    /**
+     * \brief Returns the limit set with SetMemoryLimit()
+     */
+    long GetMemoryLimit() { return m_memoryLimit; }
+    /**
+     * \brief Check if the memory usage is beyond the limit set with SetMemoryLimit()
+     */
+    bool IsOverMemoryLimit() { return m_memoryLimit > 0 && GetMemoryUsage() > m_memoryLimit; }
+
+private:
+    friend class CBotStack;
+    friend class CBotProgram;
+
+    CBotError       m_error;
+    int             m_start;
+    int             m_end;
+    //! result of a return
+    CBotVar*        m_retvar;
+    //! result of a return if it is the value of a class held inline (instead of m_retvar, if pClass isn't nullptr)
+    CBotInlineValue m_retinline;
+
+    int             m_initimer;
+    int             m_timer;
+    //! Cost of external calls beyond what was left of the timer, paid by the next runs (see CBotStack::ConsumeCost())
+    int             m_overdraft;
+    std::string     m_labelBreak;
+    void*           m_pUser;
+
+    //! true while executed by CBotProgram::RunParallel()
+    bool            m_bParallel;
+    //! true if the execution has been suspended by CBotStack::IfMainThreadOnly()
+    bool            m_bYielded;
+    //! true once the program has to be executed from the main thread, see CBotStack::RunOnMainThread()
+    bool            m_bMainThread;
+
+    //! Stack blocks ready to be used again, see CBotStack::AllocateStack()
+    std::vector<CBotStack*> m_freeBlocks;
+    //! Stack levels in use, see GetFrameCount()
+    int             m_frames;
+    int             m_peakFrames;
+    //! Timer ticks used, see GetStepCount()
+    long            m_steps;
+    //! Class instances and memory of the variables, see GetInstanceCount() and GetMemoryUsage()
+    std::shared_ptr<CBotUsageCounters> m_usage;
+    //! See SetMemoryLimit()
+    long            m_memoryLimit;
+
+    void FrameAdded();
+    void FrameRemoved();
+
+    static int      m_defaultTimer;
+};
+
+} // namespace CBot
@@ -19,6 +19,7 @@
 
 #include "CBot/CBotExternalCall.h"
 
+#include "CBot/CBotCallCache.h"
 #include "CBot/CBotToken.h"
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
@@ -26,6 +27,8 @@
 
 #include "CBot/CBotVar/CBotVar.h"
 
+#include <functional>
+
 namespace CBot
 {
 
@@ -71,17 +74,42 @@ bool CBotExternalCallList::CheckCall(const std::string& name)
     return m_list.count(name) > 0;
 }
 
+std::size_t CBotExternalCallList::GetHash()
+{
+    std::size_t hash = 0;
+    for (const auto& it : m_list)
+    {
+        hash = hash * 1000003 ^ std::hash<std::string>()(it.first);
+        hash = hash * 1000003 ^ std::hash<CBotExternalCall*>()(it.second.get());
+    }
+    return hash;
+}
+
+CBotExternalCall* CBotExternalCallList::Find(const std::string& name)
+{
+    auto it = m_list.find(name);
+    if (it == m_list.end())
+        return nullptr;
+
+    return it->second.get();
+}
+
 int CBotExternalCallList::DoCall(CBotToken* token, CBotVar* thisVar, CBotVar** ppVar, CBotStack* pStack,
                                  const CBotTypResult& rettype)
 {
     if (token == nullptr)
         return -1;
 
-    if (m_list.count(token->GetString()) == 0)
+    CBotExternalCall* pt = Find(token->GetString());
+    if (pt == nullptr)
         return -1;
 
-    CBotExternalCall* pt = m_list[token->GetString()].get();
+    return Call(pt, token, thisVar, ppVar, pStack, rettype);
+}
 
+int CBotExternalCallList::Call(CBotExternalCall* pt, CBotToken* token, CBotVar* thisVar, CBotVar** ppVar,
+                               CBotStack* pStack, const CBotTypResult& rettype)
+{
     if (pStack->IsCallFinished()) return true;
     CBotStack* pile = pStack->AddStackExternalCall(pt);
 
@@ -118,10 +146,32 @@ bool CBotExternalCallList::RestoreCall(CBotToken* token, CBotVar* thisVar, CBotV
 
 CBotExternalCall::CBotExternalCall()
 {
+    CBotCallCache::Invalidate();
 }
 
 CBotExternalCall::~CBotExternalCall()
 {
+    CBotCallCache::Invalidate();
+}
+
+void CBotExternalCall::SetParallelSafe(bool safe)
+{
+    m_parallelSafe = safe;
+}
+
+bool CBotExternalCall::IsParallelSafe()
+{
+    return m_parallelSafe;
+}
+
+void CBotExternalCall::SetCost(int cost)
+{
+    m_cost = cost;
+}
+
+int CBotExternalCall::GetCost()
+{
+    return m_cost;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -144,6 +194,7 @@ CBotTypResult CBotExternalCallDefault::Compile(CBotVar* thisVar, CBotVar* args,
 bool CBotExternalCallDefault::Run(CBotVar* thisVar, CBotStack* pStack)
 {
     if (pStack->IsCallFinished()) return true;
+    if (!m_parallelSafe && pStack->IfMainThreadOnly()) return false; // called again from the main thread
     CBotStack* pile = pStack->AddStackExternalCall(this);
     CBotVar* args = pile->GetVar();
 
@@ -153,6 +204,7 @@ bool CBotExternalCallDefault::Run(CBotVar* thisVar, CBotStack* pStack)
 
     int exception = CBotNoErr; // TODO: Change to CBotError
     bool res = m_rExec(args, result, exception, pStack->GetUserPtr());
+    if (m_cost > 1) pStack->ConsumeCost(m_cost - 1); // the call itself is one step
 
     if (!res)
     {
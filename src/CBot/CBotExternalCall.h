@@ -73,6 +73,37 @@ public:
      * \return false to request program interruption, true otherwise
      */
     virtual bool Run(CBotVar* thisVar, CBotStack* pStack) = 0;
+
+    /**
+     * \brief Declares if the function may be called from any thread, see CBotProgram::RunParallel()
+     *
+     * Such a function must not read or change anything but its arguments and result.
+     * Other functions are only called from the main thread, in a deterministic order.
+     */
+    void SetParallelSafe(bool safe);
+
+    /**
+     * \brief Check if the function may be called from any thread
+     * \see SetParallelSafe()
+     */
+    bool IsParallelSafe();
+
+    /**
+     * \brief Sets the number of timer ticks that one execution of the function costs, see CBotProgram::AddFunction()
+     */
+    void SetCost(int cost);
+
+    /**
+     * \brief Returns the cost of the function
+     * \see SetCost()
+     */
+    int GetCost();
+
+protected:
+    //! Set by SetParallelSafe()
+    bool m_parallelSafe = false;
+    //! Set by SetCost()
+    int m_cost = 1;
 };
 
 /**
@@ -142,6 +173,11 @@ public:
      */
     bool CheckCall(const std::string& name);
 
+    /**
+     * \brief Hash of the names of all the functions, see CBotProgram::Compile()
+     */
+    std::size_t GetHash();
+
     /**
      * \brief Find and call runtime function
      *
@@ -156,6 +192,27 @@ public:
      */
     int DoCall(CBotToken* token, CBotVar* thisVar, CBotVar** ppVars, CBotStack* pStack, const CBotTypResult& rettype);
 
+    /**
+     * \brief Find a function by name
+     * \param name Function name
+     * \return The function, nullptr if it has not been defined
+     */
+    CBotExternalCall* Find(const std::string& name);
+
+    /**
+     * \brief Call a function returned by Find()
+     *
+     * \param pt Function to call
+     * \param token Token representing the function name
+     * \param thisVar "this" variable for class calls, nullptr for normal calls
+     * \param ppVars List of arguments
+     * \param pStack Runtime stack
+     * \param rettype Return type of the function, as returned by CompileCall()
+     * \return 0 if function requested interruption, 1 on success
+     */
+    int Call(CBotExternalCall* pt, CBotToken* token, CBotVar* thisVar, CBotVar** ppVars, CBotStack* pStack,
+             const CBotTypResult& rettype);
+
     /**
      * \brief Restore execution status after loading saved state
      *
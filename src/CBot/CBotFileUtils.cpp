@@ -23,6 +23,9 @@
 #include "CBot/CBotEnums.h"
 #include "CBot/CBotUtils.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace CBot
 {
 
@@ -64,86 +67,284 @@ std::size_t fRead(void *buffer,
 
 
 ////////////////////////////////////////////////////////////////////////////////
-bool ReadWord(FILE* pf, unsigned short& w)
+bool fReadAll(FILE* filehandle, std::string& data)
 {
+    char    buf[4096];
     size_t  lg;
 
-    lg = fread(&w, sizeof( unsigned short ), 1, pf );
+    data.clear();
+    while ((lg = fread(buf, 1, sizeof(buf), filehandle)) > 0)
+    {
+        data.append(buf, lg);
+    }
+    return ferror(filehandle) == 0;
+}
+
+namespace
+{
+//! Identifies data written by CBotWriter, followed by the version
+const char HEADER[4] = {'C', 'B', 'S', 'T'};
+} // namespace
+
+const int CBotWriter::VERSION;
+const int CBotReader::VERSION_LEGACY;
 
-    return (lg == 1);
+////////////////////////////////////////////////////////////////////////////////
+CBotWriter::CBotWriter()
+{
+    Write(HEADER, sizeof(HEADER));
+    WriteWord(*this, VERSION);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool ReadFloat(FILE* pf, float& w)
+void CBotWriter::Write(const void* data, std::size_t size)
 {
-    size_t  lg;
+    m_data.append(static_cast<const char*>(data), size);
+}
 
-    lg = fread(&w, sizeof( float ), 1, pf );
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotWriter::BeginBlock()
+{
+    std::size_t block = m_data.size();
+    WriteInt(*this, 0);     // size, see EndBlock()
+    return block;
+}
 
-    return (lg == 1);
+////////////////////////////////////////////////////////////////////////////////
+void CBotWriter::EndBlock(std::size_t block)
+{
+    unsigned int size = m_data.size() - block - 4;
+    for (int i = 0; i < 4; i++)
+    {
+        m_data[block + i] = static_cast<char>(size >> (8 * i));
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool WriteLong(FILE* pf, long w)
+bool CBotWriter::Flush(FILE* filehandle)
 {
-    size_t  lg;
+    bool ok = fwrite(m_data.data(), 1, m_data.size(), filehandle) == m_data.size();
+    m_data.clear();
+    return ok;
+}
 
-    lg = fwrite(&w, sizeof( long ), 1, pf );
+////////////////////////////////////////////////////////////////////////////////
+CBotReader::CBotReader(const char* data, std::size_t size)
+{
+    m_data = data;
+    m_size = size;
+    m_pos = 0;
+    m_version = VERSION_LEGACY;
 
-    return (lg == 1);
+    unsigned short w;
+    if (size >= sizeof(HEADER) + 2 && std::equal(HEADER, HEADER + sizeof(HEADER), data))
+    {
+        m_pos = sizeof(HEADER);
+        m_version = CBotWriter::VERSION;    // values are read as in the current format
+        ReadWord(*this, w);
+        if (w != CBotWriter::VERSION) m_bFailed = true;    // nothing else can be read
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool ReadLong(FILE* pf, long& w)
+CBotReader::CBotReader() : CBotReader(nullptr, 0)
 {
-    size_t  lg;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotReader::Read(void* data, std::size_t size)
+{
+    const char* p = ReadData(size);
+    if (p == nullptr) return false;
+    std::copy(p, p + size, static_cast<char*>(data));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char* CBotReader::ReadData(std::size_t size)
+{
+    if (m_bFailed || size > m_size - m_pos) return nullptr;
+    const char* p = m_data + m_pos;
+    m_pos += size;
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotReader::ReadBlock(CBotReader& block)
+{
+    int size;
+    if (IsLegacy() || !ReadInt(*this, size)) return false;
+
+    const char* p = ReadData(size);
+    if (p == nullptr) return false;
+
+    block.m_data = p;
+    block.m_size = size;
+    block.m_pos = 0;
+    block.m_version = m_version;
+    block.m_bFailed = false;
+    return true;
+}
+
+namespace
+{
+
+//! Writes the lowest bytes of a value, little endian
+bool WriteBytes(CBotWriter& ostr, unsigned long w, int size)
+{
+    char buf[4];
+    for (int i = 0; i < size; i++)
+    {
+        buf[i] = static_cast<char>(w >> (8 * i));
+    }
+    ostr.Write(buf, size);
+    return true;
+}
+
+//! Reads a little endian value
+bool ReadBytes(CBotReader& istr, unsigned long& w, int size)
+{
+    const char* p = istr.ReadData(size);
+    if (p == nullptr) return false;
 
-    lg = fread(&w, sizeof( long ), 1, pf );
+    w = 0;
+    for (int i = 0; i < size; i++)
+    {
+        w |= static_cast<unsigned long>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return true;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteWord(CBotWriter& ostr, unsigned short w)
+{
+    return WriteBytes(ostr, w, 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReadWord(CBotReader& istr, unsigned short& w)
+{
+    if (istr.IsLegacy()) return istr.Read(&w, sizeof(unsigned short));
+
+    unsigned long  v;
+    if (!ReadBytes(istr, v, 2)) return false;
+    w = static_cast<unsigned short>(v);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteInt(CBotWriter& ostr, int w)
+{
+    return WriteBytes(ostr, static_cast<unsigned int>(w), 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReadInt(CBotReader& istr, int& w)
+{
+    if (istr.IsLegacy()) return istr.Read(&w, sizeof(int));
+
+    unsigned long  v;
+    if (!ReadBytes(istr, v, 4)) return false;
+    w = static_cast<int>(static_cast<unsigned int>(v));
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteLong(CBotWriter& ostr, long w)
+{
+    return WriteInt(ostr, static_cast<int>(w));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReadLong(CBotReader& istr, long& w)
+{
+    if (istr.IsLegacy()) return istr.Read(&w, sizeof(long));
+
+    int     v;
+    if (!ReadInt(istr, v)) return false;
+    w = v;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool WriteFloat(CBotWriter& ostr, float w)
+{
+    static_assert(sizeof(float) == 4, "float must be 32 bit");
+    unsigned int  v;
+    std::memcpy(&v, &w, sizeof(float));
+    return WriteBytes(ostr, v, 4);
+}
 
-    return (lg == 1);
+////////////////////////////////////////////////////////////////////////////////
+bool ReadFloat(CBotReader& istr, float& w)
+{
+    if (istr.IsLegacy()) return istr.Read(&w, sizeof(float));
+
+    unsigned long  v;
+    if (!ReadBytes(istr, v, 4)) return false;
+    unsigned int   u = static_cast<unsigned int>(v);
+    std::memcpy(&w, &u, sizeof(float));
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool ReadString(FILE* pf, std::string& s)
+bool WriteString(CBotWriter& ostr, const std::string& s)
 {
-    unsigned short  w;
-    char    buf[1000];
-    size_t  lg1, lg2;
+    if (!WriteInt(ostr, s.size())) return false;
+    ostr.Write(s.data(), s.size());
+    return true;
+}
 
-    if (!ReadWord(pf, w)) return false;
-    lg1 = w;
-    lg2 = fread(buf, 1, lg1, pf );
-    buf[lg2] = 0;
+////////////////////////////////////////////////////////////////////////////////
+bool ReadString(CBotReader& istr, std::string& s)
+{
+    std::size_t  lg;
+    if (istr.IsLegacy())
+    {
+        unsigned short  w;
+        if (!ReadWord(istr, w)) return false;
+        lg = w;
+    }
+    else
+    {
+        int  n;
+        if (!ReadInt(istr, n) || n < 0) return false;
+        lg = n;
+    }
 
-    s = buf;
-    return (lg1 == lg2);
+    const char* p = istr.ReadData(lg);
+    if (p == nullptr) return false;
+    s.assign(p, lg);
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool WriteType(FILE* pf, const CBotTypResult &type)
+bool WriteType(CBotWriter& ostr, const CBotTypResult &type)
 {
     int typ = type.GetType();
     if ( typ == CBotTypIntrinsic ) typ = CBotTypClass;
-    if ( !WriteWord(pf, typ) ) return false;
+    if ( !WriteWord(ostr, typ) ) return false;
     if ( typ == CBotTypClass )
     {
         CBotClass* p = type.GetClass();
-        if ( !WriteString(pf, p->GetName()) ) return false;
+        if ( !WriteString(ostr, p->GetName()) ) return false;
     }
     if ( type.Eq( CBotTypArrayBody ) ||
          type.Eq( CBotTypArrayPointer ) )
     {
-        if ( !WriteWord(pf, type.GetLimite()) ) return false;
-        if ( !WriteType(pf, type.GetTypElem()) ) return false;
+        if ( !WriteWord(ostr, type.GetLimite()) ) return false;
+        if ( !WriteType(ostr, type.GetTypElem()) ) return false;
     }
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool ReadType(FILE* pf, CBotTypResult &type)
+bool ReadType(CBotReader& istr, CBotTypResult &type)
 {
     unsigned short  w, ww;
-    if ( !ReadWord(pf, w) ) return false;
+    if ( !ReadWord(istr, w) ) return false;
     type.SetType(w);
 
     if ( type.Eq( CBotTypIntrinsic ) )
@@ -154,7 +355,7 @@ bool ReadType(FILE* pf, CBotTypResult &type)
     if ( type.Eq( CBotTypClass ) )
     {
         std::string  s;
-        if ( !ReadString(pf, s) ) return false;
+        if ( !ReadString(istr, s) ) return false;
         type = CBotTypResult( w, s );
     }
 
@@ -162,8 +363,8 @@ bool ReadType(FILE* pf, CBotTypResult &type)
          type.Eq( CBotTypArrayBody ) )
     {
         CBotTypResult   r;
-        if ( !ReadWord(pf, ww) ) return false;
-        if ( !ReadType(pf, r) ) return false;
+        if ( !ReadWord(istr, ww) ) return false;
+        if ( !ReadType(istr, r) ) return false;
         type = CBotTypResult( w, r );
         type.SetLimite(static_cast<short>(ww));
     }
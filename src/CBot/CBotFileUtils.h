@@ -72,84 +72,238 @@ std::size_t fRead(void *buffer,
                   std::size_t length,
                   FILE* filehandle);
 
+/*!
+ * \brief Reads the whole content of a file
+ * \param filehandle File to read
+ * \param[out] data Content of the file
+ * \return false on read error
+ */
+bool fReadAll(FILE* filehandle, std::string& data);
+
+/**
+ * \brief Buffered writer of saved execution states
+ *
+ * Everything is written to memory and goes to the file at once with Flush().
+ * The data starts with a header identifying the format and its version (see
+ * CBotReader). Values have a fixed size and are little endian, strings are
+ * prefixed with their length.
+ *
+ * Parts that can be skipped when they can't be restored (like the state of one
+ * program among others) are written between BeginBlock() and EndBlock(), which
+ * prefixes them with their size.
+ */
+class CBotWriter
+{
+public:
+    //! Version of the format written
+    static const int VERSION = 2;
+
+    CBotWriter();
+
+    /**
+     * \brief Appends raw bytes
+     */
+    void Write(const void* data, std::size_t size);
+
+    /**
+     * \brief Starts a length-prefixed block
+     * \return Position of the block, to give to EndBlock()
+     */
+    std::size_t BeginBlock();
+    /**
+     * \brief Ends a block started with BeginBlock()
+     */
+    void EndBlock(std::size_t block);
+
+    /**
+     * \brief Returns everything written so far
+     */
+    const std::string& GetData() const { return m_data; }
+
+    /**
+     * \brief Writes everything to a file
+     * \return false on write error
+     */
+    bool Flush(FILE* filehandle);
+
+private:
+    std::string m_data;
+};
+
+/**
+ * \brief Reader of saved execution states
+ *
+ * The reader doesn't copy the data, which must be kept alive while it is used.
+ *
+ * Data written by CBotWriter is recognized by its header. Anything else is
+ * read as the layout written directly to files with fWrite() before version
+ * 2 (version 1), where values had the size of the native types and there
+ * were no blocks, so that old saved games can still be loaded.
+ */
+class CBotReader
+{
+public:
+    //! Version of the layout written before CBotWriter
+    static const int VERSION_LEGACY = 1;
+
+    /**
+     * \brief Constructor, reads the header if present
+     *
+     * If the header has another version than CBotWriter::VERSION, nothing can be read, see IsFailed().
+     */
+    CBotReader(const char* data, std::size_t size);
+    CBotReader();
+
+    /**
+     * \brief Copies raw bytes
+     * \return false if there aren't enough bytes left
+     */
+    bool Read(void* data, std::size_t size);
+    /**
+     * \brief Returns a pointer to the next bytes in the data, and skips them
+     * \return nullptr if there aren't enough bytes left
+     */
+    const char* ReadData(std::size_t size);
+
+    /**
+     * \brief Reads a block written between CBotWriter::BeginBlock() and CBotWriter::EndBlock()
+     *
+     * This reader continues after the block, whatever is read from the block.
+     *
+     * \param[out] block Reader for the content of the block
+     * \return false if there is no complete block
+     */
+    bool ReadBlock(CBotReader& block);
+
+    /**
+     * \brief Returns the version of the format, VERSION_LEGACY or CBotWriter::VERSION
+     */
+    int GetVersion() const { return m_version; }
+    /**
+     * \brief Returns true if the data has the layout written before CBotWriter
+     */
+    bool IsLegacy() const { return m_version == VERSION_LEGACY; }
+
+    /**
+     * \brief Returns true if all the data has been read
+     */
+    bool IsEnd() const { return m_pos == m_size; }
+
+    /**
+     * \brief Returns true if the header has an unknown version, so that all reads fail
+     */
+    bool IsFailed() const { return m_bFailed; }
+
+private:
+    const char*     m_data;
+    std::size_t     m_size;
+    std::size_t     m_pos;
+    int             m_version;
+    bool            m_bFailed = false;
+};
+
 /*!
  * \brief SaveVars
- * \param pf
+ * \param ostr
  * \param pVar
  * \return
  */
-bool SaveVars(FILE* pf, CBotVar* pVar);
+bool SaveVars(CBotWriter& ostr, CBotVar* pVar);
 
 /*!
  * \brief WriteWord
- * \param pf
+ * \param ostr
  * \param w
  * \return
  */
-bool WriteWord(FILE* pf, unsigned short w);
+bool WriteWord(CBotWriter& ostr, unsigned short w);
 
 /*!
  * \brief ReadWord
- * \param pf
+ * \param istr
  * \param w
  * \return
  */
-bool ReadWord(FILE* pf, unsigned short& w);
+bool ReadWord(CBotReader& istr, unsigned short& w);
 
 /*!
- * \brief ReadLong
- * \param pf
+ * \brief WriteInt Writes a 32 bit integer
+ * \param ostr
  * \param w
  * \return
  */
-bool ReadLong(FILE* pf, long& w);
+bool WriteInt(CBotWriter& ostr, int w);
 
 /*!
- * \brief WriteFloat
- * \param pf
+ * \brief ReadInt Reads a 32 bit integer
+ * \param istr
  * \param w
  * \return
  */
-bool WriteFloat(FILE* pf, float w);
+bool ReadInt(CBotReader& istr, int& w);
 
 /*!
- * \brief WriteLong
- * \param pf
+ * \brief WriteLong Writes a long, always stored in 32 bits
+ * \param ostr
  * \param w
  * \return
  */
-bool WriteLong(FILE* pf, long w);
+bool WriteLong(CBotWriter& ostr, long w);
+
+/*!
+ * \brief ReadLong Reads a long, with the size of the native long in the legacy layout
+ * \param istr
+ * \param w
+ * \return
+ */
+bool ReadLong(CBotReader& istr, long& w);
+
+/*!
+ * \brief WriteFloat
+ * \param ostr
+ * \param w
+ * \return
+ */
+bool WriteFloat(CBotWriter& ostr, float w);
 
 /*!
  * \brief ReadFloat
- * \param pf
+ * \param istr
  * \param w
  * \return
  */
-bool ReadFloat(FILE* pf, float& w);
+bool ReadFloat(CBotReader& istr, float& w);
+
+/*!
+ * \brief WriteString
+ * \param ostr
+ * \param s
+ * \return
+ */
+bool WriteString(CBotWriter& ostr, const std::string& s);
 
 /*!
  * \brief ReadString
- * \param pf
+ * \param istr
  * \param s
  * \return
  */
-bool ReadString(FILE* pf, std::string& s);
+bool ReadString(CBotReader& istr, std::string& s);
 
 /*!
  * \brief WriteType
- * \param pf
+ * \param ostr
  * \param type
  * \return
  */
-bool WriteType(FILE* pf, const CBotTypResult &type);
+bool WriteType(CBotWriter& ostr, const CBotTypResult &type);
 
 /*!
  * \brief ReadType
- * \param pf
+ * \param istr
  * \param type
  * \return
  */
-bool ReadType(FILE* pf, CBotTypResult &type);
+bool ReadType(CBotReader& istr, CBotTypResult &type);
 
 } // namespace CBot
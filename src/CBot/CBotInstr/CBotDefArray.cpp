@@ -163,10 +163,12 @@ bool CBotDefArray::Execute(CBotStack* &pj)
         }
         while (n<100) max[n++] = 0;
 
-        m_typevar.SetArray(max);                                    // store the limitations
+        // store the limitations in a copy, the instruction may be shared by several programs
+        CBotTypResult type = m_typevar;
+        type.SetArray(max);
 
         // create simply a nullptr pointer
-        CBotVar*    var = CBotVar::Create(*(m_var->GetToken()), m_typevar);
+        CBotVar*    var = CBotVar::Create(*(m_var->GetToken()), type);
         var->SetPointer(nullptr);
         var->SetUniqNum((static_cast<CBotLeftExprVar*>(m_var))->m_nIdent);
         pj->AddVar(var);
@@ -25,6 +25,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -173,6 +174,21 @@ void CBotDefBoolean::RestoreState(CBotStack* &pj, bool bMain)
          m_next2b->RestoreState(pile, bMain);                // other(s) definition(s)
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotDefBoolean::GenerateStatementBytecode(CBotBytecode& code)
+{
+    if (m_next2b != nullptr)
+    {
+        CBotInstr::GenerateStatementBytecode(code);     // several definitions are done by the tree
+        return;
+    }
+
+    int start = code.BeginExpression(this, false, 0);
+    bool ok = m_expr == nullptr || m_expr->GenerateBytecode(code, 0);
+    code.EmitDeclare(m_var, 0, m_expr != nullptr);
+    if (code.EndExpression(start, ok) && m_expr != nullptr) m_expr->DropBytecode();
+}
+
 std::map<std::string, CBotInstr*> CBotDefBoolean::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
@@ -78,7 +78,7 @@ CBotInstr* CBotDefClass::Compile(CBotToken* &p, CBotCStack* pStack, CBotClass* p
 
     inst = new CBotDefClass();
     /// TODO Need to be revised and fixed after adding unit tests
-    CBotToken token(pClass->GetName(), std::string(), p->GetStart(), p->GetEnd());
+    CBotToken token(pClass->GetName(), p->GetStart(), p->GetEnd());
     inst->SetToken(&token);
     CBotToken*  vartoken = p;
 
@@ -238,6 +238,9 @@ bool CBotDefClass::Execute(CBotStack* &pj)
 
     if ( pile->GetState()==0)
     {
+        // the destructor is executed without interruption wherever the instance is released
+        if ( pClass->HasDestructor() && !pile->RunOnMainThread() ) return false;
+
         std::string  name = m_var->m_token.GetString();
         if ( bIntrincic )
         {
@@ -266,7 +269,12 @@ bool CBotDefClass::Execute(CBotStack* &pj)
             // evaluates the expression for the assignment
             if (!m_expr->Execute(pile)) return false;
 
-            if ( bIntrincic )
+            CBotInlineValue inlineValue;
+            if ( bIntrincic && pile->GetInlineValue(inlineValue) && pThis->SetInlineValue(inlineValue) )
+            {
+                // value of the same class held inline, copied in place
+            }
+            else if ( bIntrincic )
             {
                 CBotVar*    pv = pile->GetVar();
                 if ( pv == nullptr || pv->GetPointer() == nullptr )
@@ -333,7 +341,7 @@ bool CBotDefClass::Execute(CBotStack* &pj)
 
             if ( !pClass->ExecuteMethode(m_nMethodeIdent, pClass->GetName(),
                                          pThis, ppVars,
-                                         pResult, pile2, GetToken())) return false; // interrupt
+                                         pResult, pile2, GetToken(), &m_cache)) return false; // interrupt
 
             pThis->SetInit(CBotVar::InitType::DEF);
             pThis->ConstructorSet();        // indicates that the constructor has been called
@@ -21,6 +21,8 @@
 
 #include "CBot/CBotInstr/CBotInstr.h"
 
+#include "CBot/CBotCallCache.h"
+
 namespace CBot
 {
 
@@ -84,6 +86,8 @@ private:
     bool m_hasParams;
     //! Constructor method unique identifier
     long m_nMethodeIdent;
+    //! Constructor called the last time
+    CBotCallCache m_cache;
 
 };
 
@@ -25,6 +25,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -185,6 +186,21 @@ void CBotDefInt::RestoreState(CBotStack* &pj, bool bMain)
     if (m_next2b) m_next2b->RestoreState(pile, bMain);            // other(s) definition(s)
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotDefInt::GenerateStatementBytecode(CBotBytecode& code)
+{
+    if (m_next2b != nullptr)
+    {
+        CBotInstr::GenerateStatementBytecode(code);     // several definitions are done by the tree
+        return;
+    }
+
+    int start = code.BeginExpression(this, false, 0);
+    bool ok = m_expr == nullptr || m_expr->GenerateBytecode(code, 0);
+    code.EmitDeclare(m_var, 0, m_expr != nullptr);
+    if (code.EndExpression(start, ok) && m_expr != nullptr) m_expr->DropBytecode();
+}
+
 std::map<std::string, CBotInstr*> CBotDefInt::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
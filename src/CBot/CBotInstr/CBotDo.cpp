@@ -23,6 +23,8 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotProgram.h"
+#include "CBot/CBotBytecode.h"
 
 namespace CBot
 {
@@ -32,6 +34,7 @@ CBotDo::CBotDo()
 {
     m_condition = nullptr;
     m_block = nullptr;
+    m_bytecode = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -39,6 +42,7 @@ CBotDo::~CBotDo()
 {
     delete m_condition;    // frees the condition
     delete m_block;        // frees the instruction block
+    delete m_bytecode;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -74,6 +78,10 @@ CBotInstr* CBotDo::Compile(CBotToken* &p, CBotCStack* pStack)
                 // the condition exists
                 if (IsOfType(p, ID_SEP))
                 {
+                    // lowers the whole loop with the statements in it, see CBotBytecode::Run()
+                    CBotProgram* prog = pStack->GetProgram();
+                    if ( prog != nullptr && prog->IsBytecodeEnabled() ) inst->m_bytecode = CBotBytecode::CompileLoop(inst);
+
                     return pStack->Return(inst, pStk);  // return an object to the application
                 }
                 pStk->SetError(CBotErrNoTerminator, p->GetStart());
@@ -95,6 +103,10 @@ bool CBotDo :: Execute(CBotStack* &pj)
 
     if ( pile->IfStep() ) return false;
 
+    // executes the whole loop as bytecode, unless it has been started step by step
+    if ( m_bytecode != nullptr && (pile->GetState() < 0 || pile->IsFresh()) )
+        return m_bytecode->Run(pj, pile);
+
     while( true ) switch( pile->GetState() )            // executes the loop
     {                                                   // there are two possible states (depending on recovery)
     case 0:
@@ -106,8 +118,8 @@ bool CBotDo :: Execute(CBotStack* &pj)
             return pj->BreakReturn(pile, m_label);      // sends the results and releases the stack
         }
 
-        // terminates if there is an error
-        if ( !pile->IsOk() )
+        // terminates if there is an error, or if the loop used up the memory
+        if ( !pile->IsOk() || pile->MemoryOver() )
         {
             return pj->Return(pile);                    // sends the results and releases the stack
         }
@@ -140,6 +152,12 @@ void CBotDo :: RestoreState(CBotStack* &pj, bool bMain)
     CBotStack* pile = pj->RestoreStack(this);           // adds an item to the stack
     if ( pile == nullptr ) return;
 
+    if ( pile->GetState() < 0 )                 // suspended in the bytecode
+    {
+        if ( m_bytecode != nullptr ) m_bytecode->RestoreState(pile);
+        return;
+    }
+
     switch( pile->GetState() )
     {                                                   // there are two possible states (depending on recovery)
     case 0:
@@ -154,6 +172,28 @@ void CBotDo :: RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotDo::GenerateStatementBytecode(CBotBytecode& code)
+{
+    if (!code.IsRoot(this))
+    {
+        delete m_bytecode;                      // lowered with the loop around it
+        m_bytecode = nullptr;
+    }
+
+    int loop = code.BeginLoop(m_label);
+    int start = code.GetPosition();
+    if (m_block != nullptr) m_block->GenerateStatementBytecode(code);
+    code.EmitEndBody();
+    code.EmitCheck(1);                          // SetState(1)
+    code.SetContinue(loop);                     // "continue" goes to the test
+    code.EmitCondition(m_condition);
+    int exit = code.EmitBranch(0, false);
+    code.EmitLoop(start, 1, 0);                 // SetState(0, 0)
+    code.PatchJump(exit);
+    code.EndLoop(loop);
+}
+
 std::string CBotDo::GetDebugData()
 {
     return !m_label.empty() ? "m_label = "+m_label : "";
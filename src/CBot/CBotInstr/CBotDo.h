@@ -55,6 +55,12 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateStatementBytecode
+     * \param code
+     */
+    void GenerateStatementBytecode(CBotBytecode& code) override;
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotDo"; }
     virtual std::string GetDebugData() override;
@@ -67,6 +73,8 @@ private:
     CBotInstr* m_condition;
     //! A label if there is
     std::string m_label;
+    //! Whole loop lowered to bytecode, if possible
+    CBotBytecode* m_bytecode;
 };
 
 } // namespace CBot
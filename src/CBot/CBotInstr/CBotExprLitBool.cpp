@@ -21,6 +21,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -30,6 +31,7 @@ namespace CBot
 ////////////////////////////////////////////////////////////////////////////////
 CBotExprLitBool::CBotExprLitBool()
 {
+    m_value = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -48,6 +50,7 @@ CBotInstr* CBotExprLitBool::Compile(CBotToken* &p, CBotCStack* pStack)
     {
         inst = new CBotExprLitBool();
         inst->SetToken(p);  // stores the operation false or true
+        inst->m_value = p->GetType() == ID_TRUE;
         p = p->GetNext();
 
         CBotVar*    var = CBotVar::Create("", CBotTypBoolean);
@@ -57,6 +60,15 @@ CBotInstr* CBotExprLitBool::Compile(CBotToken* &p, CBotCStack* pStack)
     return pStack->Return(inst, pStk);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+CBotInstr* CBotExprLitBool::Create(const CBotToken& token, bool value)
+{
+    CBotExprLitBool* inst = new CBotExprLitBool();
+    inst->m_token = token;
+    inst->m_value = value;
+    return inst;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotExprLitBool::Execute(CBotStack* &pj)
 {
@@ -64,12 +76,11 @@ bool CBotExprLitBool::Execute(CBotStack* &pj)
 
     if (pile->IfStep()) return false;
 
-    CBotVar*    var = CBotVar::Create("", CBotTypBoolean);
+    CBotValue   value;
+    value.type = CBotTypBoolean;
+    value.valInt = m_value ? 1 : 0;
 
-    if (GetTokenType() == ID_TRUE)      var->SetValInt(1);
-    else                              var->SetValInt(0);
-
-    pile->SetVar(var);  // put on the stack
+    pile->SetValue(value);  // put on the stack
     return pj->Return(pile);    // forwards below
 }
 
@@ -79,4 +90,19 @@ void CBotExprLitBool::RestoreState(CBotStack* &pj, bool bMain)
     if (bMain) pj->RestoreStack(this);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprLitBool::GenerateBytecode(CBotBytecode& code, int reg)
+{
+    code.EmitBool(reg, m_value);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprLitBool::GetConstant(CBotValue& value)
+{
+    value.type = CBotTypBoolean;
+    value.valInt = m_value ? 1 : 0;
+    return true;
+}
+
 } // namespace CBot
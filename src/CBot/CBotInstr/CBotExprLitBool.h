@@ -41,6 +41,15 @@ public:
      */
     static CBotInstr* Compile(CBotToken* &p, CBotCStack* pStack);
 
+    /*!
+     * \brief Create Creates the literal replacing an expression computed
+     * while compiling.
+     * \param token Token of the expression
+     * \param value
+     * \return
+     */
+    static CBotInstr* Create(const CBotToken& token, bool value);
+
     /*!
      * \brief Execute Executes, returns true or false.
      * \param pj
@@ -55,8 +64,24 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateBytecode
+     * \param code
+     * \param reg
+     * \return
+     */
+    bool GenerateBytecode(CBotBytecode& code, int reg) override;
+
+    bool GetConstant(CBotValue& value) override;
+
+    bool HasEffect() override { return false; }
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotExprLitBool"; }
+
+private:
+    //! The value, true or false.
+    bool m_value;
 };
 
 } // namespace CBot
@@ -19,6 +19,7 @@
 
 #include "CBot/CBotInstr/CBotExprLitNum.h"
 #include "CBot/CBotStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotCStack.h"
 #include "CBot/CBotVar/CBotVar.h"
@@ -79,6 +80,17 @@ CBotInstr* CBotExprLitNum::Compile(CBotToken* &p, CBotCStack* pStack)
     return pStack->Return(nullptr, pStk);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+CBotInstr* CBotExprLitNum::Create(const CBotToken& token, const CBotValue& value)
+{
+    CBotExprLitNum* inst = new CBotExprLitNum();
+    inst->m_token = token;
+    inst->m_numtype = value.type;
+    if (value.type == CBotTypFloat) inst->m_valfloat = value.valFloat;
+    else                            inst->m_valint = value.valInt;
+    return inst;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotExprLitNum::Execute(CBotStack* &pj)
 {
@@ -86,6 +98,16 @@ bool CBotExprLitNum::Execute(CBotStack* &pj)
 
     if (pile->IfStep()) return false;
 
+    if (m_token.GetType() != TokenTypDef)       // keeps the name of constants in a variable
+    {
+        CBotValue   value;
+        value.type = m_numtype;
+        if (m_numtype == CBotTypFloat) value.valFloat = m_valfloat;
+        else                           value.valInt = m_valint;
+        pile->SetValue(value);                  // place on the stack
+        return pj->Return(pile);
+    }
+
     CBotVar*    var = CBotVar::Create("", m_numtype);
 
     std::string    nombre ;
@@ -117,6 +139,31 @@ void CBotExprLitNum::RestoreState(CBotStack* &pj, bool bMain)
     if (bMain) pj->RestoreStack(this);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprLitNum::GenerateBytecode(CBotBytecode& code, int reg)
+{
+    switch (m_numtype)
+    {
+    case CBotTypInt:
+        code.EmitInt(reg, m_valint);
+        return true;
+    case CBotTypFloat:
+        code.EmitFloat(reg, m_valfloat);
+        return true;
+    default:
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprLitNum::GetConstant(CBotValue& value)
+{
+    value.type = m_numtype;
+    if (m_numtype == CBotTypFloat) value.valFloat = m_valfloat;
+    else                           value.valInt = m_valint;
+    return m_numtype == CBotTypInt || m_numtype == CBotTypFloat;
+}
+
 std::string CBotExprLitNum::GetDebugData()
 {
     std::stringstream ss;
@@ -44,6 +44,15 @@ public:
      */
     static CBotInstr* Compile(CBotToken* &p, CBotCStack* pStack);
 
+    /*!
+     * \brief Create Creates the literal replacing an expression computed
+     * while compiling.
+     * \param token Token of the expression
+     * \param value Value of type ::CBotTypInt or ::CBotTypFloat
+     * \return
+     */
+    static CBotInstr* Create(const CBotToken& token, const CBotValue& value);
+
     /*!
      * \brief Execute Execute, returns the corresponding number.
      * \param pj
@@ -58,6 +67,18 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateBytecode
+     * \param code
+     * \param reg
+     * \return
+     */
+    bool GenerateBytecode(CBotBytecode& code, int reg) override;
+
+    bool GetConstant(CBotValue& value) override;
+
+    bool HasEffect() override { return false; }
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotExprLitNum"; }
     virtual std::string GetDebugData() override;
@@ -19,9 +19,12 @@
 
 #include "CBot/CBotInstr/CBotExprUnaire.h"
 #include "CBot/CBotInstr/CBotParExpr.h"
+#include "CBot/CBotInstr/CBotExprLitBool.h"
+#include "CBot/CBotInstr/CBotExprLitNum.h"
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -55,15 +58,15 @@ CBotInstr* CBotExprUnaire::Compile(CBotToken* &p, CBotCStack* pStack)
     if (nullptr != (inst->m_expr = CBotParExpr::Compile(p, pStk )))
     {
         if (op == ID_ADD && pStk->GetType() < CBotTypBoolean)        // only with the number
-            return pStack->Return(inst, pStk);
+            return pStack->Return(Fold(inst, pStk), pStk);
         if (op == ID_SUB && pStk->GetType() < CBotTypBoolean)        // only with the numer
-            return pStack->Return(inst, pStk);
+            return pStack->Return(Fold(inst, pStk), pStk);
         if (op == ID_NOT && pStk->GetType() < CBotTypFloat)        // only with an integer
-            return pStack->Return(inst, pStk);
+            return pStack->Return(Fold(inst, pStk), pStk);
         if (op == ID_LOG_NOT && pStk->GetTypResult().Eq(CBotTypBoolean))// only with boolean
-            return pStack->Return(inst, pStk);
+            return pStack->Return(Fold(inst, pStk), pStk);
         if (op == ID_TXT_NOT && pStk->GetTypResult().Eq(CBotTypBoolean))// only with boolean
-            return pStack->Return(inst, pStk);
+            return pStack->Return(Fold(inst, pStk), pStk);
 
         pStk->SetError(CBotErrBadType1, &inst->m_token);
     }
@@ -71,6 +74,37 @@ CBotInstr* CBotExprUnaire::Compile(CBotToken* &p, CBotCStack* pStack)
     return pStack->Return(nullptr, pStk);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+CBotInstr* CBotExprUnaire::Fold(CBotExprUnaire* inst, CBotCStack* pStack)
+{
+    CBotProgram* prog = pStack->GetProgram();
+    if ( prog == nullptr || !prog->IsOptimizeEnabled() ) return inst;
+
+    CBotValue   value;
+    if ( !inst->m_expr->GetConstant(value) ) return inst;
+
+    switch (inst->GetTokenType())
+    {
+    case ID_SUB:
+        if (!CBotBytecode::Unary(CBotBytecode::Opcode::Neg, value)) return inst;
+        break;
+    case ID_NOT:
+    case ID_LOG_NOT:
+    case ID_TXT_NOT:
+        if (!CBotBytecode::Unary(CBotBytecode::Opcode::Not, value)) return inst;
+        break;
+    }
+
+    // the literal covers the whole expression
+    CBotToken   token(inst->m_token);
+    token.SetPos(inst->m_token.GetStart(), inst->m_expr->GetToken()->GetEnd());
+
+    CBotInstr*  literal = value.type == CBotTypBoolean ? CBotExprLitBool::Create(token, value.valInt != 0) :
+                                                         CBotExprLitNum::Create(token, value);
+    delete inst;
+    return literal;
+}
+
 // executes unary expression
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotExprUnaire::Execute(CBotStack* &pj)
@@ -86,6 +120,29 @@ bool CBotExprUnaire::Execute(CBotStack* &pj)
     CBotStack* pile2 = pile->AddStack();
     if (pile2->IfStep()) return false;
 
+    // primitive values are changed without creating a variable
+    CBotValue   value;
+    if (pile->GetValue(value))
+    {
+        bool ok = true;
+        switch (GetTokenType())
+        {
+        case ID_SUB:
+            ok = CBotBytecode::Unary(CBotBytecode::Opcode::Neg, value);
+            break;
+        case ID_NOT:
+        case ID_LOG_NOT:
+        case ID_TXT_NOT:
+            ok = CBotBytecode::Unary(CBotBytecode::Opcode::Not, value);
+            break;
+        }
+        if (ok)
+        {
+            pile->SetValue(value);
+            return pj->Return(pile);                                // forwards below
+        }
+    }
+
     CBotVar*    var = pile->GetVar();                                // get the result on the stack
 
     switch (GetTokenType())
@@ -119,6 +176,38 @@ void CBotExprUnaire::RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotExprUnaire::DropBytecode()
+{
+    m_expr->DropBytecode();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprUnaire::IsFloatResult()
+{
+    return GetTokenType() == ID_SUB && m_expr->IsFloatResult();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprUnaire::GenerateBytecode(CBotBytecode& code, int reg)
+{
+    if (!m_expr->GenerateBytecode(code, reg)) return false;
+
+    switch (GetTokenType())
+    {
+    case ID_SUB:
+        code.Emit(CBotBytecode::Opcode::Neg, reg, 0, 1);
+        return true;
+    case ID_NOT:
+    case ID_LOG_NOT:
+    case ID_TXT_NOT:
+        code.Emit(CBotBytecode::Opcode::Not, reg, 0, 1);
+        return true;
+    default:
+        return false;
+    }
+}
+
 std::map<std::string, CBotInstr*> CBotExprUnaire::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
@@ -55,11 +55,35 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateBytecode
+     * \param code
+     * \param reg
+     * \return
+     */
+    bool GenerateBytecode(CBotBytecode& code, int reg) override;
+
+    /*!
+     * \brief DropBytecode
+     */
+    void DropBytecode() override;
+
+    bool IsFloatResult() override;
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotExprUnaire"; }
     virtual std::map<std::string, CBotInstr*> GetDebugLinks() override;
 
 private:
+    /*!
+     * \brief Fold Replaces an operation on a constant by its result,
+     * if the program is optimized (see CBotProgram::SetOptimizeEnabled()).
+     * \param inst The operation, deleted if it is replaced
+     * \param pStack
+     * \return The literal replacing inst, or inst
+     */
+    static CBotInstr* Fold(CBotExprUnaire* inst, CBotCStack* pStack);
+
     //! Expression to be evaluated.
     CBotInstr* m_expr;
 };
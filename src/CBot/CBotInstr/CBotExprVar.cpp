@@ -26,6 +26,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVarArray.h"
 
@@ -239,6 +240,13 @@ bool CBotExprVar::Execute(CBotStack* &pj)
         pile1->IncState();
     }
 
+    CBotValue   value;
+    if (pile1->GetValue(value)) return pj->Return(pile1);   // a defined primitive value
+
+    CBotInlineValue inlineValue;                            // a defined value of a class held inline
+    if (pile1->GetInlineValue(inlineValue) && static_cast<CBotVar::InitType>(inlineValue.init) != CBotVar::InitType::UNDEF)
+        return pj->Return(pile1);
+
     pVar = pile1->GetVar();
 
     if (pVar == nullptr)
@@ -281,13 +289,15 @@ bool CBotExprVar::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* prevToke
 
     if (bStep && m_nIdent>0 && pj->IfStep()) return false;
 
-    pVar = pj->FindVar(m_nIdent, true);     // tries with the variable update if necessary
+    pVar = pj->FindVar(m_nIdent, false);
     if (pVar == nullptr)
     {
         assert(false);
         //pj->SetError(static_cast<CBotError>(1), &m_token); // TODO: yeah, don't care that this exception doesn't exist ~krzys_h
         return false;
     }
+    // tries with the variable update if necessary
+    if (!pj->UpdateVar(pVar, dynamic_cast<CBotFieldExpr*>(m_next3) != nullptr)) return false;
     if ( m_next3 != nullptr &&
          !m_next3->ExecuteVar(pVar, pj, &m_token, bStep, false) )
             return false;   // field of an instance, table, methode
@@ -295,6 +305,24 @@ bool CBotExprVar::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* prevToke
     return pile->ReturnKeep(pj);    // does not put on stack but get the result if a method was called
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprVar::GenerateBytecode(CBotBytecode& code, int reg)
+{
+    // only plain local variables, no fields, indexes or methods
+    if (m_nIdent <= 0 || m_next3 != nullptr) return false;
+
+    code.EmitVar(reg, m_nIdent, 1);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotExprVar::GenerateStoreBytecode(CBotBytecode& code, int reg, bool bSameType)
+{
+    if (m_nIdent <= 0 || m_next3 != nullptr) return false;
+
+    return code.EmitStore(reg, m_nIdent, bSameType) >= 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void CBotExprVar::RestoreStateVar(CBotStack* &pj, bool bMain)
 {
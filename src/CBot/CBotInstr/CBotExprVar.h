@@ -71,6 +71,24 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateBytecode
+     * \param code
+     * \param reg
+     * \return
+     */
+    bool GenerateBytecode(CBotBytecode& code, int reg) override;
+
+    /*!
+     * \brief GenerateStoreBytecode Appends the bytecode storing a register
+     * in this variable, only if it is a local variable.
+     * \param code
+     * \param reg
+     * \param bSameType Whether the value must already have the type of the variable
+     * \return false if this variable can't be stored by the bytecode
+     */
+    bool GenerateStoreBytecode(CBotBytecode& code, int reg, bool bSameType);
+
     /*!
      * \brief ExecuteVar Fetch a variable at runtime.
      * \param pVar
@@ -25,6 +25,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -151,6 +152,45 @@ CBotInstr* CBotExpression::Compile(CBotToken* &p, CBotCStack* pStack)
     return i;
 }
 
+// gives the operation done by an assignment operator
+static bool GetOperation(int tokenType, CBotBytecode::Opcode& op)
+{
+    switch (tokenType)
+    {
+    case ID_ASSADD:     op = CBotBytecode::Opcode::Add;     return true;
+    case ID_ASSSUB:     op = CBotBytecode::Opcode::Sub;     return true;
+    case ID_ASSMUL:     op = CBotBytecode::Opcode::Mul;     return true;
+    case ID_ASSDIV:     op = CBotBytecode::Opcode::Div;     return true;
+    case ID_ASSMODULO:  op = CBotBytecode::Opcode::Modulo;  return true;
+    case ID_ASSAND:     op = CBotBytecode::Opcode::And;     return true;
+    case ID_ASSXOR:     op = CBotBytecode::Opcode::XOr;     return true;
+    case ID_ASSOR:      op = CBotBytecode::Opcode::Or;      return true;
+    case ID_ASSSL:      op = CBotBytecode::Opcode::SL;      return true;
+    case ID_ASSSR:      op = CBotBytecode::Opcode::SR;      return true;
+    case ID_ASSASR:     op = CBotBytecode::Opcode::ASR;     return true;
+    default:
+        return false;
+    }
+}
+
+// does an assignment operator with primitive values,
+// returns false if it must be done with variables
+static bool ExecuteValue(int tokenType, CBotStack* pile1, CBotStack* pile2)
+{
+    CBotBytecode::Opcode op;
+    if (!GetOperation(tokenType, op)) return false;
+
+    CBotValue left, right;
+    if (!pile1->GetValue(left) || !pile2->GetValue(right)) return false;
+
+    // the operation is done in the type of the variable (int x; x /= 2; is an integer division)
+    CBotType type = left.type;
+    if (!CBotBytecode::Binary(op, left, right) || left.type != type) return false;
+
+    pile2->SetValue(left);
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotExpression::Execute(CBotStack* &pj)
 {
@@ -170,7 +210,8 @@ bool CBotExpression::Execute(CBotStack* &pj)
 
     if ( pile1->GetState()==0)
     {
-        pile1->SetCopyVar(pVar);    // keeps the copy on the stack (if interrupted)
+        // keeps the copy on the stack (if interrupted), a simple assignment doesn't read it
+        if (m_token.GetType() != ID_ASS) pile1->SetCopyVar(pVar);
         pile1->IncState();
     }
 
@@ -182,6 +223,12 @@ bool CBotExpression::Execute(CBotStack* &pj)
         pile2->IncState();
     }
 
+    // operations on primitive values are done without creating variables
+    if (pile1->GetState() == 1 && ExecuteValue(m_token.GetType(), pile1, pile2))
+    {
+        pile1->IncState();
+    }
+
     if (pile1->GetState() == 1)
     {
         if (m_token.GetType() != ID_ASS)
@@ -295,6 +342,35 @@ void CBotExpression::RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotExpression::GenerateStatementBytecode(CBotBytecode& code)
+{
+    int type = m_token.GetType();
+    CBotBytecode::Opcode op = CBotBytecode::Opcode::Add;
+    if (m_rightop == nullptr || (type != ID_ASS && !GetOperation(type, op)))
+    {
+        CBotInstr::GenerateStatementBytecode(code);
+        return;
+    }
+
+    // the variable is changed at the end, the tree does the whole assignment if anything fails before
+    int start = code.BeginExpression(this, false, 3);    // the three IncState()
+    bool ok;
+    if (type == ID_ASS)
+    {
+        ok = m_rightop->GenerateBytecode(code, 0) &&
+             m_leftop->GenerateStoreBytecode(code, 0, false);
+    }
+    else
+    {
+        ok = m_leftop->GenerateBytecode(code, 0) &&
+             m_rightop->GenerateBytecode(code, 1) &&
+             code.Emit(op, 0, 1) >= 0 &&
+             m_leftop->GenerateStoreBytecode(code, 0, true);    // in the type of the variable, see ExecuteValue()
+    }
+    if (code.EndExpression(start, ok)) m_rightop->DropBytecode();
+}
+
 std::map<std::string, CBotInstr*> CBotExpression::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
@@ -66,6 +66,12 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateStatementBytecode
+     * \param code
+     */
+    void GenerateStatementBytecode(CBotBytecode& code) override;
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotExpression"; }
     virtual std::map<std::string, CBotInstr*> GetDebugLinks() override;
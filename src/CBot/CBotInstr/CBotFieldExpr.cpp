@@ -100,13 +100,17 @@ bool CBotFieldExpr::ExecuteVar(CBotVar* &pVar, CBotStack* &pile, CBotToken* prev
 
     if (pVar->IsStatic())
     {
+        // static variables are shared by all the programs
+        if (!pile->RunOnMainThread()) return false;
+
         // for a static variable, takes it in the class itself
         CBotClass* pClass = pItem->GetClass();
         pVar = pClass->GetItem(m_token.GetString());
     }
 
     // request the update of the element, if applicable
-    pVar->Update(pile->GetUserPtr());
+    if (!pile->UpdateItem(pItem, pVar)) return false;
+    if (!pile->UpdateVar(pVar, dynamic_cast<CBotFieldExpr*>(m_next3) != nullptr)) return false;
 
     if ( m_next3 != nullptr &&
          !m_next3->ExecuteVar(pVar, pile, &m_token, bStep, bExtend) ) return false;
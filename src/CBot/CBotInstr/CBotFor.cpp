@@ -24,6 +24,8 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotProgram.h"
+#include "CBot/CBotBytecode.h"
 
 namespace CBot
 {
@@ -35,6 +37,7 @@ CBotFor::CBotFor()
     m_test = nullptr;
     m_incr = nullptr;
     m_block = nullptr;
+    m_bytecode = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -44,6 +47,7 @@ CBotFor::~CBotFor()
     delete m_test;
     delete m_incr;
     delete m_block;        // frees the instruction block
+    delete m_bytecode;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -97,7 +101,13 @@ CBotInstr* CBotFor::Compile(CBotToken* &p, CBotCStack* pStack)
                     inst->m_block = CBotBlock::CompileBlkOrInst(p, pStk, true );
                     DecLvl();
                     if ( pStk->IsOk() )
-                        return pStack->Return(inst, pStk);;
+                    {
+                        // lowers the whole loop with the statements in it, see CBotBytecode::Run()
+                        CBotProgram* prog = pStack->GetProgram();
+                        if ( prog != nullptr && prog->IsBytecodeEnabled() ) inst->m_bytecode = CBotBytecode::CompileLoop(inst);
+
+                        return pStack->Return(inst, pStk);
+                    }
                 }
                 pStack->SetError(CBotErrClosePar, p->GetStart());
             }
@@ -118,6 +128,10 @@ bool CBotFor :: Execute(CBotStack* &pj)
 
     if ( pile->IfStep() ) return false;
 
+    // executes the whole loop as bytecode, unless it has been started step by step
+    if ( m_bytecode != nullptr && (pile->GetState() < 0 || pile->IsFresh()) )
+        return m_bytecode->Run(pj, pile);
+
     while( true ) switch( pile->GetState() )    // executes the loop
     {                                           // there are four possible states (depending on recovery)
     case 0:
@@ -153,8 +167,8 @@ bool CBotFor :: Execute(CBotStack* &pj)
             return pj->BreakReturn(pile, m_label);      // sends the results and releases the stack
         }
 
-        // terminates if there is an error
-        if ( !pile->IsOk() )
+        // terminates if there is an error, or if the loop used up the memory
+        if ( !pile->IsOk() || pile->MemoryOver() )
         {
             return pj->Return(pile);                    // sends the results and releases the stack
         }
@@ -180,6 +194,12 @@ void CBotFor :: RestoreState(CBotStack* &pj, bool bMain)
     CBotStack* pile = pj->RestoreStack(this);       // adds an item to the stack (variables locales)
     if ( pile == nullptr ) return;
 
+    if ( pile->GetState() < 0 )                 // suspended in the bytecode
+    {
+        if ( m_bytecode != nullptr ) m_bytecode->RestoreState(pile);
+        return;
+    }
+
     switch( pile->GetState() )
     {                                           // there are four possible states (depending on recovery)
     case 0:
@@ -210,6 +230,50 @@ void CBotFor :: RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotFor::GenerateStatementBytecode(CBotBytecode& code)
+{
+    // the level of the loop holds the variables of the initialization
+    int block = -1;
+    if (!code.IsRoot(this))
+    {
+        delete m_bytecode;                      // lowered with the loop around it
+        m_bytecode = nullptr;
+        block = code.BeginBlock(this);
+    }
+
+    if (m_init != nullptr)
+    {
+        int init = code.BeginStatement(m_init, 0);
+        m_init->GenerateStatementBytecode(code);
+        code.EndStatement(init);
+    }
+    code.EmitCheck(1);                          // SetState(1)
+
+    int loop = code.BeginLoop(m_label);
+    int test = code.GetPosition();
+    int exit = -1;
+    if (m_test != nullptr)
+    {
+        code.EmitCondition(m_test);
+        exit = code.EmitBranch(1, false);       // SetState(2)
+    }
+    else
+    {
+        code.EmitCheck(1);                      // SetState(2)
+    }
+    if (m_block != nullptr) m_block->GenerateStatementBytecode(code);
+    code.EmitEndBody();
+    code.EmitCheck(1);                          // SetState(3)
+    code.SetContinue(loop);                     // "continue" goes to the incrementation
+    if (m_incr != nullptr) m_incr->GenerateStatementBytecode(code);
+    code.EmitLoop(test, 1, 1);                  // SetState(1, 0)
+    code.PatchJump(exit);
+    code.EndLoop(loop);
+
+    if (block >= 0) code.EndBlock(block);
+}
+
 std::string CBotFor::GetDebugData()
 {
     return !m_label.empty() ? "m_label = "+m_label : "";
@@ -29,6 +29,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotCallCache.h"
 #include "CBot/CBotClass.h"
 #include "CBot/CBotDefParam.h"
 #include "CBot/CBotUtils.h"
@@ -36,11 +37,18 @@
 #include "CBot/CBotVar/CBotVar.h"
 
 #include <cassert>
+#include <functional>
 #include <sstream>
 
 namespace CBot
 {
 
+namespace
+{
+//! Functions with more identifiers than this look up their variables on the stack
+const int MAX_SLOTS = 1024;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotFunction::CBotFunction()
 {
@@ -53,6 +61,9 @@ CBotFunction::CBotFunction()
 //  m_nThisIdent = 0;
     m_nFuncIdent = 0;
     m_bSynchro    = false;
+    m_slotBase   = 0;
+    m_slotCount  = 0;
+    CBotCallCache::Invalidate();  // may be a better match for calls by name
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -64,6 +75,7 @@ CBotFunction::~CBotFunction()
     delete m_param;                // empty parameter list
     delete m_block;                // the instruction block
     delete  m_next;
+    CBotCallCache::Invalidate();  // forget calls to this function
 
     // remove public list if there is
     if (m_bPublic)
@@ -72,6 +84,31 @@ CBotFunction::~CBotFunction()
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotFunction::HasPublicFunctions()
+{
+    return !m_publicFunctions.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotFunction::GetPublicHash()
+{
+    std::size_t hash = 0;
+    for (CBotFunction* f : m_publicFunctions)
+    {
+        // the set is ordered by address, the sum does not depend on it
+        hash += std::hash<std::string>()(f->GetName() + f->GetParams() + f->m_retTyp.ToString());
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotProgram* CBotFunction::GetProgram(CBotStack* pStack)
+{
+    if ( m_pProg != nullptr ) return m_pProg;
+    return pStack->GetProgram();                // shared by several programs, see CBotProgram::Compile()
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotFunction::IsPublic()
 {
@@ -126,6 +163,17 @@ bool CBotFunction::GetPosition(int& start, int& stop, CBotGet modestart, CBotGet
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotFunction::ShiftPosition(int delta)
+{
+    CBotInstr::ShiftPosition(delta);
+    for (CBotToken* p : { &m_retToken, &m_classToken, &m_extern, &m_openpar, &m_closepar, &m_openblk, &m_closeblk })
+    {
+        p->SetPos(p->GetStart() + delta, p->GetEnd() + delta);
+    }
+    if (m_param != nullptr) m_param->ShiftPosition(delta);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotFunction* CBotFunction::Compile(CBotToken* &p, CBotCStack* pStack, CBotFunction* finput, bool bLocal)
 {
@@ -185,6 +233,9 @@ CBotFunction* CBotFunction::Compile(CBotToken* &p, CBotCStack* pStack, CBotFunct
                 if (!IsOfType(p, TokenTypVar)) goto bad;
 
             }
+            // parameters and local variables get the following identifiers
+            func->m_slotBase = CBotVar::NextUniqNum() + 1;
+            func->m_slotCount = 0;
             func->m_openpar = *p;
             func->m_param = CBotDefParam::Compile(p, pStk );
             func->m_closepar = *(p->GetPrev());
@@ -224,6 +275,9 @@ CBotFunction* CBotFunction::Compile(CBotToken* &p, CBotCStack* pStack, CBotFunct
                 func->m_closeblk = (p != nullptr && p->GetPrev() != nullptr) ? *(p->GetPrev()) : CBotToken();
                 if ( pStk->IsOk() )
                 {
+                    long count = CBotVar::NextUniqNum() - func->m_slotBase;
+                    if ( count > 0 && count <= MAX_SLOTS ) func->m_slotCount = count;  // else find them on the stack
+
                     if ( func->m_bPublic )  // public function, return known for all
                     {
                         CBotFunction::AddPublic(func);
@@ -336,7 +390,8 @@ bool CBotFunction::Execute(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInstance)
     CBotStack*  pile = pj->AddStack(this, CBotStack::BlockVisibilityType::FUNCTION);               // one end of stack local to this function
 //  if ( pile == EOX ) return true;
 
-    pile->SetProgram(m_pProg);                              // bases for routines
+    pile->SetProgram(GetProgram(pj));                       // bases for routines
+    pile->InitSlots(m_slotBase, m_slotCount);
 
     if ( pile->GetState() == 0 )
     {
@@ -393,7 +448,7 @@ void CBotFunction::RestoreState(CBotVar** ppVars, CBotStack* &pj, CBotVar* pInst
     if ( pile == nullptr ) return;
     CBotStack*  pile2 = pile;
 
-    pile->SetProgram(m_pProg);                          // bases for routines
+    pile->SetProgram(GetProgram(pj));                   // bases for routines
 
     if ( pile->GetBlock() != CBotStack::BlockVisibilityType::FUNCTION)
     {
@@ -598,67 +653,76 @@ int CBotFunction::DoCall(long& nIdent, const std::string& name, CBotVar** ppVars
 
     if ( pt != nullptr )
     {
-        CBotStack*  pStk1 = pStack->AddStack(pt, CBotStack::BlockVisibilityType::FUNCTION);    // to put "this"
-//      if ( pStk1 == EOX ) return true;
+        return pt->Call(ppVars, pStack, pToken);
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotFunction::Call(CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken)
+{
+    CBotProgram*    pProgCurrent = pStack->GetProgram();
 
-        pStk1->SetProgram(pt->m_pProg);                 // it may have changed module
+    CBotStack*  pStk1 = pStack->AddStack(this, CBotStack::BlockVisibilityType::FUNCTION);    // to put "this"
+//  if ( pStk1 == EOX ) return true;
 
-        if ( pStk1->IfStep() ) return false;
+    pStk1->SetProgram(GetProgram(pStack));      // it may have changed module
+    pStk1->InitSlots(m_slotBase, m_slotCount);
 
-        CBotStack*  pStk3 = pStk1->AddStack(nullptr, CBotStack::BlockVisibilityType::BLOCK);    // parameters
+    if ( pStk1->IfStep() ) return false;
 
-        // preparing parameters on the stack
+    CBotStack*  pStk3 = pStk1->AddStack(nullptr, CBotStack::BlockVisibilityType::BLOCK);    // parameters
 
-        if ( pStk1->GetState() == 0 )
+    // preparing parameters on the stack
+
+    if ( pStk1->GetState() == 0 )
+    {
+        if ( !m_MasterClass.empty() )
         {
-            if ( !pt->m_MasterClass.empty() )
+            CBotVar* pInstance = pProgCurrent->m_thisVar;
+            // make "this" known
+            CBotVar* pThis ;
+            if ( pInstance == nullptr )
             {
-                CBotVar* pInstance = m_pProg->m_thisVar;
-                // make "this" known
-                CBotVar* pThis ;
-                if ( pInstance == nullptr )
+                pThis = CBotVar::Create("this", CBotTypResult( CBotTypClass, m_MasterClass ));
+            }
+            else
+            {
+                if (m_MasterClass != pInstance->GetClass()->GetName())
                 {
-                    pThis = CBotVar::Create("this", CBotTypResult( CBotTypClass, pt->m_MasterClass ));
+                    pStack->SetError(CBotErrBadType2, &m_classToken);
+                    return false;
                 }
-                else
-                {
-                    if (pt->m_MasterClass != pInstance->GetClass()->GetName())
-                    {
-                        pStack->SetError(CBotErrBadType2, &pt->m_classToken);
-                        return false;
-                    }
 
-                    pThis = CBotVar::Create("this", CBotTypResult( CBotTypPointer, pt->m_MasterClass ));
-                    pThis->SetPointer(pInstance);
-                }
-                assert(pThis != nullptr);
-                pThis->SetInit(CBotVar::InitType::IS_POINTER);
-
-                pThis->SetUniqNum(-2);
-                pStk1->AddVar(pThis);
+                pThis = CBotVar::Create("this", CBotTypResult( CBotTypPointer, m_MasterClass ));
+                pThis->SetPointer(pInstance);
             }
+            assert(pThis != nullptr);
+            pThis->SetInit(CBotVar::InitType::IS_POINTER);
 
-            // initializes the variables as parameters
-            pt->m_param->Execute(ppVars, pStk3);            // cannot be interrupted
-
-            pStk1->IncState();
+            pThis->SetUniqNum(-2);
+            pStk1->AddVar(pThis);
         }
 
-        // finally execution of the found function
+        // initializes the variables as parameters
+        m_param->Execute(ppVars, pStk3);            // cannot be interrupted
+
+        pStk1->IncState();
+    }
 
-        if ( !pStk3->GetRetVar(                     // puts the result on the stack
-            pt->m_block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
+    // finally execution of the found function
+
+    if ( !pStk3->GetRetVar(                     // puts the result on the stack
+        m_block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
+    {
+        if ( !pStk3->IsOk() && GetProgram(pStack) != pProgCurrent )
         {
-            if ( !pStk3->IsOk() && pt->m_pProg != m_pProg )
-            {
-                pStk3->SetPosError(pToken);         // indicates the error on the procedure call
-            }
-            return false;   // interrupt !
+            pStk3->SetPosError(pToken);         // indicates the error on the procedure call
         }
-
-        return pStack->Return( pStk3 );
+        return false;   // interrupt !
     }
-    return -1;
+
+    return pStack->Return( pStk3 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -678,7 +742,7 @@ void CBotFunction::RestoreCall(long& nIdent, const std::string& name, CBotVar**
         pStk1 = pStack->RestoreStack(pt);
         if ( pStk1 == nullptr ) return;
 
-        pStk1->SetProgram(pt->m_pProg);                 // it may have changed module
+        pStk1->SetProgram(pt->GetProgram(pStack));      // it may have changed module
 
         if ( pStk1->GetBlock() != CBotStack::BlockVisibilityType::FUNCTION)
         {
@@ -723,81 +787,90 @@ int CBotFunction::DoCall(long& nIdent, const std::string& name, CBotVar* pThis,
                          CBotToken* pToken, CBotClass* pClass)
 {
     CBotTypResult   type;
-    CBotProgram*    pProgCurrent = pStack->GetProgram();
 
     CBotFunction*   pt = FindLocalOrPublic(nIdent, name, ppVars, type, false);
 
     if ( pt != nullptr )
     {
-//      DEBUG( "CBotFunction::DoCall" + pt->GetName(), 0, pStack);
+        return pt->Call(pThis, ppVars, pStack, pToken, pClass);
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotFunction::Call(CBotVar* pThis, CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken, CBotClass* pClass)
+{
+    CBotProgram*    pProgCurrent = pStack->GetProgram();
 
-        CBotStack*  pStk = pStack->AddStack(pt, CBotStack::BlockVisibilityType::FUNCTION);
-//      if ( pStk == EOX ) return true;
+//  DEBUG( "CBotFunction::DoCall" + GetName(), 0, pStack);
 
-        pStk->SetProgram(pt->m_pProg);                  // it may have changed module
-        CBotStack*  pStk3 = pStk->AddStack(nullptr, CBotStack::BlockVisibilityType::BLOCK); // to set parameters passed
+    CBotStack*  pStk = pStack->AddStack(this, CBotStack::BlockVisibilityType::FUNCTION);
+//  if ( pStk == EOX ) return true;
 
-        // preparing parameters on the stack
+    pStk->SetProgram(GetProgram(pStack));       // it may have changed module
+    pStk->InitSlots(m_slotBase, m_slotCount);
+    CBotStack*  pStk3 = pStk->AddStack(nullptr, CBotStack::BlockVisibilityType::BLOCK); // to set parameters passed
+
+    // preparing parameters on the stack
 
-        if ( pStk->GetState() == 0 )
+    if ( pStk->GetState() == 0 )
+    {
+        // sets the variable "this" on the stack
+        CBotVar* pthis = CBotVar::Create("this", CBotTypNullPointer);
+        pthis->Copy(pThis, false);
+        pthis->SetUniqNum(-2);      // special value
+        pStk->AddVar(pthis);
+
+        CBotClass*  pClass = pThis->GetClass()->GetParent();
+        if ( pClass )
         {
-            // sets the variable "this" on the stack
-            CBotVar* pthis = CBotVar::Create("this", CBotTypNullPointer);
-            pthis->Copy(pThis, false);
-            pthis->SetUniqNum(-2);      // special value
-            pStk->AddVar(pthis);
-
-            CBotClass*  pClass = pThis->GetClass()->GetParent();
-            if ( pClass )
-            {
-                // sets the variable "super" on the stack
-                CBotVar* psuper = CBotVar::Create("super", CBotTypNullPointer);
-                psuper->Copy(pThis, false); // in fact identical to "this"
-                psuper->SetUniqNum(-3);     // special value
-                pStk->AddVar(psuper);
-            }
-            // initializes the variables as parameters
-            pt->m_param->Execute(ppVars, pStk3);            // cannot be interrupted
-            pStk->IncState();
+            // sets the variable "super" on the stack
+            CBotVar* psuper = CBotVar::Create("super", CBotTypNullPointer);
+            psuper->Copy(pThis, false); // in fact identical to "this"
+            psuper->SetUniqNum(-3);     // special value
+            pStk->AddVar(psuper);
         }
+        // initializes the variables as parameters
+        m_param->Execute(ppVars, pStk3);            // cannot be interrupted
+        pStk->IncState();
+    }
 
-        if ( pStk->GetState() == 1 )
+    if ( pStk->GetState() == 1 )
+    {
+        if ( m_bSynchro )
         {
-            if ( pt->m_bSynchro )
-            {
-                CBotProgram* pProgBase = pStk->GetProgram(true);
-                if ( !pClass->Lock(pProgBase) ) return false; // try to lock, interrupt if failed
-            }
-            pStk->IncState();
+            if ( !pStk->RunOnMainThread() ) return false;    // the lock is shared by all the programs
+            CBotProgram* pProgBase = pStk->GetProgram(true);
+            if ( !pClass->Lock(pProgBase) ) return false; // try to lock, interrupt if failed
         }
-        // finally calls the found function
+        pStk->IncState();
+    }
+    // finally calls the found function
 
-        if ( !pStk3->GetRetVar(                         // puts the result on the stack
-            pt->m_block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
+    if ( !pStk3->GetRetVar(                         // puts the result on the stack
+        m_block->Execute(pStk3) ))          // GetRetVar said if it is interrupted
+    {
+        if ( !pStk3->IsOk() )
         {
-            if ( !pStk3->IsOk() )
+            if ( m_bSynchro )
             {
-                if ( pt->m_bSynchro )
-                {
-                    pClass->Unlock();                   // release function
-                }
-
-                if ( pt->m_pProg != pProgCurrent )
-                {
-                    pStk3->SetPosError(pToken);         // indicates the error on the procedure call
-                }
+                pClass->Unlock();                   // release function
             }
-            return false;   // interrupt !
-        }
 
-        if ( pt->m_bSynchro )
-        {
-            pClass->Unlock();                           // release function
+            if ( GetProgram(pStack) != pProgCurrent )
+            {
+                pStk3->SetPosError(pToken);         // indicates the error on the procedure call
+            }
         }
+        return false;   // interrupt !
+    }
 
-        return pStack->Return( pStk3 );
+    if ( m_bSynchro )
+    {
+        pClass->Unlock();                           // release function
     }
-    return -1;
+
+    return pStack->Return( pStk3 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -811,7 +884,7 @@ void CBotFunction::RestoreCall(long& nIdent, const std::string& name, CBotVar* p
     {
         CBotStack*  pStk = pStack->RestoreStack(pt);
         if ( pStk == nullptr ) return;
-        pStk->SetProgram(pt->m_pProg);                  // it may have changed module
+        pStk->SetProgram(pt->GetProgram(pStack));       // it may have changed module
 
         CBotVar*    pthis = pStk->FindVar("this");
         pthis->SetUniqNum(-2);
@@ -826,6 +899,7 @@ void CBotFunction::RestoreCall(long& nIdent, const std::string& name, CBotVar* p
             {
                 CBotProgram* pProgBase = pStk->GetProgram(true);
                 pClass->Lock(pProgBase);                    // locks the class
+                pStk->RunOnMainThread();
             }
 
         // finally calls the found function
@@ -884,6 +958,7 @@ CBotFunction* CBotFunction::Next()
 void CBotFunction::AddPublic(CBotFunction* func)
 {
     m_publicFunctions.insert(func);
+    CBotCallCache::Invalidate();
 }
 
 std::string CBotFunction::GetDebugData()
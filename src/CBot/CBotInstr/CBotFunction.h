@@ -151,6 +151,16 @@ public:
                      CBotVar** ppVars,
                      CBotStack* pStack);
 
+    /*!
+     * \brief Call Calls this function, once found by DoCall() or a
+     * CBotCallCache.
+     * \param ppVars
+     * \param pStack
+     * \param pToken
+     * \return
+     */
+    int Call(CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken);
+
     /*!
      * \brief DoCall Makes call of a method note: this is already on the stack,
      * the pointer pThis is just to simplify.
@@ -171,6 +181,18 @@ public:
                CBotToken* pToken,
                CBotClass* pClass);
 
+    /*!
+     * \brief Call Calls this method, once found by DoCall() or a
+     * CBotCallCache.
+     * \param pThis
+     * \param ppVars
+     * \param pStack
+     * \param pToken
+     * \param pClass
+     * \return
+     */
+    int Call(CBotVar* pThis, CBotVar** ppVars, CBotStack* pStack, CBotToken* pToken, CBotClass* pClass);
+
     /*!
      * \brief RestoreCall
      * \param nIdent
@@ -218,6 +240,18 @@ public:
      */
     bool IsPublic();
 
+    /*!
+     * \brief HasPublicFunctions Check if any program defines a public function
+     * \return
+     */
+    static bool HasPublicFunctions();
+
+    /*!
+     * \brief GetPublicHash Hash of the declarations of all public functions
+     * \return
+     */
+    static std::size_t GetPublicHash();
+
     /*!
      * \brief IsExtern
      * \return
@@ -242,16 +276,30 @@ public:
                      CBotGet modestart,
                      CBotGet modestop);
 
+    void ShiftPosition(int delta) override;
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotFunction"; }
     virtual std::string GetDebugData() override;
     virtual std::map<std::string, CBotInstr*> GetDebugLinks() override;
 
 private:
+    /*!
+     * \brief GetProgram Program the function runs in.
+     * \param pStack Stack of the caller.
+     * \return m_pProg, or the program of the caller if the function is shared
+     * by several programs.
+     */
+    CBotProgram* GetProgram(CBotStack* pStack);
+
     friend class CBotDebug;
     long m_nFuncIdent;
     //! Synchronized method.
     bool m_bSynchro;
+    //! Identifier of the first local variable, see CBotStack::InitSlots()
+    long m_slotBase;
+    //! Number of identifiers given to parameters and local variables.
+    int m_slotCount;
 
     //! Parameter list.
     CBotDefParam* m_param;
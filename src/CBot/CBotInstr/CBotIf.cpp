@@ -23,6 +23,8 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotValue.h"
+#include "CBot/CBotBytecode.h"
 
 namespace CBot
 {
@@ -59,15 +61,18 @@ CBotInstr* CBotIf::Compile(CBotToken* &p, CBotCStack* pStack)
     {
         // the condition does exist
 
+        bool bBlock = p->GetType() == ID_OPBLK;
         inst->m_block = CBotBlock::CompileBlkOrInst(p, pStk, true );
         if ( pStk->IsOk() )
         {
             // the statement block is ok (can be empty)
 
             // see if the next instruction is the token "else"
+            bool bBlockElse = false;
             if (IsOfType(p, ID_ELSE))
             {
                 // if so, compiles the following statement block
+                bBlockElse = p->GetType() == ID_OPBLK;
                 inst->m_blockElse = CBotBlock::CompileBlkOrInst(p, pStk, true );
                 if (!pStk->IsOk())
                 {
@@ -78,6 +83,26 @@ CBotInstr* CBotIf::Compile(CBotToken* &p, CBotCStack* pStack)
                 }
             }
 
+            // with a constant condition, only the branch taken is kept
+            CBotValue       value;
+            CBotProgram*    prog = pStack->GetProgram();
+            if ( prog != nullptr && prog->IsOptimizeEnabled() && inst->m_condition->GetConstant(value) )
+            {
+                bool        bTrue = value.valInt != 0;
+                CBotInstr*  taken = bTrue ? inst->m_block : inst->m_blockElse;
+                delete (bTrue ? inst->m_blockElse : inst->m_block);
+                inst->m_block = bTrue ? taken : nullptr;
+                inst->m_blockElse = bTrue ? nullptr : taken;
+
+                if ( taken != nullptr && (bTrue ? bBlock : bBlockElse) )
+                {
+                    // a block has its own variables, it can replace the "if"
+                    inst->m_block = inst->m_blockElse = nullptr;
+                    delete inst;
+                    return pStack->Return(taken, pStk);
+                }
+            }
+
             // return the corrent object to the application
             return pStack->Return(inst, pStk);
         }
@@ -89,6 +114,12 @@ CBotInstr* CBotIf::Compile(CBotToken* &p, CBotCStack* pStack)
     return pStack->Return(nullptr, pStk);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotIf::HasEffect()
+{
+    return m_block != nullptr || m_blockElse != nullptr || m_condition->HasEffect();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotIf :: Execute(CBotStack* &pj)
 {
@@ -163,6 +194,22 @@ void CBotIf :: RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotIf::GenerateStatementBytecode(CBotBytecode& code)
+{
+    code.EmitCondition(m_condition);
+    int jump = code.EmitBranch(1, true);        // SetState(1)
+    if (m_block != nullptr) m_block->GenerateStatementBytecode(code);
+    if (m_blockElse != nullptr)
+    {
+        int end = code.EmitJump();
+        code.PatchJump(jump);
+        m_blockElse->GenerateStatementBytecode(code);
+        jump = end;
+    }
+    code.PatchJump(jump);
+}
+
 std::map<std::string, CBotInstr*> CBotIf::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
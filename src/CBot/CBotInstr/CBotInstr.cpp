@@ -40,6 +40,7 @@
 
 #include "CBot/CBotClass.h"
 #include "CBot/CBotStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include <cassert>
 
@@ -318,6 +319,42 @@ bool CBotInstr::CompCase(CBotStack* &pj, int val)
     return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotInstr::GenerateBytecode(CBotBytecode& code, int reg)
+{
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotInstr::DropBytecode()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotInstr::GenerateStatementBytecode(CBotBytecode& code)
+{
+    code.EmitExec(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotInstr::GetConstant(CBotValue& value)
+{
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotInstr::IsFloatResult()
+{
+    CBotValue value;
+    return GetConstant(value) && value.type == CBotTypFloat;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotInstr::HasEffect()
+{
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotInstr* CBotInstr::CompileArray(CBotToken* &p, CBotCStack* pStack, CBotTypResult type, bool first)
 {
@@ -359,6 +396,18 @@ CBotInstr* CBotInstr::CompileArray(CBotToken* &p, CBotCStack* pStack, CBotTypRes
     return nullptr;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotInstr::ShiftPosition(int delta)
+{
+    m_token.SetPos(m_token.GetStart() + delta, m_token.GetEnd() + delta);
+
+    // the debug links are all the instructions owned by this one
+    for (const auto& it : GetDebugLinks())
+    {
+        if (it.second != nullptr) it.second->ShiftPosition(delta);
+    }
+}
+
 std::map<std::string, CBotInstr*> CBotInstr::GetDebugLinks()
 {
     return {
@@ -27,6 +27,8 @@
 namespace CBot
 {
 class CBotDebug;
+class CBotBytecode;
+struct CBotValue;
 
 /**
  * \brief Class for one CBot instruction
@@ -202,6 +204,67 @@ public:
     virtual bool CompCase(CBotStack* &pj,
                           int val);
 
+    /**
+     * \brief GenerateBytecode Appends the bytecode evaluating this expression.
+     * Only pure expressions on primitive values can be lowered.
+     * \param code
+     * \param reg Register receiving the result, registers above it are free
+     * \return false if this instruction can't be lowered
+     * \see CBotBytecode
+     */
+    virtual bool GenerateBytecode(CBotBytecode& code,
+                                  int reg);
+
+    /**
+     * \brief DropBytecode Frees the bytecode of the expressions in this one,
+     * once they have been lowered as part of a larger expression.
+     * \see GenerateBytecode()
+     */
+    virtual void DropBytecode();
+
+    /**
+     * \brief GenerateStatementBytecode Appends the bytecode executing this
+     * statement, as part of a loop. By default the statement is executed by
+     * the tree walker from the bytecode.
+     * \param code
+     * \see CBotBytecode::CompileLoop()
+     */
+    virtual void GenerateStatementBytecode(CBotBytecode& code);
+
+    /**
+     * \brief GetConstant Gives the value of this expression if it is known
+     * when compiling, used by the optimizations.
+     * \param[out] value
+     * \return false if the value is only known at run time
+     * \see CBotProgram::SetOptimizeEnabled()
+     */
+    virtual bool GetConstant(CBotValue& value);
+
+    /**
+     * \brief IsFloatResult Tells if this expression gives a float at run time
+     * although it is compiled as an int, like a division of two ints.
+     * \return
+     * \see CBotTwoOpExpr::Specialize()
+     */
+    virtual bool IsFloatResult();
+
+    /**
+     * \brief HasEffect Tells if executing this statement can change anything,
+     * statements without effect are removed by the optimizations.
+     * \return
+     * \see CBotProgram::SetOptimizeEnabled()
+     */
+    virtual bool HasEffect();
+
+    /**
+     * \brief ShiftPosition Moves the tokens of this instruction and of all
+     * the instructions connected with it, used when the text before them
+     * changed but their own text did not.
+     * \param delta Number of characters to add to the positions
+     * \see CBotProgram::Compile
+     */
+    virtual void ShiftPosition(int delta);
+
     /**
      * \brief SetToken Set the token corresponding to the instruction.
      * \param p
@@ -136,7 +136,7 @@ bool CBotInstrCall::Execute(CBotStack* &pj)
 {
     CBotVar*    ppVars[1000];
     CBotStack*  pile  = pj->AddStack(this);
-    if ( pile->StackOver() ) return pj->Return( pile );
+    if ( pile->StackOver() || pile->MemoryOver() ) return pj->Return( pile );
 
 //    CBotStack*  pile1 = pile;
 
@@ -163,7 +163,7 @@ bool CBotInstrCall::Execute(CBotStack* &pj)
     CBotStack* pile2 = pile->AddStack();
     if ( pile2->IfStep() ) return false;
 
-    if ( !pile2->ExecuteCall(m_nFuncIdent, GetToken(), ppVars, m_typRes)) return false; // interrupt
+    if ( !pile2->ExecuteCall(m_nFuncIdent, GetToken(), ppVars, m_typRes, m_cache)) return false; // interrupt
 
     return pj->Return(pile2);   // release the entire stack
 }
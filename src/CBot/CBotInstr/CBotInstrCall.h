@@ -21,6 +21,8 @@
 
 #include "CBot/CBotInstr/CBotInstr.h"
 
+#include "CBot/CBotCallCache.h"
+
 namespace CBot
 {
 
@@ -69,6 +71,8 @@ private:
     CBotTypResult m_typRes;
     //! Id of a function.
     long m_nFuncIdent;
+    //! Function called the last time.
+    CBotCallCache m_cache;
     friend class CBotDebug;
 };
 
@@ -143,7 +143,8 @@ bool CBotInstrMethode::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* pre
     }
     ppVars[i] = nullptr;
 
-    CBotClass*    pClass = CBotClass::Find(m_className);
+    CBotClass*    pClass = m_cache.LoadClass();
+    if (pClass == nullptr) pClass = CBotClass::Find(m_className);
     CBotVar*    pThis  = pile1->FindVar(-2, false);
     CBotVar*    pResult = nullptr;
     if (m_typRes.GetType() > 0) pResult = CBotVar::Create("", m_typRes);
@@ -155,7 +156,7 @@ bool CBotInstrMethode::ExecuteVar(CBotVar* &pVar, CBotStack* &pj, CBotToken* pre
 
     if ( !pClass->ExecuteMethode(m_MethodeIdent, m_methodName,
                                  pThis, ppVars,
-                                 pResult, pile2, GetToken())) return false;
+                                 pResult, pile2, GetToken(), &m_cache)) return false;
     if (pRes != pResult) delete pRes;
 
     pVar = nullptr;                // does not return value for this
@@ -249,7 +250,8 @@ bool CBotInstrMethode::Execute(CBotStack* &pj)
     }
     ppVars[i] = nullptr;
 
-    CBotClass*    pClass = CBotClass::Find(m_className);
+    CBotClass*    pClass = m_cache.LoadClass();
+    if (pClass == nullptr) pClass = CBotClass::Find(m_className);
     CBotVar*    pThis  = pile1->FindVar("this");
     CBotVar*    pResult = nullptr;
     if (m_typRes.GetType()>0) pResult = CBotVar::Create("", m_typRes);
@@ -261,7 +263,7 @@ bool CBotInstrMethode::Execute(CBotStack* &pj)
 
     if ( !pClass->ExecuteMethode(m_MethodeIdent, m_methodName,
                                  pThis, ppVars,
-                                 pResult, pile2, GetToken())) return false;    // interupted
+                                 pResult, pile2, GetToken(), &m_cache)) return false;    // interupted
 
     // set the new value of this in place of the old variable
     CBotVar*    old = pile1->FindVar(m_token, false);
@@ -21,6 +21,8 @@
 
 #include "CBot/CBotInstr/CBotInstr.h"
 
+#include "CBot/CBotCallCache.h"
+
 namespace CBot
 {
 
@@ -83,6 +85,8 @@ private:
     long m_MethodeIdent;
     //! Name of the class.
     std::string m_className;
+    //! Class and method called the last time.
+    CBotCallCache m_cache;
 };
 
 } // namespace CBot
@@ -25,6 +25,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 #include "CBot/CBotClass.h"
 
 #include "CBot/CBotVar/CBotVarArray.h"
@@ -172,7 +173,18 @@ bool CBotLeftExpr::Execute(CBotStack* &pj, CBotStack* array)
 
     if (pile->IfStep()) return false;
 
-    if (var1)
+    CBotValue    value;
+    CBotInlineValue inlineValue;
+    if (var1 && pj->GetValue(value))
+    {
+        var1->SetValue(value);  // primitive value, no type to check
+        pile->SetCopyVar(var1);
+    }
+    else if (var1 && pj->GetInlineValue(inlineValue) && var1->SetInlineValue(inlineValue))
+    {
+        pile->SetCopyVar(var1); // value of the same class held inline, copied in place
+    }
+    else if (var1)
     {
         var2 = pj->GetVar();    // result on the input stack
         if (var2)
@@ -242,6 +254,24 @@ void CBotLeftExpr::RestoreStateVar(CBotStack* &pile, bool bMain)
          m_next3->RestoreStateVar(pile, bMain);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotLeftExpr::GenerateBytecode(CBotBytecode& code, int reg)
+{
+    // only plain local variables, no fields or indexes
+    if (m_nIdent <= 0 || m_next3 != nullptr) return false;
+
+    code.EmitVar(reg, m_nIdent, 0);                 // read by ExecuteVar(), without a step
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotLeftExpr::GenerateStoreBytecode(CBotBytecode& code, int reg, bool bSameType)
+{
+    if (m_nIdent <= 0 || m_next3 != nullptr) return false;
+
+    return code.EmitStore(reg, m_nIdent, bSameType) >= 0;
+}
+
 std::string CBotLeftExpr::GetDebugData()
 {
     std::stringstream ss;
@@ -26,6 +26,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 namespace CBot
 {
@@ -127,6 +128,15 @@ void CBotListExpression::RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotListExpression::GenerateStatementBytecode(CBotBytecode& code)
+{
+    for (CBotInstr* p = m_expr; p != nullptr; p = p->GetNext())
+    {
+        p->GenerateStatementBytecode(code);
+    }
+}
+
 std::map<std::string, CBotInstr*> CBotListExpression::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
@@ -22,6 +22,7 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 namespace CBot
 {
@@ -44,6 +45,9 @@ CBotInstr* CBotListInstr::Compile(CBotToken* &p, CBotCStack* pStack, bool bLocal
     CBotCStack* pStk = pStack->TokenStack(p, bLocal);        // variables are local
 
     CBotListInstr* inst = new CBotListInstr();
+    CBotProgram* prog = pStack->GetProgram();
+    bool bOptimize = prog != nullptr && prog->IsOptimizeEnabled();
+    bool bReachable = true;
 
     while (true)
     {
@@ -67,6 +71,18 @@ CBotInstr* CBotListInstr::Compile(CBotToken* &p, CBotCStack* pStack, bool bLocal
             return pStack->Return(nullptr, pStk);
         }
 
+        if (bOptimize && i != nullptr)
+        {
+            // statements never reached or without effect are only compiled for their errors
+            if (!bReachable || !i->HasEffect())
+            {
+                delete i;
+                continue;
+            }
+            int type = i->GetTokenType();
+            bReachable = type != ID_RETURN && type != ID_BREAK && type != ID_CONTINUE && type != ID_THROW;
+        }
+
         if (inst->m_instr == nullptr) inst->m_instr = i;
         else inst->m_instr->AddNext(i);                            // added a result
     }
@@ -78,7 +94,7 @@ bool CBotListInstr::Execute(CBotStack* &pj)
 {
 
     CBotStack*    pile = pj->AddStack(this, CBotStack::BlockVisibilityType::BLOCK);                //needed for SetState()
-    if (pile->StackOver() ) return pj->Return( pile);
+    if (pile->StackOver() || pile->MemoryOver() ) return pj->Return( pile);
 
 
     CBotInstr*    p = m_instr;                                    // the first expression
@@ -117,6 +133,25 @@ void CBotListInstr::RestoreState(CBotStack* &pj, bool bMain)
     if (p != nullptr) p->RestoreState(pile, true);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotListInstr::GenerateStatementBytecode(CBotBytecode& code)
+{
+    int block = code.BeginBlock(this);
+    for (CBotInstr* p = m_instr; p != nullptr; p = p->GetNext())
+    {
+        int statement = code.BeginStatement(p, p == m_instr ? 0 : 1);     // IncState() between the statements
+        p->GenerateStatementBytecode(code);
+        code.EndStatement(statement);
+    }
+    code.EndBlock(block);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotListInstr::HasEffect()
+{
+    return m_instr != nullptr;
+}
+
 std::map<std::string, CBotInstr*> CBotListInstr::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
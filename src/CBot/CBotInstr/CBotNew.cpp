@@ -27,6 +27,7 @@
 #include "CBot/CBotInstr/CBotInstrUtils.h"
 
 #include "CBot/CBotVar/CBotVar.h"
+#include "CBot/CBotVar/CBotVarClass.h"
 
 namespace CBot
 {
@@ -126,6 +127,9 @@ bool CBotNew::Execute(CBotStack* &pj)
 
     if ( pile->GetState()==0)
     {
+        // the destructor is executed without interruption wherever the instance is released
+        if ( pClass->HasDestructor() && !pile->RunOnMainThread() ) return false;
+
         // create an instance of the requested class
         // and initialize the pointer to that object
 
@@ -177,11 +181,14 @@ bool CBotNew::Execute(CBotStack* &pj)
 
         if ( !pClass->ExecuteMethode(m_nMethodeIdent, pClass->GetName(),
                                      pThis, ppVars,
-                                     pResult, pile2, GetToken())) return false;    // interrupt
+                                     pResult, pile2, GetToken(), &m_cache)) return false;    // interrupt
 
         pThis->ConstructorSet();    // indicates that the constructor has been called
     }
 
+    // the value of a class held inline is passed below without the instance
+    if ( pClass->IsInline() ) pile1->SetCopyVar(pThis->GetPointer());
+
     return pj->Return(pile1);   // passes below
 }
 
@@ -244,6 +251,13 @@ void CBotNew::RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+void CBotNew::ShiftPosition(int delta)
+{
+    CBotInstr::ShiftPosition(delta);
+    m_vartoken.SetPos(m_vartoken.GetStart() + delta, m_vartoken.GetEnd() + delta);
+}
+
+////////////////////////////////////////////////////////////////////////////////
 std::string CBotNew::GetDebugData()
 {
     std::stringstream ss;
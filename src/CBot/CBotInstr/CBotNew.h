@@ -21,6 +21,8 @@
 
 #include "CBot/CBotInstr/CBotInstr.h"
 
+#include "CBot/CBotCallCache.h"
+
 namespace CBot
 {
 
@@ -55,6 +57,8 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    void ShiftPosition(int delta) override;
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotNew"; }
     virtual std::string GetDebugData() override;
@@ -64,6 +68,8 @@ private:
     //! The parameters to be evaluated
     CBotInstr* m_parameters;
     long m_nMethodeIdent;
+    //! Constructor called the last time
+    CBotCallCache m_cache;
     CBotToken m_vartoken;
 
 };
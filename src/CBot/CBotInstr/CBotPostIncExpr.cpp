@@ -21,6 +21,7 @@
 #include "CBot/CBotInstr/CBotExprVar.h"
 
 #include "CBot/CBotStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -85,6 +86,21 @@ void CBotPostIncExpr::RestoreState(CBotStack* &pj, bool bMain)
     if (pile1 != nullptr) pile1->RestoreStack(this);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotPostIncExpr::GenerateStatementBytecode(CBotBytecode& code)
+{
+    // as a statement, the value is not used: x = x + 1 in the type of x
+    CBotExprVar* var = static_cast<CBotExprVar*>(m_instr);
+    CBotBytecode::Opcode op = GetTokenType() == ID_INC ? CBotBytecode::Opcode::Add : CBotBytecode::Opcode::Sub;
+
+    int start = code.BeginExpression(this, false, 0);   // SetState(1) is counted as the read of the variable
+    bool ok = var->GenerateBytecode(code, 0) &&
+              code.EmitInt(1, 1) >= 0 &&
+              code.Emit(op, 0, 1) >= 0 &&
+              var->GenerateStoreBytecode(code, 0, true);
+    code.EndExpression(start, ok);
+}
+
 std::map<std::string, CBotInstr*> CBotPostIncExpr::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
@@ -21,6 +21,7 @@
 #include "CBot/CBotInstr/CBotExprVar.h"
 
 #include "CBot/CBotStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -93,6 +94,21 @@ void CBotPreIncExpr::RestoreState(CBotStack* &pj, bool bMain)
     m_instr->RestoreState(pile, bMain);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotPreIncExpr::GenerateStatementBytecode(CBotBytecode& code)
+{
+    // as a statement, the value is not used: x = x + 1 in the type of x
+    CBotExprVar* var = static_cast<CBotExprVar*>(m_instr);
+    CBotBytecode::Opcode op = GetTokenType() == ID_INC ? CBotBytecode::Opcode::Add : CBotBytecode::Opcode::Sub;
+
+    int start = code.BeginExpression(this, false, 1);   // IncState(), then the variable is read again
+    bool ok = var->GenerateBytecode(code, 0) &&
+              code.EmitInt(1, 1) >= 0 &&
+              code.Emit(op, 0, 1) >= 0 &&
+              var->GenerateStoreBytecode(code, 0, true);
+    code.EndExpression(start, ok);
+}
+
 std::map<std::string, CBotInstr*> CBotPreIncExpr::GetDebugLinks()
 {
     auto links = CBotInstr::GetDebugLinks();
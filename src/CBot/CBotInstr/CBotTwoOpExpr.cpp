@@ -24,9 +24,12 @@
 #include "CBot/CBotInstr/CBotParExpr.h"
 #include "CBot/CBotInstr/CBotLogicExpr.h"
 #include "CBot/CBotInstr/CBotExpression.h"
+#include "CBot/CBotInstr/CBotExprLitBool.h"
+#include "CBot/CBotInstr/CBotExprLitNum.h"
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotBytecode.h"
 
 #include "CBot/CBotVar/CBotVar.h"
 
@@ -41,6 +44,9 @@ CBotTwoOpExpr::CBotTwoOpExpr()
 {
     m_leftop    = nullptr;
     m_rightop   = nullptr;
+    m_bytecode  = nullptr;
+    m_kind      = Kind::Generic;
+    m_opcode    = CBotBytecode::Opcode::Add;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -48,6 +54,7 @@ CBotTwoOpExpr::~CBotTwoOpExpr()
 {
     delete  m_leftop;
     delete  m_rightop;
+    delete  m_bytecode;
 }
 
 // This list contains all possible operations
@@ -134,11 +141,31 @@ bool TypeOk(int type, int test)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack, int* pOperations)
+CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack)
+{
+    CBotInstr* inst = CompileOperations(p, pStack, ListOp);
+
+    // lowers the whole expression if it only works on primitive values
+    // (expressions in parentheses were lowered on their own, and are part of it)
+    CBotTwoOpExpr* expr = dynamic_cast<CBotTwoOpExpr*>(inst);
+    CBotProgram* prog = pStack->GetProgram();
+    if ( expr != nullptr && prog != nullptr && prog->IsBytecodeEnabled() )
+    {
+        expr->m_bytecode = CBotBytecode::Compile(expr);
+        if ( expr->m_bytecode != nullptr )
+        {
+            expr->m_leftop->DropBytecode();
+            expr->m_rightop->DropBytecode();
+        }
+    }
+    return inst;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotInstr* CBotTwoOpExpr::CompileOperations(CBotToken* &p, CBotCStack* pStack, int* pOperations)
 {
     int typeMask;
 
-    if ( pOperations == nullptr ) pOperations = ListOp;
     int* pOp = pOperations;
     while ( *pOp++ != 0 );              // follows the table
 
@@ -147,7 +174,7 @@ CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack, int* pOpera
     // search the intructions that may be suitable to the left of the operation
     CBotInstr*  left = (*pOp == 0) ?
                         CBotParExpr::Compile( p, pStk ) :       // expression (...) left
-                        CBotTwoOpExpr::Compile( p, pStk, pOp ); // expression A * B left
+                        CompileOperations( p, pStk, pOp );      // expression A * B left
 
     if (left == nullptr) return pStack->Return(nullptr, pStk);        // if error,  transmit
 
@@ -207,7 +234,7 @@ CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack, int* pOpera
 
         // looking statements that may be suitable for right
 
-        if ( nullptr != (inst->m_rightop = CBotTwoOpExpr::Compile( p, pStk, pOp )) )
+        if ( nullptr != (inst->m_rightop = CompileOperations( p, pStk, pOp )) )
                                                                 // expression (...) right
         {
             // there is an second operand acceptable
@@ -246,6 +273,7 @@ CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack, int* pOpera
             {
                 // ok so, saves the operand in the object
                 inst->m_leftop = left;
+                Specialize(inst, type1, type2);
 
                 // special for evaluation of the operations of the same level from left to right
                 while ( IsInList(p->GetType(), pOperations, typeMask) ) // same operation(s) follows?
@@ -253,11 +281,11 @@ CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack, int* pOpera
                     typeOp = p->GetType();
                     CBotTwoOpExpr* i = new CBotTwoOpExpr();             // element for operation
                     i->SetToken(p);                                     // stores the operation
-                    i->m_leftop = inst;                                 // left operand
+                    i->m_leftop = Fold(inst, pStk);                     // left operand
                     type1 = TypeRes;
 
                     p = p->GetNext();                                       // advance after
-                    i->m_rightop = CBotTwoOpExpr::Compile( p, pStk, pOp );
+                    i->m_rightop = CompileOperations( p, pStk, pOp );
                     type2 = pStk->GetTypResult();
 
                     if ( !TypeCompatible (type1, type2, typeOp) )       // the results are compatible
@@ -266,6 +294,7 @@ CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack, int* pOpera
                         delete i;
                         return pStack->Return(nullptr, pStk);
                     }
+                    Specialize(i, type1, type2);
 
                     if ( TypeRes != CBotTypString )
                         TypeRes = std::max(type1.GetType(), type2.GetType());
@@ -277,6 +306,10 @@ CBotInstr* CBotTwoOpExpr::Compile(CBotToken* &p, CBotCStack* pStack, int* pOpera
                 // is a variable on the stack for the type of result
                 pStk->SetVar(CBotVar::Create("", t));
 
+                // an operation on constants is replaced by its result
+                CBotInstr* folded = Fold(inst, pStk);
+                if ( folded != inst ) return pStack->Return(folded, pStk);
+
                 // and returns the requested object
                 return pStack->Return(inst, pStk);
             }
@@ -312,6 +345,85 @@ bool IsNan(CBotVar* left, CBotVar* right, CBotError* err = nullptr)
     return false;
 }
 
+// gives the bytecode operation doing the same as the operator
+static bool GetOpcode(int tokenType, CBotBytecode::Opcode& op)
+{
+    switch (tokenType)
+    {
+    case ID_ADD:        op = CBotBytecode::Opcode::Add;     break;
+    case ID_SUB:        op = CBotBytecode::Opcode::Sub;     break;
+    case ID_MUL:        op = CBotBytecode::Opcode::Mul;     break;
+    case ID_DIV:        op = CBotBytecode::Opcode::Div;     break;
+    case ID_MODULO:     op = CBotBytecode::Opcode::Modulo;  break;
+    case ID_POWER:      op = CBotBytecode::Opcode::Power;   break;
+    case ID_LO:         op = CBotBytecode::Opcode::Lo;      break;
+    case ID_HI:         op = CBotBytecode::Opcode::Hi;      break;
+    case ID_LS:         op = CBotBytecode::Opcode::Ls;      break;
+    case ID_HS:         op = CBotBytecode::Opcode::Hs;      break;
+    case ID_EQ:         op = CBotBytecode::Opcode::Eq;      break;
+    case ID_NE:         op = CBotBytecode::Opcode::Ne;      break;
+    case ID_AND:        op = CBotBytecode::Opcode::And;     break;
+    case ID_OR:         op = CBotBytecode::Opcode::Or;      break;
+    case ID_XOR:        op = CBotBytecode::Opcode::XOr;     break;
+    case ID_TXT_AND:
+    case ID_LOG_AND:    op = CBotBytecode::Opcode::LogAnd;  break;
+    case ID_TXT_OR:
+    case ID_LOG_OR:     op = CBotBytecode::Opcode::LogOr;   break;
+    case ID_SL:         op = CBotBytecode::Opcode::SL;      break;
+    case ID_SR:         op = CBotBytecode::Opcode::SR;      break;
+    case ID_ASR:        op = CBotBytecode::Opcode::ASR;     break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotInstr* CBotTwoOpExpr::Fold(CBotTwoOpExpr* inst, CBotCStack* pStack)
+{
+    CBotProgram* prog = pStack->GetProgram();
+    if ( prog == nullptr || !prog->IsOptimizeEnabled() ) return inst;
+
+    CBotValue   left, right;
+    CBotBytecode::Opcode op;
+    if ( !inst->m_leftop->GetConstant(left) || !inst->m_rightop->GetConstant(right) ||
+         !GetOpcode(inst->GetTokenType(), op) ||
+         !CBotBytecode::Binary(op, left, right) ) return inst;    // errors are left for the execution
+
+    // the literal covers the whole expression
+    CBotToken   token(inst->m_token);
+    token.SetPos(inst->m_leftop->GetToken()->GetStart(), inst->m_rightop->GetToken()->GetEnd());
+
+    CBotInstr*  literal = left.type == CBotTypBoolean ? CBotExprLitBool::Create(token, left.valInt != 0) :
+                                                        CBotExprLitNum::Create(token, left);
+    delete inst;
+    return literal;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotTwoOpExpr::Specialize(CBotTwoOpExpr* inst, const CBotTypResult& type1, const CBotTypResult& type2)
+{
+    // the division of two ints gives a float
+    const int t1 = inst->m_leftop->IsFloatResult()  ? static_cast<int>(CBotTypFloat) : type1.GetType();
+    const int t2 = inst->m_rightop->IsFloatResult() ? static_cast<int>(CBotTypFloat) : type2.GetType();
+
+    inst->m_kind = Kind::Generic;
+    if ( inst->GetTokenType() == ID_ADD && (t1 == CBotTypString || t2 == CBotTypString) )
+    {
+        inst->m_kind = Kind::Concat;
+        return;
+    }
+
+    if ( !GetOpcode(inst->GetTokenType(), inst->m_opcode) ) return;
+
+    if ( t1 == CBotTypInt && t2 == CBotTypInt )
+        inst->m_kind = Kind::Integer;
+    else if ( (t1 == CBotTypInt || t1 == CBotTypFloat) && (t2 == CBotTypInt || t2 == CBotTypFloat) )
+        inst->m_kind = Kind::Float;
+    else if ( t1 == CBotTypBoolean && t2 == CBotTypBoolean )
+        inst->m_kind = Kind::Boolean;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotTwoOpExpr::Execute(CBotStack* &pStack)
 {
@@ -319,6 +431,21 @@ bool CBotTwoOpExpr::Execute(CBotStack* &pStack)
                                                 // or return in case of recovery
 //  if ( pStk1 == EOX ) return true;
 
+    // evaluates everything at once if the expression has been lowered to bytecode
+    // (except step by step, and if anything goes wrong the tree does it again)
+    if ( m_bytecode != nullptr && !m_bytecode->IsDisabled() &&
+         pStk1->GetState() == 0 && pStk1->GetTimer() > 0 )
+    {
+        CBotValue   result;
+        int         steps;
+        if ( m_bytecode->Execute(pStk1, result, steps) )
+        {
+            pStk1->ConsumeTimer(steps);
+            pStk1->SetValue(result);
+            return pStack->Return(pStk1);           // transmits the result
+        }
+    }
+
     // according to recovery, it may be in one of two states
 
     if ( pStk1->GetState() == 0 )                   // first state, evaluates the left operand
@@ -328,16 +455,18 @@ bool CBotTwoOpExpr::Execute(CBotStack* &pStack)
         // for OR and AND logic does not evaluate the second expression if not necessary
         if ( (GetTokenType() == ID_LOG_AND || GetTokenType() == ID_TXT_AND ) && pStk1->GetVal() == false )
         {
-            CBotVar*    res = CBotVar::Create("", CBotTypBoolean);
-            res->SetValInt(false);
-            pStk1->SetVar(res);
+            CBotValue   res;
+            res.type = CBotTypBoolean;
+            res.valInt = false;
+            pStk1->SetValue(res);
             return pStack->Return(pStk1);               // transmits the result
         }
         if ( (GetTokenType() == ID_LOG_OR||GetTokenType() == ID_TXT_OR) && pStk1->GetVal() == true )
         {
-            CBotVar*    res = CBotVar::Create("", CBotTypBoolean);
-            res->SetValInt(true);
-            pStk1->SetVar(res);
+            CBotValue   res;
+            res.type = CBotTypBoolean;
+            res.valInt = true;
+            pStk1->SetValue(res);
             return pStack->Return(pStk1);               // transmits the result
         }
 
@@ -359,13 +488,58 @@ bool CBotTwoOpExpr::Execute(CBotStack* &pStack)
         pStk2->IncState();
     }
 
+    CBotStack* pStk3 = pStk2->AddStack(this);               // adds an item to the stack
+    if ( pStk3->IfStep() ) return false;                    // shows the operation if step by step
+
+    // operations on primitive values are done without creating variables
+    // (a division by zero goes on below, to create the error as usual)
+    CBotValue   leftValue, rightValue;
+    if ( m_kind != Kind::Concat && pStk1->GetValue(leftValue) && pStk2->GetValue(rightValue) )
+    {
+        bool done;
+        switch (m_kind)
+        {
+        case Kind::Integer:
+            done = CBotBytecode::BinaryInt(m_opcode, leftValue.GetValInt(), rightValue.GetValInt(), leftValue);
+            break;
+        case Kind::Float:
+            done = CBotBytecode::BinaryFloat(m_opcode, leftValue.GetValFloat(), rightValue.GetValFloat(), leftValue);
+            break;
+        case Kind::Boolean:
+            done = CBotBytecode::BinaryBool(m_opcode, leftValue.GetValInt(), rightValue.GetValInt(), leftValue);
+            break;
+        default:
+        {
+            CBotBytecode::Opcode op;
+            done = GetOpcode(GetTokenType(), op) && CBotBytecode::Binary(op, leftValue, rightValue);
+        }
+        }
+        if ( done )
+        {
+            pStk2->SetValue(leftValue);
+            return pStack->Return(pStk2);                   // transmits the result
+        }
+    }
+
+    if ( m_kind == Kind::Concat )
+    {
+        // no temporary variable is needed to add strings
+        CBotVar*    left  = pStk1->GetVar();
+        CBotVar*    right = pStk2->GetVar();
+        CBotVar*    result = CBotVar::Create("", CBotTypString);
+
+        CBotError err = CBotNoErr;
+        if ( !IsNan(left, right, &err) ) result->Add(left , right);
+
+        pStk2->SetVar(result);
+        if ( err ) pStk2->SetError(err, &m_token);
+        return pStack->Return(pStk2);
+    }
+
     assert(pStk1->GetVar() != nullptr && pStk2->GetVar() != nullptr);
     CBotTypResult       type1 = pStk1->GetVar()->GetTypResult();      // what kind of results?
     CBotTypResult       type2 = pStk2->GetVar()->GetTypResult();
 
-    CBotStack* pStk3 = pStk2->AddStack(this);               // adds an item to the stack
-    if ( pStk3->IfStep() ) return false;                    // shows the operation if step by step
-
     // creates a temporary variable to put the result
     // what kind of result?
     int TypeRes = std::max(type1.GetType(), type2.GetType());
@@ -523,6 +697,53 @@ void CBotTwoOpExpr::RestoreState(CBotStack* &pStack, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotTwoOpExpr::GenerateBytecode(CBotBytecode& code, int reg)
+{
+    CBotBytecode::Opcode op;
+    if ( !GetOpcode(GetTokenType(), op) ) return false;
+
+    if ( !m_leftop->GenerateBytecode(code, reg) ) return false;
+
+    // the second operand of && and || is evaluated only if necessary
+    int jump = -1;
+    if ( op == CBotBytecode::Opcode::LogAnd ) jump = code.Emit(CBotBytecode::Opcode::JumpIfFalse, reg);
+    if ( op == CBotBytecode::Opcode::LogOr )  jump = code.Emit(CBotBytecode::Opcode::JumpIfTrue, reg);
+
+    if ( !m_rightop->GenerateBytecode(code, reg + 1) ) return false;
+
+    code.Emit(op, reg, reg + 1, 2);             // same as SetState(1) and IncState()
+    code.PatchJump(jump);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotTwoOpExpr::IsFloatResult()
+{
+    switch (GetTokenType())
+    {
+    case ID_DIV:
+        return true;
+    case ID_ADD:
+    case ID_SUB:
+    case ID_MUL:
+    case ID_MODULO:
+    case ID_POWER:
+        return m_kind == Kind::Float;           // an operand is itself a division
+    default:
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotTwoOpExpr::DropBytecode()
+{
+    delete m_bytecode;
+    m_bytecode = nullptr;
+    m_leftop->DropBytecode();
+    m_rightop->DropBytecode();
+}
+
 std::string CBotTwoOpExpr::GetDebugData()
 {
     return m_token.GetString();
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "CBot/CBotInstr/CBotInstr.h"
+#include "CBot/CBotBytecode.h"
 
 namespace CBot
 {
@@ -59,13 +60,13 @@ public:
     ~CBotTwoOpExpr();
 
     /*!
-     * \brief Compiles CBotTwoOpExpr or CBotLogicExpr
+     * \brief Compiles CBotTwoOpExpr or CBotLogicExpr, and lowers it to bytecode
+     * if possible (see CBotProgram::SetBytecodeEnabled())
      * \param p
      * \param pStack
-     * \param pOperations
      * \return
      */
-    static CBotInstr* Compile(CBotToken* &p, CBotCStack* pStack, int* pOperations = nullptr);
+    static CBotInstr* Compile(CBotToken* &p, CBotCStack* pStack);
 
     /*!
      * \brief Execute Performes the operation on two operands.
@@ -81,16 +82,75 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateBytecode
+     * \param code
+     * \param reg
+     * \return
+     */
+    bool GenerateBytecode(CBotBytecode& code, int reg) override;
+
+    /*!
+     * \brief DropBytecode
+     */
+    void DropBytecode() override;
+
+    bool IsFloatResult() override;
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotTwoOpExpr"; }
     virtual std::string GetDebugData() override;
     virtual std::map<std::string, CBotInstr*> GetDebugLinks() override;
 
 private:
+    //! How the operation is evaluated, chosen when compiling from the types of the operands
+    enum class Kind : unsigned char
+    {
+        Generic,        //!< operation on variables, chosen at execution from their types
+        Integer,        //!< int with int (see CBotBytecode::BinaryInt())
+        Float,          //!< float with float or int (see CBotBytecode::BinaryFloat())
+        Boolean,        //!< bool with bool (see CBotBytecode::BinaryBool())
+        Concat,         //!< + with a string, creates only the resulting string
+    };
+
+    /*!
+     * \brief CompileOperations Compiles the operations of the level of priority
+     * pOperations, with operands compiled at the next levels
+     * \param p
+     * \param pStack
+     * \param pOperations
+     * \return
+     */
+    static CBotInstr* CompileOperations(CBotToken* &p, CBotCStack* pStack, int* pOperations);
+
+    /*!
+     * \brief Specialize Chooses how the operation is evaluated,
+     * an operand which gives a float at run time counts as a float (see IsFloatResult())
+     * \param inst The operation, with its operands
+     * \param type1 Type of the left operand
+     * \param type2 Type of the right operand
+     */
+    static void Specialize(CBotTwoOpExpr* inst, const CBotTypResult& type1, const CBotTypResult& type2);
+
+    /*!
+     * \brief Fold Replaces an operation on two constants by its result,
+     * if the program is optimized (see CBotProgram::SetOptimizeEnabled()).
+     * \param inst The operation, deleted if it is replaced
+     * \param pStack
+     * \return The literal replacing inst, or inst
+     */
+    static CBotInstr* Fold(CBotTwoOpExpr* inst, CBotCStack* pStack);
+
     //! Left element
     CBotInstr* m_leftop;
     //! Right element
     CBotInstr* m_rightop;
+    //! Whole expression lowered to bytecode, if possible
+    CBotBytecode* m_bytecode;
+    //! Evaluation chosen by Specialize()
+    Kind m_kind;
+    //! The operation, for primitive values
+    CBotBytecode::Opcode m_opcode;
 };
 
 } // namespace CBot
@@ -23,6 +23,8 @@
 
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
+#include "CBot/CBotProgram.h"
+#include "CBot/CBotBytecode.h"
 
 namespace CBot
 {
@@ -32,6 +34,7 @@ CBotWhile::CBotWhile()
 {
     m_condition = nullptr;
     m_block = nullptr;
+    m_bytecode = nullptr;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -39,6 +42,7 @@ CBotWhile::~CBotWhile()
 {
     delete m_condition;    // frees the condition
     delete m_block;        // releases the block instruction
+    delete m_bytecode;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -71,6 +75,10 @@ CBotInstr* CBotWhile::Compile(CBotToken* &p, CBotCStack* pStack)
         {
             // the statement block is ok (it may be empty!
 
+            // lowers the whole loop with the statements in it, see CBotBytecode::Run()
+            CBotProgram* prog = pStack->GetProgram();
+            if ( prog != nullptr && prog->IsBytecodeEnabled() ) inst->m_bytecode = CBotBytecode::CompileLoop(inst);
+
             return pStack->Return(inst, pStk);  // return an object to the application
                                                 // makes the object to which the application
         }
@@ -89,6 +97,10 @@ bool CBotWhile::Execute(CBotStack* &pj)
 
     if ( pile->IfStep() ) return false;
 
+    // executes the whole loop as bytecode, unless it has been started step by step
+    if ( m_bytecode != nullptr && (pile->GetState() < 0 || pile->IsFresh()) )
+        return m_bytecode->Run(pj, pile);
+
     while( true ) switch( pile->GetState() )    // executes the loop
     {                                           // there are two possible states (depending on recovery)
     case 0:
@@ -116,8 +128,8 @@ bool CBotWhile::Execute(CBotStack* &pj)
             return pj->BreakReturn(pile, m_label);      // sends the results and releases the stack
         }
 
-        // terminates if there is an error
-        if ( !pile->IsOk() )
+        // terminates if there is an error, or if the loop used up the memory
+        if ( !pile->IsOk() || pile->MemoryOver() )
         {
             return pj->Return(pile);                    // sends the results and releases the stack
         }
@@ -135,6 +147,12 @@ void CBotWhile::RestoreState(CBotStack* &pj, bool bMain)
     CBotStack* pile = pj->RestoreStack(this);   // adds an item to the stack
     if ( pile == nullptr ) return;
 
+    if ( pile->GetState() < 0 )                 // suspended in the bytecode
+    {
+        if ( m_bytecode != nullptr ) m_bytecode->RestoreState(pile);
+        return;
+    }
+
     switch( pile->GetState() )
     {                                           // there are two possible states (depending on recovery)
     case 0:
@@ -149,6 +167,26 @@ void CBotWhile::RestoreState(CBotStack* &pj, bool bMain)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotWhile::GenerateStatementBytecode(CBotBytecode& code)
+{
+    if (!code.IsRoot(this))
+    {
+        delete m_bytecode;                      // lowered with the loop around it
+        m_bytecode = nullptr;
+    }
+
+    int loop = code.BeginLoop(m_label);         // "continue" returns to the test
+    int test = code.GetPosition();
+    code.EmitCondition(m_condition);
+    int exit = code.EmitBranch(1, false);       // SetState(1)
+    if (m_block != nullptr) m_block->GenerateStatementBytecode(code);
+    code.EmitEndBody();
+    code.EmitLoop(test, 1, 0);                  // SetState(0, 0)
+    code.PatchJump(exit);
+    code.EndLoop(loop);
+}
+
 std::string CBotWhile::GetDebugData()
 {
     return !m_label.empty() ? "m_label = "+m_label : "";
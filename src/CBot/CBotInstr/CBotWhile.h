@@ -64,6 +64,12 @@ public:
      */
     void RestoreState(CBotStack* &pj, bool bMain) override;
 
+    /*!
+     * \brief GenerateStatementBytecode
+     * \param code
+     */
+    void GenerateStatementBytecode(CBotBytecode& code) override;
+
 protected:
     virtual const std::string GetDebugName() override { return "CBotWhile"; }
     virtual std::string GetDebugData() override;
@@ -76,6 +82,8 @@ private:
     CBotInstr* m_block;
     //! A label if there is
     std::string m_label;
+    //! Whole loop lowered to bytecode, if possible
+    CBotBytecode* m_bytecode;
 };
 
 } // namespace CBot
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#include "CBot/CBotMemoryPool.h"
+
+#include <new>
+
+namespace CBot
+{
+
+namespace
+{
+
+//! Blocks are rounded up to a multiple of this
+const std::size_t GRANULARITY = 16;
+//! Larger blocks are not recycled
+const std::size_t MAX_SIZE = 256;
+const std::size_t SIZE_CLASSES = MAX_SIZE / GRANULARITY;
+//! Free blocks kept per size class
+const std::size_t MAX_FREE_BLOCKS = 4096;
+
+struct FreeBlock
+{
+    FreeBlock* next;
+};
+
+//! Free lists of one thread (trivially destructible, so still usable while the thread exits)
+struct FreeLists
+{
+    FreeBlock*  head[SIZE_CLASSES];
+    std::size_t count[SIZE_CLASSES];
+    //! Set once the release at thread exit is registered
+    bool        registered;
+    //! Set when the thread exits, blocks released later go back to the system
+    bool        closed;
+};
+
+thread_local FreeLists t_freeLists;
+
+//! Gives the free blocks back to the system when the thread exits
+struct FreeListsRelease
+{
+    ~FreeListsRelease()
+    {
+        for (std::size_t i = 0; i < SIZE_CLASSES; i++)
+        {
+            while (t_freeLists.head[i] != nullptr)
+            {
+                FreeBlock* block = t_freeLists.head[i];
+                t_freeLists.head[i] = block->next;
+                ::operator delete(block);
+            }
+            t_freeLists.count[i] = 0;
+        }
+        t_freeLists.closed = true;
+    }
+};
+
+thread_local FreeListsRelease t_freeListsRelease;
+
+//! Returns the free lists of the thread, before their first use
+FreeLists& GetFreeLists()
+{
+    if (!t_freeLists.registered)
+    {
+        t_freeLists.registered = true;
+        static_cast<void>(&t_freeListsRelease);     // constructs it, so that it is destroyed at thread exit
+    }
+    return t_freeLists;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+void* CBotMemoryPool::Allocate(std::size_t size)
+{
+    if (size == 0 || size > MAX_SIZE) return ::operator new(size);
+
+    FreeLists& lists = GetFreeLists();
+    std::size_t i = (size - 1) / GRANULARITY;
+    FreeBlock* block = lists.head[i];
+    if (block == nullptr) return ::operator new((i + 1) * GRANULARITY);
+
+    lists.head[i] = block->next;
+    lists.count[i]--;
+    return block;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotMemoryPool::Free(void* p, std::size_t size)
+{
+    if (p == nullptr) return;
+
+    if (size == 0 || size > MAX_SIZE)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    FreeLists& lists = GetFreeLists();
+    std::size_t i = (size - 1) / GRANULARITY;
+    if (lists.closed || lists.count[i] >= MAX_FREE_BLOCKS)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = lists.head[i];
+    lists.head[i] = block;
+    lists.count[i]++;
+}
+
+} // namespace CBot
@@ -0,0 +1,61 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#pragma once
+
+#include <cstddef>
+
+namespace CBot
+{
+
+/**
+ * \brief Recycles the memory of the small objects created during execution
+ *
+ * Variables (CBotVar) and their names (CBotToken) are created and destroyed
+ * for each value of a class passed around, like the intrinsic "point" of the
+ * game: a copy, a parameter or a return value each allocate an instance, its
+ * name and each of its members. Their memory is taken from free lists of
+ * blocks of the same size class instead of the general purpose allocator, so
+ * that a program working on such values doesn't allocate anything once its
+ * loop has run once.
+ *
+ * The free lists are kept per thread, so that no lock is needed. A block may
+ * be released by another thread than the one which allocated it, it then
+ * simply goes to the free list of that thread. Each list is limited in size,
+ * the blocks beyond are given back to the system.
+ */
+class CBotMemoryPool
+{
+public:
+    /**
+     * \brief Allocates a block
+     * \param size Size of the block, larger blocks are allocated with ::operator new
+     */
+    static void* Allocate(std::size_t size);
+
+    /**
+     * \brief Releases a block
+     * \param p Block returned by Allocate()
+     * \param size The same size as given to Allocate()
+     */
+    static void Free(void* p, std::size_t size);
+};
+
+} // namespace CBot
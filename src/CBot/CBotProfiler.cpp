@@ -0,0 +1,127 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#include "CBot/CBotProfiler.h"
+
+#include <algorithm>
+
+namespace CBot
+{
+
+namespace
+{
+
+void Add(CBotProfiler::Entry& entry, long steps, double time)
+{
+    entry.samples++;
+    entry.steps += steps;
+    entry.time += time;
+}
+
+/**
+ * \brief Converts positions in the source code to line numbers
+ */
+class LineTable
+{
+public:
+    LineTable(const std::string& source)
+    {
+        m_starts.push_back(0);
+        for (std::size_t i = 0; i < source.size(); i++)
+        {
+            if (source[i] == '\n') m_starts.push_back(static_cast<int>(i + 1));
+        }
+    }
+
+    int GetLine(int position) const
+    {
+        return static_cast<int>(std::upper_bound(m_starts.begin(), m_starts.end(), position) - m_starts.begin());
+    }
+
+private:
+    std::vector<int> m_starts;
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotProfiler::Frame::operator<(const Frame& other) const
+{
+    if (position != other.position) return position < other.position;
+    return function < other.function;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::Clear()
+{
+    m_total = Entry();
+    m_functions.clear();
+    m_positions.clear();
+    m_stacks.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::AddSample(const std::vector<Frame>& stack, long steps, double time)
+{
+    Add(m_total, steps, time);
+    if (stack.empty()) return;
+
+    const Frame& top = stack.back();
+    Add(m_functions[top.function], steps, time);
+    if (top.position >= 0) Add(m_positions[top.position], steps, time);
+    Add(m_stacks[stack], steps, time);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::map<int, CBotProfiler::Entry> CBotProfiler::GetLines(const std::string& source) const
+{
+    LineTable lines(source);
+    std::map<int, Entry> result;
+    for (const auto& position : m_positions)
+    {
+        Entry& entry = result[lines.GetLine(position.first)];
+        entry.samples += position.second.samples;
+        entry.steps += position.second.steps;
+        entry.time += position.second.time;
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProfiler::WriteCollapsedStacks(std::ostream& out, const std::string& source, const std::string& root) const
+{
+    LineTable lines(source);
+    for (const auto& stack : m_stacks)
+    {
+        if (stack.second.steps <= 0) continue;
+
+        if (!root.empty()) out << root << ';';
+        for (std::size_t i = 0; i < stack.first.size(); i++)
+        {
+            const Frame& frame = stack.first[i];
+            if (i > 0) out << ';';
+            out << frame.function;
+            if (frame.position >= 0) out << ':' << lines.GetLine(frame.position);
+        }
+        out << ' ' << stack.second.steps << '\n';
+    }
+}
+
+} // namespace CBot
@@ -0,0 +1,129 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace CBot
+{
+
+/**
+ * \brief Collects where a program spends its execution steps and time
+ *
+ * The profiler is sampled by CBotProgram each time a run stops, i.e. when
+ * the timer ticks given to CBotProgram::Run() are used or the program waits
+ * for an external call. The steps and time of this run are attributed to
+ * the call stack where the program stopped. With the small timer used by
+ * the game (one run per frame), this gives a statistical picture of the
+ * hot spots without slowing down the execution of each instruction.
+ *
+ * \see CBotProgram::SetProfiler()
+ */
+class CBotProfiler
+{
+public:
+    /**
+     * \brief Steps and time attributed to a function, a position or a call stack
+     */
+    struct Entry
+    {
+        //! Number of samples
+        long    samples = 0;
+        //! Number of timer ticks used
+        long    steps = 0;
+        //! Execution time, in seconds
+        double  time = 0.0;
+    };
+
+    /**
+     * \brief One level of a call stack
+     */
+    struct Frame
+    {
+        //! Name of the function
+        std::string function;
+        //! Position of the instruction being executed, -1 if unknown
+        int         position;
+
+        bool operator<(const Frame& other) const;
+    };
+
+    /**
+     * \brief Removes all samples
+     */
+    void Clear();
+
+    /**
+     * \brief Adds a sample
+     * \param stack Call stack, outermost function first
+     * \param steps Timer ticks used since the previous sample
+     * \param time Time spent since the previous sample, in seconds
+     */
+    void AddSample(const std::vector<Frame>& stack, long steps, double time);
+
+    /**
+     * \brief Returns the total of all samples
+     */
+    const Entry& GetTotal() const { return m_total; }
+
+    /**
+     * \brief Returns the samples of each function, not including the functions it calls
+     */
+    const std::map<std::string, Entry>& GetFunctions() const { return m_functions; }
+
+    /**
+     * \brief Returns the samples of each instruction, by position in the program
+     */
+    const std::map<int, Entry>& GetPositions() const { return m_positions; }
+
+    /**
+     * \brief Returns the samples of each line of the program
+     * \param source Source code of the profiled program
+     * \return Entries by line number, starting at 1
+     */
+    std::map<int, Entry> GetLines(const std::string& source) const;
+
+    /**
+     * \brief Writes the call stacks in the "collapsed" format of flame graph tools
+     *
+     * Each line holds the frames separated by ';', written as function:line,
+     * followed by the number of steps, for example:
+     * \code
+     * Main:12;Compute:25 340
+     * \endcode
+     *
+     * \param out Output stream
+     * \param source Source code of the profiled program, used for line numbers
+     * \param root If not empty, added as the first frame of every stack
+     */
+    void WriteCollapsedStacks(std::ostream& out, const std::string& source, const std::string& root = "") const;
+
+private:
+    Entry                           m_total;
+    std::map<std::string, Entry>    m_functions;
+    std::map<int, Entry>            m_positions;
+    std::map<std::vector<Frame>, Entry> m_stacks;
+};
+
+} // namespace CBot
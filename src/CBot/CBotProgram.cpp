@@ -18,8 +18,10 @@
  */
 
 #include "CBot/CBotVar/CBotVar.h"
+#include "CBot/CBotVar/CBotVarClass.h"
 
 #include "CBot/CBotExternalCall.h"
+#include "CBot/CBotExecutionContext.h"
 #include "CBot/CBotStack.h"
 #include "CBot/CBotCStack.h"
 #include "CBot/CBotClass.h"
@@ -30,34 +32,65 @@
 
 #include "CBot/stdlib/stdlib.h"
 
+#include <chrono>
+#include <functional>
+
 namespace CBot
 {
 
+struct CBotProgram::SharedFunctions
+{
+    //! Source of the program, in case two sources have the same key
+    std::string source;
+    //! Value of IsBytecodeEnabled() when compiled
+    bool bytecode = false;
+    //! Value of IsOptimizeEnabled() when compiled
+    bool optimize = false;
+    //! Value of GetCompileKey() when compiled
+    int compileKey = 0;
+    //! Compiled functions, CBotFunction::m_pProg is nullptr
+    CBotFunction* functions = nullptr;
+    //! Names of the extern functions, as returned by Compile()
+    std::vector<std::string> externs;
+
+    ~SharedFunctions()
+    {
+        delete functions;
+    }
+};
+
 CBotExternalCallList* CBotProgram::m_externalCalls = new CBotExternalCallList();
+std::map<std::size_t, std::weak_ptr<CBotProgram::SharedFunctions>> CBotProgram::m_shared;
+std::mutex CBotProgram::m_sharedMutex;
 
 CBotProgram::CBotProgram()
+: m_context(new CBotExecutionContext())
 {
 }
 
 CBotProgram::CBotProgram(CBotVar* thisVar)
-: m_thisVar(thisVar)
+: m_thisVar(thisVar), m_context(new CBotExecutionContext())
 {
 }
 
 CBotProgram::~CBotProgram()
 {
+    CBotExecutionContext::Scope scope(m_context.get());     // for destructors of the remaining instances
+
 //  delete  m_classes;
     m_classes->Purge();
     m_classes = nullptr;
 
     CBotClass::FreeLock(this);
 
-    delete m_functions;
+    FreeFunctions();
     m_stack->Delete();
 }
 
 bool CBotProgram::Compile(const std::string& program, std::vector<std::string>& functions, void* pUser)
 {
+    CBotExecutionContext::Scope scope(m_context.get());     // for initializers of static fields
+
     // Cleanup the previously compiled program
     Stop();
 
@@ -65,11 +98,33 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
     m_classes->Purge();      // purge the old definitions of classes
                             // but without destroying the object
     m_classes = nullptr;
-    delete m_functions; m_functions = nullptr;
+    std::vector<std::unique_ptr<CBotFunction>> previous = TakeFunctions();
+    FreeFunctions();
 
     functions.clear();
     m_error = CBotNoErr;
 
+    // Step 0. Reuse the functions of another program with the same source
+    std::size_t key = 0;
+    bool bShare = !CBotFunction::HasPublicFunctions() && !CBotClass::HasUserDefinedClasses();
+    if (bShare)
+    {
+        key = GetSharedKey(program);
+        std::lock_guard<std::mutex> lock(m_sharedMutex);
+        auto it = m_shared.find(key);
+        std::shared_ptr<SharedFunctions> shared = it == m_shared.end() ? nullptr : it->second.lock();
+        if (shared != nullptr && shared->source == program &&
+            shared->bytecode == m_bytecodeEnabled && shared->optimize == m_optimizeEnabled &&
+            shared->compileKey == m_compileKey)
+        {
+            m_sharedFunctions = shared;
+            m_functions = shared->functions;
+            functions = shared->externs;
+            m_compiledRanges.clear();
+            return true;
+        }
+    }
+
     // Step 1. Process the code into tokens
     auto tokens = CBotToken::CompileTokens(program);
     if (tokens == nullptr) return false;
@@ -81,35 +136,64 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
     m_externalCalls->SetUserPtr(pUser);
 
     // Step 2. Find all function and class definitions
+    std::string decls;                                      // all the code outside of function blocks
+    std::vector<std::pair<int, int>> ranges;                // position of each function
     while ( pStack->IsOk() && p != nullptr && p->GetType() != 0)
     {
         if ( IsOfType(p, ID_SEP) ) continue;                // semicolons lurking
 
+        CBotToken* first = p;
         if ( p->GetType() == ID_CLASS ||
             ( p->GetType() == ID_PUBLIC && p->GetNext()->GetType() == ID_CLASS ))
         {
             CBotClass*  nxt = CBotClass::Compile1(p, pStack.get());
             if (m_classes == nullptr ) m_classes = nxt;
             else m_classes->AddNext(nxt);
+            if (!pStack->IsOk()) break;
+
+            int end = (p != nullptr && p->GetPrev() != nullptr) ? p->GetPrev()->GetEnd() : static_cast<int>(program.size());
+            decls += program.substr(first->GetStart(), end - first->GetStart());
         }
         else
         {
             CBotFunction*   next = CBotFunction::Compile1(p, pStack.get(), nullptr);
             if (m_functions == nullptr ) m_functions = next;
             else m_functions->AddNext(next);
+            if (!pStack->IsOk()) break;
+
+            int end = (p != nullptr && p->GetPrev() != nullptr) ? p->GetPrev()->GetEnd() : static_cast<int>(program.size());
+            ranges.push_back(std::make_pair(first->GetStart(), end));
+            CBotToken* block = first;
+            while (block->GetType() != ID_OPBLK) block = block->GetNext();
+            decls += program.substr(first->GetStart(), block->GetStart() - first->GetStart());
         }
+        decls += '\n';
     }
     if ( !pStack->IsOk() )
     {
         m_error = pStack->GetError(m_errorStart, m_errorEnd);
         delete m_functions;
         m_functions = nullptr;
+        m_compiledRanges.clear();
         return false;
     }
 
+    // Unchanged functions of the last compilation are kept if all the declarations are the same,
+    // the function identifiers too, so that calls compiled before still find them
+    std::size_t declsKey = GetSharedKey(decls) * 1000003 ^ CBotFunction::GetPublicHash();
+    std::vector<CBotFunction*> fresh;
+    for (CBotFunction* f = m_functions; f != nullptr; f = f->m_next) fresh.push_back(f);
+    bool bReuse = !previous.empty() && declsKey == m_compiledDecls && fresh.size() == previous.size();
+    if (bReuse)
+    {
+        for (std::size_t i = 0; i < fresh.size(); i++) fresh[i]->m_nFuncIdent = previous[i]->m_nFuncIdent;
+    }
+    std::vector<bool> reused(fresh.size(), false);
+
     // Step 3. Real compilation
 //  CBotFunction*   temp = nullptr;
     CBotFunction*   next = m_functions;      // rewind the list
+    std::size_t     index = 0;
 
     p  = tokens.get()->GetNext();                             // returns to the beginning
 
@@ -126,10 +210,26 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
         else
         {
             m_bCompileClass = false;
-            CBotFunction::Compile(p, pStack.get(), next);
-            if (next->IsExtern()) functions.push_back(next->GetName()/* + next->GetParams()*/);
-            next->m_pProg = this;                           // keeps pointers to the module
+            CBotFunction* func = next;
+            int start = ranges[index].first;
+            int length = ranges[index].second - start;
+            int oldStart = bReuse ? m_compiledRanges[index].first : 0;
+            if ( bReuse && m_compiledRanges[index].second - oldStart == length &&
+                 program.compare(start, length, m_compiledSource, oldStart, length) == 0 )
+            {
+                func = previous[index].get();               // same text, same code
+                func->ShiftPosition(start - oldStart);
+                reused[index] = true;
+                while ( p != nullptr && p->GetType() != 0 && p->GetStart() < start + length ) p = p->GetNext();
+            }
+            else
+            {
+                CBotFunction::Compile(p, pStack.get(), next);
+            }
+            if (func->IsExtern()) functions.push_back(func->GetName()/* + func->GetParams()*/);
+            func->m_pProg = this;                           // keeps pointers to the module
             next = next->Next();
+            index++;
         }
     }
 
@@ -141,11 +241,109 @@ bool CBotProgram::Compile(const std::string& program, std::vector<std::string>&
         m_error = pStack->GetError(m_errorStart, m_errorEnd);
         delete m_functions;
         m_functions = nullptr;
+        m_compiledRanges.clear();
+        return false;
+    }
+
+    // Put the reused functions in place of their declarations
+    for (std::size_t i = 0; i < fresh.size(); i++)
+    {
+        if (!reused[i]) continue;
+        fresh[i]->m_next = nullptr;
+        delete fresh[i];
+        fresh[i] = previous[i].release();
+    }
+    for (std::size_t i = 0; i < fresh.size(); i++)
+    {
+        fresh[i]->m_next = i + 1 < fresh.size() ? fresh[i + 1] : nullptr;
+    }
+    m_functions = fresh.empty() ? nullptr : fresh[0];
+
+    m_compiledSource = program;
+    m_compiledDecls = declsKey;
+    m_compiledRanges = ranges;
+
+    // Step 4. Let the next programs with the same source use these functions
+    for (CBotFunction* f = m_functions; f != nullptr; f = f->Next())
+    {
+        if (f->IsPublic()) bShare = false;
+    }
+    if (bShare && m_functions != nullptr && m_classes == nullptr)
+    {
+        m_sharedFunctions = std::make_shared<SharedFunctions>();
+        m_sharedFunctions->source = program;
+        m_sharedFunctions->bytecode = m_bytecodeEnabled;
+        m_sharedFunctions->optimize = m_optimizeEnabled;
+        m_sharedFunctions->compileKey = m_compileKey;
+        m_sharedFunctions->functions = m_functions;
+        m_sharedFunctions->externs = functions;
+        for (CBotFunction* f = m_functions; f != nullptr; f = f->Next())
+        {
+            f->m_pProg = nullptr;                       // runs in the program that called it
+        }
+
+        std::lock_guard<std::mutex> lock(m_sharedMutex);
+        for (auto it = m_shared.begin(); it != m_shared.end(); )
+        {
+            if (it->second.expired()) it = m_shared.erase(it);
+            else ++it;
+        }
+        m_shared[key] = m_sharedFunctions;
     }
 
     return (m_functions != nullptr);
 }
 
+std::size_t CBotProgram::GetSharedKey(const std::string& program)
+{
+    std::size_t key = std::hash<std::string>()(program);
+    key = key * 1000003 ^ m_externalCalls->GetHash();
+    key = key * 1000003 ^ CBotClass::GetHash();
+    key = key * 1000003 ^ CBotToken::GetDefineNumHash();
+    key = key * 1000003 ^ std::hash<int>()(m_compileKey);
+    return key * 4 + (m_bytecodeEnabled ? 1 : 0) + (m_optimizeEnabled ? 2 : 0);
+}
+
+void CBotProgram::FreeFunctions()
+{
+    if (m_sharedFunctions != nullptr)
+    {
+        m_sharedFunctions.reset();      // the last program deletes them
+    }
+    else
+    {
+        delete m_functions;
+    }
+    m_functions = nullptr;
+}
+
+std::vector<std::unique_ptr<CBotFunction>> CBotProgram::TakeFunctions()
+{
+    std::vector<std::unique_ptr<CBotFunction>> previous;
+    if (m_compiledRanges.empty()) return previous;
+    for (CBotFunction* f = m_functions; f != nullptr; f = f->m_next)
+    {
+        if (f->IsPublic()) return previous;         // must not exist while compiling again
+    }
+
+    if (m_sharedFunctions != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_sharedMutex);
+        if (m_sharedFunctions.use_count() > 1) return previous;    // still used by another program
+        m_sharedFunctions->functions = nullptr;
+        m_sharedFunctions.reset();
+    }
+
+    while (m_functions != nullptr)
+    {
+        CBotFunction* next = m_functions->m_next;
+        m_functions->m_next = nullptr;
+        previous.emplace_back(m_functions);
+        m_functions = next;
+    }
+    return previous;
+}
+
 bool CBotProgram::Start(const std::string& name)
 {
     Stop();
@@ -163,8 +361,9 @@ bool CBotProgram::Start(const std::string& name)
         return false;
     }
 
-    m_stack = CBotStack::AllocateStack();
+    m_stack = CBotStack::AllocateStack(m_context.get());
     m_stack->SetProgram(this);
+    m_context->m_bMainThread = false;
 
     return true; // we are ready for Run()
 }
@@ -185,6 +384,43 @@ bool CBotProgram::GetPosition(const std::string& name, int& start, int& stop, CB
 }
 
 bool CBotProgram::Run(void* pUser, int timer)
+{
+    m_context->m_bYielded = false;
+    return RunStack(pUser, timer, false);
+}
+
+bool CBotProgram::CanRunParallel()
+{
+    return !m_context->m_bMainThread;
+}
+
+void CBotProgram::BeginParallelRound()
+{
+    CBotVarClass::NextUpdateRound();
+}
+
+bool CBotProgram::RunParallel(void* pUser, int timer)
+{
+    m_context->m_bYielded = false;
+    m_context->m_bParallel = true;
+    bool ok = RunStack(pUser, timer, false);
+    m_context->m_bParallel = false;
+    return ok;
+}
+
+bool CBotProgram::IsWaitingForMainThread()
+{
+    return m_context->m_bYielded;
+}
+
+bool CBotProgram::ContinueRun(void* pUser)
+{
+    if (!m_context->m_bYielded) return false;
+    m_context->m_bYielded = false;
+    return RunStack(pUser, -1, true);
+}
+
+bool CBotProgram::RunStack(void* pUser, int timer, bool bResume)
 {
     if (m_stack == nullptr || m_entryPoint == nullptr)
     {
@@ -194,12 +430,24 @@ bool CBotProgram::Run(void* pUser, int timer)
 
     m_error = CBotNoErr;
 
+    // independent stacks created during the execution share the context of this program
+    CBotExecutionContext::Scope scope(m_context.get());
+
     m_stack->SetUserPtr(pUser);
-    if ( timer >= 0 ) m_stack->SetTimer(timer); // TODO: Check if changing order here fixed ipf()
-    m_stack->Reset();                         // reset the possible previous error, and resets the timer
+    if (!bResume)
+    {
+        if ( timer >= 0 ) m_stack->SetTimer(timer); // TODO: Check if changing order here fixed ipf()
+        m_stack->Reset();                         // reset the possible previous error, and resets the timer
+
+        // the whole timer pays for the expensive calls of the previous runs
+        if (m_context->m_overdraft > 0) return false;
+    }
 
     m_stack->SetProgram(this);                     // bases for routines
 
+    auto start = std::chrono::steady_clock::now();
+    int  ticks = m_context->m_timer;
+
     // resumes execution on the top of the stack
     bool ok = m_stack->Execute();
     if (ok)
@@ -208,6 +456,19 @@ bool CBotProgram::Run(void* pUser, int timer)
         ok = m_entryPoint->Execute(nullptr, m_stack, m_thisVar);
     }
 
+    ticks -= m_context->m_timer;
+    m_context->m_steps += ticks;
+
+    // the steps and time of this run go to the place where the program stopped
+    if (m_profiler != nullptr)
+    {
+        std::vector<CBotProfiler::Frame> frames;
+        m_stack->GetRunStack(frames);
+        if (frames.empty()) frames.push_back({ m_entryPoint->GetName(), -1 });
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+        m_profiler->AddSample(frames, ticks, time.count());
+    }
+
     // completed on a mistake?
     if (!ok && !m_stack->IsOk())
     {
@@ -223,6 +484,8 @@ bool CBotProgram::Run(void* pUser, int timer)
 
 void CBotProgram::Stop()
 {
+    CBotExecutionContext::Scope scope(m_context.get());
+    m_context->m_bYielded = false;
     m_stack->Delete();
     m_stack = nullptr;
     m_entryPoint = nullptr;
@@ -251,7 +514,53 @@ CBotVar* CBotProgram::GetStackVars(std::string& functionName, int level)
 ////////////////////////////////////////////////////////////////////////////////
 void CBotProgram::SetTimer(int n)
 {
-    CBotStack::SetTimer( n );
+    CBotExecutionContext::SetDefaultTimer( n );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotProgram::SetBytecodeEnabled(bool enabled)
+{
+    m_bytecodeEnabled = enabled;
+}
+
+bool CBotProgram::IsBytecodeEnabled()
+{
+    return m_bytecodeEnabled;
+}
+
+void CBotProgram::SetOptimizeEnabled(bool enabled)
+{
+    m_optimizeEnabled = enabled;
+}
+
+bool CBotProgram::IsOptimizeEnabled()
+{
+    return m_optimizeEnabled;
+}
+
+void CBotProgram::SetCompileKey(int key)
+{
+    m_compileKey = key;
+}
+
+int CBotProgram::GetCompileKey()
+{
+    return m_compileKey;
+}
+
+void CBotProgram::SetProfiler(CBotProfiler* profiler)
+{
+    m_profiler = profiler;
+}
+
+CBotProfiler* CBotProgram::GetProfiler()
+{
+    return m_profiler;
+}
+
+CBotExecutionContext* CBotProgram::GetContext()
+{
+    return m_context.get();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -298,25 +607,22 @@ bool rSizeOf( CBotVar* pVar, CBotVar* pResult, int& ex, void* pUser )
 {
     if ( pVar == nullptr ) return CBotErrLowParam;
 
-    int i = 0;
-    pVar = pVar->GetItemList();
-
-    while ( pVar != nullptr )
-    {
-        i++;
-        pVar = pVar->GetNext();
-    }
-
-    pResult->SetValInt(i);
+    CBotVarClass* array = pVar->GetPointer();
+    pResult->SetValInt(array == nullptr ? 0 : array->GetItemCount());
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotProgram::AddFunction(const std::string& name,
                               bool rExec(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                              CBotTypResult rCompile(CBotVar*& pVar, void* pUser))
+                              CBotTypResult rCompile(CBotVar*& pVar, void* pUser),
+                              bool parallelSafe,
+                              int cost)
 {
-    return m_externalCalls->AddFunction(name, std::unique_ptr<CBotExternalCall>(new CBotExternalCallDefault(rExec, rCompile)));
+    std::unique_ptr<CBotExternalCall> call(new CBotExternalCallDefault(rExec, rCompile));
+    call->SetParallelSafe(parallelSafe);
+    call->SetCost(cost);
+    return m_externalCalls->AddFunction(name, std::move(call));
 }
 
 bool CBotProgram::DefineNum(const std::string& name, long val)
@@ -326,38 +632,42 @@ bool CBotProgram::DefineNum(const std::string& name, long val)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotProgram::SaveState(FILE* pf)
+bool CBotProgram::SaveState(CBotWriter& ostr)
 {
-    if (!WriteWord( pf, CBOTVERSION)) return false;
+    if (!WriteWord( ostr, CBOTVERSION)) return false;
 
 
     if (m_stack != nullptr )
     {
-        if (!WriteWord( pf, 1)) return false;
-        if (!WriteString( pf, m_entryPoint->GetName() )) return false;
-        if (!m_stack->SaveState(pf)) return false;
+        // 2: the stack has levels of loops lowered to bytecode
+        if (!WriteWord( ostr, m_bytecodeEnabled ? 2 : 1)) return false;
+        if (!WriteString( ostr, m_entryPoint->GetName() )) return false;
+        if (!m_stack->SaveState(ostr)) return false;
     }
     else
     {
-        if (!WriteWord( pf, 0)) return false;
+        if (!WriteWord( ostr, 0)) return false;
     }
     return true;
 }
 
-bool CBotProgram::RestoreState(FILE* pf)
+bool CBotProgram::RestoreState(CBotReader& istr)
 {
     unsigned short  w;
     std::string      s;
 
+    CBotExecutionContext::Scope scope(m_context.get());
+
     Stop();
 
-    if (!ReadWord( pf, w )) return false;
+    if (!ReadWord( istr, w )) return false;
     if ( w != CBOTVERSION ) return false;
 
-    if (!ReadWord( pf, w )) return false;
+    if (!ReadWord( istr, w )) return false;
     if ( w == 0 ) return true;
+    if ( w == 2 && !m_bytecodeEnabled ) return false;    // these levels can only continue in the bytecode
 
-    if (!ReadString( pf, s )) return false;
+    if (!ReadString( istr, s )) return false;
     Start(s);       // point de reprise
 
     m_stack->Delete();
@@ -365,7 +675,7 @@ bool CBotProgram::RestoreState(FILE* pf)
 
     // retrieves the stack from the memory
     // uses a nullptr pointer (m_stack) but it's ok like that
-    if (!m_stack->RestoreState(pf, m_stack)) return false;
+    if (!m_stack->RestoreState(istr, m_stack)) return false;
     m_stack->SetProgram(this);                     // bases for routines
 
     // restored some states in the stack according to the structure
@@ -394,8 +704,9 @@ void CBotProgram::Init()
     CBotProgram::DefineNum("CBotErrOutArray",   CBotErrOutArray);    // Attempted access out of bounds of an array
     CBotProgram::DefineNum("CBotErrStackOver",  CBotErrStackOver);   // Stack overflow
     CBotProgram::DefineNum("CBotErrDeletedPtr", CBotErrDeletedPtr);  // Attempted to use deleted object
+    CBotProgram::DefineNum("CBotErrMemory",     CBotErrMemory);      // Memory limit of the program exceeded
 
-    CBotProgram::AddFunction("sizeof", rSizeOf, cSizeOf);
+    CBotProgram::AddFunction("sizeof", rSizeOf, cSizeOf, true);
 
     InitStringFunctions();
     InitMathFunctions();
@@ -22,16 +22,23 @@
 #include "CBot/CBotTypResult.h"
 #include "CBot/CBotEnums.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace CBot
 {
 
+class CBotExecutionContext;
 class CBotFunction;
 class CBotClass;
+class CBotProfiler;
 class CBotStack;
 class CBotVar;
 class CBotExternalCallList;
+class CBotWriter;
+class CBotReader;
 
 /**
  * \brief Class that manages a CBot program. This is the main entry point into the CBot engine.
@@ -123,6 +130,16 @@ public:
      * 2. First pass - getting declarations of all functions an classes for use later
      * 3. Second pass - compiling definitions of all functions and classes
      *
+     * When a program is compiled again and no declaration changed (function headers,
+     * classes, external functions, constants and public functions of other programs),
+     * only the functions whose text changed are compiled again, the others are kept.
+     *
+     * Programs without classes and public functions share their compiled functions
+     * with the other programs compiled from the same source, as long as the external
+     * functions, classes and constants stay the same. Such programs are compiled only once.
+     * The compile functions of the external calls may also depend on pUser, so the programs
+     * must have the same key, see SetCompileKey().
+     *
      * \param program Code to compile
      * \param[out] functions Returns the names of functions declared as extern
      * \param pUser Optional pointer to be passed to compile function (see AddFunction())
@@ -131,6 +148,86 @@ public:
      */
     bool Compile(const std::string& program, std::vector<std::string>& functions, void* pUser = nullptr);
 
+    /**
+     * \brief Enables lowering of expressions and loops to bytecode, see CBotBytecode
+     *
+     * Primitive expressions without side effects are evaluated by the bytecode. Loops
+     * (while, do, for) are lowered with their body and run by the bytecode, with the same
+     * suspension points as the instruction tree; the statements of the body that can't be
+     * lowered (calls, objects, arrays...) are still executed by the tree. Step by step,
+     * loops are executed by the tree.
+     *
+     * A state saved with SaveState() by such a program can only be restored by a program
+     * compiled with the bytecode enabled.
+     *
+     * Must be set before Compile(). The program behaves the same with or without it,
+     * so that both execution engines can be compared.
+     *
+     * \param enabled true to use the bytecode, false to always walk the instruction tree
+     */
+    void SetBytecodeEnabled(bool enabled);
+
+    /**
+     * \brief Tells if primitive expressions are lowered to bytecode
+     * \see SetBytecodeEnabled()
+     */
+    bool IsBytecodeEnabled();
+
+    /**
+     * \brief Enables the optimizations done while compiling
+     *
+     * Operations on constants (CBotTwoOpExpr, CBotExprUnaire) are replaced by their result,
+     * branches of an "if" with a constant condition that are never taken are removed, and so
+     * are the statements following a return, break, continue or throw in the same block and
+     * the statements without effect. The remaining instructions keep their position in the
+     * code, for step by step execution. Errors found in removed code are reported the same.
+     *
+     * Must be set before Compile().
+     *
+     * \param enabled true to optimize
+     */
+    void SetOptimizeEnabled(bool enabled);
+
+    /**
+     * \brief Tells if compilation optimizes the code
+     * \see SetOptimizeEnabled()
+     */
+    bool IsOptimizeEnabled();
+
+    /**
+     * \brief Sets the key of what the compile functions of the external calls read through pUser
+     *
+     * Compiled functions are shared only between programs with the same key, see Compile().
+     * For instance, a function that accepts other parameters depending on the type of the robot
+     * needs the type of the robot in the key. Must be set before Compile().
+     *
+     * \param key Key, 0 by default
+     */
+    void SetCompileKey(int key);
+
+    /**
+     * \brief Returns the key set with SetCompileKey()
+     */
+    int GetCompileKey();
+
+    /**
+     * \brief Sets the profiler sampled after each run of this program
+     * \param profiler Profiler, not owned by the program, or nullptr to stop profiling
+     * \see CBotProfiler
+     */
+    void SetProfiler(CBotProfiler* profiler);
+
+    /**
+     * \brief Returns the profiler set with SetProfiler()
+     */
+    CBotProfiler* GetProfiler();
+
+    /**
+     * \brief Returns the execution context of this program, for statistics about its execution
+     * \see CBotExecutionContext::GetPeakFrameCount(), CBotExecutionContext::SetMemoryLimit()
+     */
+    CBotExecutionContext* GetContext();
+
     /**
      * \brief Returns the last error
      * \return Error code
@@ -177,6 +274,55 @@ public:
      */
     bool Run(void* pUser = nullptr, int timer = -1);
 
+    /**
+     * \brief Check if RunParallel() may be used for this program
+     *
+     * This is no longer the case once the program used a static field or a synchronized method,
+     * which are shared with other programs, or created an instance of a class with a destructor
+     * since the last Start() (see CBotStack::RunOnMainThread()). Only this program is then
+     * executed from the main thread, the others are not concerned.
+     */
+    bool CanRunParallel();
+
+    /**
+     * \brief Starts a round of RunParallel() calls
+     *
+     * The instances of classes with an update function (see CBotClass::SetUpdateFunc()) are
+     * updated only once per round by the programs executed in parallel, so what the update
+     * functions read must not change before the next call.
+     */
+    static void BeginParallelRound();
+
+    /**
+     * \brief Executes the program like Run(), but suspends it before anything that has to be done from the main thread
+     *
+     * Several programs may be executed this way at the same time from different threads, see CanRunParallel().
+     * The execution is suspended before calling an external function that is not parallel safe (see AddFunction())
+     * or a method of a class created with CBotClass::Create(), and before the first use of data shared with other
+     * programs. Everything else only depends on the program's own state and on what doesn't change during the round
+     * (see BeginParallelRound()), so the result doesn't depend on the order in which the programs are executed.
+     *
+     * If IsWaitingForMainThread() returns true afterwards, the execution has to be finished with
+     * ContinueRun() from the main thread.
+     *
+     * \param pUser Custom pointer to be passed to execute function (see AddFunction())
+     * \param timer Same as in Run()
+     * \return true if the program execution finished
+     */
+    bool RunParallel(void* pUser = nullptr, int timer = -1);
+
+    /**
+     * \brief Check if the last RunParallel() has been suspended before something that has to be done from the main thread
+     */
+    bool IsWaitingForMainThread();
+
+    /**
+     * \brief Continues the execution suspended by RunParallel(), with what is left of the timer
+     * \param pUser Custom pointer to be passed to execute function (see AddFunction())
+     * \return true if the program execution finished, false if the program is suspended
+     */
+    bool ContinueRun(void* pUser = nullptr);
+
     /**
      * \brief Gives the current position in the executing program
      * \param[out] functionName Name of the currently executed function
@@ -203,6 +349,8 @@ public:
      * \brief Sets the number of steps (parts of instructions) to execute in Run() before suspending the program execution
      * \param n new timer value
      *
+     * This only applies to programs created afterwards, see also Run()
+     *
      * FIXME: Seems to be currently kind of broken (see issue #410)
      */
     static void SetTimer(int n);
@@ -267,11 +415,17 @@ public:
      * \param name Name of the function
      * \param rExec Execution function
      * \param rCompile Compilation function
+     * \param parallelSafe true if the function only uses its arguments and reads state that doesn't change during a round
+     * of RunParallel() calls, so that it can be called from any thread (see BeginParallelRound())
+     * \param cost Estimated time of one execution, in timer ticks (steps). Functions that scan the whole world should cost
+     * more than a simple instruction, so that they use up the timer given to Run() sooner.
      * \return true
      */
     static bool AddFunction(const std::string& name,
                             bool rExec(CBotVar* pVar, CBotVar* pResult, int& Exception, void* pUser),
-                            CBotTypResult rCompile(CBotVar*& pVar, void* pUser));
+                            CBotTypResult rCompile(CBotVar*& pVar, void* pUser),
+                            bool parallelSafe = false,
+                            int cost = 1);
 
     /**
      * \copydoc CBotToken::DefineNum()
@@ -280,28 +434,21 @@ public:
     static bool DefineNum(const std::string& name, long val);
 
     /**
-     * \brief Save the current execution status into a file
-     * \param pf
-     * \parblock
-     * file handle
-     *
-     * This file handle must have been opened by this library! Otherwise crashes on Windows
-     *
-     * TODO: Verify this
-     * \endparblock
+     * \brief Save the current execution status
+     * \param ostr Writer of the saved state, see CBotWriter::Flush() to write it to a file
      * \return true on success, false on write error
      */
-    bool SaveState(FILE* pf);
+    bool SaveState(CBotWriter& ostr);
 
     /**
      * \brief Restore the execution state from a file
      *
      * The previous program code must already have been recompiled with Compile() before calling this function
      *
-     * \param pf file handle
+     * \param istr Reader of the saved state, in the current format or the layout of older saves
      * \return true on success, false on read error
      */
-    bool RestoreState(FILE* pf);
+    bool RestoreState(CBotReader& istr);
 
     /**
      * \brief GetPosition Gives the position of a routine in the original text
@@ -345,24 +492,75 @@ public:
     static CBotExternalCallList* GetExternalCalls();
 
 private:
+    /**
+     * \brief Common part of Run(), RunParallel() and ContinueRun()
+     * \param pUser Custom pointer to be passed to execute function
+     * \param timer Same as in Run()
+     * \param bResume true to keep the current timer
+     */
+    bool RunStack(void* pUser, int timer, bool bResume);
+
+    /**
+     * \brief Delete the compiled functions, or stop sharing them with other programs
+     */
+    void FreeFunctions();
+
+    /**
+     * \brief Takes the functions of the last compilation, if Compile() can reuse them
+     * \return Functions in the order of m_compiledRanges, or nothing
+     */
+    std::vector<std::unique_ptr<CBotFunction>> TakeFunctions();
+
+    //! Compiled functions shared with other programs, see Compile()
+    struct SharedFunctions;
+
+    /**
+     * \brief Hash of this source with the current definitions and options, key of the shared functions
+     * \param program Code to compile
+     */
+    std::size_t GetSharedKey(const std::string& program);
+
     //! All external calls
     static CBotExternalCallList* m_externalCalls;
+    //! Functions of the programs compiled so far, see Compile()
+    static std::map<std::size_t, std::weak_ptr<SharedFunctions>> m_shared;
+    //! Protects m_shared
+    static std::mutex m_sharedMutex;
     //! All user-defined functions
     CBotFunction* m_functions = nullptr;
+    //! Owner of m_functions if they are shared with other programs
+    std::shared_ptr<SharedFunctions> m_sharedFunctions;
     //! The entry point function
     CBotFunction* m_entryPoint = nullptr;
     //! Classes defined in this program
     CBotClass* m_classes = nullptr;
     //! Execution stack
     CBotStack* m_stack = nullptr;
+    //! Source of the last successful compilation
+    std::string m_compiledSource;
+    //! Declarations of the last successful compilation, see Compile()
+    std::size_t m_compiledDecls = 0;
+    //! Start and end of each function of m_functions in m_compiledSource
+    std::vector<std::pair<int, int>> m_compiledRanges;
     //! "this" variable
     CBotVar* m_thisVar = nullptr;
+    //! Error, timer and user pointer of the execution stack
+    std::unique_ptr<CBotExecutionContext> m_context;
     friend class CBotFunction;
     friend class CBotDebug;
 
     CBotError m_error = CBotNoErr;
     int m_errorStart = 0;
     int m_errorEnd = 0;
+
+    //! Lower expressions to bytecode when compiling
+    bool m_bytecodeEnabled = false;
+    //! Optimize when compiling
+    bool m_optimizeEnabled = false;
+    //! Inputs of the compile functions read through pUser, see SetCompileKey()
+    int m_compileKey = 0;
+    //! Sampled by RunStack(), see SetProfiler()
+    CBotProfiler* m_profiler = nullptr;
 };
 
 } // namespace CBot
@@ -19,61 +19,78 @@
 
 #include "CBot/CBotStack.h"
 
+#include "CBot/CBotExecutionContext.h"
+
 #include "CBot/CBotInstr/CBotFunction.h"
 
 #include "CBot/CBotVar/CBotVarPointer.h"
 #include "CBot/CBotVar/CBotVarClass.h"
 
+#include "CBot/CBotCallCache.h"
+#include "CBot/CBotClass.h"
 #include "CBot/CBotFileUtils.h"
+#include "CBot/CBotMemoryPool.h"
 #include "CBot/CBotUtils.h"
 #include "CBot/CBotExternalCall.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
-#include <cstring>
 
 
 namespace CBot
 {
 
-const int DEFAULT_TIMER = 100;
-
-int         CBotStack::m_initimer = DEFAULT_TIMER;
-int         CBotStack::m_timer = 0;
-CBotVar*    CBotStack::m_retvar = nullptr;
-CBotError   CBotStack::m_error = CBotNoErr;
-int         CBotStack::m_start = 0;
-int         CBotStack::m_end   = 0;
-std::string  CBotStack::m_labelBreak="";
-void*       CBotStack::m_pUser = nullptr;
+namespace
+{
+//! Number of released stack blocks kept by each context
+const std::size_t MAX_FREE_BLOCKS = 4;
+} // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
-CBotStack* CBotStack::AllocateStack()
+CBotStack* CBotStack::AllocateStack(CBotExecutionContext* context)
 {
     CBotStack*    p;
 
-    long    size = sizeof(CBotStack);
-    size    *= (MAXSTACK+10);
-
-    // request a slice of memory for the stack
-    p = static_cast<CBotStack*>(malloc(size));
-
-    // completely empty
-    memset(p, 0, size);
+    if (context == nullptr) context = CBotExecutionContext::GetCurrent();
 
-    p->m_block = BlockVisibilityType::BLOCK;
-    m_timer = m_initimer;                // sets the timer at the beginning
-
-    CBotStack* pp = p;
-    pp += MAXSTACK;
-    int i;
-    for ( i = 0 ; i< 10 ; i++ )
+    if (!context->m_freeBlocks.empty())
     {
-        pp->m_bOver = true;
-        pp ++;
+        // all levels have already been cleared by Delete()
+        p = context->m_freeBlocks.back();
+        context->m_freeBlocks.pop_back();
+    }
+    else
+    {
+        // request a slice of memory for the stack, completely empty
+        // (calloc() can often avoid touching the pages that will never be used)
+        p = static_cast<CBotStack*>(calloc(MAXSTACK+10, sizeof(CBotStack)));
+
+        CBotStack* pp = p;
+        pp += MAXSTACK;
+        int i;
+        for ( i = 0 ; i< 10 ; i++ )
+        {
+            pp->m_bOver = true;
+            pp ++;
+        }
     }
 
-    m_error = CBotNoErr;    // avoids deadlocks because m_error is static
+    p->m_block = BlockVisibilityType::BLOCK;
+    p->m_instr = nullptr;
+    p->m_prog = nullptr;
+    p->m_context = context;
+    p->m_step = 0;
+    p->m_state = 0;
+    p->m_call = nullptr;
+    p->m_func = IsFunction::NO;
+    p->m_callFinished = false;
+    p->m_slotBase = 0;
+    p->m_slotCount = 0;
+    context->m_timer = context->m_initimer;     // sets the timer at the beginning
+    context->FrameAdded();
+
+    context->m_error = CBotNoErr;    // avoids deadlocks because the error is shared by the whole context
     return p;
 }
 
@@ -95,17 +112,45 @@ void CBotStack::Delete()
     }
 
     delete m_var;
+    if ( m_bSlotOwner )
+    {
+        CBotMemoryPool::Free(m_slots, m_slotCount * sizeof(CBotVar*));
+    }
+    else if ( m_slots != nullptr )
+    {
+        // the function call goes on without the variables of this level
+        for ( CBotVar* var = m_listVar ; var != nullptr ; var = var->m_next )
+        {
+            long n = var->GetUniqNum() - m_slotBase;
+            if ( n >= 0 && n < m_slotCount && m_slots[n] == var ) m_slots[n] = nullptr;
+        }
+    }
     delete m_listVar;
 
     CBotStack*    p = m_prev;
-    bool        bOver = m_bOver;
+    CBotExecutionContext* context = m_context;
+
+    // clears only what the next user of this level doesn't set (see AddStack()),
+    // m_prev == nullptr marks it as free
+    m_next      = nullptr;
+    m_next2     = nullptr;
+    m_prev      = nullptr;
+    m_var       = nullptr;
+    m_value.type = CBotTypVoid;
+    m_listVar   = nullptr;
+    m_slots     = nullptr;
+    m_bSlotOwner = false;
 
-    // clears the freed block
-    memset(this, 0, sizeof(CBotStack));
-    m_bOver    = bOver;
+    if ( context != nullptr ) context->FrameRemoved();
 
     if ( p == nullptr )
-        free( this );
+    {
+        // the whole stack is now clear, keep it for the next AllocateStack()
+        if ( context != nullptr && context->m_freeBlocks.size() < MAX_FREE_BLOCKS )
+            context->m_freeBlocks.push_back(this);
+        else
+            free( this );
+    }
 }
 
 // routine improved
@@ -125,15 +170,20 @@ CBotStack* CBotStack::AddStack(CBotInstr* instr, BlockVisibilityType bBlock)
     while ( p->m_prev != nullptr );
 
     m_next = p;                                    // chain an element
+    m_context->FrameAdded();
     p->m_block  = bBlock;
     p->m_instr  = instr;
     p->m_prog   = m_prog;
+    p->m_context = m_context;
     p->m_step   = 0;
     p->m_prev   = this;
     p->m_state  = 0;
     p->m_call   = nullptr;
     p->m_func   = IsFunction::NO;
     p->m_callFinished = false;
+    p->m_slots  = m_slots;
+    p->m_slotBase = m_slotBase;
+    p->m_slotCount = m_slotCount;
     return p;
 }
 
@@ -168,10 +218,20 @@ CBotStack* CBotStack::AddStack2(BlockVisibilityType bBlock)
     while ( p->m_prev != nullptr );
 
     m_next2 = p;                                // chain an element
+    m_context->FrameAdded();
     p->m_prev = this;
     p->m_block = bBlock;
+    p->m_instr = nullptr;
     p->m_prog = m_prog;
+    p->m_context = m_context;
     p->m_step = 0;
+    p->m_state = 0;
+    p->m_call = nullptr;
+    p->m_func = IsFunction::NO;
+    p->m_callFinished = false;
+    p->m_slots = m_slots;
+    p->m_slotBase = m_slotBase;
+    p->m_slotCount = m_slotCount;
     return    p;
 }
 
@@ -189,6 +249,8 @@ bool CBotStack::Return(CBotStack* pfils)
     if (m_var != nullptr) delete m_var;            // value replaced?
     m_var = pfils->m_var;                        // result transmitted
     pfils->m_var = nullptr;                        // not to destroy the variable
+    m_value = pfils->m_value;
+    if (m_value.type == CBotTypIntrinsic) m_inline = pfils->m_inline;
 
     m_next->Delete();m_next = nullptr;                // releases the stack above
     m_next2->Delete();m_next2 = nullptr;            // also the second stack (catch)
@@ -204,6 +266,8 @@ bool CBotStack::ReturnKeep(CBotStack* pfils)
     if (m_var != nullptr) delete m_var;            // value replaced?
     m_var = pfils->m_var;                        // result transmitted
     pfils->m_var = nullptr;                        // not to destroy the variable
+    m_value = pfils->m_value;
+    if (m_value.type == CBotTypIntrinsic) m_inline = pfils->m_inline;
 
     return IsOk();                        // interrupted if error
 }
@@ -212,18 +276,36 @@ bool CBotStack::ReturnKeep(CBotStack* pfils)
 bool CBotStack::StackOver()
 {
     if (!m_bOver) return false;
-    m_error = CBotErrStackOver;
+    m_context->m_error = CBotErrStackOver;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::MemoryOver()
+{
+    if (!m_context->IsOverMemoryLimit()) return false;
+    m_context->m_error = CBotErrMemory;
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::Reset()
 {
-    m_timer = m_initimer; // resets the timer
-    m_error    = CBotNoErr;
+    m_context->m_timer = m_context->m_initimer; // resets the timer
+    if ( m_context->m_initimer <= 0 )           // step by step, there is no budget
+    {
+        m_context->m_overdraft = 0;
+    }
+    else if ( m_context->m_overdraft > 0 )      // pays what the previous calls cost too much
+    {
+        int paid = std::min(m_context->m_overdraft, std::max(m_context->m_timer, 0));
+        m_context->m_timer -= paid;
+        m_context->m_overdraft -= paid;
+    }
+    m_context->m_error    = CBotNoErr;
 //    m_start = 0;
 //    m_end    = 0;
-    m_labelBreak.clear();
+    m_context->m_labelBreak.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -247,38 +329,86 @@ CBotStack* CBotStack::RestoreStackEOX(CBotExternalCall* instr)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// routine for execution step by step
-bool CBotStack::IfStep()
+bool CBotStack::IfMainThreadOnly()
+{
+    if ( !m_context->m_bParallel ) return false;
+
+    CBotStack*    p = this;
+    while ( p->m_prev != nullptr ) p = p->m_prev;
+    if ( p->m_prog == nullptr ) return false;       // independent stack, can't be interrupted
+
+    m_context->m_bYielded = true;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::UpdateVar(CBotVar* var, bool bFieldRead)
 {
-    if ( m_initimer > 0 || m_step++ > 0 ) return false;
+    if ( var->GetType() < CBotTypPointer ) return true;   // not an instance of a class
+
+    CBotClass*    pClass = var->GetClass();
+    if ( pClass == nullptr || !pClass->HasUpdateFunc() ) return true;
+    if ( bFieldRead && pClass->HasItemUpdateFuncs() ) return true;    // see UpdateItem()
+
+    if ( m_context->m_bParallel )
+    {
+        CBotVarClass* instance = var->GetPointer();
+        if ( instance != nullptr ) instance->UpdateOnce(m_context->m_pUser);
+        return true;
+    }
+
+    var->Update(m_context->m_pUser);
     return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::UpdateItem(CBotVarClass* instance, CBotVar* item)
+{
+    CBotClass*    pClass = instance->GetClass();
+    if ( pClass == nullptr || !pClass->HasItemUpdateFuncs() ) return true;
+
+    if ( m_context->m_bParallel )
+    {
+        instance->UpdateOnce(m_context->m_pUser);   // the whole instance, read from several threads
+        return true;
+    }
+
+    instance->UpdateItem(item, m_context->m_pUser);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::RunOnMainThread()
+{
+    m_context->m_bMainThread = true;            // from now on, see CBotProgram::CanRunParallel()
+    return !IfMainThreadOnly();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotStack::BreakReturn(CBotStack* pfils, const std::string& name)
 {
-    if ( m_error>=0 ) return false;                // normal output
-    if ( m_error==-3 ) return false;            // normal output (return current)
+    if ( m_context->m_error>=0 ) return false;                // normal output
+    if ( m_context->m_error==-3 ) return false;            // normal output (return current)
 
-    if (!m_labelBreak.empty() && (name.empty() || m_labelBreak != name))
+    if (!m_context->m_labelBreak.empty() && (name.empty() || m_context->m_labelBreak != name))
         return false;                            // it's not for me
 
-    m_error = CBotNoErr;
-    m_labelBreak.clear();
+    m_context->m_error = CBotNoErr;
+    m_context->m_labelBreak.clear();
     return Return(pfils);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotStack::IfContinue(int state, const std::string& name)
 {
-    if ( m_error != -2 ) return false;
+    if ( m_context->m_error != -2 ) return false;
 
-    if (!m_labelBreak.empty() && (name.empty() || m_labelBreak != name))
+    if (!m_context->m_labelBreak.empty() && (name.empty() || m_context->m_labelBreak != name))
         return false;                            // it's not for me
 
     m_state = state;                            // where again?
-    m_error = CBotNoErr;
-    m_labelBreak.clear();
+    m_context->m_error = CBotNoErr;
+    m_context->m_labelBreak.clear();
     m_next->Delete();            // purge above stack
     return true;
 }
@@ -286,11 +416,18 @@ bool CBotStack::IfContinue(int state, const std::string& name)
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::SetBreak(int val, const std::string& name)
 {
-    m_error = static_cast<CBotError>(-val);                                // reacts as an Exception
-    m_labelBreak = name;
+    m_context->m_error = static_cast<CBotError>(-val);                                // reacts as an Exception
+    m_context->m_labelBreak = name;
     if (val == 3)    // for a return
     {
-        m_retvar = m_var;
+        if (m_value.type == CBotTypIntrinsic)       // returned without creating a variable
+        {
+            m_context->m_retinline = m_inline;
+            m_value.type = CBotTypVoid;
+            return;
+        }
+        m_context->m_retvar = GetVar();
+        m_context->m_retinline.pClass = nullptr;
         m_var = nullptr;
     }
 }
@@ -299,12 +436,19 @@ void CBotStack::SetBreak(int val, const std::string& name)
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotStack::GetRetVar(bool bRet)
 {
-    if (m_error == -3)
+    if (m_context->m_error == -3)
     {
         if ( m_var ) delete m_var;
-        m_var        = m_retvar;
-        m_retvar    = nullptr;
-        m_error      = CBotNoErr;
+        m_var        = m_context->m_retvar;
+        m_value.type = CBotTypVoid;
+        if (m_context->m_retinline.pClass != nullptr)
+        {
+            m_inline     = m_context->m_retinline;
+            m_value.type = CBotTypIntrinsic;
+            m_context->m_retinline.pClass = nullptr;
+        }
+        m_context->m_retvar    = nullptr;
+        m_context->m_error      = CBotNoErr;
         return        true;
     }
     return bRet;                        // interrupted by something other than return
@@ -324,7 +468,7 @@ CBotVar* CBotStack::FindVar(CBotToken*& pToken, bool bUpdate)
             if (pp->GetName() == name)
             {
                 if ( bUpdate )
-                    pp->Update(m_pUser);
+                    pp->Update(m_context->m_pUser);
 
                 return pp;
             }
@@ -358,6 +502,16 @@ CBotVar* CBotStack::FindVar(const std::string& name)
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotStack::FindVar(long ident, bool bUpdate)
 {
+    long n = ident - m_slotBase;
+    if ( m_slots != nullptr && n >= 0 && n < m_slotCount && m_slots[n] != nullptr )
+    {
+        CBotVar*    pp = m_slots[n];
+        if ( bUpdate )
+            pp->Update(m_context->m_pUser);
+
+        return pp;
+    }
+
     CBotStack*    p = this;
     while (p != nullptr)
     {
@@ -367,7 +521,7 @@ CBotVar* CBotStack::FindVar(long ident, bool bUpdate)
             if (pp->GetUniqNum() == ident)
             {
                 if ( bUpdate )
-                    pp->Update(m_pUser);
+                    pp->Update(m_context->m_pUser);
 
                 return pp;
             }
@@ -398,59 +552,57 @@ CBotVar* CBotStack::CopyVar(CBotToken& pToken, bool bUpdate)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotStack::SetState(int n, int limite)
-{
-    m_state = n;
-
-    m_timer--;                                    // decrement the timer
-    return ( m_timer > limite );                    // interrupted if timer pass
-}
-
-////////////////////////////////////////////////////////////////////////////////
-bool CBotStack::IncState(int limite)
+void CBotStack::ConsumeCost(int n)
 {
-    m_state++;
+    if ( m_context->m_initimer <= 0 ) return;                // step by step, there is no budget
 
-    m_timer--;                                    // decrement the timer
-    return ( m_timer > limite );                    // interrupted if timer pass
+    int left = std::max(m_context->m_timer, 0);
+    if ( n > left )
+    {
+        m_context->m_overdraft += n - left;
+        m_context->m_steps += n - left;                     // counted now, not when paid
+        n = left;
+    }
+    m_context->m_timer -= n;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::SetError(CBotError n, CBotToken* token)
 {
-    if (n != CBotNoErr && m_error != CBotNoErr) return;    // does not change existing error
-    m_error = n;
+    if (n != CBotNoErr && m_context->m_error != CBotNoErr) return;    // does not change existing error
+    m_context->m_error = n;
     if (token != nullptr)
     {
-        m_start = token->GetStart();
-        m_end   = token->GetEnd();
+        m_context->m_start = token->GetStart();
+        m_context->m_end   = token->GetEnd();
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::ResetError(CBotError n, int start, int end)
 {
-    m_error = n;
-    m_start    = start;
-    m_end    = end;
+    m_context->m_error = n;
+    m_context->m_start    = start;
+    m_context->m_end    = end;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::SetPosError(CBotToken* token)
 {
-    m_start = token->GetStart();
-    m_end   = token->GetEnd();
+    m_context->m_start = token->GetStart();
+    m_context->m_end   = token->GetEnd();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::SetTimer(int n)
 {
-    m_initimer = n;
+    m_context->m_initimer = n;
 }
 
+////////////////////////////////////////////////////////////////////////////////
 int CBotStack::GetTimer()
 {
-    return m_initimer;
+    return m_context->m_initimer;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -488,13 +640,29 @@ void CBotStack::SetVar( CBotVar* var )
 {
     if (m_var) delete m_var;    // replacement of a variable
     m_var = var;
+    m_value.type = CBotTypVoid;
 }
 
 // puts on the stack a copy of a variable
 ////////////////////////////////////////////////////////////////////////////////
 void CBotStack::SetCopyVar( CBotVar* var )
 {
+    CBotValue value;
+    if (var->GetValue(value))   // a primitive value doesn't need a new variable
+    {
+        SetValue(value);
+        return;
+    }
+    if (var->GetInlineValue(m_inline))  // neither does the value of a class held inline
+    {
+        if (m_var) delete m_var;
+        m_var = nullptr;
+        m_value.type = CBotTypIntrinsic;
+        return;
+    }
+
     if (m_var) delete m_var;    // replacement of a variable
+    m_value.type = CBotTypVoid;
 
     m_var = CBotVar::Create("", var->GetTypResult(CBotVar::GetTypeMode::CLASS_AS_INTRINSIC));
     m_var->Copy( var );
@@ -503,12 +671,67 @@ void CBotStack::SetCopyVar( CBotVar* var )
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotStack::GetVar()
 {
+    if (m_value.type == CBotTypIntrinsic)
+    {
+        m_var = CBotVar::Create("", CBotTypResult(CBotTypIntrinsic, m_inline.pClass));
+        m_var->SetInlineValue(m_inline);
+        m_value.type = CBotTypVoid;
+    }
+    else if (m_value.type != CBotTypVoid)    // creates the variable only when really needed
+    {
+        m_var = CBotVar::Create("", m_value.type);
+        if (m_value.type == CBotTypFloat)               m_var->SetValFloat(m_value.valFloat);
+        else if (m_value.type == CBotTypNullPointer)    m_var->SetInit(CBotVar::InitType::DEF);
+        else                                            m_var->SetValInt(m_value.valInt);
+        m_value.type = CBotTypVoid;
+    }
     return m_var;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::SetValue(const CBotValue& value)
+{
+    if (m_var) delete m_var;    // replacement of a variable
+    m_var = nullptr;
+    m_value = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::GetValue(CBotValue& value)
+{
+    if (m_value.type == CBotTypInt || m_value.type == CBotTypFloat || m_value.type == CBotTypBoolean)
+    {
+        value = m_value;
+        return true;
+    }
+    return m_var != nullptr && m_var->GetValue(value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::SetInlineValue(const CBotInlineValue& value)
+{
+    if (m_var) delete m_var;    // replacement of a variable
+    m_var = nullptr;
+    m_value.type = CBotTypIntrinsic;
+    m_inline = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotStack::GetInlineValue(CBotInlineValue& value)
+{
+    if (m_value.type == CBotTypIntrinsic)
+    {
+        value = m_inline;
+        return true;
+    }
+    return m_var != nullptr && m_var->GetInlineValue(value);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 long CBotStack::GetVal()
 {
+    if (m_value.type == CBotTypIntrinsic) return 0;
+    if (m_value.type != CBotTypVoid) return m_value.GetValInt();
     if (m_var == nullptr) return 0;
     return m_var->GetValInt();
 }
@@ -527,6 +750,26 @@ void CBotStack::AddVar(CBotVar* pVar)
     while ( *pp != nullptr ) pp = &(*pp)->m_next;
 
     *pp = pVar;                    // added after
+
+    long n = pVar->GetUniqNum() - p->m_slotBase;
+    if ( p->m_slots != nullptr && n >= 0 && n < p->m_slotCount && p->m_slots[n] == nullptr )
+        p->m_slots[n] = pVar;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::InitSlots(long base, int count)
+{
+    if ( m_bSlotOwner ) return;                 // already done (resuming the call)
+
+    m_slots = nullptr;                          // don't use the table of the caller
+    m_slotBase = base;
+    m_slotCount = count;
+    if ( count <= 0 ) return;
+
+    // the tables of the nested calls are recycled, see CBotMemoryPool
+    m_slots = static_cast<CBotVar**>(CBotMemoryPool::Allocate(count * sizeof(CBotVar*)));
+    std::fill(m_slots, m_slots + count, nullptr);
+    m_bSlotOwner = true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -545,45 +788,67 @@ CBotProgram*  CBotStack::GetProgram(bool bFirst)
     return p->m_prog;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+CBotExecutionContext* CBotStack::GetContext()
+{
+    return m_context;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void* CBotStack::GetUserPtr()
 {
-    return m_pUser;
+    return m_context->m_pUser;
 }
 
 void CBotStack::SetUserPtr(void* user)
 {
-    m_pUser = user;
+    m_context->m_pUser = user;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotStack::ExecuteCall(long& nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype)
+bool CBotStack::ExecuteCall(long nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype,
+                            CBotCallCache& cache)
 {
-    int res;
+    CBotCallTarget      found;
+    const CBotCallTarget* target = &found;
 
-    // first looks by the identifier
+    if ( !cache.Load(ppVar, found) )
+    {
+        CBotTypResult type;
+        found.Reset(ppVar);
 
-    res = m_prog->GetExternalCalls()->DoCall(nullptr, nullptr, ppVar, this, rettype);
-    if (res >= 0) return res;
+        // first looks by the identifier
 
-    res = m_prog->GetFunctions()->DoCall(nIdent, "", ppVar, this, token );
-    if (res >= 0) return res;
+        found.function = m_prog->GetFunctions()->FindLocalOrPublic(nIdent, "", ppVar, type);
 
-    // if not found (recompile?) seeks by name
+        // if not found (recompile?) seeks by name
 
-    nIdent = 0;
-    res = m_prog->GetExternalCalls()->DoCall(token, nullptr, ppVar, this, rettype);
-    if (res >= 0) return res;
+        if (found.function == nullptr)
+        {
+            nIdent = 0;
+            found.external = m_prog->GetExternalCalls()->Find(token->GetString());
+        }
+        if (found.function == nullptr && found.external == nullptr)
+        {
+            found.function = m_prog->GetFunctions()->FindLocalOrPublic(nIdent, token->GetString(), ppVar, type);
+        }
 
-    res = m_prog->GetFunctions()->DoCall(nIdent, token->GetString(), ppVar, this, token );
-    if (res >= 0) return res;
+        found.ident = nIdent;
+        if (found.function != nullptr || found.external != nullptr) cache.Store(found);
+    }
+
+    if (target->external != nullptr)
+        return m_prog->GetExternalCalls()->Call(target->external, token, nullptr, ppVar, this, rettype);
+
+    if (target->function != nullptr)
+        return target->function->Call(ppVar, this, token);
 
     SetError(CBotErrUndefFunc, token);
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void CBotStack::RestoreCall(long& nIdent, CBotToken* token, CBotVar** ppVar)
+void CBotStack::RestoreCall(long nIdent, CBotToken* token, CBotVar** ppVar)
 {
     if (m_next == nullptr) return;
 
@@ -628,6 +893,26 @@ void CBotStack::GetRunPos(std::string& functionName, int& start, int& end)
     end   = t->GetEnd();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotStack::GetRunStack(std::vector<CBotProfiler::Frame>& frames)
+{
+    frames.clear();
+
+    CBotStack*  p = this;
+    while (true)
+    {
+        if ( p->m_instr != nullptr )
+        {
+            if ( p->m_func == IsFunction::YES ) frames.push_back({ p->m_instr->GetToken()->GetString(), -1 });
+            if ( !frames.empty() ) frames.back().position = p->m_instr->GetToken()->GetStart();
+        }
+        if ( p->m_next == nullptr || p->m_next->m_prog != m_prog ) break;
+
+        if (p->m_next2 && p->m_next2->m_state != 0) p = p->m_next2 ;
+        else                                        p = p->m_next;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotStack::GetStackVars(std::string& functionName, int level)
 {
@@ -677,56 +962,56 @@ CBotVar* CBotStack::GetStackVars(std::string& functionName, int level)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotStack::SaveState(FILE* pf)
+bool CBotStack::SaveState(CBotWriter& ostr)
 {
     if (m_next2 != nullptr)
     {
-        if (!WriteWord(pf, 2)) return false; // a marker of type (m_next2)
-        if (!m_next2->SaveState(pf)) return false; // saves the next element
+        if (!WriteWord(ostr, 2)) return false; // a marker of type (m_next2)
+        if (!m_next2->SaveState(ostr)) return false; // saves the next element
     }
     else
     {
-        if (!WriteWord(pf, 1)) return false; // a marker of type (m_next)
+        if (!WriteWord(ostr, 1)) return false; // a marker of type (m_next)
     }
-    if (!WriteWord(pf, static_cast<unsigned short>(m_block))) return false;
-    if (!WriteWord(pf, m_state)) return false;
-    if (!WriteWord(pf, 0)) return false; // for backwards combatibility (m_bDontDelete)
-    if (!WriteWord(pf, m_step)) return false;
+    if (!WriteWord(ostr, static_cast<unsigned short>(m_block))) return false;
+    if (!WriteWord(ostr, m_state)) return false;
+    if (!WriteWord(ostr, 0)) return false; // for backwards combatibility (m_bDontDelete)
+    if (!WriteWord(ostr, m_step)) return false;
 
 
-    if (!SaveVars(pf, m_var)) return false;            // current result
-    if (!SaveVars(pf, m_listVar)) return false;        // local variables
+    if (!SaveVars(ostr, GetVar())) return false;         // current result
+    if (!SaveVars(ostr, m_listVar)) return false;        // local variables
 
     if (m_next != nullptr)
     {
-        if (!m_next->SaveState(pf)) return false; // saves the next element
+        if (!m_next->SaveState(ostr)) return false; // saves the next element
     }
     else
     {
-        if (!WriteWord(pf, 0)) return false; // terminator
+        if (!WriteWord(ostr, 0)) return false; // terminator
     }
     return true;
 }
 
-bool SaveVars(FILE* pf, CBotVar* pVar)
+bool SaveVars(CBotWriter& ostr, CBotVar* pVar)
 {
     while (pVar != nullptr)
     {
-        if (!pVar->Save0State(pf)) return false; // common header
-        if (!pVar->Save1State(pf)) return false; // saves the data
+        if (!pVar->Save0State(ostr)) return false; // common header
+        if (!pVar->Save1State(ostr)) return false; // saves the data
 
         pVar = pVar->GetNext();
     }
-    return WriteWord(pf, 0); // terminator
+    return WriteWord(ostr, 0); // terminator
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotStack::RestoreState(FILE* pf, CBotStack* &pStack)
+bool CBotStack::RestoreState(CBotReader& istr, CBotStack* &pStack)
 {
     unsigned short w;
 
     pStack = nullptr;
-    if (!ReadWord(pf, w)) return false;
+    if (!ReadWord(istr, w)) return false;
     if ( w == 0 ) return true; // 0 - terminator
 
     if ( this == nullptr ) pStack = AllocateStack();
@@ -734,38 +1019,38 @@ bool CBotStack::RestoreState(FILE* pf, CBotStack* &pStack)
 
     if ( w == 2 ) // 2 - m_next2
     {
-        if (!pStack->RestoreState(pf, pStack->m_next2)) return false;
+        if (!pStack->RestoreState(istr, pStack->m_next2)) return false;
     }
 
-    if (!ReadWord(pf, w)) return false;
+    if (!ReadWord(istr, w)) return false;
     pStack->m_block = static_cast<BlockVisibilityType>(w);
 
-    if (!ReadWord(pf, w)) return false;
+    if (!ReadWord(istr, w)) return false;
     pStack->SetState(static_cast<short>(w));
 
-    if (!ReadWord(pf, w)) return false; // backwards compatibility (m_bDontDelete)
+    if (!ReadWord(istr, w)) return false; // backwards compatibility (m_bDontDelete)
 
-    if (!ReadWord(pf, w)) return false;
+    if (!ReadWord(istr, w)) return false;
     pStack->m_step = w;
 
-    if (!CBotVar::RestoreState(pf, pStack->m_var)) return false;    // temp variable
-    if (!CBotVar::RestoreState(pf, pStack->m_listVar)) return false;// local variables
+    if (!CBotVar::RestoreState(istr, pStack->m_var)) return false;    // temp variable
+    if (!CBotVar::RestoreState(istr, pStack->m_listVar)) return false;// local variables
 
-    return pStack->RestoreState(pf, pStack->m_next);
+    return pStack->RestoreState(istr, pStack->m_next);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVar::Save0State(FILE* pf)
+bool CBotVar::Save0State(CBotWriter& ostr)
 {
-    if (!WriteWord(pf, 100+static_cast<int>(m_mPrivate)))return false;        // private variable?
-    if (!WriteWord(pf, m_bStatic))return false;                // static variable?
-    if (!WriteWord(pf, m_type.GetType()))return false;        // saves the type (always non-zero)
-    if (!WriteWord(pf, static_cast<unsigned short>(m_binit))) return false;                // variable defined?
-    return WriteString(pf, m_token->GetString());            // and variable name
+    if (!WriteWord(ostr, 100+static_cast<int>(m_mPrivate)))return false;        // private variable?
+    if (!WriteWord(ostr, m_bStatic))return false;                // static variable?
+    if (!WriteWord(ostr, m_type.GetType()))return false;        // saves the type (always non-zero)
+    if (!WriteWord(ostr, static_cast<unsigned short>(m_binit))) return false;                // variable defined?
+    return WriteString(ostr, m_token->GetString());            // and variable name
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVar::RestoreState(FILE* pf, CBotVar* &pVar)
+bool CBotVar::RestoreState(CBotReader& istr, CBotVar* &pVar)
 {
     unsigned short        w, wi, prv, st;
     float        ww;
@@ -779,48 +1064,57 @@ bool CBotVar::RestoreState(FILE* pf, CBotVar* &pVar)
 
     while ( true )            // retrieves a list
     {
-        if (!ReadWord(pf, w)) return false;                        // private or type?
+        if (!ReadWord(istr, w)) return false;                        // private or type?
         if ( w == 0 ) return true;
 
         std::string defnum;
         if ( w == 200 )
         {
-            if (!ReadString(pf, defnum)) return false;            // number with identifier
-            if (!ReadWord(pf, w)) return false;                    // type
+            if (!ReadString(istr, defnum)) return false;            // number with identifier
+            if (!ReadWord(istr, w)) return false;                    // type
         }
 
         prv = 100; st = 0;
         if ( w >= 100 )
         {
             prv = w;
-            if (!ReadWord(pf, st)) return false;                // static
-            if (!ReadWord(pf, w)) return false;                    // type
+            if (!ReadWord(istr, st)) return false;                // static
+            if (!ReadWord(istr, w)) return false;                    // type
         }
 
         if ( w == CBotTypClass ) w = CBotTypIntrinsic;            // necessarily intrinsic
 
-        if (!ReadWord(pf, wi)) return false;                    // init ?
+        if (!ReadWord(istr, wi)) return false;                    // init ?
         CBotVar::InitType initType = static_cast<CBotVar::InitType>(wi);
-        if (!ReadString(pf, name)) return false;                // variable name
+        if (!ReadString(istr, name)) return false;                // variable name
 
-        CBotToken token(name, std::string());
+        CBotToken token(name);
 
         switch (w)
         {
         case CBotTypInt:
         case CBotTypBoolean:
             pNew = CBotVar::Create(token, w);                        // creates a variable
-            if (!ReadWord(pf, w)) return false;
-            pNew->SetValInt(static_cast<short>(w), defnum);
+            if (istr.IsLegacy())
+            {
+                if (!ReadWord(istr, w)) return false;               // values were saved in 16 bits
+                pNew->SetValInt(static_cast<short>(w), defnum);
+            }
+            else
+            {
+                int     n;
+                if (!ReadInt(istr, n)) return false;
+                pNew->SetValInt(n, defnum);
+            }
             break;
         case CBotTypFloat:
             pNew = CBotVar::Create(token, w);                        // creates a variable
-            if (!ReadFloat(pf, ww)) return false;
+            if (!ReadFloat(istr, ww)) return false;
             pNew->SetValFloat(ww);
             break;
         case CBotTypString:
             pNew = CBotVar::Create(token, w);                        // creates a variable
-            if (!ReadString(pf, s)) return false;
+            if (!ReadString(istr, s)) return false;
             pNew->SetValString(s);
             break;
 
@@ -830,17 +1124,17 @@ bool CBotVar::RestoreState(FILE* pf, CBotVar* &pVar)
             {
                 CBotTypResult    r;
                 long            id;
-                if (!ReadType(pf, r))  return false;                // complete type
-                if (!ReadLong(pf, id) ) return false;
+                if (!ReadType(istr, r))  return false;                // complete type
+                if (!ReadLong(istr, id) ) return false;
 
-//                if (!ReadString(pf, s)) return false;
+//                if (!ReadString(istr, s)) return false;
                 {
                     CBotVar* p = nullptr;
                     if ( id ) p = CBotVarClass::Find(id) ;
 
                     pNew = new CBotVarClass(token, r);                // directly creates an instance
                                                                     // attention cptuse = 0
-                    if ( !RestoreState(pf, (static_cast<CBotVarClass*>(pNew))->m_pVar)) return false;
+                    if ( !RestoreState(istr, (static_cast<CBotVarClass*>(pNew))->m_pVar)) return false;
                     pNew->SetIdent(id);
 
                     if ( p != nullptr )
@@ -854,17 +1148,17 @@ bool CBotVar::RestoreState(FILE* pf, CBotVar* &pVar)
 
         case CBotTypPointer:
         case CBotTypNullPointer:
-            if (!ReadString(pf, s)) return false;
+            if (!ReadString(istr, s)) return false;
             {
                 pNew = CBotVar::Create(token, CBotTypResult(w, s));// creates a variable
 //                CBotVarClass* p = nullptr;
                 long id;
-                ReadLong(pf, id);
+                if (!ReadLong(istr, id)) return false;
 //                if ( id ) p = CBotVarClass::Find(id);        // found the instance (made by RestoreInstance)
 
                 // returns a copy of the original instance
                 CBotVar* pInstance = nullptr;
-                if ( !CBotVar::RestoreState( pf, pInstance ) ) return false;
+                if ( !CBotVar::RestoreState( istr, pInstance ) ) return false;
                 (static_cast<CBotVarPointer*>(pNew))->SetPointer( pInstance );            // and point over
 
 //                if ( p != nullptr ) (static_cast<CBotVarPointer*>(pNew))->SetPointer( p );    // rather this one
@@ -875,13 +1169,13 @@ bool CBotVar::RestoreState(FILE* pf, CBotVar* &pVar)
         case CBotTypArrayPointer:
             {
                 CBotTypResult    r;
-                if (!ReadType(pf, r))  return false;
+                if (!ReadType(istr, r))  return false;
 
                 pNew = CBotVar::Create(token, r);                        // creates a variable
 
                 // returns a copy of the original instance
                 CBotVar* pInstance = nullptr;
-                if ( !CBotVar::RestoreState( pf, pInstance ) ) return false;
+                if ( !CBotVar::RestoreState( istr, pInstance ) ) return false;
                 (static_cast<CBotVarPointer*>(pNew))->SetPointer( pInstance );            // and point over
             }
             break;
@@ -22,6 +22,9 @@
 #include "CBot/CBotDefines.h"
 #include "CBot/CBotTypResult.h"
 #include "CBot/CBotEnums.h"
+#include "CBot/CBotExecutionContext.h"
+#include "CBot/CBotProfiler.h"
+#include "CBot/CBotValue.h"
 #include "CBot/CBotVar/CBotVar.h"
 
 #include <cstdio>
@@ -32,6 +35,7 @@ namespace CBot
 
 class CBotInstr;
 class CBotExternalCall;
+struct CBotCallCache;
 class CBotVar;
 class CBotProgram;
 class CBotToken;
@@ -62,9 +66,13 @@ public:
 
     /**
      * \brief Allocate the stack
+     *
+     * This also resets the error and the timer of the context.
+     *
+     * \param context Execution context the stack belongs to, nullptr for the current context of the thread (see CBotExecutionContext::GetCurrent())
      * \return pointer to created stack
      */
-    static CBotStack* AllocateStack();
+    static CBotStack* AllocateStack(CBotExecutionContext* context = nullptr);
 
     /** \brief Remove the current stack */
     void Delete();
@@ -78,13 +86,19 @@ public:
      */
     bool StackOver();
 
+    /**
+     * \brief Check if the program uses more memory than allowed and set error status as needed
+     * \return true if the limit is exceeded
+     * \see CBotExecutionContext::SetMemoryLimit()
+     */
+    bool MemoryOver();
+
     //@}
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /** \name Error management
      *
-     * BE CAREFUL - errors are stored in static variables!
-     * \todo Refactor that
+     * BE CAREFUL - errors are shared by all levels of the stack (see CBotExecutionContext)!
      */
     //@{
 
@@ -94,14 +108,14 @@ public:
      * \param[out] end Ending position in code of the error
      * \return Error number
      */
-    CBotError GetError(int& start, int& end) { start = m_start; end = m_end; return m_error; }
+    CBotError GetError(int& start, int& end) { start = m_context->m_start; end = m_context->m_end; return m_context->m_error; }
 
     /**
      * \brief Get last error
      * \return Error number
      * \see GetError(int&, int&) for error position in code
      */
-    CBotError GetError() { return m_error; }
+    CBotError GetError() { return m_context->m_error; }
 
     /**
      * \brief Check if there was an error
@@ -110,7 +124,7 @@ public:
      */
     bool IsOk()
     {
-        return m_error == CBotNoErr;
+        return m_context->m_error == CBotNoErr;
     }
 
     /**
@@ -190,6 +204,19 @@ public:
      */
     CBotVar* FindVar(long ident, bool bUpdate);
 
+    /**
+     * \brief Gives this function call level its own table of local variable slots
+     *
+     * Local variables and parameters of a function get consecutive unique identifiers
+     * at compile time (see CBotFunction::Compile()), so the variable with identifier
+     * base + n is kept in slot n and FindVar(long, bool) doesn't have to walk the stack.
+     * Levels added above this one share the table.
+     *
+     * \param base Identifier of the first local variable of the function
+     * \param count Number of slots, 0 if the function has no slots
+     */
+    void InitSlots(long base, int count);
+
     /**
      * \brief Find variable by its token and returns a copy of it
      *
@@ -303,7 +330,19 @@ public:
      * \param lim Required amount of "ticks" on the timer required to allow to continue execution. By default allows a little overflow (up to 10 ticks)
      * \return false if timer requests interruption (timer <= limit)
      */
-    bool            SetState(int n, int lim = -10);
+    bool            SetState(int n, int lim = -10)
+    {
+        m_state = n;
+        return --m_context->m_timer > lim;
+    }
+    /**
+     * \brief Set execution state without making the timer tick
+     *
+     * Used by CBotBytecode, which charges the timer itself
+     *
+     * \param n New state
+     */
+    void            SetStateOnly(int n) { m_state = n; }
     /**
      * \brief Return current execution state
      *
@@ -317,13 +356,110 @@ public:
      * \param lim Required amount of "ticks" on the timer required to allow to continue execution. By default allows a little overflow (up to 10 ticks)
      * \return false if timer requests interruption (timer <= limit)
      */
-    bool            IncState(int lim = -10);
+    bool            IncState(int lim = -10)
+    {
+        m_state++;
+        return --m_context->m_timer > lim;
+    }
+    /**
+     * \brief Makes the timer tick several times without changing the state
+     *
+     * Used when a whole expression has been evaluated at once (see CBotBytecode)
+     *
+     * \param n Number of ticks
+     * \param lim Same as in IncState()
+     * \return false if timer requests interruption (timer <= limit)
+     */
+    bool            ConsumeTimer(int n, int lim = -10)
+    {
+        m_context->m_timer -= n;
+        return m_context->m_timer > lim;
+    }
+    /**
+     * \brief Charges the timer with the cost of an external call (see CBotExternalCall::SetCost())
+     *
+     * What the timer can't pay in this run is taken from the next runs by Reset(),
+     * so that an expensive call doesn't get cheaper with a small timer.
+     * CBotProgram::Run() doesn't execute anything as long as the whole timer goes to that debt.
+     *
+     * \param n Number of ticks
+     */
+    void            ConsumeCost(int n);
+
+    /**
+     * \brief Check if the execution has to stop here because the program is executed step by step
+     *
+     * Step by step mode is only enabled for a program executed with a timer of 0 (see CBotProgram::Run()),
+     * so for all the others this is a single test, inlined in every instruction.
+     * Their execution is still suspended when the timer runs out, by SetState() and IncState().
+     *
+     * \return true if step by step and this is the first time this level is executed, false otherwise
+     */
+    bool            IfStep()
+    {
+        if ( m_context->m_initimer > 0 ) return false;     // fast mode
+        return m_step++ == 0;
+    }
 
     /**
-     * \brief Check if we are in step by step execution mode
-     * \return true if step by step, false otherwise
+     * \brief Check if nothing was executed yet at this level
+     *
+     * Used by the instructions lowered to CBotBytecode, which only enter the bytecode from the start:
+     * a level already executed by the tree (step by step, or restored from an old save) continues in the tree.
+     *
+     * \return true if the state is 0 and there is no step nor child level yet
      */
-    bool            IfStep();
+    bool            IsFresh()
+    {
+        return m_state == 0 && m_step == 0 && m_next == nullptr;
+    }
+
+    /**
+     * \brief Check if the execution has to be suspended before something that is only allowed from the main thread
+     *
+     * This is the case while the program is executed by CBotProgram::RunParallel().
+     * Independent stacks (see AllocateStack()) are executed without interruption, they never suspend.
+     *
+     * \return true if the execution must be suspended, it will be continued by CBotProgram::ContinueRun()
+     */
+    bool            IfMainThreadOnly();
+
+    /**
+     * \brief Calls the update function of the class of the given variable, if any
+     *
+     * Instances of classes whose elements have their own update functions
+     * are not updated as a whole when only one of their fields is read next,
+     * this field is then updated by UpdateItem().
+     *
+     * While the program is executed by CBotProgram::RunParallel(), the instance
+     * is updated as a whole, once per round (see CBotVarClass::UpdateOnce()).
+     *
+     * \param var Variable to update
+     * \param bFieldRead true if only a field of var is read next
+     * \return true, the update never suspends the execution
+     * \see CBotClass::SetUpdateFunc()
+     */
+    bool            UpdateVar(CBotVar* var, bool bFieldRead);
+
+    /**
+     * \brief Updates a field which is being read, if its class has update functions per element
+     *
+     * \param instance Instance the field belongs to
+     * \param item The field
+     * \return true, the update never suspends the execution
+     * \see CBotClass::UpdateItem()
+     */
+    bool            UpdateItem(CBotVarClass* instance, CBotVar* item);
+
+    /**
+     * \brief Makes the program run from the main thread until it is started again, see CBotProgram::CanRunParallel()
+     *
+     * Used before static fields and synchronized methods, which are shared with other programs,
+     * and before creating instances whose destructor could be called anywhere without interruption.
+     *
+     * \return false if the execution has to be suspended first, see IfMainThreadOnly()
+     */
+    bool            RunOnMainThread();
 
     /**
      * \brief Resumes execution of interrupted external call
@@ -345,19 +481,50 @@ public:
     void            SetVar(CBotVar* var);
     /**
      * \brief Set the result variable to copy of given variable
+     *
+     * Primitive values and values of classes held inline are copied without creating a variable
      * \param var Variable to copy as result
      */
     void            SetCopyVar(CBotVar* var);
     /**
      * \brief Return result variable
+     *
+     * If the result has been set with SetValue() or SetInlineValue(), a variable holding it is created now
+     *
      * \return Variable set with SetVar() or SetCopyVar()
      */
     CBotVar*        GetVar();
 
+    /**
+     * \brief Set the result to a primitive value, without creating a variable
+     * \param value Value to set
+     * \see GetVar()
+     */
+    void            SetValue(const CBotValue& value);
+    /**
+     * \brief Get the result as a primitive value, without creating a variable
+     * \param[out] value The result
+     * \return false if the result is not a defined int, float or bool
+     */
+    bool            GetValue(CBotValue& value);
+
+    /**
+     * \brief Set the result to the value of a class held inline, without creating a variable
+     * \param value Value to set
+     * \see GetVar()
+     */
+    void            SetInlineValue(const CBotInlineValue& value);
+    /**
+     * \brief Get the result as the value of a class held inline, without creating a variable
+     * \param[out] value The result
+     * \return false if the result is not an instance of a class held inline (see CBotClass::IsInline())
+     */
+    bool            GetInlineValue(CBotInlineValue& value);
+
     /**
      * \todo Document
      *
-     * Copies the result value from static m_retvar (m_var at a moment of SetBreak(3)) to this stack result
+     * Copies the result value from the context's m_retvar (m_var at a moment of SetBreak(3)) to this stack result
      */
     bool            GetRetVar(bool bRet);
 
@@ -386,6 +553,11 @@ public:
      */
     CBotProgram*    GetProgram(bool bFirst = false);
 
+    /**
+     * \brief Get the execution context this stack level belongs to
+     */
+    CBotExecutionContext* GetContext();
+
     /**
      * \brief Set user pointer for external calls
      *
@@ -414,19 +586,21 @@ public:
 
     /**
      * \brief Execute a function call, either external or user-defined
-     * \param[in, out] nIdent Unique function identifier, if not found will be updated
+     * \param nIdent Unique function identifier, the function is looked up by name if it is not found
      * \param token Function name token
      * \param ppVar Array of function arguments
      * \param rettype Expected return type
+     * \param[in, out] cache Function found by the previous execution of this call
      */
-    bool            ExecuteCall(long& nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype);
+    bool            ExecuteCall(long nIdent, CBotToken* token, CBotVar** ppVar, const CBotTypResult& rettype,
+                                CBotCallCache& cache);
     /**
      * \brief Restore a function call after the program state has been restored from a file
-     * \param[in, out] nIdent Unique function identifier, if not found will be updated
+     * \param nIdent Unique function identifier, the function is looked up by name if it is not found
      * \param token Function name token
      * \param ppVar Array of function arguments
      */
-    void            RestoreCall(long& nIdent, CBotToken* token, CBotVar** ppVar);
+    void            RestoreCall(long nIdent, CBotToken* token, CBotVar** ppVar);
 
     //@}
 
@@ -434,23 +608,23 @@ public:
     //! \name Write to file
     //@{
 
-    bool            SaveState(FILE* pf);
-    bool            RestoreState(FILE* pf, CBotStack* &pStack);
+    bool            SaveState(CBotWriter& ostr);
+    bool            RestoreState(CBotReader& istr, CBotStack* &pStack);
 
     //@}
 
     /**
      * \brief Set the maximum number of "timer ticks" (parts of instructions) to execute
      *
-     * This setting gets applied on next call to Reset()
+     * This setting gets applied on next call to Reset(), for the whole execution context
      *
      * \todo Full documentation of the timer
      */
-    static void     SetTimer(int n);
+    void            SetTimer(int n);
     /**
      * \brief Get the current configured maximum number of "timer ticks" (parts of instructions) to execute
      */
-    static int GetTimer();
+    int             GetTimer();
 
     /**
      * \brief Get current position in the program
@@ -460,6 +634,12 @@ public:
      */
     void            GetRunPos(std::string& functionName, int& start, int& end);
 
+    /**
+     * \brief Get the functions being executed in the program
+     * \param[out] frames Functions called, outermost first, with the position of the instruction executed in each
+     */
+    void            GetRunStack(std::vector<CBotProfiler::Frame>& frames);
+
     /**
      * \brief Get local variables at the given stack level
      * \param[out] functionName Name of instruction being executed at this level
@@ -476,23 +656,24 @@ private:
 
     int               m_state;
     int               m_step;
-    static CBotError  m_error;
-    static int        m_start;
-    static int        m_end;
-    static CBotVar*   m_retvar;                    // result of a return
 
     CBotVar*        m_var;                        // result of the operations
+    CBotValue       m_value;                      // result of the operations if it is a primitive value (instead of m_var)
+    CBotInlineValue m_inline;                     // result of the operations if m_value.type is CBotTypIntrinsic
     CBotVar*        m_listVar;                    // variables declared at this level
+    //! Local variables of the current function call, see InitSlots()
+    CBotVar**       m_slots;
+    long            m_slotBase;
+    int             m_slotCount;
+    //! If m_slots was allocated by this level
+    bool            m_bSlotOwner;
 
     BlockVisibilityType m_block;                    // is part of a block (variables are local to this block)
     bool            m_bOver;                    // stack limits?
     //! CBotProgram instance the execution is in in this stack level
     CBotProgram*    m_prog;
-
-    static int      m_initimer;
-    static int      m_timer;
-    static std::string m_labelBreak;
-    static void*    m_pUser;
+    //! Error, timer and user pointer shared by all levels of this stack
+    CBotExecutionContext* m_context;
 
     //! The corresponding instruction
     CBotInstr* m_instr;
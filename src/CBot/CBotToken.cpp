@@ -19,8 +19,12 @@
 
 #include "CBot/CBotToken.h"
 
+#include "CBot/CBotMemoryPool.h"
+
 #include <cstdarg>
 #include <cassert>
+#include <cstring>
+#include <functional>
 
 namespace CBot
 {
@@ -133,18 +137,175 @@ const std::string& LoadString(TokenId id)
     }
 }
 
-////////////////////////////////////////////////////////////////////////////////
-std::map<std::string, long> CBotToken::m_defineNum;
+namespace
+{
+
+//! FNV-1a hash of a word, changed by the seed
+std::size_t HashWord(const char* w, std::size_t length, std::size_t seed)
+{
+    std::size_t hash = 2166136261u ^ seed;
+    for (std::size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(w[i])) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+/**
+ * \brief Perfect hash table of the keywords
+ *
+ * The keywords never change, so when the table is built, the seed of the hash
+ * function is chosen so that each keyword has its own slot. Finding a word
+ * then takes one hash and at most one comparison.
+ */
+class CBotKeywordTable
+{
+public:
+    CBotKeywordTable()
+    {
+        m_seed = 0;
+        while (!Build()) m_seed++;
+    }
+
+    int Find(const char* w, std::size_t length) const
+    {
+        const Slot& slot = m_slots[HashWord(w, length, m_seed) & (SIZE - 1)];
+        if (slot.keyword == nullptr || slot.keyword->size() != length) return -1;
+        if (std::memcmp(slot.keyword->data(), w, length) != 0) return -1;
+        return slot.id;
+    }
+
+private:
+    static const std::size_t SIZE = 1024;
+
+    struct Slot
+    {
+        const std::string* keyword;
+        int id;
+    };
+
+    bool Build()
+    {
+        m_slots.assign(SIZE, Slot{nullptr, -1});
+        for (const auto& it : KEYWORDS)
+        {
+            Slot& slot = m_slots[HashWord(it.second.data(), it.second.size(), m_seed) & (SIZE - 1)];
+            if (slot.keyword != nullptr)
+            {
+                if (*slot.keyword == it.second) continue;   // keeps the lowest id, like ">>"
+                return false;
+            }
+            slot.keyword = &it.second;
+            slot.id = it.first;
+        }
+        return true;
+    }
+
+    std::vector<Slot> m_slots;
+    std::size_t m_seed;
+};
+
+/**
+ * \brief Hash table of the constants defined with CBotToken::DefineNum()
+ *
+ * Open addressing with linear probing, the table is at most half full.
+ */
+class CBotDefineTable
+{
+public:
+    CBotDefineTable() : m_slots(64), m_count(0)
+    {
+    }
+
+    bool Find(const std::string& name, long& value) const
+    {
+        std::size_t mask = m_slots.size() - 1;
+        for (std::size_t i = HashWord(name.data(), name.size(), 0) & mask; m_slots[i].used; i = (i + 1) & mask)
+        {
+            if (m_slots[i].name == name)
+            {
+                value = m_slots[i].value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Add(const std::string& name, long value)
+    {
+        long old;
+        if (Find(name, old)) return false;
+
+        if (2 * (m_count + 1) > m_slots.size()) Grow();
+        Insert(name, value);
+        m_count++;
+        return true;
+    }
+
+    void Clear()
+    {
+        m_slots.assign(64, Slot());
+        m_count = 0;
+    }
+
+    std::size_t GetHash() const
+    {
+        // doesn't depend on the order of the slots
+        std::size_t hash = m_count;
+        for (const Slot& slot : m_slots)
+        {
+            if (!slot.used) continue;
+            hash += HashWord(slot.name.data(), slot.name.size(), 0) * 1000003 ^ std::hash<long>()(slot.value);
+        }
+        return hash;
+    }
+
+private:
+    struct Slot
+    {
+        std::string name;
+        long value = 0;
+        bool used = false;
+    };
+
+    void Insert(const std::string& name, long value)
+    {
+        std::size_t mask = m_slots.size() - 1;
+        std::size_t i = HashWord(name.data(), name.size(), 0) & mask;
+        while (m_slots[i].used) i = (i + 1) & mask;
+        m_slots[i].name = name;
+        m_slots[i].value = value;
+        m_slots[i].used = true;
+    }
+
+    void Grow()
+    {
+        std::vector<Slot> old(m_slots.size() * 2);
+        old.swap(m_slots);
+        for (const Slot& slot : old)
+        {
+            if (slot.used) Insert(slot.name, slot.value);
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    std::size_t m_count;
+};
+
+//! All defined constants (see CBotToken::DefineNum())
+CBotDefineTable g_defineNum;
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotToken::CBotToken()
 {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-CBotToken::CBotToken(const std::string& text, const std::string& sep, int start, int end)
+CBotToken::CBotToken(const std::string& text, int start, int end)
 {
     m_text  = text;
-    m_sep   = sep;
 
     m_start = start;
     m_end   = end;
@@ -157,7 +318,6 @@ CBotToken::CBotToken(const CBotToken& pSrc)
     m_keywordId = pSrc.m_keywordId;
 
     m_text      = pSrc.m_text;
-    m_sep       = pSrc.m_sep;
 
     m_start     = pSrc.m_start;
     m_end       = pSrc.m_end;
@@ -168,10 +328,28 @@ CBotToken::~CBotToken()
 {
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void* CBotToken::operator new(std::size_t size)
+{
+    return CBotMemoryPool::Allocate(size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotToken::operator delete(void* p, std::size_t size)
+{
+    CBotMemoryPool::Free(p, size);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void CBotToken::ClearDefineNum()
 {
-    m_defineNum.clear();
+    g_defineNum.Clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::size_t CBotToken::GetDefineNumHash()
+{
+    return g_defineNum.GetHash();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -186,7 +364,6 @@ const CBotToken& CBotToken::operator=(const CBotToken& src)
     }
 
     m_text      = src.m_text;
-    m_sep       = src.m_sep;
 
     m_type      = src.m_type;
     m_keywordId = src.m_keywordId;
@@ -211,7 +388,7 @@ long CBotToken::GetKeywordId()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-std::string CBotToken::GetString()
+const std::string& CBotToken::GetString()
 {
     return m_text;
 }
@@ -263,10 +440,10 @@ static char    hexnum[]   = "0123456789ABCDEFabcdef";
 static char    nch[]  = "\"\r\n\t";                          // forbidden in chains
 
 ////////////////////////////////////////////////////////////////////////////////
-CBotToken*  CBotToken::NextToken(const char*& program, bool first)
+CBotToken*  CBotToken::NextToken(const char*& program, const char* base, bool first)
 {
     std::string token; // found token
-    std::string sep;   // separators after the token
+    const char* start = program;
     bool stop = first;
 
     if (*program == 0) return nullptr;
@@ -339,8 +516,8 @@ cc:             token += c;
 
         if (CharInList(token[0], sep3))               // an operational separator?
         {
-            std::string  motc = token;
-            while (motc += c, c != 0 && GetKeyWord(motc) > 0)    // operand seeks the longest possible
+            // the characters from start to c are the operator with c added
+            while (c != 0 && GetKeyWord(start, program - start) > 0)    // operand seeks the longest possible
             {
                 token += c;                           // build the word
                 c = *(program++);                   // next character
@@ -357,17 +534,16 @@ cc:             token += c;
         if (stop || c == 0 || CharInList(c, sep1))
         {
             if (!first && token.empty()) return nullptr;   // end of the analysis
+            const char* end = program - 1;
 bis:
             while (CharInList(c, sep2))
             {
-                sep += c;                           // after all the separators
-                c = *(program++);
+                c = *(program++);                   // after all the separators
             }
             if (c == '/' && *program == '/')        // comment on the heap?
             {
                 while( c != '\n' && c != 0 )
                 {
-                    sep += c;
                     c = *(program++);               // next character
                 }
                 goto bis;
@@ -377,14 +553,11 @@ bis:
             {
                 while( c != 0 && (c != '*' || *program != '/'))
                 {
-                    sep += c;
                     c = *(program++);               // next character
                 }
                 if ( c != 0 )
                 {
-                    sep += c;
                     c = *(program++);               // next character
-                    sep += c;
                     c = *(program++);               // next character
                 }
                 goto bis;
@@ -392,15 +565,19 @@ bis:
 
             program--;
 
-            CBotToken* t = new CBotToken(token, sep);
+            CBotToken* t = new CBotToken();
+            t->m_text.swap(token);
+            t->m_start = start - base;
+            t->m_end   = end - base;
 
-            if (CharInList(token[0], num )) t->m_type = TokenTypNum;
-            if (token[0] == '\"') t->m_type = TokenTypString;
+            const std::string& text = t->m_text;
+            if (CharInList(text[0], num )) t->m_type = TokenTypNum;
+            if (text[0] == '\"') t->m_type = TokenTypString;
             if (first) t->m_type = TokenTypNone;
 
-            t->m_keywordId = GetKeyWord(token);
+            t->m_keywordId = GetKeyWord(text.data(), text.size());
             if (t->m_keywordId > 0) t->m_type = TokenTypKeyWord;
-            else GetDefineNum(token, t) ;         // treats DefineNum
+            else GetDefineNum(text, t) ;         // treats DefineNum
 
             return t;
         }
@@ -414,67 +591,52 @@ bis:
 std::unique_ptr<CBotToken> CBotToken::CompileTokens(const std::string& program)
 {
     CBotToken       *nxt, *prv, *tokenbase;
-    const char*     p = program.c_str();
-    int             pos = 0;
+    const char*     base = program.c_str();
+    const char*     p = base;
 
-    prv = tokenbase = NextToken(p, true);
+    prv = tokenbase = NextToken(p, base, true);
 
     if (tokenbase == nullptr) return nullptr;
 
-    tokenbase->m_start  = pos;
-    pos += tokenbase->m_text.length();
-    tokenbase->m_end    = pos;
-    pos += tokenbase->m_sep.length();
-
-    const char* pp = p;
-    while (nullptr != (nxt = NextToken(p, false)))
+    while (nullptr != (nxt = NextToken(p, base, false)))
     {
         prv->m_next = nxt;              // added after
         nxt->m_prev = prv;
         prv = nxt;                      // advance
-
-        nxt->m_start    = pos;
-        pos += (p - pp);                // total size
-        nxt->m_end  = pos - nxt->m_sep.length();
-        pp = p;
     }
 
     return std::unique_ptr<CBotToken>(tokenbase);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-int CBotToken::GetKeyWord(const std::string& w)
+int CBotToken::GetKeyWord(const char* w, std::size_t length)
 {
-    for (const auto& it : KEYWORDS)
-    {
-        if (it.second == w) return it.first;
-    }
-
-    return -1;
+    static const CBotKeywordTable keywords;
+    return keywords.Find(w, length);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotToken::GetDefineNum(const std::string& name, CBotToken* token)
 {
-    if (m_defineNum.count(name) == 0)
+    long    value;
+    if (!g_defineNum.Find(name, value))
         return false;
 
     token->m_type = TokenTypDef;
-    token->m_keywordId = m_defineNum[name];
+    token->m_keywordId = value;
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotToken::DefineNum(const std::string& name, long val)
 {
-    if (m_defineNum.count(name) > 0)
+    if (!g_defineNum.Add(name, val))
     {
         // TODO: No access to the logger from CBot library :(
         printf("CBOT WARNING: %s redefined\n", name.c_str());
         return false;
     }
 
-    m_defineNum[name] = val;
     return true;
 }
 
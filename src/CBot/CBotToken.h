@@ -92,12 +92,10 @@ public:
      * \brief Constructor
      *
      * \param text The string this token represents
-     * \param sep All separators that appeared after this token
      * \param start Beginning location in the source code of this token
      * \param end Ending location in the source code of this token
      */
     CBotToken(const std::string& text,
-              const std::string& sep = "",
               int start = 0,
               int end = 0);
 
@@ -110,6 +108,12 @@ public:
      */
     ~CBotToken();
 
+    /**
+     * \brief Tokens are allocated from CBotMemoryPool
+     */
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p, std::size_t size);
+
     /**
      * \brief Return the token type or the keyword id
      * \return A value from ::TokenType. For ::TokenTypKeyWord, returns the keyword ID instead.
@@ -120,7 +124,7 @@ public:
      * \brief Return the token string
      * \return The string associated with this token
      */
-    std::string GetString();
+    const std::string& GetString();
 
     /**
      * \brief Set the token string
@@ -177,17 +181,24 @@ public:
      */
     static void ClearDefineNum();
 
+    /**
+     * \brief Hash of all the constants, see CBotProgram::Compile()
+     */
+    static std::size_t GetDefineNumHash();
+
 private:
     /**
      * \brief Find the next token in the string
      *
-     * The string must not start with separators. The separator is part of the previous token.
+     * The string must not start with separators. The separators are skipped
+     * after the token, they are not kept.
      *
      * \param [in, out] program The program string, modified to point at the next token
+     * \param base Beginning of the program string, for the positions of the token
      * \param first true if this is the first call (beginning of the program string)
      * \return A processed CBotToken
      */
-    static CBotToken* NextToken(const char*& program, bool first);
+    static CBotToken* NextToken(const char*& program, const char* base, bool first);
 
 private:
     //! The token type
@@ -197,26 +208,28 @@ private:
 
     //! The token string
     std::string m_text = "";
-    //! The separator that appeared after this token
-    std::string m_sep = "";
 
     //! The strat position of the token in the CBotProgram
     int m_start = 0;
     //! The end position of the token in the CBotProgram
     int m_end = 0;
 
-    //! Map of all defined constants (see DefineNum())
-    static std::map<std::string, long> m_defineNum;
-
     /**
      * \brief Check if the word is a keyword
+     *
+     * The keywords are found in a perfect hash table, with a single comparison.
+     *
      * \param w The word to check
+     * \param length Length of the word
      * \return the keyword ID (::CBotTokenId), or -1 if this is not a keyword
      */
-    static int GetKeyWord(const std::string& w);
+    static int GetKeyWord(const char* w, std::size_t length);
 
     /**
      * \brief Resolve a constant defined with DefineNum()
+     *
+     * The constants are kept in an open addressing hash table.
+     *
      * \param name Constant name
      * \param token Token that we are working on, will be filled with data about found constant
      * \return true if the constant was found, false otherwise
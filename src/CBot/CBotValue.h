@@ -0,0 +1,84 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#pragma once
+
+#include "CBot/CBotEnums.h"
+
+namespace CBot
+{
+
+class CBotClass;
+
+/**
+ * \brief A primitive value held without creating a CBotVar
+ *
+ * Used for intermediate results of expressions on CBotStack (see
+ * CBotStack::SetValue()) and for the registers of CBotBytecode. Conversions
+ * are the same as in CBotVarInt, CBotVarFloat and CBotVarBoolean.
+ */
+struct CBotValue
+{
+    //! CBotTypInt, CBotTypFloat, CBotTypBoolean or CBotTypNullPointer, CBotTypVoid if there is no value
+    //! (CBotTypIntrinsic on CBotStack, for a CBotInlineValue)
+    CBotType type;
+    union
+    {
+        int     valInt;
+        float   valFloat;
+    };
+
+    int GetValInt() const
+    {
+        return type == CBotTypFloat ? static_cast<int>(valFloat) : valInt;
+    }
+
+    float GetValFloat() const
+    {
+        return type == CBotTypFloat ? valFloat : static_cast<float>(valInt);
+    }
+};
+
+/**
+ * \brief The value of an intrinsic class held by value, without creating a CBotVar
+ *
+ * Only for the classes whose members are all primitive (see CBotClass::IsInline()),
+ * like the "point" of the game. The members are at a fixed offset, the order in
+ * which they were added to the class. Used for the results of expressions on
+ * CBotStack (see CBotStack::SetInlineValue()), so that copying such a value
+ * doesn't create the instance and its members.
+ */
+struct CBotInlineValue
+{
+    //! Maximum number of members
+    static const int MAX_FIELDS = 4;
+
+    //! Class of the value
+    CBotClass*      pClass;
+    //! Number of members
+    int             count;
+    //! CBotVar::InitType of the instance
+    unsigned char   init;
+    //! CBotVar::InitType of the members
+    unsigned char   fieldInit[MAX_FIELDS];
+    //! Values of the members
+    CBotValue       fields[MAX_FIELDS];
+};
+
+} // namespace CBot
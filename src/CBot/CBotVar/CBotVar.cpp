@@ -31,21 +31,45 @@
 #include "CBot/CBotVar/CBotVarInt.h"
 
 #include "CBot/CBotClass.h"
+#include "CBot/CBotExecutionContext.h"
 #include "CBot/CBotToken.h"
+#include "CBot/CBotMemoryPool.h"
 
 #include "CBot/CBotEnums.h"
 
 #include <cassert>
 #include <cmath>
 #include <cstdio>
+#include <memory>
+#include <new>
 #include <string>
 
 
 namespace CBot
 {
 
+namespace
+{
+//! Start of each block allocated by CBotVar::operator new()
+struct CBotVarHeader
+{
+    std::shared_ptr<CBotUsageCounters> owner;
+};
+
+//! Size of the header, keeps the alignment of the blocks of CBotMemoryPool
+const std::size_t HEADER_SIZE = 16;
+static_assert(sizeof(CBotVarHeader) <= HEADER_SIZE, "the header must fit before the variable");
+
+CBotVarHeader* GetHeader(void* p)
+{
+    return reinterpret_cast<CBotVarHeader*>(static_cast<char*>(p) - HEADER_SIZE);
+}
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
-long CBotVar::m_identcpt = 0;
+std::atomic<long> CBotVar::m_identcpt{0};
+std::atomic<long> CBotVar::m_createdCount{0};
+std::atomic<long> CBotVar::m_liveCount{0};
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar::CBotVar( )
@@ -59,12 +83,54 @@ CBotVar::CBotVar( )
     m_ident = 0;
     m_bStatic = false;
     m_mPrivate = ProtectionLevel::Public;
+
+    m_createdCount.fetch_add(1, std::memory_order_relaxed);
+    m_liveCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar::~CBotVar( )
 {
     delete  m_token;
+
+    m_liveCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void* CBotVar::operator new(std::size_t size)
+{
+    char* block = static_cast<char*>(CBotMemoryPool::Allocate(HEADER_SIZE + size));
+    CBotVarHeader* header = new (block) CBotVarHeader{ CBotExecutionContext::GetCurrent()->GetUsageCounters() };
+    header->owner->AddBytes(HEADER_SIZE + size);
+    return block + HEADER_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVar::operator delete(void* p, std::size_t size)
+{
+    CBotVarHeader* header = GetHeader(p);
+    header->owner->RemoveBytes(HEADER_SIZE + size);
+    header->~CBotVarHeader();
+    CBotMemoryPool::Free(header, HEADER_SIZE + size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotUsageCounters* CBotVar::GetUsageCounters()
+{
+    // the block starts before the complete object, not before this part of it
+    return GetHeader(dynamic_cast<void*>(this))->owner.get();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+long CBotVar::GetCreatedCount()
+{
+    return m_createdCount.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+long CBotVar::GetLiveCount()
+{
+    return m_liveCount.load(std::memory_order_relaxed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -101,8 +167,14 @@ void CBotVar::SetUniqNum(long n)
 ////////////////////////////////////////////////////////////////////////////////
 long CBotVar::NextUniqNum()
 {
-    if (++m_identcpt < 10000) m_identcpt = 10000;
-    return m_identcpt;
+    long n = ++m_identcpt;
+    while (n < 10000)       // first use or wrap around
+    {
+        long expected = n;
+        if (m_identcpt.compare_exchange_strong(expected, 10000)) return 10000;
+        n = ++m_identcpt;
+    }
+    return n;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -118,7 +190,7 @@ void* CBotVar::GetUserPtr()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVar::Save1State(FILE* pf)
+bool CBotVar::Save1State(CBotWriter& ostr)
 {
     // this routine "virtual" must never be called,
     // there must be a routine for each of the subclasses (CBotVarInt, CBotVarFloat, etc)
@@ -268,7 +340,7 @@ CBotVar* CBotVar::Create(const std::string& n, CBotTypResult type)
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotVar::Create(const std::string& name, CBotType type, CBotClass* pClass)
 {
-    CBotToken    token( name, "" );
+    CBotToken    token( name );
     CBotVar*    pVar = Create( token, type );
 
     if ( type == CBotTypPointer && pClass == nullptr )        // pointer "null" ?
@@ -290,7 +362,7 @@ CBotVar* CBotVar::Create(const std::string& name, CBotType type, CBotClass* pCla
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotVar::Create(const std::string& name, CBotClass* pClass)
 {
-    CBotToken    token( name, "" );
+    CBotToken    token( name );
     CBotVar*    pVar = Create( token, CBotTypResult( CBotTypClass, pClass ) );
 //    pVar->SetClass( pClass );
     return        pVar;
@@ -415,6 +487,13 @@ CBotVar* CBotVar::GetItem(int index, bool grow)
     return nullptr;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVar::SetItemCount(int count)
+{
+    assert(0);
+    return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool CBotVar::IsElemOfClass(const std::string& name)
 {
@@ -463,7 +542,10 @@ void CBotVar::SetVal(CBotVar* var)
         SetValFloat(var->GetValFloat());
         break;
     case CBotTypString:
-        SetValString(var->GetValString());
+        if (GetType() == CBotTypString)
+            static_cast<CBotVarString*>(this)->SetValString(static_cast<CBotVarString*>(var));
+        else
+            SetValString(var->GetValString());
         break;
     case CBotTypPointer:
     case CBotTypNullPointer:
@@ -471,11 +553,7 @@ void CBotVar::SetVal(CBotVar* var)
         SetPointer(var->GetPointer());
         break;
     case CBotTypClass:
-        {
-            delete (static_cast<CBotVarClass*>(this))->m_pVar;
-            (static_cast<CBotVarClass*>(this))->m_pVar = nullptr;
-            Copy(var, false);
-        }
+        if (var != this) Copy(var, false);     // reuses the members of an intrinsic class
         break;
     default:
         assert(0);
@@ -527,6 +605,62 @@ CBotVarClass* CBotVar::GetPointer()
     return nullptr;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVar::GetValue(CBotValue& value)
+{
+    if (m_binit != InitType::DEF) return false;
+
+    switch (m_type.GetType())
+    {
+    case CBotTypInt:
+        if (!static_cast<CBotVarInt*>(this)->m_defnum.empty()) return false;
+        value.type = CBotTypInt;
+        value.valInt = GetValInt();
+        return true;
+    case CBotTypBoolean:
+        value.type = CBotTypBoolean;
+        value.valInt = GetValInt();
+        return true;
+    case CBotTypFloat:
+        value.type = CBotTypFloat;
+        value.valFloat = GetValFloat();
+        return true;
+    default:
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVar::SetValue(const CBotValue& value)
+{
+    switch (value.type)
+    {
+    case CBotTypBoolean:
+    case CBotTypInt:
+        SetValInt(value.valInt);
+        break;
+    case CBotTypFloat:
+        SetValFloat(value.valFloat);
+        break;
+    default:
+        assert(0);
+    }
+
+    m_binit = InitType::DEF;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVar::GetInlineValue(CBotInlineValue& value)
+{
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVar::SetInlineValue(const CBotInlineValue& value)
+{
+    return false;
+}
+
 // All these functions must be defined in the subclasses
 // derived from class CBotVar
 ////////////////////////////////////////////////////////////////////////////////
@@ -23,7 +23,9 @@
 #include "CBot/CBotTypResult.h"
 #include "CBot/CBotEnums.h"
 #include "CBot/CBotUtils.h"
+#include "CBot/CBotValue.h"
 
+#include <atomic>
 #include <string>
 
 namespace CBot
@@ -33,6 +35,9 @@ class CBotVarClass;
 class CBotInstr;
 class CBotClass;
 class CBotToken;
+class CBotWriter;
+class CBotReader;
+struct CBotUsageCounters;
 
 /**
  * \brief A CBot variable
@@ -55,6 +60,16 @@ public:
      */
     virtual ~CBotVar();
 
+    /**
+     * \brief Variables are allocated from CBotMemoryPool
+     *
+     * Each block starts with a reference to the usage counters of the current execution
+     * context (see CBotExecutionContext::GetMemoryUsage()), which are charged with the size
+     * of the variable until it is destroyed.
+     */
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p, std::size_t size);
+
     /**
      * \brief Creates a new variable from a type described by CBotTypResult
      * \param name Variable name
@@ -125,6 +140,16 @@ public:
      */
     static void Destroy(CBotVar* var);
 
+    /**
+     * \brief Returns the number of variables created so far, on all threads
+     */
+    static long GetCreatedCount();
+
+    /**
+     * \brief Returns the number of variables currently existing, on all threads
+     */
+    static long GetLiveCount();
+
     //@}
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -419,6 +444,17 @@ public:
      */
     virtual CBotVar* GetItem(int index, bool grow = false);
 
+    /**
+     * \brief Sets the number of elements of the array in one pass
+     *
+     * Missing elements are created uninitialized and extra elements are destroyed.
+     * Use this instead of GetItem(i, true) to fill a whole array, then walk GetItemList().
+     *
+     * \param count Number of elements
+     * \return false if the array cannot hold that many elements
+     */
+    virtual bool SetItemCount(int count);
+
     /**
      * \brief Return all elements of this variable as a linked list. Works for both classes and arrays.
      * \return CBotVar representing the first object in the linked list. Use CBotVar::GetNext() to access next ones.
@@ -509,6 +545,33 @@ public:
      */
     virtual CBotVarClass* GetPointer();
 
+    /**
+     * \brief Get the value of a primitive variable, see CBotStack::SetValue()
+     * \param[out] value The value
+     * \return false if this is not a defined int, float or bool, or if this int holds the name of a constant (see SetValInt())
+     */
+    bool GetValue(CBotValue& value);
+
+    /**
+     * \brief Set the value from a primitive value, converting it to the type of the variable like SetVal()
+     * \param value New value
+     */
+    void SetValue(const CBotValue& value);
+
+    /**
+     * \brief Get the value of an instance of a class held inline, see CBotStack::SetInlineValue()
+     * \param[out] value The value
+     * \return false if this is not an instance of a class held inline (see CBotClass::IsInline())
+     */
+    virtual bool GetInlineValue(CBotInlineValue& value);
+
+    /**
+     * \brief Set the members of an instance from a value of the same class, in place like Copy()
+     * \param value New value
+     * \return false if this is not an instance of the class of the value, nothing is changed then
+     */
+    virtual bool SetInlineValue(const CBotInlineValue& value);
+
     //@}
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -610,32 +673,37 @@ public:
 
     /**
      * \brief Save common variable header (name, type, etc.)
-     * \param pf file pointer
+     * \param ostr Writer of the saved state
      * \return false on write error
      */
-    virtual bool Save0State(FILE* pf);
+    virtual bool Save0State(CBotWriter& ostr);
 
     /**
      * \brief Save variable data
      *
      * Overriden in child classes
      *
-     * \param pf file pointer
+     * \param ostr Writer of the saved state
      * \return false on write error
      */
-    virtual bool Save1State(FILE* pf);
+    virtual bool Save1State(CBotWriter& ostr);
 
     /**
      * \brief Restore variable
-     * \param pf file pointer
+     * \param istr Reader of the saved state
      * \param[out] pVar Pointer to recieve the variable
      * \return false on read error
      */
-    static bool RestoreState(FILE* pf, CBotVar* &pVar);
+    static bool RestoreState(CBotReader& istr, CBotVar* &pVar);
 
     //@}
 
 protected:
+    /**
+     * \brief Returns the usage counters of the context in which this variable was created
+     */
+    CBotUsageCounters* GetUsageCounters();
+
     //! The corresponding token, defines the variable name
     CBotToken* m_token;
     //! Type of value.
@@ -665,8 +733,11 @@ protected:
      */
     long m_ident;
 
-    //! TODO: ?
-    static long m_identcpt;
+    //! Last identifier given by NextUniqNum(), shared by all threads
+    static std::atomic<long> m_identcpt;
+    //! Counters for GetCreatedCount() and GetLiveCount()
+    static std::atomic<long> m_createdCount;
+    static std::atomic<long> m_liveCount;
 
     friend class CBotStack;
     friend class CBotCStack;
@@ -123,6 +123,20 @@ CBotVar* CBotVarArray::GetItem(int n, bool bExtend)
     return m_pInstance->GetItem(n, bExtend);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVarArray::SetItemCount(int count)
+{
+    if ( m_pInstance == nullptr )
+    {
+        if ( count == 0 ) return true;
+        // creates an instance of the table
+
+        CBotVarClass* instance = new CBotVarClass(CBotToken(), m_type);
+        SetPointer( instance );
+    }
+    return m_pInstance->SetItemCount(count);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotVarArray::GetItemList()
 {
@@ -138,10 +152,10 @@ std::string CBotVarArray::GetValString()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarArray::Save1State(FILE* pf)
+bool CBotVarArray::Save1State(CBotWriter& ostr)
 {
-    if ( !WriteType(pf, m_type) ) return false;
-    return SaveVars(pf, m_pInstance);                        // saves the instance that manages the table
+    if ( !WriteType(ostr, m_type) ) return false;
+    return SaveVars(ostr, m_pInstance);                        // saves the instance that manages the table
 }
 
 } // namespace CBot
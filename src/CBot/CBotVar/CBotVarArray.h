@@ -47,11 +47,12 @@ public:
     void Copy(CBotVar* pSrc, bool bName = true) override;
 
     CBotVar* GetItem(int n, bool grow = false) override;
+    bool SetItemCount(int count) override;
     CBotVar* GetItemList() override;
 
     std::string GetValString() override;
 
-    bool Save1State(FILE* pf) override;
+    bool Save1State(CBotWriter& ostr) override;
 
 private:
     //! Array data
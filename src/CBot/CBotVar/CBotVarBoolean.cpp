@@ -21,6 +21,7 @@
 
 #include "CBot/CBotEnums.h"
 #include "CBot/CBotUtils.h"
+#include "CBot/CBotFileUtils.h"
 
 #include "CBot/CBotToken.h"
 
@@ -150,9 +151,9 @@ bool CBotVarBoolean::Ne(CBotVar* left, CBotVar* right)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarBoolean::Save1State(FILE* pf)
+bool CBotVarBoolean::Save1State(CBotWriter& ostr)
 {
-    return WriteWord(pf, m_val);                            // the value of the variable
+    return WriteInt(ostr, m_val);                            // the value of the variable
 }
 
 } // namespace CBot
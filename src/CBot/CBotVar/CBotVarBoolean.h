@@ -51,7 +51,7 @@ public:
     bool Eq(CBotVar* left, CBotVar* right) override;
     bool Ne(CBotVar* left, CBotVar* right) override;
 
-    bool Save1State(FILE* pf) override;
+    bool Save1State(CBotWriter& ostr) override;
 
 private:
     //! The value.
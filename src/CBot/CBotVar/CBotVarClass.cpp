@@ -22,18 +22,132 @@
 #include "CBot/CBotClass.h"
 #include "CBot/CBotStack.h"
 #include "CBot/CBotDefines.h"
+#include "CBot/CBotExecutionContext.h"
 
 #include "CBot/CBotFileUtils.h"
 
 #include "CBot/CBotInstr/CBotInstr.h"
 
 #include <cassert>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 
 namespace CBot
 {
 
-////////////////////////////////////////////////////////////////////////////////
-std::set<CBotVarClass*> CBotVarClass::m_instances{};
+namespace
+{
+
+/**
+ * \brief Table of all class instances, indexed by generational handles
+ *
+ * A handle holds the index of a slot and the generation of the slot, which
+ * changes each time the slot is released. A handle of a destroyed instance
+ * doesn't find the instance which reused its slot, until the generation wraps
+ * around. Released slots are reused in order, and only once MIN_FREE_SLOTS
+ * others are waiting, so the generation of a slot wraps around after
+ * MIN_FREE_SLOTS << GENERATION_BITS instances at least have been destroyed.
+ *
+ * Handles are above 2^30, so they don't collide with identifiers given by
+ * CBotVar::NextUniqNum() or by the game (see CBotVar::SetIdent()). They stay
+ * below 2^31, as identifiers are saved on 32 bits (see WriteLong()).
+ *
+ * Instances identified by anything else than their own handle are found
+ * through a hash table of aliases.
+ */
+class CBotInstanceTable
+{
+public:
+    long Add(CBotVarClass* instance)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        unsigned long index;
+        if (m_free.size() > MIN_FREE_SLOTS || (!m_free.empty() && m_slots.size() > INDEX_MASK))
+        {
+            index = m_free.front();
+            m_free.pop_front();
+        }
+        else
+        {
+            if (m_slots.size() > INDEX_MASK) return 0;
+            index = m_slots.size();
+            m_slots.push_back(Slot{nullptr, 0});
+        }
+        m_slots[index].instance = instance;
+        return HANDLE_BASE | (m_slots[index].generation << INDEX_BITS) | index;
+    }
+
+    void Remove(long handle)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        unsigned long index = handle & INDEX_MASK;
+        m_slots[index].instance = nullptr;
+        m_slots[index].generation = (m_slots[index].generation + 1) & GENERATION_MASK;
+        m_free.push_back(index);
+    }
+
+    CBotVarClass* Get(long handle)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ((handle & HANDLE_BASE) == 0) return nullptr;
+        unsigned long index = handle & INDEX_MASK;
+        if (index >= m_slots.size()) return nullptr;
+        if (m_slots[index].generation != ((handle >> INDEX_BITS) & GENERATION_MASK)) return nullptr;
+        return m_slots[index].instance;
+    }
+
+    void SetAlias(long id, CBotVarClass* instance)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_aliases[id] = instance;
+    }
+
+    void RemoveAlias(long id, CBotVarClass* instance)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_aliases.find(id);
+        if (it != m_aliases.end() && it->second == instance) m_aliases.erase(it);
+    }
+
+    CBotVarClass* GetAlias(long id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_aliases.find(id);
+        return it != m_aliases.end() ? it->second : nullptr;
+    }
+
+private:
+    static const int INDEX_BITS = 18;
+    static const int GENERATION_BITS = 30 - INDEX_BITS;
+    static const unsigned long INDEX_MASK = (1ul << INDEX_BITS) - 1;
+    static const unsigned long GENERATION_MASK = (1ul << GENERATION_BITS) - 1;
+    static const long HANDLE_BASE = 1l << 30;
+    //! Number of released slots kept before the first of them is reused
+    static const std::size_t MIN_FREE_SLOTS = 4096;
+
+    struct Slot
+    {
+        CBotVarClass* instance;
+        unsigned long generation;
+    };
+
+    //! Protects the table, instances are created by programs running on several threads
+    std::mutex m_mutex;
+    std::vector<Slot> m_slots;
+    //! Indexes of the released slots, oldest first
+    std::deque<unsigned long> m_free;
+    std::unordered_map<long, CBotVarClass*> m_aliases;
+};
+
+CBotInstanceTable g_instances;
+
+//! Current round of UpdateOnce(), see CBotProgram::BeginParallelRound()
+std::atomic<unsigned int> g_updateRound(1);
+//! Taken by the first UpdateOnce() of an instance in a round
+std::mutex g_updateMutex;
+
+} // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
 CBotVarClass::CBotVarClass(const CBotToken& name, const CBotTypResult& type)
@@ -63,10 +177,18 @@ CBotVarClass::CBotVarClass(const CBotToken& name, const CBotTypResult& type)
     m_mPrivate    = ProtectionLevel::Public;
     m_bConstructor = false;
     m_CptUse    = 0;
-    m_ItemIdent = type.Eq(CBotTypIntrinsic) ? 0 : CBotVar::NextUniqNum();
-
-    // add to the list
-    m_instances.insert(this);
+    m_updateRound = 0;
+    GetUsageCounters()->created++;
+    GetUsageCounters()->live++;
+
+    // add to the table, except values of intrinsic classes which are never found by identifier
+    m_handle    = 0;
+    m_ItemIdent = 0;
+    if (!type.Eq(CBotTypIntrinsic))
+    {
+        m_handle = g_instances.Add(this);
+        SetIdent(m_handle != 0 ? m_handle : CBotVar::NextUniqNum());
+    }
 
     CBotClass* pClass = type.GetClass();
     CBotClass* pClass2 = pClass->GetParent();
@@ -89,8 +211,10 @@ CBotVarClass::~CBotVarClass( )
     if ( m_pParent ) delete m_pParent;
     m_pParent = nullptr;
 
-    // removes the class list
-    m_instances.erase(this);
+    // removes from the table
+    if (m_ItemIdent != 0 && m_ItemIdent != m_handle) g_instances.RemoveAlias(m_ItemIdent, this);
+    if (m_handle != 0) g_instances.Remove(m_handle);
+    GetUsageCounters()->live--;
 
     delete    m_pVar;
 }
@@ -116,6 +240,7 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
     m_type        = p->m_type;
     m_binit        = p->m_binit;
 //-    m_bStatic    = p->m_bStatic;
+    CBotClass*  pOldClass = m_pClass;
     m_pClass    = p->m_pClass;
     if ( p->m_pParent )
     {
@@ -125,13 +250,35 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
 //    m_next        = nullptr;
     m_pUserPtr    = p->m_pUserPtr;
     m_pMyThis    = nullptr;//p->m_pMyThis;
+
+    // takes the identifier of the source, which stays the instance found by it
+    if (m_ItemIdent != 0 && m_ItemIdent != m_handle) g_instances.RemoveAlias(m_ItemIdent, this);
     m_ItemIdent = p->m_ItemIdent;
 
     // keeps indentificator the same (by default)
     if (m_ident == 0 ) m_ident     = p->m_ident;
 
+    if ( m_pVar != nullptr && m_pClass == pOldClass && m_pClass != nullptr && m_pClass->IsIntrinsic() )
+    {
+        // a value of the same intrinsic class has the same members, copies them in place,
+        // so that m_items still holds them
+        CBotVar*    pn = m_pVar;
+        CBotVar*    pv = p->m_pVar;
+        while ( pn != nullptr && pv != nullptr )
+        {
+            CBotVar*    next = pn->m_next;
+            pn->Copy( pv );
+            pn->m_next = next;
+
+            pn = next;
+            pv = pv->GetNext();
+        }
+        if ( pn == nullptr && pv == nullptr ) return;
+    }
+
     delete        m_pVar;
     m_pVar        = nullptr;
+    m_items.clear();
 
     CBotVar*    pv = p->m_pVar;
     while( pv != nullptr )
@@ -145,10 +292,51 @@ void CBotVarClass::Copy(CBotVar* pSrc, bool bName)
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVarClass::GetInlineValue(CBotInlineValue& value)
+{
+    if ( m_pClass == nullptr || !m_pClass->IsInline() ) return false;
+
+    value.pClass = m_pClass;
+    value.init   = static_cast<unsigned char>(GetInit());
+
+    // the members are in the order of the class, which gives their offset
+    int i = 0;
+    for ( CBotVar* pv = m_pVar ; pv != nullptr ; pv = pv->m_next, i++ )
+    {
+        if ( i == CBotInlineValue::MAX_FIELDS ) return false;
+
+        value.fieldInit[i] = static_cast<unsigned char>(pv->m_binit);
+        // an int holding the name of a constant is kept only by a variable
+        if ( pv->m_binit == InitType::DEF && !pv->GetValue(value.fields[i]) ) return false;
+    }
+    value.count = i;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVarClass::SetInlineValue(const CBotInlineValue& value)
+{
+    if ( m_pClass != value.pClass || m_type.GetType() != CBotTypClass ) return false;
+
+    m_binit = static_cast<InitType>(value.init);
+
+    int i = 0;
+    for ( CBotVar* pv = m_pVar ; pv != nullptr && i < value.count ; pv = pv->m_next, i++ )
+    {
+        InitType init = static_cast<InitType>(value.fieldInit[i]);
+        if ( init == InitType::DEF ) pv->SetValue(value.fields[i]);
+        else                         pv->SetInit(init);
+    }
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void CBotVarClass::SetIdent(long n)
 {
+    if (m_ItemIdent != 0 && m_ItemIdent != m_handle) g_instances.RemoveAlias(m_ItemIdent, this);
     m_ItemIdent = n;
+    if (m_ItemIdent != 0 && m_ItemIdent != m_handle) g_instances.SetAlias(m_ItemIdent, this);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -163,6 +351,7 @@ void CBotVarClass::SetClass(CBotClass* pClass)//, int &nIdent)
     // initializes the variables associated with this class
     delete m_pVar;
     m_pVar = nullptr;
+    m_items.clear();
 
     if (pClass == nullptr) return;
 
@@ -239,6 +428,33 @@ void CBotVarClass::Update(void* pUser)
     m_pClass->Update(this, pUser);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::UpdateItem(CBotVar* item, void* pUser)
+{
+    if ( m_pUserPtr != nullptr) pUser = m_pUserPtr;
+    if ( pUser == OBJECTDELETED ||
+         pUser == OBJECTCREATED ) return;
+    m_pClass->UpdateItem(this, item, pUser);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::UpdateOnce(void* pUser)
+{
+    unsigned int round = g_updateRound.load();
+    if ( m_updateRound.load(std::memory_order_acquire) == round ) return;
+
+    std::lock_guard<std::mutex> lock(g_updateMutex);
+    if ( m_updateRound.load(std::memory_order_relaxed) == round ) return;   // updated by another thread meanwhile
+    Update(pUser);
+    m_updateRound.store(round, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::NextUpdateRound()
+{
+    g_updateRound++;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotVarClass::GetItem(const std::string& name)
 {
@@ -272,32 +488,94 @@ CBotVar* CBotVarClass::GetItemRef(int nIdent)
 ////////////////////////////////////////////////////////////////////////////////
 CBotVar* CBotVarClass::GetItem(int n, bool bExtend)
 {
-    CBotVar*    p = m_pVar;
-
     if ( n < 0 ) return nullptr;
     if ( n > MAXARRAYSIZE ) return nullptr;
 
     if ( m_type.GetLimite() >= 0 && n >= m_type.GetLimite() ) return nullptr;
 
-    if ( p == nullptr && bExtend )
+    if ( m_pVar == nullptr )
     {
-        p = CBotVar::Create("", m_type.GetTypElem());
-        m_pVar = p;
+        if ( !bExtend ) return nullptr;
+        m_pVar = CBotVar::Create("", m_type.GetTypElem());
     }
 
-    if ( n == 0 ) return p;
+    CheckItems();
 
-    while ( n-- > 0 )
+    // the elements known by m_items are reached directly
+    while ( static_cast<int>(m_items.size()) <= n )
     {
+        CBotVar*    p = m_items.back();
         if ( p->m_next == nullptr )
         {
-            if ( bExtend ) p->m_next = CBotVar::Create("", m_type.GetTypElem());
-            if ( p->m_next == nullptr ) return nullptr;
+            if ( !bExtend ) return nullptr;
+            p->m_next = CBotVar::Create("", m_type.GetTypElem());
         }
+        m_items.push_back(p->m_next);
+    }
+
+    return m_items[n];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int CBotVarClass::GetItemCount()
+{
+    if ( m_pVar == nullptr ) return 0;
+
+    CheckItems();
+
+    CBotVar*    p = m_items.back();
+    while ( p->m_next != nullptr )
+    {
+        p = p->m_next;
+        m_items.push_back(p);
+    }
+    return m_items.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CBotVarClass::SetItemCount(int count)
+{
+    if ( m_pClass != nullptr ) return false;        // not an array
+    if ( count < 0 || count > MAXARRAYSIZE ) return false;
+    if ( m_type.GetLimite() >= 0 && count > m_type.GetLimite() ) return false;
+
+    if ( count == 0 )
+    {
+        delete m_pVar;
+        m_pVar = nullptr;
+        m_items.clear();
+        return true;
+    }
+
+    if ( m_pVar == nullptr ) m_pVar = CBotVar::Create("", m_type.GetTypElem());
+
+    GetItemCount();                                 // all the existing elements in m_items
+    m_items.reserve(count);
+
+    CBotVar*    p = m_items.back();
+    while ( static_cast<int>(m_items.size()) < count )
+    {
+        p->m_next = CBotVar::Create("", m_type.GetTypElem());
         p = p->m_next;
+        m_items.push_back(p);
+    }
+
+    if ( static_cast<int>(m_items.size()) > count )
+    {
+        p = m_items[count - 1];
+        delete p->m_next;
+        p->m_next = nullptr;
+        m_items.resize(count);
     }
+    return true;
+}
 
-    return p;
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarClass::CheckItems()
+{
+    // every change of the list clears m_items, which only has to be started again
+    assert( m_items.empty() || m_items[0] == m_pVar );
+    if ( m_items.empty() && m_pVar != nullptr ) m_items.push_back(m_pVar);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -370,8 +648,7 @@ void CBotVarClass::IncrementUse()
 ////////////////////////////////////////////////////////////////////////////////
 void CBotVarClass::DecrementUse()
 {
-    m_CptUse--;
-    if ( m_CptUse == 0 )
+    if ( --m_CptUse == 0 )
     {
         // if there is one, call the destructor
         // but only if a constructor had been called.
@@ -379,14 +656,13 @@ void CBotVarClass::DecrementUse()
         {
             m_CptUse++;    // does not return to the destructor
 
-            // m_error is static in the stack
+            // the error is shared by the whole execution context
             // saves the value for return
-            CBotError err;
+            CBotExecutionContext* context = CBotExecutionContext::GetCurrent();
             int start, end;
-            CBotStack*    pile = nullptr;
-            err = pile->GetError(start,end);    // stack == nullptr it does not bother!
+            CBotError err = context->GetError(start, end);
 
-            pile = CBotStack::AllocateStack();        // clears the error
+            CBotStack*    pile = CBotStack::AllocateStack(context);        // clears the error
             CBotVar*    ppVars[1];
             ppVars[0] = nullptr;
 
@@ -419,12 +695,10 @@ CBotVarClass* CBotVarClass::GetPointer()
 ////////////////////////////////////////////////////////////////////////////////
 CBotVarClass* CBotVarClass::Find(long id)
 {
-    for (CBotVarClass* p : m_instances)
-    {
-        if (p->m_ItemIdent == id) return p;
-    }
+    CBotVarClass* p = g_instances.Get(id);
+    if (p != nullptr && p->m_ItemIdent == id) return p;
 
-    return nullptr;
+    return g_instances.GetAlias(id);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -462,12 +736,12 @@ bool CBotVarClass::Ne(CBotVar* left, CBotVar* right)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarClass::Save1State(FILE* pf)
+bool CBotVarClass::Save1State(CBotWriter& ostr)
 {
-    if ( !WriteType(pf, m_type) ) return false;
-    if ( !WriteLong(pf, m_ItemIdent) ) return false;
+    if ( !WriteType(ostr, m_type) ) return false;
+    if ( !WriteLong(ostr, m_ItemIdent) ) return false;
 
-    return SaveVars(pf, m_pVar);                                // content of the object
+    return SaveVars(ostr, m_pVar);                                // content of the object
 }
 
 } // namespace CBot
@@ -21,7 +21,8 @@
 
 #include "CBot/CBotVar/CBotVar.h"
 
-#include <set>
+#include <atomic>
+#include <vector>
 
 namespace CBot
 {
@@ -45,6 +46,9 @@ public:
 
     void Copy(CBotVar* pSrc, bool bName = true) override;
 
+    bool GetInlineValue(CBotInlineValue& value) override;
+    bool SetInlineValue(const CBotInlineValue& value) override;
+
     void SetClass(CBotClass* pClass) override;
     CBotClass* GetClass() override;
 
@@ -52,12 +56,39 @@ public:
     CBotVar* GetItemRef(int nIdent) override;
     CBotVar* GetItem(int n, bool bExtend) override;
     CBotVar* GetItemList() override;
+
+    /**
+     * \brief Returns the number of elements of an array
+     */
+    int GetItemCount();
+    bool SetItemCount(int count) override;
     std::string GetValString() override;
 
-    bool Save1State(FILE* pf) override;
+    bool Save1State(CBotWriter& ostr) override;
 
     void Update(void* pUser) override;
 
+    /**
+     * \brief Updates one element of this instance, see CBotClass::UpdateItem()
+     * \param item The element
+     * \param pUser User pointer to pass to the update function
+     */
+    void UpdateItem(CBotVar* item, void* pUser);
+
+    /**
+     * \brief Updates all the elements of this instance, unless it has already been done in the current round
+     *
+     * Used by the programs executed with CBotProgram::RunParallel(), which may read the same
+     * instance from several threads while what the update function reads doesn't change.
+     * \param pUser User pointer to pass to the update function
+     */
+    void UpdateOnce(void* pUser);
+
+    /**
+     * \brief Starts a new round for UpdateOnce(), see CBotProgram::BeginParallelRound()
+     */
+    static void NextUpdateRound();
+
     //! \name Reference counter
     //@{
 
@@ -82,6 +113,11 @@ public:
 
     /*!
      * \brief Finds a class instance by unique identifier
+     *
+     * New instances are identified by their handle in the table of all
+     * instances, which is found in constant time. Identifiers changed with
+     * SetIdent() are kept in a hash table.
+     *
      * \param id Identifier to find
      * \return Found class instance
      */
@@ -95,18 +131,28 @@ public:
     void ConstructorSet() override;
 
 private:
-    //! List of all class instances - first
-    static std::set<CBotVarClass*> m_instances;
+    /**
+     * \brief Makes m_items start with m_pVar again after it has been cleared
+     */
+    void CheckItems();
+
     //! Class definition
     CBotClass* m_pClass;
     //! Parent class instance
     CBotVarClass* m_pParent;
     //! Class members
     CBotVar* m_pVar;
+    //! Direct access to the elements of an array, which are also chained from m_pVar (see GetItem(int, bool)),
+    //! to be cleared by everything that changes the list of m_pVar
+    std::vector<CBotVar*> m_items;
     //! Reference counter
-    int m_CptUse;
+    std::atomic<int> m_CptUse;
+    //! Round of the last UpdateOnce()
+    std::atomic<unsigned int> m_updateRound;
     //! Identifier (unique) of an instance
     long m_ItemIdent;
+    //! Handle in the table of all instances, 0 if the table is full
+    long m_handle;
     //! Set after constructor is called, allows destructor to be called
     bool m_bConstructor;
 
@@ -23,6 +23,7 @@
 #include "CBot/CBotToken.h"
 
 #include "CBot/CBotUtils.h"
+#include "CBot/CBotFileUtils.h"
 
 #include <cmath>
 
@@ -218,9 +219,9 @@ bool CBotVarFloat::Ne(CBotVar* left, CBotVar* right)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarFloat::Save1State(FILE* pf)
+bool CBotVarFloat::Save1State(CBotWriter& ostr)
 {
-    return WriteFloat(pf, m_val); // the value of the variable
+    return WriteFloat(ostr, m_val); // the value of the variable
 }
 
 } // namespace CBot
@@ -61,7 +61,7 @@ public:
     void Inc() override;
     void Dec() override;
 
-    bool Save1State(FILE* pf) override;
+    bool Save1State(CBotWriter& ostr) override;
 
 private:
     //! The value.
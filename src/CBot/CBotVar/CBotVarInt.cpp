@@ -22,6 +22,7 @@
 #include "CBot/CBotEnums.h"
 #include "CBot/CBotToken.h"
 #include "CBot/CBotUtils.h"
+#include "CBot/CBotFileUtils.h"
 
 #include <cmath>
 
@@ -274,21 +275,21 @@ bool CBotVarInt::Ne(CBotVar* left, CBotVar* right)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarInt::Save0State(FILE* pf)
+bool CBotVarInt::Save0State(CBotWriter& ostr)
 {
     if ( !m_defnum.empty() )
     {
-        if(!WriteWord(pf, 200 )) return false;            // special marker
-        if(!WriteString(pf, m_defnum)) return false;    // name of the value
+        if(!WriteWord(ostr, 200 )) return false;            // special marker
+        if(!WriteString(ostr, m_defnum)) return false;    // name of the value
     }
 
-    return CBotVar::Save0State(pf);
+    return CBotVar::Save0State(ostr);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarInt::Save1State(FILE* pf)
+bool CBotVarInt::Save1State(CBotWriter& ostr)
 {
-    return WriteWord(pf, m_val);                            // the value of the variable
+    return WriteInt(ostr, m_val);                            // the value of the variable
 }
 
 } // namespace CBot
@@ -70,8 +70,8 @@ public:
     void Inc() override;
     void Dec() override;
 
-    bool Save0State(FILE* pf) override;
-    bool Save1State(FILE* pf) override;
+    bool Save0State(CBotWriter& ostr) override;
+    bool Save1State(CBotWriter& ostr) override;
 
 private:
     //! The value.
@@ -172,21 +172,21 @@ CBotClass* CBotVarPointer::GetClass()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarPointer::Save1State(FILE* pf)
+bool CBotVarPointer::Save1State(CBotWriter& ostr)
 {
     if ( m_pClass )
     {
-        if (!WriteString(pf, m_pClass->GetName())) return false;    // name of the class
+        if (!WriteString(ostr, m_pClass->GetName())) return false;    // name of the class
     }
     else
     {
-        if (!WriteString(pf, "")) return false;
+        if (!WriteString(ostr, "")) return false;
     }
 
-    if (!WriteLong(pf, GetIdent())) return false;        // the unique reference
+    if (!WriteLong(ostr, GetIdent())) return false;        // the unique reference
 
     // also saves the proceedings copies
-    return SaveVars(pf, GetPointer());
+    return SaveVars(ostr, GetPointer());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -61,7 +61,7 @@ public:
 
     void ConstructorSet() override;
 
-    bool Save1State(FILE* pf) override;
+    bool Save1State(CBotWriter& ostr) override;
 
     void Update(void* pUser) override;
 
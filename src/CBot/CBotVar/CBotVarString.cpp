@@ -22,10 +22,44 @@
 #include "CBot/CBotEnums.h"
 #include "CBot/CBotToken.h"
 #include "CBot/CBotUtils.h"
+#include "CBot/CBotFileUtils.h"
+#include "CBot/CBotExecutionContext.h"
 
 namespace CBot
 {
 
+/**
+ * \brief Characters of the strings sharing a buffer, and the memory charged for them
+ */
+struct CBotVarString::Buffer
+{
+    //! Characters, see CBotVarString::m_length
+    std::string value;
+    //! Counters of the context charged for the buffer
+    std::shared_ptr<CBotUsageCounters> owner = CBotExecutionContext::GetCurrent()->GetUsageCounters();
+    //! Bytes charged to owner so far
+    std::size_t charged = 0;
+
+    explicit Buffer(const std::string& val) : value(val)
+    {
+        Charge();
+    }
+
+    ~Buffer()
+    {
+        owner->RemoveBytes(charged);
+    }
+
+    //! Charges the capacity of value, after it has changed
+    void Charge()
+    {
+        std::size_t capacity = value.capacity();
+        if (capacity > charged) owner->AddBytes(capacity - charged);
+        else owner->RemoveBytes(charged - capacity);
+        charged = capacity;
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 CBotVarString::CBotVarString(const CBotToken& name)
 {
@@ -40,7 +74,13 @@ CBotVarString::CBotVarString(const CBotToken& name)
     m_bStatic = false;
     m_mPrivate = ProtectionLevel::Public;
 
-    m_val.clear();
+    m_val = nullptr;
+    m_length = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotVarString::~CBotVarString()
+{
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -51,6 +91,7 @@ void CBotVarString::Copy(CBotVar* pSrc, bool bName)
     if (bName)    *m_token    = *p->m_token;
     m_type        = p->m_type;
     m_val        = p->m_val;
+    m_length    = p->m_length;
     m_binit        = p->m_binit;
 //-    m_bStatic    = p->m_bStatic;
     m_next        = nullptr;
@@ -64,7 +105,16 @@ void CBotVarString::Copy(CBotVar* pSrc, bool bName)
 ////////////////////////////////////////////////////////////////////////////////
 void CBotVarString::SetValString(const std::string& val)
 {
-    m_val = val;
+    m_val = std::make_shared<Buffer>(val);
+    m_length = val.size();
+    m_binit    = CBotVar::InitType::DEF;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CBotVarString::SetValString(CBotVarString* src)
+{
+    m_val = src->m_val;
+    m_length = src->m_length;
     m_binit    = CBotVar::InitType::DEF;
 }
 
@@ -80,14 +130,31 @@ std::string CBotVarString::GetValString()
         return LoadString(TX_NAN);
     }
 
-    return    m_val;
+    if (m_val == nullptr) return std::string();
+    return    m_val->value.substr(0, m_length);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void CBotVarString::Add(CBotVar* left, CBotVar* right)
 {
-    m_val = left->GetValString() + right->GetValString();
-    m_binit = CBotVar::InitType::DEF;
+    std::string tail = right->GetValString();
+
+    if (left->GetType() == CBotTypString && left->GetInit() == CBotVar::InitType::DEF)
+    {
+        CBotVarString* l = static_cast<CBotVarString*>(left);
+        // append in place, unless another string already extended this buffer
+        if (l->m_val != nullptr && l->m_val->value.size() == l->m_length)
+        {
+            l->m_val->value.append(tail);
+            l->m_val->Charge();
+            m_val = l->m_val;
+            m_length = m_val->value.size();
+            m_binit = CBotVar::InitType::DEF;
+            return;
+        }
+    }
+
+    SetValString(left->GetValString() + tail);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -127,9 +194,9 @@ bool CBotVarString::Hs(CBotVar* left, CBotVar* right)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-bool CBotVarString::Save1State(FILE* pf)
+bool CBotVarString::Save1State(CBotWriter& ostr)
 {
-    return WriteString(pf, m_val);                            // the value of the variable
+    return WriteString(ostr, m_val != nullptr ? m_val->value.substr(0, m_length) : std::string());                            // the value of the variable
 }
 
 } // namespace CBot
@@ -21,11 +21,24 @@
 
 #include "CBot/CBotVar/CBotVar.h"
 
+#include <memory>
+
 namespace CBot
 {
 
 /**
  * \brief CBotVar subclass for managing string values (::CBotTypString)
+ *
+ * The value is a prefix of a buffer that can be shared with other strings.
+ * Copying a string only shares the buffer, and concatenation appends to the
+ * buffer of the left operand in place as long as nothing was appended to it
+ * after that prefix yet. This makes building a string in a loop with
+ * s = s + x; or s += x; amortized O(length of x). Characters in a buffer are never
+ * modified, so every string sharing it keeps its value. GetValString() always
+ * returns the flattened value.
+ *
+ * The memory of a buffer is charged once, to the context in which it was created
+ * (see CBotExecutionContext::GetMemoryUsage()), however many strings share it.
  */
 class CBotVarString : public CBotVar
 {
@@ -34,10 +47,20 @@ public:
      * \brief Constructor. Do not call directly, use CBotVar::Create()
      */
     CBotVarString(const CBotToken& name);
+    /**
+     * \brief Destructor. Do not call directly, use CBotVar::Destroy()
+     */
+    ~CBotVarString();
 
     void SetValString(const std::string& val) override;
     std::string GetValString() override;
 
+    /**
+     * \brief Sets the value to the value of another string, sharing its buffer
+     * \param src String to take the value from
+     */
+    void SetValString(CBotVarString* src);
+
     void Copy(CBotVar* pSrc, bool bName = true) override;
 
     void Add(CBotVar* left, CBotVar* right) override;
@@ -49,11 +72,16 @@ public:
     bool Eq(CBotVar* left, CBotVar* right) override;
     bool Ne(CBotVar* left, CBotVar* right) override;
 
-    bool Save1State(FILE* pf) override;
+    bool Save1State(CBotWriter& ostr) override;
 
 private:
-    //! The value.
-    std::string m_val;
+    //! Characters shared by several strings, see CBotVarString.cpp
+    struct Buffer;
+
+    //! Buffer holding the value, possibly followed by characters appended by other strings
+    std::shared_ptr<Buffer> m_val;
+    //! Length of the value, the prefix of m_val that belongs to this string
+    std::size_t m_length;
 };
 
 } // namespace CBot
@@ -22,6 +22,7 @@
 #include "CBot/CBot.h"
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <cassert>
 
@@ -33,6 +34,8 @@ namespace
 std::unique_ptr<CBotFileAccessHandler> g_fileHandler;
 std::unordered_map<int, std::unique_ptr<CBotFile>> g_files;
 int g_nextFileId = 1;
+// destructors may be called from any thread, see CBotProgram::RunParallel()
+std::mutex g_filesMutex;
 }
 
 
@@ -74,8 +77,10 @@ bool FileClassOpenFile(CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exc
 
         if (!file->Opened()) { Exception = CBotErrFileOpen; return false; }
 
+        std::unique_lock<std::mutex> lock(g_filesMutex);
         int fileHandle = g_nextFileId++;
         g_files[fileHandle] = std::move(file);
+        lock.unlock();
 
         // save the file handle
         pVar = pThis->GetItem("handle");
@@ -131,6 +136,7 @@ bool rfdestruct (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception
     pVar = pThis->GetItem("handle");
 
     if (!pVar->IsDefined()) return true; // file not opened
+    std::lock_guard<std::mutex> lock(g_filesMutex);
     g_files.erase(pVar->GetValInt());
 
     pVar->SetInit(CBotVar::InitType::IS_NAN);
@@ -194,6 +200,7 @@ bool rfclose (CBotVar* pThis, CBotVar* pVar, CBotVar* pResult, int& Exception, v
 
     int fileHandle = pVar->GetValInt();
 
+    std::lock_guard<std::mutex> lock(g_filesMutex);
     const auto handleIter = g_files.find(fileHandle);
     if (handleIter == g_files.end())
     {
@@ -110,6 +110,7 @@ void InitializeRestext()
     stringsText[RT_STUDIO_COMPOK]    = TR("Compilation ok (0 errors)");
     stringsText[RT_STUDIO_PROGSTOP]  = TR("Program finished");
     stringsText[RT_STUDIO_CLONED]    = TR("Program cloned");
+    stringsText[RT_STUDIO_MEMORY]    = TR("Memory used: %d KB (peak %d KB)");
 
     stringsText[RT_PROGRAM_READONLY] = TR("This program is read-only, clone it to edit");
     stringsText[RT_PROGRAM_EXAMPLE]  = TR("This is example code that cannot be run directly");
@@ -732,6 +733,7 @@ void InitializeRestext()
     stringsCbot[CBot::CBotErrNotOpen]       = TR("File not open");
     stringsCbot[CBot::CBotErrRead]          = TR("Read error");
     stringsCbot[CBot::CBotErrWrite]         = TR("Write error");
+    stringsCbot[CBot::CBotErrMemory]        = TR("Memory limit reached");
 }
 
 
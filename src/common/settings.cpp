@@ -88,6 +88,9 @@ void CSettings::SaveSettings()
     GetConfigFile().SetBoolProperty("Setup", "Autosave", main->GetAutosave());
     GetConfigFile().SetIntProperty("Setup", "AutosaveInterval", main->GetAutosaveInterval());
     GetConfigFile().SetIntProperty("Setup", "AutosaveSlots", main->GetAutosaveSlots());
+    GetConfigFile().SetIntProperty("Setup", "ScriptFrameSteps", main->GetScriptFrameSteps());
+    GetConfigFile().SetIntProperty("Setup", "ScriptMemoryLimit", main->GetScriptMemoryLimit());
+    GetConfigFile().SetBoolProperty("Setup", "ScriptBytecode", main->GetScriptBytecode());
     GetConfigFile().SetBoolProperty("Setup", "ObjectDirty", engine->GetDirty());
     GetConfigFile().SetBoolProperty("Setup", "FogMode", engine->GetFog());
     GetConfigFile().SetBoolProperty("Setup", "LightMode", engine->GetLightMode());
@@ -179,6 +182,15 @@ void CSettings::LoadSettings()
     if (GetConfigFile().GetIntProperty("Setup", "AutosaveSlots", iValue))
         main->SetAutosaveSlots(iValue);
 
+    if (GetConfigFile().GetIntProperty("Setup", "ScriptFrameSteps", iValue))
+        main->SetScriptFrameSteps(iValue);
+
+    if (GetConfigFile().GetIntProperty("Setup", "ScriptMemoryLimit", iValue))
+        main->SetScriptMemoryLimit(iValue);
+
+    if (GetConfigFile().GetBoolProperty("Setup", "ScriptBytecode", bValue))
+        main->SetScriptBytecode(bValue);
+
     if (GetConfigFile().GetBoolProperty("Setup", "ObjectDirty", bValue))
         engine->SetDirty(bValue);
 
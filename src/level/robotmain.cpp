@@ -68,6 +68,10 @@
 
 #include "object/auto/auto.h"
 
+#include "object/interface/destroyable_object.h"
+#include "object/interface/program_storage_object.h"
+#include "object/interface/programmable_object.h"
+
 #include "object/motion/motion.h"
 #include "object/motion/motionhuman.h"
 #include "object/motion/motiontoto.h"
@@ -83,6 +87,7 @@
 #include "script/cbottoken.h"
 #include "script/script.h"
 #include "script/scriptfunc.h"
+#include "script/scriptscheduler.h"
 
 #include "sound/sound.h"
 
@@ -105,6 +110,7 @@
 
 #include "ui/screen/screen_loading.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <stdexcept>
 
@@ -156,6 +162,8 @@ CRobotMain::CRobotMain()
         m_modelManager.get(),
         m_particle);
 
+    m_scriptScheduler = MakeUnique<CScriptScheduler>();
+
     m_time = 0.0f;
     m_gameTime = 0.0f;
     m_gameTimeAbsolute = 0.0f;
@@ -232,6 +240,10 @@ CRobotMain::CRobotMain()
     m_autosaveSlots = 3;
     m_autosaveLast = 0.0f;
 
+    m_scriptFrameSteps = 20000;
+    m_scriptMemoryLimit = 64 * 1024;
+    m_scriptBytecode = true;
+
     m_shotSaving = 0;
 
     m_cameraPan  = 0.0f;
@@ -2486,6 +2498,9 @@ bool CRobotMain::EventFrame(const Event &event)
     CObject* toto = nullptr;
     if (!m_pause->IsPauseType(PAUSE_OBJECT_UPDATES))
     {
+        ShareScriptFrameSteps();
+        m_deferScripts = true;
+
         // Advances all the robots, but not toto.
         for (CObject* obj : m_objMan->GetAllObjects())
         {
@@ -2524,6 +2539,9 @@ bool CRobotMain::EventFrame(const Event &event)
                 dynamic_cast<CInteractiveObject*>(obj)->EventProcess(event);
         }
 
+        m_deferScripts = false;
+        RunScriptsParallel();
+
         m_engine->GetPyroManager()->EventProcess(event);
     }
 
@@ -4447,7 +4465,7 @@ void CRobotMain::SaveOneScript(CObject *obj)
 }
 
 //! Saves the stack of the program in execution of a robot
-bool CRobotMain::SaveFileStack(CObject *obj, FILE *file, int objRank)
+bool CRobotMain::SaveFileStack(CObject *obj, CBot::CBotWriter& ostr, int objRank)
 {
     if (objRank == -1) return true;
 
@@ -4458,11 +4476,14 @@ bool CRobotMain::SaveFileStack(CObject *obj, FILE *file, int objRank)
     ObjectType type = obj->GetType();
     if (type == OBJECT_HUMAN) return true;
 
-    return programmable->WriteStack(file);
+    std::size_t block = ostr.BeginBlock();
+    bool ok = programmable->WriteStack(ostr);
+    ostr.EndBlock(block);
+    return ok;
 }
 
 //! Resumes the execution stack of the program in a robot
-bool CRobotMain::ReadFileStack(CObject *obj, FILE *file, int objRank)
+bool CRobotMain::ReadFileStack(CObject *obj, CBot::CBotReader& istr, int objRank)
 {
     if (objRank == -1) return true;
 
@@ -4473,7 +4494,17 @@ bool CRobotMain::ReadFileStack(CObject *obj, FILE *file, int objRank)
     ObjectType type = obj->GetType();
     if (type == OBJECT_HUMAN) return true;
 
-    return programmable->ReadStack(file);
+    if (istr.IsLegacy()) return programmable->ReadStack(istr);
+
+    // the stack of each robot is in its own block, a stack that can't be
+    // restored doesn't prevent restoring the next ones
+    CBot::CBotReader block;
+    if (!istr.ReadBlock(block)) return false;
+    if (!programmable->ReadStack(block))
+    {
+        GetLogger()->Warn("Failed to restore the program state of object %d\n", obj->GetID());
+    }
+    return true;
 }
 
 
@@ -4714,10 +4745,11 @@ bool CRobotMain::IOWriteScene(std::string filename, std::string filecbot, std::s
     FILE* file = CBot::fOpen((CResourceManager::GetSaveLocation() + "/" + filecbot).c_str(), "wb");
     if (file == nullptr) return false;
 
+    CBot::CBotWriter ostr;      // buffered in memory, written to the file at once
     long version = 1;
-    CBot::fWrite(&version, sizeof(long), 1, file);  // version of COLOBOT
+    CBot::WriteLong(ostr, version);  // version of COLOBOT
     version = CBot::CBotProgram::GetVersion();
-    CBot::fWrite(&version, sizeof(long), 1, file);  // version of CBOT
+    CBot::WriteLong(ostr, version);  // version of CBOT
 
     objRank = 0;
     for (CObject* obj : m_objMan->GetAllObjects())
@@ -4726,9 +4758,10 @@ bool CRobotMain::IOWriteScene(std::string filename, std::string filecbot, std::s
         if (IsObjectBeingTransported(obj)) continue;
         if (obj->Implements(ObjectInterfaceType::Destroyable) && dynamic_cast<CDestroyableObject*>(obj)->IsDying()) continue;
 
-        if (!SaveFileStack(obj, file, objRank++))  break;
+        if (!SaveFileStack(obj, ostr, objRank++))  break;
     }
-    CBot::CBotClass::SaveStaticState(file);
+    CBot::CBotClass::SaveStaticState(ostr);
+    ostr.Flush(file);
     CBot::fClose(file);
 
     if (!emergencySave)
@@ -4911,11 +4944,16 @@ CObject* CRobotMain::IOReadScene(std::string filename, std::string filecbot)
     FILE* file = CBot::fOpen((CResourceManager::GetSaveLocation() + "/" + filecbot).c_str(), "rb");
     if (file != nullptr)
     {
-        long version;
-        CBot::fRead(&version, sizeof(long), 1, file);  // version of COLOBOT
+        std::string data;
+        CBot::fReadAll(file, data);
+        CBot::fClose(file);
+
+        CBot::CBotReader istr(data.data(), data.size());    // also reads the layout of older saves
+        long version = 0;
+        CBot::ReadLong(istr, version);  // version of COLOBOT
         if (version == 1)
         {
-            CBot::fRead(&version, sizeof(long), 1, file);  // version of CBOT
+            CBot::ReadLong(istr, version);  // version of CBOT
             if (version == CBot::CBotProgram::GetVersion())
             {
                 objRank = 0;
@@ -4925,12 +4963,11 @@ CObject* CRobotMain::IOReadScene(std::string filename, std::string filecbot)
                     if (IsObjectBeingTransported(obj)) continue;
                     if (obj->Implements(ObjectInterfaceType::Destroyable) && dynamic_cast<CDestroyableObject*>(obj)->IsDying()) continue;
 
-                    if (!ReadFileStack(obj, file, objRank++)) break;
+                    if (!ReadFileStack(obj, istr, objRank++)) break;
                 }
             }
         }
-        CBot::CBotClass::RestoreStaticState(file);
-        CBot::fClose(file);
+        CBot::CBotClass::RestoreStaticState(istr);
     }
 
     m_ui->GetLoadingScreen()->SetProgress(1.0f, RT_LOADING_FINISHED);
@@ -5647,6 +5684,36 @@ int CRobotMain::GetAutosaveSlots()
     return m_autosaveSlots;
 }
 
+void CRobotMain::SetScriptFrameSteps(int steps)
+{
+    m_scriptFrameSteps = std::max(steps, 0);
+}
+
+int CRobotMain::GetScriptFrameSteps()
+{
+    return m_scriptFrameSteps;
+}
+
+void CRobotMain::SetScriptMemoryLimit(int kilobytes)
+{
+    m_scriptMemoryLimit = std::max(kilobytes, 0);
+}
+
+int CRobotMain::GetScriptMemoryLimit()
+{
+    return m_scriptMemoryLimit;
+}
+
+void CRobotMain::SetScriptBytecode(bool enable)
+{
+    m_scriptBytecode = enable;
+}
+
+bool CRobotMain::GetScriptBytecode()
+{
+    return m_scriptBytecode;
+}
+
 int CRobotMain::AutosaveRotate(bool freeOne)
 {
     if (m_playerProfile == nullptr)
@@ -6032,3 +6099,95 @@ void CRobotMain::UpdateDebugCrashSpheres()
         }
     }
 }
+
+//! Shares the steps of the frame (see SetScriptFrameSteps()) fairly between the running programs:
+//! each program gets the steps it asks for with ipf(), up to an equal share, and what the programs
+//! asking for less leave goes to the others.
+void CRobotMain::ShareScriptFrameSteps()
+{
+    std::vector<CScript*> scripts;
+    for (CObject* obj : m_objMan->GetAllObjects())
+    {
+        if (IsObjectBeingTransported(obj)) continue;
+        if (!obj->Implements(ObjectInterfaceType::Programmable)) continue;
+        if (obj->Implements(ObjectInterfaceType::Destroyable) && dynamic_cast<CDestroyableObject*>(obj)->IsDying()) continue;
+
+        CProgrammableObject* programmable = dynamic_cast<CProgrammableObject*>(obj);
+        if (!programmable->GetActivity() || !programmable->IsProgram()) continue;
+
+        scripts.push_back(programmable->GetCurrentProgram()->script.get());
+    }
+
+    if (m_scriptFrameSteps == 0)
+    {
+        for (CScript* script : scripts)
+            script->SetFrameSteps(script->GetIPF());
+    }
+    else
+    {
+        std::vector<CScript*> byIPF = scripts;
+        std::stable_sort(byIPF.begin(), byIPF.end(), [](CScript* a, CScript* b) { return a->GetIPF() < b->GetIPF(); });
+
+        int stepsLeft = m_scriptFrameSteps;
+        int scriptsLeft = byIPF.size();
+        for (CScript* script : byIPF)
+        {
+            int steps = std::min(script->GetIPF(), std::max(stepsLeft / scriptsLeft, 1));
+            script->SetFrameSteps(steps);
+            stepsLeft -= steps;
+            scriptsLeft--;
+        }
+    }
+}
+
+bool CRobotMain::DeferScript(CObject* object)
+{
+    if (!m_deferScripts) return false;
+
+    m_deferredScripts.push_back(object->GetID());
+    return true;
+}
+
+//! Returns the program of a deferred object, unless it has been stopped or destroyed since
+CScript* CRobotMain::GetDeferredScript(int id)
+{
+    CObject* obj = m_objMan->GetObjectById(id);
+    if (obj == nullptr || !obj->Implements(ObjectInterfaceType::Programmable)) return nullptr;
+
+    CProgrammableObject* programmable = dynamic_cast<CProgrammableObject*>(obj);
+    if (!programmable->IsProgram()) return nullptr;
+    return programmable->GetCurrentProgram()->script.get();
+}
+
+//! Executes the programs left by CScript::Continue() while the objects were advanced
+//!
+//! What only depends on the programs themselves and on the world as it is now is executed
+//! on several threads. Everything else (calls changing the world, programs using data shared
+//! with other programs) is then committed from the main thread in object id order, so the
+//! result is the same whatever the number of threads, and replays stay deterministic.
+void CRobotMain::RunScriptsParallel()
+{
+    std::sort(m_deferredScripts.begin(), m_deferredScripts.end());
+    m_deferredScripts.erase(std::unique(m_deferredScripts.begin(), m_deferredScripts.end()), m_deferredScripts.end());
+
+    std::vector<CScript*> scripts;
+    for (int id : m_deferredScripts)
+    {
+        CScript* script = GetDeferredScript(id);
+        if (script != nullptr) scripts.push_back(script);
+    }
+    m_scriptScheduler->RunParallel(scripts);
+
+    for (int id : m_deferredScripts)
+    {
+        // a program committed before may have destroyed the object or stopped its program
+        CScript* script = GetDeferredScript(id);
+        if (script == nullptr) continue;
+
+        if (script->FinishFrame())
+        {
+            dynamic_cast<CProgrammableObject*>(m_objMan->GetObjectById(id))->StopProgram();
+        }
+    }
+    m_deferredScripts.clear();
+}
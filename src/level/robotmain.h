@@ -91,8 +91,16 @@ class CPlayerProfile;
 class CSettings;
 class COldObject;
 class CPauseManager;
+class CScript;
+class CScriptScheduler;
 struct ActivePause;
 
+namespace CBot
+{
+class CBotWriter;
+class CBotReader;
+}
+
 namespace Gfx
 {
 class CEngine;
@@ -263,8 +271,8 @@ public:
 
     void        SaveAllScript();
     void        SaveOneScript(CObject *obj);
-    bool        SaveFileStack(CObject *obj, FILE *file, int objRank);
-    bool        ReadFileStack(CObject *obj, FILE *file, int objRank);
+    bool        SaveFileStack(CObject *obj, CBot::CBotWriter& ostr, int objRank);
+    bool        ReadFileStack(CObject *obj, CBot::CBotReader& istr, int objRank);
 
     void        FlushNewScriptName();
     void        AddNewScriptName(ObjectType type, const std::string& name);
@@ -303,6 +311,19 @@ public:
     void        SetAutosaveSlots(int slots);
     int         GetAutosaveSlots();
 
+    //! Sets the number of program steps executed by all the robots in one frame, 0 for no limit
+    void        SetScriptFrameSteps(int steps);
+    int         GetScriptFrameSteps();
+    //! Sets the memory in KB that each program may use, 0 for no limit
+    void        SetScriptMemoryLimit(int kilobytes);
+    int         GetScriptMemoryLimit();
+    //! Enables lowering of expressions to bytecode when programs are compiled, see CBot::CBotBytecode
+    void        SetScriptBytecode(bool enable);
+    bool        GetScriptBytecode();
+    //! Leaves the execution of the program of the object for the end of the frame, see RunScriptsParallel()
+    //! \return false if the program has to be executed right away
+    bool        DeferScript(CObject* object);
+
     //! Enable mode where completing mission closes the game
     void        SetExitAfterMission(bool exit);
 
@@ -408,6 +429,9 @@ protected:
     void        DestroyCodeBattleInterface();
     void        SetCodeBattleSpectatorMode(bool mode);
     void        UpdateDebugCrashSpheres();
+    void        ShareScriptFrameSteps();
+    void        RunScriptsParallel();
+    CScript*    GetDeferredScript(int id);
 
 
 protected:
@@ -426,6 +450,7 @@ protected:
     std::unique_ptr<CObjectManager> m_objMan;
     std::unique_ptr<CMainMovie> m_movie;
     std::unique_ptr<CPauseManager> m_pause;
+    std::unique_ptr<CScriptScheduler> m_scriptScheduler;
     std::unique_ptr<Gfx::CModelManager> m_modelManager;
     std::unique_ptr<Gfx::CTerrain> m_terrain;
     std::unique_ptr<Gfx::CCamera> m_camera;
@@ -581,6 +606,14 @@ protected:
     int             m_autosaveSlots = 0;
     float           m_autosaveLast = 0.0f;
 
+    int             m_scriptFrameSteps = 0;
+    int             m_scriptMemoryLimit = 0;
+    bool            m_scriptBytecode = false;
+    //! true while the objects are advanced, see DeferScript()
+    bool            m_deferScripts = false;
+    //! Ids of the objects whose program is executed by RunScriptsParallel()
+    std::vector<int> m_deferredScripts;
+
     int             m_shotSaving = 0;
 
     std::deque<CObject*> m_selectionHistory;
@@ -140,21 +140,24 @@ bool CProgrammableObjectImpl::IsProgram()
 
 // Load a stack of script implementation from a file.
 
-bool CProgrammableObjectImpl::ReadStack(FILE *file)
+bool CProgrammableObjectImpl::ReadStack(CBot::CBotReader& istr)
 {
-    short       op;
+    unsigned short  w;
+    short           op;
 
-    CBot::fRead(&op, sizeof(short), 1, file);
+    if (!CBot::ReadWord(istr, w)) return false;
+    op = static_cast<short>(w);
     if ( op == 1 )  // run ?
     {
-        CBot::fRead(&op, sizeof(short), 1, file);  // program rank
+        if (!CBot::ReadWord(istr, w)) return false;  // program rank
+        op = static_cast<short>(w);
         if ( op >= 0 )
         {
             if (m_object->Implements(ObjectInterfaceType::ProgramStorage))
             {
                 assert(op < static_cast<int>(dynamic_cast<CProgramStorageObject*>(m_object)->GetProgramCount()));
                 m_currentProgram = dynamic_cast<CProgramStorageObject*>(m_object)->GetProgram(op);
-                if ( !m_currentProgram->script->ReadStack(file) )  return false;
+                if ( !m_currentProgram->script->ReadStack(istr) )  return false;
             }
             else
             {
@@ -168,7 +171,7 @@ bool CProgrammableObjectImpl::ReadStack(FILE *file)
 
 // Save the script implementation stack of a file.
 
-bool CProgrammableObjectImpl::WriteStack(FILE *file)
+bool CProgrammableObjectImpl::WriteStack(CBot::CBotWriter& ostr)
 {
     short       op;
 
@@ -176,20 +179,20 @@ bool CProgrammableObjectImpl::WriteStack(FILE *file)
          m_currentProgram->script->IsRunning() )
     {
         op = 1;  // run
-        CBot::fWrite(&op, sizeof(short), 1, file);
+        CBot::WriteWord(ostr, op);
 
         op = -1;
         if (m_object->Implements(ObjectInterfaceType::ProgramStorage))
         {
             op = dynamic_cast<CProgramStorageObject*>(m_object)->GetProgramIndex(m_currentProgram);
         }
-        CBot::fWrite(&op, sizeof(short), 1, file);
+        CBot::WriteWord(ostr, op);
 
-        return m_currentProgram->script->WriteStack(file);
+        return m_currentProgram->script->WriteStack(ostr);
     }
 
     op = 0;  // stop
-    CBot::fWrite(&op, sizeof(short), 1, file);
+    CBot::WriteWord(ostr, op);
     return true;
 }
 
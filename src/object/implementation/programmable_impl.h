@@ -58,8 +58,8 @@ public:
     Program* GetCurrentProgram() override;
     void StopProgram() override;
 
-    bool ReadStack(FILE *file) override;
-    bool WriteStack(FILE *file) override;
+    bool ReadStack(CBot::CBotReader& istr) override;
+    bool WriteStack(CBot::CBotWriter& ostr) override;
 
     void TraceRecordStart() override;
     void TraceRecordStop() override;
@@ -27,6 +27,12 @@
 
 struct Program;
 
+namespace CBot
+{
+class CBotWriter;
+class CBotReader;
+}
+
 /**
  * \class CProgrammableObject
  * \brief Interface for programmable objects
@@ -52,10 +58,10 @@ public:
     //! Check if a program is running
     virtual bool IsProgram() = 0;
 
-    //! Save current execution status to file
-    virtual bool WriteStack(FILE *file) = 0;
-    //! Read current execution status from file
-    virtual bool ReadStack(FILE *file) = 0;
+    //! Save current execution status
+    virtual bool WriteStack(CBot::CBotWriter& ostr) = 0;
+    //! Read current execution status
+    virtual bool ReadStack(CBot::CBotReader& istr) = 0;
 
     //! Start recording trace
     virtual void TraceRecordStart() = 0;
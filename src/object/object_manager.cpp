@@ -118,8 +118,9 @@ void CObjectManager::DeleteAllObjects()
 
 CObject* CObjectManager::GetObjectById(unsigned int id)
 {
-    if (m_objects.count(id) == 0) return nullptr;
-    return m_objects[id].get();
+    auto it = m_objects.find(id);     // doesn't change the map, see CScriptScheduler
+    if (it == m_objects.end()) return nullptr;
+    return it->second.get();
 }
 
 CObject* CObjectManager::GetObjectByRank(unsigned int id)
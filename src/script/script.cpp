@@ -44,6 +44,9 @@
 #include "ui/controls/interface.h"
 #include "ui/controls/list.h"
 
+#include <algorithm>
+#include <map>
+
 
 const int CBOT_IPF = 100;       // CBOT: default number of instructions / frame
 
@@ -65,6 +68,7 @@ CScript::CScript(COldObject* object)
     m_interface     = m_main->GetInterface();
 
     m_ipf = CBOT_IPF;
+    m_frameSteps = CBOT_IPF;
     m_errMode = ERM_STOP;
     m_len = 0;
     m_bRun = false;
@@ -233,7 +237,11 @@ bool CScript::Compile()
     if (m_botProg == nullptr)
     {
         m_botProg = MakeUnique<CBot::CBotProgram>(m_object->GetBotVar());
+        m_botProg->SetOptimizeEnabled(true);
+        m_botProg->SetProfiler(&m_profiler);
     }
+    m_botProg->SetBytecodeEnabled(m_main->GetScriptBytecode());    // step by step mode uses the tree anyway
+    m_botProg->SetCompileKey(static_cast<int>(m_object->GetType()));   // see cFire()
 
     if ( m_botProg->Compile(m_script.get(), functionList, this) )
     {
@@ -321,9 +329,13 @@ bool CScript::Run()
 
     if ( !m_botProg->Start(m_mainFunction) )  return false;
 
+    m_botProg->GetContext()->SetMemoryLimit(static_cast<long>(m_main->GetScriptMemoryLimit()) * 1024);
+    m_profiler.Clear();
     m_bRun = true;
     m_bContinue = false;
+    m_parallelState = ParallelState::None;
     m_ipf = CBOT_IPF;
+    m_frameSteps = CBOT_IPF;
     m_errMode = ERM_STOP;
 
     if ( m_bStepMode )  // step by step mode?
@@ -334,6 +346,33 @@ bool CScript::Run()
     return true;
 }
 
+// Executes the part of the current frame that doesn't need the main thread.
+// May be called from any thread, see CScriptScheduler.
+// The execution is then completed by FinishFrame().
+
+void CScript::RunParallel()
+{
+    m_parallelState = ParallelState::None;
+
+    if (m_botProg == nullptr)  return;
+    if ( !m_bRun )  return;
+    if ( m_bStepMode )  return;
+    if ( !m_botProg->CanRunParallel() )  return;
+
+    if ( m_botProg->RunParallel(this, m_frameSteps) )
+    {
+        m_parallelState = ParallelState::Finished;
+    }
+    else if ( m_botProg->IsWaitingForMainThread() )
+    {
+        m_parallelState = ParallelState::Yielded;
+    }
+    else
+    {
+        m_parallelState = ParallelState::Suspended;
+    }
+}
+
 // Continues the execution of current program.
 // Returns true when execution is finished.
 
@@ -374,7 +413,30 @@ bool CScript::Continue()
         return false;
     }
 
-    if ( m_botProg->Run(this, m_ipf) )
+    if ( m_main->DeferScript(m_object) )  return false;  // see CRobotMain::RunScriptsParallel()
+
+    return FinishFrame();
+}
+
+// Executes the current frame of the program, or what is left of it after RunParallel().
+// Returns true when execution is finished.
+
+bool CScript::FinishFrame()
+{
+    if (m_botProg == nullptr)  return true;
+    if ( !m_bRun )  return true;
+
+    bool finished = false;
+    switch (m_parallelState)
+    {
+        case ParallelState::None:      finished = m_botProg->Run(this, m_frameSteps); break;
+        case ParallelState::Finished:  finished = true;                               break;
+        case ParallelState::Suspended: finished = false;                              break;
+        case ParallelState::Yielded:   finished = m_botProg->ContinueRun(this);       break;
+    }
+    m_parallelState = ParallelState::None;
+
+    if ( finished )
     {
         m_botProg->GetError(m_error, m_cursor1, m_cursor2);
         if ( m_cursor1 < 0 || m_cursor1 > m_len ||
@@ -450,6 +512,7 @@ void CScript::Stop()
     }
 
     m_bRun = false;
+    m_parallelState = ParallelState::None;
 }
 
 // Indicates whether the program runs.
@@ -466,6 +529,21 @@ bool CScript::IsContinue()
     return m_bContinue;
 }
 
+// Returns the number of steps per frame asked by the program, see ipf().
+
+int CScript::GetIPF()
+{
+    return m_ipf;
+}
+
+// Sets the number of steps executed in the next frames,
+// CRobotMain shares the budget of a frame between the programs.
+
+void CScript::SetFrameSteps(int steps)
+{
+    m_frameSteps = steps;
+}
+
 
 // Gives the position of the cursor during the execution.
 
@@ -596,7 +674,11 @@ void CScript::UpdateList(Ui::CList* list)
         list->SetSelect(select);
     }
 
-    list->SetTooltip("");
+    std::string res;
+    GetResource(RES_TEXT, RT_STUDIO_MEMORY, res);
+    CBot::CBotExecutionContext* context = m_botProg->GetContext();
+    list->SetTooltip(StrUtils::Format(res.c_str(), static_cast<int>(context->GetMemoryUsage() / 1024),
+                                      static_cast<int>(context->GetPeakMemoryUsage() / 1024)));
     list->SetState(Ui::STATE_ENABLE);
 }
 
@@ -666,6 +748,105 @@ void CScript::ColorizeScript(Ui::CEdit* edit, int rangeStart, int rangeEnd)
     }
 }
 
+// Gives a background to the lines of the edited program according to the steps
+// the last run spent on them, the syntax colors are kept. Returns false if there
+// is nothing to show, or if the text is no longer the one that was executed.
+
+bool CScript::ColorizeHeat(Ui::CEdit* edit)
+{
+    edit->ClearLineBack();
+    if ( m_script == nullptr || m_profiler.GetTotal().steps <= 0 )  return false;
+
+    std::string text = std::string(edit->GetText(), edit->GetTextLength());
+    if ( text != std::string(m_script.get(), m_len) )  return false;
+
+    std::map<int, CBot::CBotProfiler::Entry> lines = m_profiler.GetLines(text);
+    long max = 0;
+    for ( const auto& line : lines )
+    {
+        max = std::max(max, line.second.steps);
+    }
+    if ( max <= 0 )  return false;
+
+    int line = 1;
+    int start = 0;
+    for ( int i = 0 ; i <= m_len ; i++ )
+    {
+        if ( i < m_len && text[i] != '\n' )  continue;
+
+        auto it = lines.find(line);
+        if ( it != lines.end() && it->second.steps > 0 )
+        {
+            Gfx::Color heat(1.000f, 1.000f, 0.800f, 1.0f);  // rarely executed: pale yellow
+            if ( it->second.steps*2 >= max )  heat = Gfx::Color(1.000f, 0.750f, 0.700f, 1.0f);  // most: pale red
+            else if ( it->second.steps*8 >= max )  heat = Gfx::Color(1.000f, 0.880f, 0.650f, 1.0f);  // often: pale orange
+            edit->SetLineBack(start, i+1, heat);
+        }
+        line ++;
+        start = i+1;
+    }
+    return true;
+}
+
+// Returns the start of the comment /* */ containing the position, or -1.
+
+static int GetBlockCommentStart(const std::string& text, int pos)
+{
+    int i = 0;
+    while ( i < pos )
+    {
+        if ( text[i] == '"' )  // string
+        {
+            i ++;
+            while ( i < pos && text[i] != '"' && text[i] != '\n' )
+            {
+                if ( text[i] == '\\' )  i ++;
+                i ++;
+            }
+        }
+        else if ( text[i] == '/' && i+1 < pos && text[i+1] == '/' )  // comment until the end of the line
+        {
+            while ( i < pos && text[i] != '\n' )  i ++;
+        }
+        else if ( text[i] == '/' && i+1 < pos && text[i+1] == '*' )
+        {
+            std::size_t end = text.find("*/", i+2);
+            if ( end == std::string::npos || static_cast<int>(end)+2 > pos )  return i;
+            i = end+2;
+            continue;
+        }
+        i ++;
+    }
+    return -1;
+}
+
+// Gives the part of the text to colorize again after a modification.
+// Tokens never go beyond the end of a line, except comments /* */.
+
+void CScript::GetColorizeRange(const std::string& oldText, const std::string& newText, int& rangeStart, int& rangeEnd)
+{
+    int oldLength = oldText.size();
+    int newLength = newText.size();
+
+    int prefix = 0;
+    while ( prefix < oldLength && prefix < newLength && oldText[prefix] == newText[prefix] )  prefix ++;
+    int suffix = 0;
+    while ( suffix < oldLength-prefix && suffix < newLength-prefix &&
+            oldText[oldLength-1-suffix] == newText[newLength-1-suffix] )  suffix ++;
+
+    rangeStart = prefix;
+    int comment = GetBlockCommentStart(newText, rangeStart);
+    if ( comment >= 0 )  rangeStart = comment;
+    while ( rangeStart > 0 && newText[rangeStart-1] != '\n' )  rangeStart --;
+
+    rangeEnd = newLength-suffix;
+    if ( (GetBlockCommentStart(newText, rangeEnd) >= 0) != (GetBlockCommentStart(oldText, oldLength-suffix) >= 0) )
+    {
+        rangeEnd = newLength;  // a comment was opened or closed
+    }
+    while ( rangeEnd < newLength && newText[rangeEnd] != '\n' )  rangeEnd ++;
+}
+
 
 // Seeks a token at random in a script.
 // Returns the index of the start of the token found, or -1.
@@ -975,17 +1156,18 @@ bool CScript::WriteScript(const char* filename)
 
 // Reads a stack of script by execution as a file.
 
-bool CScript::ReadStack(FILE *file)
+bool CScript::ReadStack(CBot::CBotReader& istr)
 {
     int     nb;
 
-    CBot::fRead(&nb, sizeof(int), 1, file);
-    CBot::fRead(&m_ipf, sizeof(int), 1, file);
-    CBot::fRead(&m_errMode, sizeof(int), 1, file);
+    if (!CBot::ReadInt(istr, nb)) return false;
+    if (!CBot::ReadInt(istr, m_ipf)) return false;
+    if (!CBot::ReadInt(istr, m_errMode)) return false;
 
     if (m_botProg == nullptr) return false;
-    if ( !m_botProg->RestoreState(file) )  return false;
+    if ( !m_botProg->RestoreState(istr) )  return false;
 
+    m_botProg->GetContext()->SetMemoryLimit(static_cast<long>(m_main->GetScriptMemoryLimit()) * 1024);
     m_bRun = true;
     m_bContinue = false;
     return true;
@@ -993,16 +1175,16 @@ bool CScript::ReadStack(FILE *file)
 
 // Writes a stack of script by execution as a file.
 
-bool CScript::WriteStack(FILE *file)
+bool CScript::WriteStack(CBot::CBotWriter& ostr)
 {
     int     nb;
 
     nb = 2;
-    CBot::fWrite(&nb, sizeof(int), 1, file);
-    CBot::fWrite(&m_ipf, sizeof(int), 1, file);
-    CBot::fWrite(&m_errMode, sizeof(int), 1, file);
+    CBot::WriteInt(ostr, nb);
+    CBot::WriteInt(ostr, m_ipf);
+    CBot::WriteInt(ostr, m_errMode);
 
-    return m_botProg->SaveState(file);
+    return m_botProg->SaveState(ostr);
 }
 
 
@@ -71,14 +71,20 @@ public:
     void        SetStepMode(bool bStep);
     bool        GetStepMode();
     bool        Run();
+    void        RunParallel();
     bool        Continue();
+    bool        FinishFrame();
     bool        Step();
     void        Stop();
     bool        IsRunning();
     bool        IsContinue();
+    int         GetIPF();
+    void        SetFrameSteps(int steps);
     bool        GetCursor(int &cursor1, int &cursor2);
     void        UpdateList(Ui::CList* list);
     static void ColorizeScript(Ui::CEdit* edit, int rangeStart = 0, int rangeEnd = std::numeric_limits<int>::max());
+    static void GetColorizeRange(const std::string& oldText, const std::string& newText, int& rangeStart, int& rangeEnd);
+    bool        ColorizeHeat(Ui::CEdit* edit);
     bool        IntroduceVirus();
 
     int         GetError();
@@ -88,13 +94,23 @@ public:
     bool        SendScript(const char* text);
     bool        ReadScript(const char* filename);
     bool        WriteScript(const char* filename);
-    bool        ReadStack(FILE *file);
-    bool        WriteStack(FILE *file);
+    bool        ReadStack(CBot::CBotReader& istr);
+    bool        WriteStack(CBot::CBotWriter& ostr);
     bool        Compare(CScript* other);
 
     void        SetFilename(char *filename);
     char*       GetFilename();
 
+protected:
+    //! Result of the last RunParallel(), used by the following FinishFrame()
+    enum class ParallelState
+    {
+        None,       // not executed in parallel in this frame
+        Finished,   // program finished
+        Suspended,  // timer elapsed
+        Yielded,    // waiting for the main thread
+    };
+
 protected:
     bool        IsEmpty();
     bool        CheckToken();
@@ -107,17 +123,20 @@ protected:
     Gfx::CEngine*       m_engine = nullptr;
     Ui::CInterface*     m_interface = nullptr;
     std::unique_ptr<CBot::CBotProgram> m_botProg;
+    CBot::CBotProfiler  m_profiler;     // where the last run spent its time
     CRobotMain*         m_main = nullptr;
     Gfx::CTerrain*      m_terrain = nullptr;
     Gfx::CWater*        m_water = nullptr;
 
     int     m_ipf = 0;          // number of instructions/second
+    int     m_frameSteps = 0;   // number of steps allowed in the current frame, see SetFrameSteps()
     int     m_errMode = 0;      // what to do in case of error
     int     m_len = 0;          // length of the script (without <0>)
     std::unique_ptr<char[]> m_script;       // script ends with <0>
     bool    m_bRun = false;         // program during execution?
     bool    m_bStepMode = false;        // step by step
     bool    m_bContinue = false;        // external function to continue
+    ParallelState m_parallelState = ParallelState::None;
     bool    m_bCompile = false;     // compilation ok?
     char    m_title[50] = {};        // script title
     char    m_mainFunction[50] = {};
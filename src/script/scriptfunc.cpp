@@ -937,16 +937,24 @@ bool CScriptFunctions::rRadar(CBotVar* var, CBotVar* result, int& exception, voi
 
 bool CScriptFunctions::rRadarAll(CBotVar* var, CBotVar* result, int& exception, void* user)
 {
-    return runRadar(var, [&result, user](std::vector<ObjectType> types, float angle, float focus, float minDist, float maxDist, bool furthest, RadarFilter filter)
+    return runRadar(var, [&result, &exception, user](std::vector<ObjectType> types, float angle, float focus, float minDist, float maxDist, bool furthest, RadarFilter filter)
     {
         CObject* pThis = static_cast<CScript*>(user)->m_object;
         std::vector<CObject*> best = CObjectManager::GetInstancePointer()->RadarAll(pThis, types, angle, focus, minDist, maxDist, furthest, filter, true);
 
-        int i = 0;
+        if (best.size() > MAXARRAYSIZE)  best.resize(MAXARRAYSIZE);
+
         result->SetInit(CBotVar::InitType::DEF);
+        if (!result->SetItemCount(best.size()))
+        {
+            exception = CBotErrOutArray;    // more objects than the array can hold
+            return true;
+        }
+        CBotVar* item = result->GetItemList();
         for (CObject* obj : best)
         {
-            result->GetItem(i++, true)->SetPointer(obj->GetBotVar());
+            item->SetPointer(obj->GetBotVar());
+            item = item->GetNext();
         }
 
         return true;
@@ -2318,7 +2326,7 @@ CBotTypResult CScriptFunctions::cFire(CBotVar* &var, void* user)
     CObject*    pThis = static_cast<CScript*>(user)->m_object;
     ObjectType  type;
 
-    type = pThis->GetType();
+    type = pThis->GetType();    // part of the compile key, see CScript::Compile()
 
     if ( type == OBJECT_ANT )
     {
@@ -3085,6 +3093,11 @@ private:
 
 
 
+// Costs of the functions that look at all the objects or at the terrain around a point,
+// in steps of the program (see CBotProgram::AddFunction())
+const int COST_SCAN_OBJECTS = 20;
+const int COST_SCAN_TERRAIN = 50;
+
 // Initializes all functions for module CBOT.
 
 void CScriptFunctions::Init()
@@ -3208,34 +3221,37 @@ void CScriptFunctions::Init()
     CBotProgram::AddFunction("playmusic", rPlayMusic ,cPlayMusic);
     CBotProgram::AddFunction("stopmusic", rStopMusic ,cNull);
 
-    CBotProgram::AddFunction("getbuild",          rGetBuild,          cNull);
-    CBotProgram::AddFunction("getresearchenable", rGetResearchEnable, cNull);
+    // the functions which only read the world are parallel safe, the world doesn't change
+    // while the programs are executed in parallel (see CScriptScheduler); getresearchdone(),
+    // canbuild() and researched() aren't, they may fill the research of a new team
+    CBotProgram::AddFunction("getbuild",          rGetBuild,          cNull, true);
+    CBotProgram::AddFunction("getresearchenable", rGetResearchEnable, cNull, true);
     CBotProgram::AddFunction("getresearchdone",   rGetResearchDone,   cNull);
     CBotProgram::AddFunction("setbuild",          rSetBuild,          cOneInt);
     CBotProgram::AddFunction("setresearchenable", rSetResearchEnable, cOneInt);
     CBotProgram::AddFunction("setresearchdone",   rSetResearchDone,   cOneInt);
 
     CBotProgram::AddFunction("canbuild",        rCanBuild,        cOneIntReturnBool);
-    CBotProgram::AddFunction("canresearch",     rCanResearch,     cOneIntReturnBool);
+    CBotProgram::AddFunction("canresearch",     rCanResearch,     cOneIntReturnBool, true);
     CBotProgram::AddFunction("researched",      rResearched,      cOneIntReturnBool);
-    CBotProgram::AddFunction("buildingenabled", rBuildingEnabled, cOneIntReturnBool);
+    CBotProgram::AddFunction("buildingenabled", rBuildingEnabled, cOneIntReturnBool, true);
 
     CBotProgram::AddFunction("build",           rBuild,           cOneInt);
 
     CBotProgram::AddFunction("retobject", rGetObject, cGetObject);
-    CBotProgram::AddFunction("retobjectbyid", rGetObjectById, cGetObject);
+    CBotProgram::AddFunction("retobjectbyid", rGetObjectById, cGetObject, true);
     CBotProgram::AddFunction("delete",    rDelete,    cDelete);
-    CBotProgram::AddFunction("search",    rSearch,    cSearch);
-    CBotProgram::AddFunction("radar",     rRadar,     cRadar);
-    CBotProgram::AddFunction("radarall",  rRadarAll,  cRadarAll);
-    CBotProgram::AddFunction("detect",    rDetect,    cDetect);
-    CBotProgram::AddFunction("direction", rDirection, cDirection);
+    CBotProgram::AddFunction("search",    rSearch,    cSearch, true, COST_SCAN_OBJECTS);
+    CBotProgram::AddFunction("radar",     rRadar,     cRadar, true, COST_SCAN_OBJECTS);
+    CBotProgram::AddFunction("radarall",  rRadarAll,  cRadarAll, true, COST_SCAN_OBJECTS);
+    CBotProgram::AddFunction("detect",    rDetect,    cDetect, false, COST_SCAN_OBJECTS);
+    CBotProgram::AddFunction("direction", rDirection, cDirection, true);
     CBotProgram::AddFunction("produce",   rProduce,   cProduce);
-    CBotProgram::AddFunction("distance",  rDistance,  cDistance);
-    CBotProgram::AddFunction("distance2d",rDistance2d,cDistance);
-    CBotProgram::AddFunction("space",     rSpace,     cSpace);
-    CBotProgram::AddFunction("flatspace", rFlatSpace, cFlatSpace);
-    CBotProgram::AddFunction("flatground",rFlatGround,cFlatGround);
+    CBotProgram::AddFunction("distance",  rDistance,  cDistance, true);
+    CBotProgram::AddFunction("distance2d",rDistance2d,cDistance, true);
+    CBotProgram::AddFunction("space",     rSpace,     cSpace, false, COST_SCAN_TERRAIN);
+    CBotProgram::AddFunction("flatspace", rFlatSpace, cFlatSpace, false, COST_SCAN_TERRAIN);
+    CBotProgram::AddFunction("flatground",rFlatGround,cFlatGround, false, COST_SCAN_TERRAIN);
     CBotProgram::AddFunction("wait",      rWait,      cOneFloat);
     CBotProgram::AddFunction("move",      rMove,      cOneFloat);
     CBotProgram::AddFunction("turn",      rTurn,      cOneFloat);
@@ -3254,7 +3270,7 @@ void CScriptFunctions::Init()
     CBotProgram::AddFunction("aim",       rAim,       cAim);
     CBotProgram::AddFunction("motor",     rMotor,     cMotor);
     CBotProgram::AddFunction("jet",       rJet,       cOneFloat);
-    CBotProgram::AddFunction("topo",      rTopo,      cTopo);
+    CBotProgram::AddFunction("topo",      rTopo,      cTopo, true);
     CBotProgram::AddFunction("message",   rMessage,   cMessage);
     CBotProgram::AddFunction("cmdline",   rCmdline,   cOneFloat);
     CBotProgram::AddFunction("ismovie",   rIsMovie,   cNull);
@@ -3272,34 +3288,18 @@ void CScriptFunctions::Init()
 }
 
 
-// Updates the class Object.
+// Updates the fields of the class Object, one function per field.
 
-void CScriptFunctions::uObject(CBotVar* botThis, void* user)
+namespace
 {
-    CPhysics*   physics;
-    CBotVar     *pVar, *pSub;
-    ObjectType  type;
-    Math::Vector    pos;
-    float       value;
-
-    if ( user == nullptr )  return;
 
-    CObject* obj = static_cast<CObject*>(user);
-    assert(obj->Implements(ObjectInterfaceType::Old));
-    COldObject* object = static_cast<COldObject*>(obj);
-
-    physics = object->GetPhysics();
-
-    // Updates the object's type.
-    pVar = botThis->GetItemList();  // "category"
-    type = object->GetType();
-    pVar->SetValInt(type, object->GetName());
+// Sets a point, or makes it NAN if the vector is not available.
 
-    // Updates the position of the object.
-    pVar = pVar->GetNext();  // "position"
-    if (IsObjectBeingTransported(object))
+void SetPointItem(CBotVar* pVar, const Math::Vector* pos)
+{
+    CBotVar* pSub = pVar->GetItemList();  // "x"
+    if (pos == nullptr)
     {
-        pSub = pVar->GetItemList();  // "x"
         pSub->SetInit(CBotVar::InitType::IS_NAN);
         pSub = pSub->GetNext();  // "y"
         pSub->SetInit(CBotVar::InitType::IS_NAN);
@@ -3308,57 +3308,107 @@ void CScriptFunctions::uObject(CBotVar* botThis, void* user)
     }
     else
     {
-        pos = object->GetPosition();
-        float waterLevel = Gfx::CEngine::GetInstancePointer()->GetWater()->GetLevel();
-        pos.y -= waterLevel;  // relative to sea level!
-        pSub = pVar->GetItemList();  // "x"
-        pSub->SetValFloat(pos.x/g_unit);
+        pSub->SetValFloat(pos->x/g_unit);
         pSub = pSub->GetNext();  // "y"
-        pSub->SetValFloat(pos.z/g_unit);
+        pSub->SetValFloat(pos->z/g_unit);  // attention y -> z !
         pSub = pSub->GetNext();  // "z"
-        pSub->SetValFloat(pos.y/g_unit);
+        pSub->SetValFloat(pos->y/g_unit);  // attention z -> y !
+    }
+}
+
+// Updates the object's type.
+
+void UpdateCategory(CBotVar* pVar, COldObject* object)
+{
+    pVar->SetValInt(object->GetType(), object->GetName());
+}
+
+// Updates the position of the object.
+
+void UpdatePosition(CBotVar* pVar, COldObject* object)
+{
+    if (IsObjectBeingTransported(object))
+    {
+        SetPointItem(pVar, nullptr);
     }
+    else
+    {
+        Math::Vector pos = object->GetPosition();
+        float waterLevel = Gfx::CEngine::GetInstancePointer()->GetWater()->GetLevel();
+        pos.y -= waterLevel;  // relative to sea level!
+        SetPointItem(pVar, &pos);
+    }
+}
+
+// Updates the angles.
 
-    // Updates the angle.
-    pos = object->GetRotation();
-    pos += object->GetTilt();
-    pVar = pVar->GetNext();  // "orientation"
+void UpdateOrientation(CBotVar* pVar, COldObject* object)
+{
+    Math::Vector pos = object->GetRotation() + object->GetTilt();
     pVar->SetValFloat(Math::NormAngle(2*Math::PI - pos.y)*180.0f/Math::PI);
-    pVar = pVar->GetNext();  // "pitch"
+}
+
+void UpdatePitch(CBotVar* pVar, COldObject* object)
+{
+    Math::Vector pos = object->GetRotation() + object->GetTilt();
     pVar->SetValFloat(Math::NormAngle(pos.z)*180.0f/Math::PI);
-    pVar = pVar->GetNext();  // "roll"
+}
+
+void UpdateRoll(CBotVar* pVar, COldObject* object)
+{
+    Math::Vector pos = object->GetRotation() + object->GetTilt();
     pVar->SetValFloat(Math::NormAngle(pos.x)*180.0f/Math::PI);
+}
 
-    // Updates the energy level of the object.
-    pVar = pVar->GetNext();  // "energyLevel"
-    value = object->GetEnergyLevel();
-    pVar->SetValFloat(value);
+// Updates the energy level of the object.
+
+void UpdateEnergyLevel(CBotVar* pVar, COldObject* object)
+{
+    pVar->SetValFloat(object->GetEnergyLevel());
+}
+
+// Updates the shield level of the object.
 
-    // Updates the shield level of the object.
-    pVar = pVar->GetNext();  // "shieldLevel"
-    if ( !obj->Implements(ObjectInterfaceType::Shielded) ) value = 1.0f;
+void UpdateShieldLevel(CBotVar* pVar, COldObject* object)
+{
+    float value;
+    if ( !object->Implements(ObjectInterfaceType::Shielded) ) value = 1.0f;
     else value = dynamic_cast<CShieldedObject*>(object)->GetShield();
     pVar->SetValFloat(value);
+}
 
-    // Updates the temperature of the reactor.
-    pVar = pVar->GetNext();  // "temperature"
-    if ( !obj->Implements(ObjectInterfaceType::JetFlying) )  value = 0.0f;
+// Updates the temperature of the reactor.
+
+void UpdateTemperature(CBotVar* pVar, COldObject* object)
+{
+    float value;
+    if ( !object->Implements(ObjectInterfaceType::JetFlying) )  value = 0.0f;
     else value = 1.0f-dynamic_cast<CJetFlyingObject*>(object)->GetReactorRange();
     pVar->SetValFloat(value);
+}
+
+// Updates the height above the ground.
 
-    // Updates the height above the ground.
-    pVar = pVar->GetNext();  // "altitude"
+void UpdateAltitude(CBotVar* pVar, COldObject* object)
+{
+    CPhysics* physics = object->GetPhysics();
+    float value;
     if ( physics == nullptr )  value = 0.0f;
     else                 value = physics->GetFloorHeight();
     pVar->SetValFloat(value/g_unit);
+}
 
-    // Updates the lifetime of the object.
-    pVar = pVar->GetNext();  // "lifeTime"
-    value = object->GetAbsTime();
-    pVar->SetValFloat(value);
+// Updates the lifetime of the object.
+
+void UpdateLifeTime(CBotVar* pVar, COldObject* object)
+{
+    pVar->SetValFloat(object->GetAbsTime());
+}
+
+// Updates the type of battery.
 
-    // Updates the type of battery.
-    pVar = pVar->GetNext();  // "energyCell"
+void UpdateEnergyCell(CBotVar* pVar, COldObject* object)
+{
     if (object->Implements(ObjectInterfaceType::Powered))
     {
         CObject* power = dynamic_cast<CPoweredObject*>(object)->GetPower();
@@ -3371,9 +3421,12 @@ void CScriptFunctions::uObject(CBotVar* botThis, void* user)
             pVar->SetPointer(power->GetBotVar());
         }
     }
+}
 
-    // Updates the transported object's type.
-    pVar = pVar->GetNext();  // "load"
+// Updates the transported object's type.
+
+void UpdateLoad(CBotVar* pVar, COldObject* object)
+{
     if (object->Implements(ObjectInterfaceType::Carrier))
     {
         CObject* cargo = dynamic_cast<CCarrierObject*>(object)->GetCargo();
@@ -3386,48 +3439,100 @@ void CScriptFunctions::uObject(CBotVar* botThis, void* user)
             pVar->SetPointer(cargo->GetBotVar());
         }
     }
+}
 
-    pVar = pVar->GetNext();  // "id"
-    value = object->GetID();
-    pVar->SetValInt(value);
+void UpdateId(CBotVar* pVar, COldObject* object)
+{
+    pVar->SetValInt(object->GetID());
+}
 
-    pVar = pVar->GetNext();  // "team"
-    value = object->GetTeam();
-    pVar->SetValInt(value);
+void UpdateTeam(CBotVar* pVar, COldObject* object)
+{
+    pVar->SetValInt(object->GetTeam());
+}
+
+// Updates the velocity of the object.
 
-    // Updates the velocity of the object.
-    pVar = pVar->GetNext();  // "velocity"
+void UpdateVelocity(CBotVar* pVar, COldObject* object)
+{
+    CPhysics* physics = object->GetPhysics();
     if (IsObjectBeingTransported(object) || physics == nullptr)
     {
-        pSub = pVar->GetItemList();  // "x"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
-        pSub = pSub->GetNext();  // "y"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
-        pSub = pSub->GetNext();  // "z"
-        pSub->SetInit(CBotVar::InitType::IS_NAN);
+        SetPointItem(pVar, nullptr);
     }
     else
     {
         Math::Matrix matRotate;
         Math::LoadRotationZXYMatrix(matRotate, object->GetRotation());
-        pos = physics->GetLinMotion(MO_CURSPEED);
+        Math::Vector pos = physics->GetLinMotion(MO_CURSPEED);
         pos = Transform(matRotate, pos);
+        SetPointItem(pVar, &pos);
+    }
+}
 
-        pSub = pVar->GetItemList();  // "x"
-        pSub->SetValFloat(pos.x/g_unit);
-        pSub = pSub->GetNext();  // "y"
-        pSub->SetValFloat(pos.z/g_unit);
-        pSub = pSub->GetNext();  // "z"
-        pSub->SetValFloat(pos.y/g_unit);
+struct ObjectItemUpdate
+{
+    const char* name;
+    void (*update)(CBotVar* thisVar, CBotVar* item, void* user);
+};
+
+template<void Update(CBotVar* pVar, COldObject* object)>
+void UpdateObjectItem(CBotVar* botThis, CBotVar* item, void* user)
+{
+    if ( user == nullptr )  return;
+
+    CObject* obj = static_cast<CObject*>(user);
+    assert(obj->Implements(ObjectInterfaceType::Old));
+    Update(item, static_cast<COldObject*>(obj));
+}
+
+// The fields in the order of their declaration in CScriptFunctions::Init()
+
+const ObjectItemUpdate OBJECT_ITEMS[] =
+{
+    { "category",    UpdateObjectItem<UpdateCategory>    },
+    { "position",    UpdateObjectItem<UpdatePosition>    },
+    { "orientation", UpdateObjectItem<UpdateOrientation> },
+    { "pitch",       UpdateObjectItem<UpdatePitch>       },
+    { "roll",        UpdateObjectItem<UpdateRoll>        },
+    { "energyLevel", UpdateObjectItem<UpdateEnergyLevel> },
+    { "shieldLevel", UpdateObjectItem<UpdateShieldLevel> },
+    { "temperature", UpdateObjectItem<UpdateTemperature> },
+    { "altitude",    UpdateObjectItem<UpdateAltitude>    },
+    { "lifeTime",    UpdateObjectItem<UpdateLifeTime>    },
+    { "energyCell",  UpdateObjectItem<UpdateEnergyCell>  },
+    { "load",        UpdateObjectItem<UpdateLoad>        },
+    { "id",          UpdateObjectItem<UpdateId>          },
+    { "team",        UpdateObjectItem<UpdateTeam>        },
+    { "velocity",    UpdateObjectItem<UpdateVelocity>    },
+};
+
+} // namespace
+
+// Updates the class Object.
+// Programs read the fields one by one, this updates all of them at once.
+
+void CScriptFunctions::uObject(CBotVar* botThis, void* user)
+{
+    CBotVar* pVar = botThis->GetItemList();  // "category"
+    for (const ObjectItemUpdate& item : OBJECT_ITEMS)
+    {
+        if (pVar == nullptr)  break;
+        item.update(botThis, pVar, user);
+        pVar = pVar->GetNext();
     }
 }
 
 CBotVar* CScriptFunctions::CreateObjectVar(CObject* obj)
 {
     CBotClass* bc = CBotClass::Find("object");
-    if ( bc != nullptr )
+    if ( bc != nullptr && !bc->HasItemUpdateFuncs() )
     {
         bc->SetUpdateFunc(CScriptFunctions::uObject);
+        for (const ObjectItemUpdate& item : OBJECT_ITEMS)
+        {
+            bc->SetUpdateFunc(item.name, item.update);
+        }
     }
 
     CBotVar* botVar = CBotVar::Create("", CBotTypResult(CBotTypClass, "object"));
@@ -51,7 +51,10 @@ public:
 
     static bool CheckOpenFiles();
 
-private:
+    //! \name Compilation of the functions
+    //! They only check the arguments (except cFire(), which needs the CScript as
+    //! user pointer), and are also used to check programs outside of the game.
+    //@{
     static CBot::CBotTypResult cEndMission(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cPlayMusic(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cGetObject(CBot::CBotVar* &var, void* user);
@@ -83,7 +86,10 @@ private:
     static CBot::CBotTypResult cOnePoint(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cPoint(CBot::CBotVar* &var, void* user);
     static CBot::CBotTypResult cOneObject(CBot::CBotVar* &var, void* user);
+    static CBot::CBotTypResult cPointConstructor(CBot::CBotVar* pThis, CBot::CBotVar* &var);
+    //@}
 
+private:
     static bool rEndMission(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rPlayMusic(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rStopMusic(CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
@@ -155,7 +161,6 @@ private:
     static bool rTakeOff(CBot::CBotVar* thisclass, CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
     static bool rDestroy(CBot::CBotVar* thisclass, CBot::CBotVar* var, CBot::CBotVar* result, int& exception, void* user);
 
-    static CBot::CBotTypResult cPointConstructor(CBot::CBotVar* pThis, CBot::CBotVar* &var);
     static bool rPointConstructor(CBot::CBotVar* pThis, CBot::CBotVar* var, CBot::CBotVar* pResult, int& Exception, void* user);
 
     static void uObject(CBot::CBotVar* botThis, void* user);
@@ -0,0 +1,127 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+#include "script/scriptscheduler.h"
+
+#include "common/logger.h"
+
+#include "script/script.h"
+
+#include <SDL_cpuinfo.h>
+
+#include <algorithm>
+
+
+CScriptScheduler::CScriptScheduler()
+{
+    int count = std::max(SDL_GetCPUCount() - 1, 0);
+    for (int i = 0; i < count; i++)
+    {
+        SDL_Thread* thread = SDL_CreateThread(WorkerMain, "CScriptScheduler", this);
+        if (thread == nullptr)
+        {
+            GetLogger()->Warn("Could not create script worker thread: %s\n", SDL_GetError());
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+    GetLogger()->Debug("Scripts are executed with %d worker threads\n", static_cast<int>(m_threads.size()));
+}
+
+CScriptScheduler::~CScriptScheduler()
+{
+    SDL_LockMutex(*m_mutex);
+    m_quit = true;
+    SDL_CondBroadcast(*m_workCond);
+    SDL_UnlockMutex(*m_mutex);
+
+    for (SDL_Thread* thread : m_threads)
+    {
+        SDL_WaitThread(thread, nullptr);
+    }
+}
+
+int CScriptScheduler::GetWorkerCount()
+{
+    return m_threads.size();
+}
+
+void CScriptScheduler::RunParallel(const std::vector<CScript*>& scripts)
+{
+    if (scripts.empty()) return;
+
+    CBot::CBotProgram::BeginParallelRound();
+
+    SDL_LockMutex(*m_mutex);
+
+    m_scripts = &scripts;
+    m_nextJob = 0;
+    m_pendingJobs = scripts.size();
+    m_generation++;
+    SDL_CondBroadcast(*m_workCond);
+
+    RunJobs();  // the main thread helps too
+
+    while (m_pendingJobs > 0)
+    {
+        SDL_CondWait(*m_doneCond, *m_mutex);
+    }
+    m_scripts = nullptr;
+
+    SDL_UnlockMutex(*m_mutex);
+}
+
+void CScriptScheduler::RunJobs()
+{
+    while (m_scripts != nullptr && m_nextJob < m_scripts->size())
+    {
+        CScript* script = (*m_scripts)[m_nextJob++];
+
+        SDL_UnlockMutex(*m_mutex);
+        script->RunParallel();
+        SDL_LockMutex(*m_mutex);
+
+        if (--m_pendingJobs == 0)
+        {
+            SDL_CondSignal(*m_doneCond);
+        }
+    }
+}
+
+int CScriptScheduler::WorkerMain(void* data)
+{
+    CScriptScheduler* scheduler = static_cast<CScriptScheduler*>(data);
+
+    SDL_LockMutex(*scheduler->m_mutex);
+    unsigned int generation = scheduler->m_generation;
+    while (true)
+    {
+        while (!scheduler->m_quit && scheduler->m_generation == generation)
+        {
+            SDL_CondWait(*scheduler->m_workCond, *scheduler->m_mutex);
+        }
+        if (scheduler->m_quit) break;
+
+        generation = scheduler->m_generation;
+        scheduler->RunJobs();
+    }
+    SDL_UnlockMutex(*scheduler->m_mutex);
+
+    return 0;
+}
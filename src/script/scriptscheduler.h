@@ -0,0 +1,80 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+/**
+ * \file script/scriptscheduler.h
+ * \brief Executes the scripts of all robots on several threads
+ */
+
+#pragma once
+
+#include "common/thread/sdl_cond_wrapper.h"
+#include "common/thread/sdl_mutex_wrapper.h"
+
+#include <SDL_thread.h>
+
+#include <vector>
+
+class CScript;
+
+/**
+ * \class CScriptScheduler
+ * \brief Pool of worker threads executing CScript::RunParallel()
+ *
+ * At the end of every frame, the programs stepped by the objects are executed
+ * on the workers as long as they only depend on themselves and on the world,
+ * which doesn't change meanwhile (radar(), object variables etc.). Calls that
+ * change the world (move(), goto(), produce(), send()...) and programs using
+ * data shared with other programs are left for CScript::FinishFrame(), which
+ * CRobotMain calls from the main thread in object id order. The result of a
+ * frame is thus the same whatever the number of threads, and replays stay
+ * deterministic.
+ */
+class CScriptScheduler
+{
+public:
+    CScriptScheduler();
+    ~CScriptScheduler();
+
+    CScriptScheduler(const CScriptScheduler&) = delete;
+    CScriptScheduler& operator=(const CScriptScheduler&) = delete;
+
+    //! Calls RunParallel() on all given scripts and waits until they are done
+    void        RunParallel(const std::vector<CScript*>& scripts);
+
+    //! Returns the number of worker threads, not counting the main thread
+    int         GetWorkerCount();
+
+protected:
+    static int  WorkerMain(void* data);
+    //! Executes jobs until there are none left, must be called with m_mutex locked
+    void        RunJobs();
+
+protected:
+    std::vector<SDL_Thread*> m_threads;
+    CSDLMutexWrapper    m_mutex;
+    CSDLCondWrapper     m_workCond;
+    CSDLCondWrapper     m_doneCond;
+
+    const std::vector<CScript*>* m_scripts = nullptr;
+    unsigned int        m_nextJob = 0;
+    unsigned int        m_pendingJobs = 0;
+    unsigned int        m_generation = 0;
+    bool                m_quit = false;
+};
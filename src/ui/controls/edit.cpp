@@ -994,6 +994,18 @@ void CEdit::Draw()
             DrawHorizontalGradient(start, end, Gfx::Color(0.996f, 0.675f, 0.329f, 1.0f), Gfx::Color(1.000f, 0.898f, 0.788f, 1.0f));  // fond orange d�grad� ->
         }
 
+        // Background of the line?
+        for ( const LineBack& back : m_lineBack )
+        {
+            if ( beg < back.start || beg >= back.end )  continue;
+            start.x = ppos.x-MARGX;
+            end.x   = dim.x-MARGX*2.0f;
+            start.y = ppos.y-(m_bMulti?0.0f:MARGY1);
+            end.y   = m_lineHeight;
+            DrawColor(start, end, back.color);
+            break;
+        }
+
         // Image \image; ?
         if ( beg+len < m_len && m_format.size() > static_cast<unsigned int>(beg) &&
              (m_format[beg]&Gfx::FONT_MASK_IMAGE) != 0 )
@@ -3181,6 +3193,25 @@ bool CEdit::ClearFormat()
     return true;
 }
 
+// Removes the backgrounds of the lines.
+
+void CEdit::ClearLineBack()
+{
+    m_lineBack.clear();
+}
+
+// Gives a background to the lines starting in a sequence of characters,
+// without changing the format of their characters.
+
+void CEdit::SetLineBack(int cursor1, int cursor2, Gfx::Color color)
+{
+    LineBack back;
+    back.start = cursor1;
+    back.end   = cursor2;
+    back.color = color;
+    m_lineBack.push_back(back);
+}
+
 // Changes the format of a sequence of characters.
 
 bool CEdit::SetFormat(int cursor1, int cursor2, int format)
@@ -98,6 +98,15 @@ struct HyperMarker
     int pos = 0;
 };
 
+struct LineBack
+{
+    //! range of the text, the lines starting in it get the background
+    int start = 0;
+    int end = 0;
+    //! color of the background
+    Gfx::Color color;
+};
+
 struct HyperHistory
 {
     //! full file name text
@@ -181,6 +190,9 @@ public:
     bool        ClearFormat();
     bool        SetFormat(int cursor1, int cursor2, int format);
 
+    void        ClearLineBack();
+    void        SetLineBack(int cursor1, int cursor2, Gfx::Color color);
+
 protected:
     void        SendModifEvent();
     bool        IsLinkPos(Math::Point pos);
@@ -262,6 +274,7 @@ protected:
     std::vector<ImageLine> m_image;
     std::vector<HyperLink> m_link;
     std::vector<HyperMarker> m_marker;
+    std::vector<LineBack> m_lineBack;     // backgrounds of lines, under the format of the text
     int     m_historyTotal;
     int     m_historyCurrent;
     HyperHistory    m_history[EDITHISTORYMAX];
@@ -92,6 +92,7 @@ CStudio::CStudio()
     m_time      = 0.0f;
     m_bRealTime = true;
     m_bRunning  = false;
+    m_bHeat     = false;
     m_fixInfoTextTime = 0.0f;
     m_dialog = SD_NULL;
     m_editCamera = Gfx::CAM_TYPE_NULL;
@@ -135,7 +136,7 @@ bool CStudio::EventProcess(const Event &event)
 
     if ( event.type == EVENT_STUDIO_EDIT )  // text modifief?
     {
-        ColorizeScript(edit);
+        ColorizeScript(edit, true);
     }
 
     if ( event.type == EVENT_STUDIO_LIST )  // list clicked?
@@ -373,6 +374,7 @@ bool CStudio::EventFrame(const Event &event)
         m_bRunning = false;
         UpdateFlux();  // stop
         AdjustEditScript();
+        ColorizeScript(edit);
         std::string res;
         GetResource(RES_TEXT, RT_STUDIO_PROGSTOP, res);
         SetInfoText(res, false);
@@ -550,10 +552,36 @@ void CStudio::SearchToken(CEdit* edit)
 }
 
 // Colors the text according to syntax.
+// After a modification, only the modified lines are colored again.
 
-void CStudio::ColorizeScript(CEdit* edit)
+void CStudio::ColorizeScript(CEdit* edit, bool bChanged)
 {
-    m_script->ColorizeScript(edit);
+    std::string text = std::string(edit->GetText(), edit->GetTextLength());
+    if ( bChanged )
+    {
+        int rangeStart, rangeEnd;
+        CScript::GetColorizeRange(m_colorizedText, text, rangeStart, rangeEnd);
+        if ( rangeStart < rangeEnd )
+        {
+            m_script->ColorizeScript(edit, rangeStart, rangeEnd);
+        }
+    }
+    else
+    {
+        m_script->ColorizeScript(edit);
+    }
+    m_colorizedText = text;
+
+    // the lines where the last run spent its time are shown until the program is changed
+    if ( bChanged || m_bRunning )
+    {
+        if ( m_bHeat )  edit->ClearLineBack();
+        m_bHeat = false;
+    }
+    else
+    {
+        m_bHeat = m_script->ColorizeHeat(edit);
+    }
 }
 
 
@@ -65,7 +65,7 @@ public:
 protected:
     bool        EventFrame(const Event &event);
     void        SearchToken(CEdit* edit);
-    void        ColorizeScript(CEdit* edit);
+    void        ColorizeScript(CEdit* edit, bool bChanged = false);
     void        AdjustEditScript();
     void        ViewEditScript();
     void        UpdateFlux();
@@ -116,6 +116,8 @@ protected:
     ActivePause* m_editorPause = nullptr;
     ActivePause* m_runningPause = nullptr;
     std::string  m_helpFilename;
+    std::string  m_colorizedText;
+    bool         m_bHeat;
 
     StudioDialog m_dialog;
 };
@@ -0,0 +1,270 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "CBot/CBot.h"
+
+/**
+ * \file test/cbot/benchmark.cpp
+ * \brief Micro-benchmarks of the CBot interpreter
+ *
+ * Runs a few representative workloads and reports, for each of them, the number
+ * of timer ticks (instructions) executed per second, the number of memory
+ * allocations per tick and the highest number of stack levels used. The
+ * programs run the same way as in the game, a hundred ticks per CBotProgram::Run().
+ *
+ * \code{.sh}
+ * ./CBot_benchmark [--bytecode] [--optimize] [--repeat N] [workload...]
+ * \endcode
+ *
+ * Compare the output with the one of a build without your changes to evaluate them.
+ */
+
+using namespace CBot;
+
+namespace
+{
+
+std::size_t g_allocations = 0;
+
+struct Workload
+{
+    const char* name;
+    const char* code;
+};
+
+const Workload WORKLOADS[] =
+{
+    {
+        "arithmetic",
+        "extern void Arithmetic()\n"
+        "{\n"
+        "    int s = 0;\n"
+        "    float f = 0;\n"
+        "    for (int i = 0; i < 20000; i++)\n"
+        "    {\n"
+        "        s = (s + i * 7) % 1000;\n"
+        "        f += i / 3.0;\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "strings",
+        "extern void Strings()\n"
+        "{\n"
+        "    string s = \"\";\n"
+        "    for (int i = 0; i < 5000; i++)\n"
+        "    {\n"
+        "        s += \"x\" + i;\n"
+        "        if (strlen(s) > 200) s = strmid(s, 100);\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "arrays",
+        "extern void Arrays()\n"
+        "{\n"
+        "    int[] a;\n"
+        "    for (int i = 0; i < 1000; i++) a[i] = i;\n"
+        "    int s = 0;\n"
+        "    for (int n = 0; n < 10; n++)\n"
+        "    {\n"
+        "        for (int i = 0; i < 1000; i++) s += a[i];\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "methods",
+        "public class Counter\n"
+        "{\n"
+        "    int value = 0;\n"
+        "    void Add(int n) { value += n; }\n"
+        "    int Get() { return value; }\n"
+        "}\n"
+        "extern void Methods()\n"
+        "{\n"
+        "    Counter c = new Counter();\n"
+        "    for (int i = 0; i < 5000; i++) c.Add(i % 10);\n"
+        "    int v = c.Get();\n"
+        "}\n"
+    },
+    {
+        "recursion",
+        "int Fib(int n)\n"
+        "{\n"
+        "    if (n < 2) return n;\n"
+        "    return Fib(n - 1) + Fib(n - 2);\n"
+        "}\n"
+        "extern void Recursion()\n"
+        "{\n"
+        "    int f = Fib(18);\n"
+        "}\n"
+    },
+    {
+        "points",
+        "float Dist2(point a, point b)\n"
+        "{\n"
+        "    return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);\n"
+        "}\n"
+        "extern void Points()\n"
+        "{\n"
+        "    point p;\n"
+        "    p.x = 0; p.y = 0; p.z = 0;\n"
+        "    float d = 0;\n"
+        "    for (int i = 0; i < 2000; i++)\n"
+        "    {\n"
+        "        point q = p;\n"
+        "        q.x += 1; q.y = i % 10;\n"
+        "        d += Dist2(p, q);\n"
+        "        p = q;\n"
+        "    }\n"
+        "}\n"
+    },
+    {
+        "external",
+        "extern void External()\n"
+        "{\n"
+        "    float s = 0;\n"
+        "    for (int i = 0; i < 10000; i++) s = stub(s);\n"
+        "}\n"
+    },
+};
+
+// float stub(float x) returns x+1, as a cheap stand-in for the functions of the game
+CBotTypResult cStub(CBotVar* &var, void* user)
+{
+    if ( var == nullptr )  return CBotTypResult(CBotErrLowParam);
+    if ( var->GetType() > CBotTypDouble )  return CBotTypResult(CBotErrBadNum);
+    var = var->GetNext();
+    if ( var != nullptr )  return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypFloat);
+}
+
+bool rStub(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValFloat(var->GetValFloat() + 1.0f);
+    return true;
+}
+
+bool RunWorkload(const Workload& workload, bool bytecode, bool optimize, int repeat)
+{
+    std::vector<std::string> externFunctions;
+    std::unique_ptr<CBotProgram> program{new CBotProgram(nullptr)};
+    program->SetBytecodeEnabled(bytecode);
+    program->SetOptimizeEnabled(optimize);
+    if (!program->Compile(workload.code, externFunctions, nullptr) || externFunctions.empty())
+    {
+        std::cerr << workload.name << ": COMPILE ERROR " << program->GetError() << std::endl;
+        return false;
+    }
+
+    CBotExecutionContext* context = program->GetContext();
+    std::size_t allocations = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; i++)
+    {
+        program->Start(externFunctions[0]);
+        while (!program->Run(nullptr));
+        if (program->GetError() != CBotNoErr)
+        {
+            std::cerr << workload.name << ": RUNTIME ERROR " << program->GetError() << std::endl;
+            return false;
+        }
+    }
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    allocations = g_allocations - allocations;
+
+    long steps = context->GetStepCount();
+    std::cout << std::left << std::setw(12) << workload.name << std::right
+              << std::setw(12) << steps
+              << std::setw(12) << std::fixed << std::setprecision(2) << time.count() * 1000.0
+              << std::setw(14) << std::setprecision(0) << steps / time.count()
+              << std::setw(14) << std::setprecision(3) << static_cast<double>(allocations) / steps
+              << std::setw(12) << context->GetPeakFrameCount() << std::endl;
+    return true;
+}
+
+} // namespace
+
+// Counts the allocations of the whole program
+// (the standard library allocates with malloc() too, and its operator delete calls free())
+void* operator new(std::size_t size)
+{
+    g_allocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+int main(int argc, char* argv[])
+{
+    bool bytecode = false;
+    bool optimize = false;
+    int repeat = 5;
+    std::vector<std::string> selected;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--bytecode") bytecode = true;
+        else if (arg == "--optimize") optimize = true;
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg[0] != '-') selected.push_back(arg);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--bytecode] [--optimize] [--repeat N] [workload...]" << std::endl;
+            return 1;
+        }
+    }
+
+    CBotProgram::Init();
+    CBotProgram::AddFunction("stub", rStub, cStub);
+
+    // intrinsic class, like the one of the game
+    CBotClass* point = CBotClass::Create("point", nullptr, true);
+    point->AddItem("x", CBotTypFloat);
+    point->AddItem("y", CBotTypFloat);
+    point->AddItem("z", CBotTypFloat);
+
+    std::cout << std::left << std::setw(12) << "workload" << std::right
+              << std::setw(12) << "steps"
+              << std::setw(12) << "time (ms)"
+              << std::setw(14) << "steps/s"
+              << std::setw(14) << "allocs/step"
+              << std::setw(12) << "peak frames" << std::endl;
+
+    bool ok = true;
+    for (const Workload& workload : WORKLOADS)
+    {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), workload.name) == selected.end()) continue;
+        ok = RunWorkload(workload, bytecode, optimize, repeat) && ok;
+    }
+
+    CBotProgram::Free();
+    return ok ? 0 : 1;
+}
@@ -17,36 +17,79 @@
  * along with this program. If not, see http://gnu.org/licenses
  */
 
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
 
 #include "common/restext.h"
 
 #include "CBot/CBot.h"
 
+#include "stubs.h"
+
+/**
+ * \file test/cbot/console.cpp
+ * \brief Compiles and runs CBot programs without the game
+ *
+ * Runs all the extern functions of a program read from stdin:
+ * \code{.sh}
+ * ./CBot_console [--profile <file>] < program.txt
+ * \endcode
+ * With --profile, the call stacks are written to file for flame graph tools.
+ *
+ * Or runs all the .txt programs of a directory, with several threads:
+ * \code{.sh}
+ * ./CBot_console --batch <directory> [--jobs N] [--steps N]
+ * \endcode
+ * Each program runs until it ends or uses more than the given number of steps
+ * (timer ticks, one million by default), then a line is printed for each program
+ * with its result, the steps used, the execution time, the number of memory
+ * allocations and the highest memory use while it was running, and the highest
+ * number of stack levels.
+ *
+ * The functions of the game are replaced by the stubs of stubs.h. The programs
+ * are compiled one after the other, as in the game the public functions and
+ * classes are shared between them. When there are none, the programs run in
+ * parallel like with CScriptScheduler.
+ */
+
 using namespace CBot;
 
-CBotTypResult cMessage(CBotVar* &var, void* user)
+namespace
 {
-    if ( var == nullptr )  return CBotTypResult(CBotErrLowParam);
-    if ( var->GetType() != CBotTypString &&
-         var->GetType() >  CBotTypDouble )  return CBotTypResult(CBotErrBadNum);
-    var = var->GetNext();
 
-    if ( var == nullptr )  return CBotTypResult(CBotTypFloat);
-    return CBotTypResult(CBotErrOverParam);
-}
+const int   BATCH_IPF = 100;        // timer ticks per run, as in the game
 
-bool rMessage(CBotVar* var, CBotVar* result, int& exception, void* user)
-{
-    std::string message = var->GetValString();
+// Memory used by the current thread, see operator new below
+// (signed, as a thread can free memory allocated by another one)
+thread_local std::size_t g_allocations = 0;
+thread_local long long   g_usedBytes = 0;
+thread_local long long   g_peakBytes = 0;
 
-    std::cout << message << std::endl;
+//! Room kept before each allocation for its size
+const std::size_t ALLOCATION_HEADER = 16;
 
-    return true;
+std::string GetErrorText(CBotError error)
+{
+    std::string text;
+    GetResource(RES_CBOT, error, text);
+    return text;
 }
 
-int main(int argc, char* argv[])
+int RunProgram(const std::string& profileFile)
 {
     // Read program code from stdin
     std::string code = "";
@@ -57,25 +100,18 @@ int main(int argc, char* argv[])
         code += "\n";
     }
 
-    // Initialize the CBot engine, add standard library functions
-    CBotProgram::Init();
-    CBotProgram::AddFunction("message", rMessage, cMessage);
-
-    // Error message strings are stored on Colobot side (meh!) so let's initialize that
-    InitializeRestext();
-
-
     // Compile the program
+    CStubRobot robot;
     std::vector<std::string> externFunctions;
-    std::unique_ptr<CBotProgram> program{new CBotProgram(nullptr)};
+    std::unique_ptr<CBotProgram> program{new CBotProgram(robot.GetBotVar())};
+    CBotProfiler profiler;
+    if (!profileFile.empty()) program->SetProfiler(&profiler);
     if (!program->Compile(code.c_str(), externFunctions, nullptr))
     {
         CBotError error;
         int cursor1, cursor2;
         program->GetError(error, cursor1, cursor2);
-        std::string errorStr;
-        GetResource(RES_CBOT, error, errorStr);
-        std::cerr << "COMPILE ERROR: " << errorStr << " (code: " << error << ") @ " << cursor1 << " - " << cursor2 << std::endl;
+        std::cerr << "COMPILE ERROR: " << GetErrorText(error) << " (code: " << error << ") @ " << cursor1 << " - " << cursor2 << std::endl;
         return 1;
     }
 
@@ -96,16 +132,14 @@ int main(int argc, char* argv[])
 
         std::cerr << "Running program: " << func << std::endl;
 
-        while (!program->Run(nullptr)); // Run the program
+        while (!program->Run(&robot)); // Run the program
 
         CBotError error;
         int cursor1, cursor2;
         program->GetError(error, cursor1, cursor2);
         if (error != 0)
         {
-            std::string errorStr;
-            GetResource(RES_CBOT, error, errorStr);
-            std::cerr << "RUNTIME ERROR: " << errorStr << " (code: " << error << ") @ " << cursor1 << " - " << cursor2 << std::endl;
+            std::cerr << "RUNTIME ERROR: " << GetErrorText(error) << " (code: " << error << ") @ " << cursor1 << " - " << cursor2 << std::endl;
             runErrors = true;
         }
         else
@@ -114,5 +148,304 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (!profileFile.empty())
+    {
+        std::ofstream profile(profileFile);
+        profiler.WriteCollapsedStacks(profile, code);
+        if (!profile)
+        {
+            std::cerr << "FAILED TO WRITE PROFILE: " << profileFile << std::endl;
+            return 4;
+        }
+    }
+
     return runErrors ? 3 : 0;
 }
+
+//! A program of the batch
+struct Job
+{
+    std::string                     name;
+    std::unique_ptr<CStubRobot>     robot;
+    std::unique_ptr<CBotProgram>    program;
+    std::vector<std::string>        externFunctions;
+
+    std::string result;
+    bool        ok = false;
+    long        steps = 0;
+    double      time = 0.0;
+    std::size_t allocations = 0;
+    long long   peakBytes = 0;
+    int         peakFrames = 0;
+    //! Class instances created by the program which still exist, leaked if the program doesn't keep them
+    long        instances = 0;
+};
+
+//! Held to run what must be on the main thread of the game
+std::mutex g_mainMutex;
+
+void RunJob(Job& job, bool parallel, long maxSteps)
+{
+    CBotProgram* program = job.program.get();
+    std::size_t allocations = g_allocations;
+    long long   usedBytes = g_usedBytes;
+    g_peakBytes = g_usedBytes;
+    auto start = std::chrono::steady_clock::now();
+
+    job.ok = true;
+    job.result = "ok";
+    for (const std::string& func : job.externFunctions)
+    {
+        program->Start(func);
+        bool finished = false;
+        while (!finished)
+        {
+            if (parallel)
+            {
+                finished = program->RunParallel(job.robot.get(), BATCH_IPF);
+                if (!finished && program->IsWaitingForMainThread())
+                {
+                    std::lock_guard<std::mutex> lock(g_mainMutex);
+                    finished = program->ContinueRun(job.robot.get());
+                }
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(g_mainMutex);
+                finished = program->Run(job.robot.get(), BATCH_IPF);
+            }
+
+            if (!finished && program->GetContext()->GetStepCount() > maxSteps)
+            {
+                std::lock_guard<std::mutex> lock(g_mainMutex);
+                program->Stop();
+                job.ok = false;
+                job.result = "step budget exceeded in " + func;
+                break;
+            }
+        }
+        if (!job.ok) break;
+
+        CBotError error;
+        int cursor1, cursor2;
+        program->GetError(error, cursor1, cursor2);
+        if (error != CBotNoErr)
+        {
+            std::stringstream ss;
+            ss << "runtime error " << error << " @ " << cursor1 << ": " << GetErrorText(error);
+            job.ok = false;
+            job.result = ss.str();
+            break;
+        }
+    }
+
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    job.time = time.count();
+    job.steps = program->GetContext()->GetStepCount();
+    job.allocations = g_allocations - allocations;
+    job.peakBytes = g_peakBytes - usedBytes;
+    job.peakFrames = program->GetContext()->GetPeakFrameCount();
+    job.instances = program->GetContext()->GetInstanceCount();
+}
+
+int RunBatch(const std::string& directory, int jobCount, long maxSteps)
+{
+    std::vector<std::unique_ptr<Job>> jobs;
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->path().extension() != ".txt" || !boost::filesystem::is_regular_file(it->path())) continue;
+        std::unique_ptr<Job> job{new Job()};
+        job->name = it->path().filename().string();
+        jobs.push_back(std::move(job));
+    }
+    if (ec)
+    {
+        std::cerr << "FAILED TO READ DIRECTORY: " << directory << ": " << ec.message() << std::endl;
+        return 1;
+    }
+    std::sort(jobs.begin(), jobs.end(), [](const std::unique_ptr<Job>& a, const std::unique_ptr<Job>& b) { return a->name < b->name; });
+
+    // Compilation uses static state, the programs are compiled one at a time
+    std::vector<Job*> runnable;
+    for (auto& job : jobs)
+    {
+        std::ifstream file((boost::filesystem::path(directory) / job->name).string());
+        std::stringstream code;
+        code << file.rdbuf();
+
+        job->robot.reset(new CStubRobot());
+        job->robot->printMessages = false;
+        job->program.reset(new CBotProgram(job->robot->GetBotVar()));
+        if (!job->program->Compile(code.str(), job->externFunctions, nullptr))
+        {
+            CBotError error;
+            int cursor1, cursor2;
+            job->program->GetError(error, cursor1, cursor2);
+            std::stringstream ss;
+            ss << "compile error " << error << " @ " << cursor1 << ": " << GetErrorText(error);
+            job->result = ss.str();
+        }
+        else if (job->externFunctions.empty())
+        {
+            job->result = "no extern function";
+        }
+        else
+        {
+            runnable.push_back(job.get());
+        }
+    }
+
+    bool parallel = runnable.empty() || runnable[0]->program->CanRunParallel();
+    if (!parallel)
+    {
+        std::cerr << "Public functions or classes are used, programs can't run in parallel" << std::endl;
+    }
+
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]()
+    {
+        for (std::size_t i = next++; i < runnable.size(); i = next++)
+        {
+            RunJob(*runnable[i], parallel, maxSteps);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < jobCount; i++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::cout << std::left << std::setw(32) << "program" << std::right
+              << std::setw(12) << "steps"
+              << std::setw(12) << "time (ms)"
+              << std::setw(10) << "allocs"
+              << std::setw(12) << "peak (KB)"
+              << std::setw(8) << "frames"
+              << std::setw(9) << "objects" << "  result" << std::endl;
+    bool ok = true;
+    for (auto& job : jobs)
+    {
+        std::cout << std::left << std::setw(32) << job->name << std::right
+                  << std::setw(12) << job->steps
+                  << std::setw(12) << std::fixed << std::setprecision(2) << job->time * 1000.0
+                  << std::setw(10) << job->allocations
+                  << std::setw(12) << std::setprecision(1) << job->peakBytes / 1024.0
+                  << std::setw(8) << job->peakFrames
+                  << std::setw(9) << job->instances << "  " << job->result << std::endl;
+        ok = ok && job->ok;
+    }
+
+    // programs are deleted on this thread, with the public functions and classes they share
+    jobs.clear();
+    return ok ? 0 : 3;
+}
+
+void PrintUsage(const char* name)
+{
+    std::cerr << "Usage: " << name << " [--profile <file>] < program.txt" << std::endl;
+    std::cerr << "       " << name << " --batch <directory> [--jobs N] [--steps N]" << std::endl;
+}
+
+} // namespace
+
+// Counts the allocations and the memory used by each thread
+void* operator new(std::size_t size)
+{
+    char* p = static_cast<char*>(std::malloc(size + ALLOCATION_HEADER));
+    if (p == nullptr) throw std::bad_alloc();
+    *reinterpret_cast<std::size_t*>(p) = size;
+
+    g_allocations++;
+    g_usedBytes += static_cast<long long>(size);
+    g_peakBytes = std::max(g_peakBytes, g_usedBytes);
+    return p + ALLOCATION_HEADER;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p == nullptr) return;
+    char* block = static_cast<char*>(p) - ALLOCATION_HEADER;
+    g_usedBytes -= static_cast<long long>(*reinterpret_cast<std::size_t*>(block));
+    std::free(block);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    operator delete(p);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string profileFile = "";
+    std::string batchDirectory = "";
+    int jobs = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    long maxSteps = 1000000;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage(argv[0]);
+            return 4;
+        }
+        if (arg == "--profile") profileFile = argv[++i];
+        else if (arg == "--batch") batchDirectory = argv[++i];
+        else if (arg == "--jobs") jobs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--steps") maxSteps = std::max(1L, std::atol(argv[++i]));
+        else
+        {
+            PrintUsage(argv[0]);
+            return 4;
+        }
+    }
+
+    // Initialize the CBot engine, add standard library functions and the functions of the game
+    CBotProgram::Init();
+    InitStubs();
+
+    // Error message strings are stored on Colobot side (meh!) so let's initialize that
+    InitializeRestext();
+
+    int result = batchDirectory.empty() ? RunProgram(profileFile) : RunBatch(batchDirectory, jobs, maxSteps);
+
+    CBotProgram::Free();
+    return result;
+}
@@ -0,0 +1,357 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+#include "stubs.h"
+
+#include "object/object_type.h"
+
+#include "script/cbottoken.h"
+#include "script/scriptfunc.h"
+
+#include "CBot/stdlib/Compilation.h"
+
+#include <cmath>
+#include <iostream>
+
+using namespace CBot;
+
+namespace
+{
+
+const float ROBOT_SPEED = 2.0f;     // distance per second of move() and goto()
+
+CStubRobot* GetRobot(void* user)
+{
+    return static_cast<CStubRobot*>(user);
+}
+
+void SetPoint(CBotVar* point, float x, float y, float z)
+{
+    point->GetItem("x")->SetValFloat(x);
+    point->GetItem("y")->SetValFloat(y);
+    point->GetItem("z")->SetValFloat(z);
+}
+
+float GetPointItem(CBotVar* point, const char* name)
+{
+    CBotVar* item = point == nullptr ? nullptr : point->GetItem(name);
+    return item == nullptr ? 0.0f : item->GetValFloat();
+}
+
+CBotVar* CreateObject(int category, float x, float y, long id)
+{
+    CBotVar* object = CBotVar::Create("", CBotTypResult(CBotTypClass, "object"));
+    object->SetIdent(id);
+    object->GetItem("category")->SetValInt(category);
+    SetPoint(object->GetItem("position"), x, y, 0.0f);
+    object->GetItem("energyLevel")->SetValFloat(1.0f);
+    object->GetItem("shieldLevel")->SetValFloat(1.0f);
+    object->GetItem("id")->SetValInt(id);
+    return object;
+}
+
+// Compilation: the arguments are checked by the functions of the game (see
+// CScriptFunctions), except for fire(), whose arguments depend on the robot
+
+CBotTypResult cFire(CBotVar* &var, void* user)
+{
+    // the stub robot is neither an ant nor a spider
+    if ( var != nullptr )
+    {
+        if ( var->GetType() > CBotTypDouble )  return CBotTypResult(CBotErrBadNum);
+        var = var->GetNext();
+        if ( var != nullptr )  return CBotTypResult(CBotErrOverParam);
+    }
+    return CBotTypResult(CBotTypFloat);
+}
+
+// Execution
+
+bool rPointConstructor(CBotVar* pThis, CBotVar* var, CBotVar* pResult, int& exception, void* user)
+{
+    float xyz[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 3 && var != nullptr; i++, var = var->GetNext())
+    {
+        xyz[i] = var->GetValFloat();
+    }
+    SetPoint(pThis, xyz[0], xyz[1], xyz[2]);
+    return true;
+}
+
+// int radar(category, ...), or the first category of an array
+int GetCategory(CBotVar* var)
+{
+    if (var == nullptr) return OBJECT_NULL;
+    if (var->GetType() != CBotTypArrayPointer) return var->GetValInt();
+    CBotVar* item = var->GetItemList();
+    return item == nullptr ? OBJECT_NULL : item->GetValInt();
+}
+
+bool rRadar(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetPointer(GetRobot(user)->GetObject(GetCategory(var)));
+    return true;
+}
+
+bool rRadarAll(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetInit(CBotVar::InitType::DEF);
+    result->GetItem(0, true)->SetPointer(GetRobot(user)->GetObject(GetCategory(var)));
+    return true;
+}
+
+bool rTrue(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValInt(true);
+    return true;
+}
+
+bool rFalse(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValInt(false);
+    return true;
+}
+
+bool rZero(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValFloat(0.0f);
+    return true;
+}
+
+bool rDistance(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    CBotVar* other = var == nullptr ? nullptr : var->GetNext();
+    float dx = GetPointItem(var, "x") - GetPointItem(other, "x");
+    float dy = GetPointItem(var, "y") - GetPointItem(other, "y");
+    float dz = GetPointItem(var, "z") - GetPointItem(other, "z");
+    result->SetValFloat(std::sqrt(dx*dx + dy*dy + dz*dz));
+    return true;
+}
+
+bool rDistance2d(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    CBotVar* other = var == nullptr ? nullptr : var->GetNext();
+    float dx = GetPointItem(var, "x") - GetPointItem(other, "x");
+    float dy = GetPointItem(var, "y") - GetPointItem(other, "y");
+    result->SetValFloat(std::sqrt(dx*dx + dy*dy));
+    return true;
+}
+
+// point space(...): the position of the robot
+bool rSpace(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    float x, y;
+    GetRobot(user)->GetPosition(x, y);
+    SetPoint(result, x, y, 0.0f);
+    return true;
+}
+
+bool rAbsTime(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValFloat(GetRobot(user)->time);
+    return true;
+}
+
+bool rWait(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    if (var != nullptr) GetRobot(user)->time += std::max(var->GetValFloat(), 0.0f);
+    result->SetValFloat(0.0f);
+    return true;
+}
+
+bool rMove(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    CStubRobot* robot = GetRobot(user);
+    float distance = var == nullptr ? 0.0f : var->GetValFloat();
+    float angle = robot->GetBotVar()->GetItem("orientation")->GetValFloat() * static_cast<float>(M_PI) / 180.0f;
+    float x, y;
+    robot->GetPosition(x, y);
+    robot->MoveTo(x + distance*std::cos(angle), y + distance*std::sin(angle));
+    robot->time += std::fabs(distance) / ROBOT_SPEED;
+    result->SetValFloat(0.0f);
+    return true;
+}
+
+bool rTurn(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    CStubRobot* robot = GetRobot(user);
+    float angle = var == nullptr ? 0.0f : var->GetValFloat();
+    CBotVar* orientation = robot->GetBotVar()->GetItem("orientation");
+    orientation->SetValFloat(std::fmod(orientation->GetValFloat() + angle + 360.0f, 360.0f));
+    robot->time += std::fabs(angle) / 90.0f;
+    result->SetValFloat(0.0f);
+    return true;
+}
+
+bool rGoto(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    CStubRobot* robot = GetRobot(user);
+    float x, y;
+    robot->GetPosition(x, y);
+    float tx = GetPointItem(var, "x");
+    float ty = GetPointItem(var, "y");
+    robot->MoveTo(tx, ty);
+    robot->time += std::sqrt((tx-x)*(tx-x) + (ty-y)*(ty-y)) / ROBOT_SPEED;
+    result->SetValFloat(0.0f);
+    return true;
+}
+
+// Actions that take a second: grab(), drop(), fire()...
+bool rAction(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    GetRobot(user)->time += 1.0f;
+    result->SetValFloat(0.0f);
+    return true;
+}
+
+bool rMessage(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    CStubRobot* robot = GetRobot(user);
+    robot->messages++;
+    if (robot->printMessages && var != nullptr) std::cout << var->GetValString() << std::endl;
+    result->SetValFloat(0.0f);
+    return true;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+CStubRobot::CStubRobot()
+{
+    m_botVar = CreateObject(OBJECT_MOBILEwa, 0.0f, 0.0f, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CStubRobot::~CStubRobot()
+{
+    for (auto& object : m_objects)
+    {
+        CBotVar::Destroy(object.second);
+    }
+    CBotVar::Destroy(m_botVar);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CBotVar* CStubRobot::GetObject(int category)
+{
+    CBotVar*& object = m_objects[category];
+    if (object == nullptr)
+    {
+        // always at the same place for a category
+        object = CreateObject(category, 10.0f + (category % 7) * 5.0f, 20.0f - (category % 5) * 3.0f, 2 + m_objects.size());
+    }
+    return object;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CStubRobot::MoveTo(float x, float y)
+{
+    SetPoint(m_botVar->GetItem("position"), x, y, 0.0f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CStubRobot::GetPosition(float& x, float& y)
+{
+    CBotVar* position = m_botVar->GetItem("position");
+    x = GetPointItem(position, "x");
+    y = GetPointItem(position, "y");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void InitStubs()
+{
+    for (int i = 0; i < OBJECT_MAX; i++)
+    {
+        ObjectType type = static_cast<ObjectType>(i);
+        const char* token = GetObjectName(type);
+        if (token[0] != 0)
+            CBotProgram::DefineNum(token, type);
+
+        token = GetObjectAlias(type);
+        if (token[0] != 0)
+            CBotProgram::DefineNum(token, type);
+    }
+    CBotProgram::DefineNum("Any", OBJECT_NULL);
+
+    CBotClass* bc = CBotClass::Create("point", nullptr, true);
+    bc->AddItem("x", CBotTypFloat);
+    bc->AddItem("y", CBotTypFloat);
+    bc->AddItem("z", CBotTypFloat);
+    bc->AddFunction("point", rPointConstructor, CScriptFunctions::cPointConstructor);
+
+    bc = CBotClass::Create("object", nullptr);
+    bc->AddItem("category",    CBotTypResult(CBotTypInt), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("position",    CBotTypResult(CBotTypClass, "point"), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("orientation", CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("pitch",       CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("roll",        CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("energyLevel", CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("shieldLevel", CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("temperature", CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("altitude",    CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("lifeTime",    CBotTypResult(CBotTypFloat), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("energyCell",  CBotTypResult(CBotTypPointer, "object"), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("load",        CBotTypResult(CBotTypPointer, "object"), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("id",          CBotTypResult(CBotTypInt), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("team",        CBotTypResult(CBotTypInt), CBotVar::ProtectionLevel::ReadOnly);
+    bc->AddItem("velocity",    CBotTypResult(CBotTypClass, "point"), CBotVar::ProtectionLevel::ReadOnly);
+
+    // all the stubs only use their arguments and the robot, they can run on any thread
+    CBotProgram::AddFunction("radar",       rRadar,      CScriptFunctions::cRadar,        true);
+    CBotProgram::AddFunction("radarall",    rRadarAll,   CScriptFunctions::cRadarAll,     true);
+    CBotProgram::AddFunction("search",      rRadar,      CScriptFunctions::cSearch,       true);
+    CBotProgram::AddFunction("retobject",   rRadar,      CScriptFunctions::cGetObject,    true);
+    CBotProgram::AddFunction("detect",      rTrue,       CScriptFunctions::cDetect,       true);
+    CBotProgram::AddFunction("direction",   rZero,       CScriptFunctions::cDirection,    true);
+    CBotProgram::AddFunction("distance",    rDistance,   CScriptFunctions::cDistance,     true);
+    CBotProgram::AddFunction("distance2d",  rDistance2d, CScriptFunctions::cDistance,     true);
+    CBotProgram::AddFunction("space",       rSpace,      CScriptFunctions::cSpace,        true);
+    CBotProgram::AddFunction("flatspace",   rSpace,      CScriptFunctions::cFlatSpace,    true);
+    CBotProgram::AddFunction("flatground",  rZero,       CScriptFunctions::cFlatGround,   true);
+    CBotProgram::AddFunction("topo",        rZero,       CScriptFunctions::cTopo,         true);
+    CBotProgram::AddFunction("abstime",     rAbsTime,    cNull,                           true);
+    CBotProgram::AddFunction("wait",        rWait,       cOneFloat,                       true);
+    CBotProgram::AddFunction("move",        rMove,       cOneFloat,                       true);
+    CBotProgram::AddFunction("turn",        rTurn,       cOneFloat,                       true);
+    CBotProgram::AddFunction("goto",        rGoto,       CScriptFunctions::cGoto,         true);
+    CBotProgram::AddFunction("grab",        rAction,     CScriptFunctions::cGrabDrop,     true);
+    CBotProgram::AddFunction("drop",        rAction,     CScriptFunctions::cGrabDrop,     true);
+    CBotProgram::AddFunction("fire",        rAction,     cFire,                           true);
+    CBotProgram::AddFunction("aim",         rAction,     CScriptFunctions::cAim,          true);
+    CBotProgram::AddFunction("recycle",     rAction,     cNull,                           true);
+    CBotProgram::AddFunction("thump",       rAction,     cNull,                           true);
+    CBotProgram::AddFunction("sniff",       rAction,     cNull,                           true);
+    CBotProgram::AddFunction("build",       rAction,     cOneInt,                         true);
+    CBotProgram::AddFunction("produce",     rAction,     CScriptFunctions::cProduce,      true);
+    CBotProgram::AddFunction("shield",      rZero,       CScriptFunctions::cShield,       true);
+    CBotProgram::AddFunction("motor",       rZero,       CScriptFunctions::cMotor,        true);
+    CBotProgram::AddFunction("jet",         rZero,       cOneFloat,                       true);
+    CBotProgram::AddFunction("receive",     rZero,       CScriptFunctions::cReceive,      true);
+    CBotProgram::AddFunction("send",        rZero,       CScriptFunctions::cSend,         true);
+    CBotProgram::AddFunction("testinfo",    rFalse,      CScriptFunctions::cTestInfo,     true);
+    CBotProgram::AddFunction("deleteinfo",  rFalse,      CScriptFunctions::cDeleteInfo,   true);
+    CBotProgram::AddFunction("pendown",     rZero,       CScriptFunctions::cPenDown,      true);
+    CBotProgram::AddFunction("penup",       rZero,       cNull,                           true);
+    CBotProgram::AddFunction("pencolor",    rZero,       cOneFloat,                       true);
+    CBotProgram::AddFunction("penwidth",    rZero,       cOneFloat,                       true);
+    CBotProgram::AddFunction("errmode",     rZero,       cOneFloat,                       true);
+    CBotProgram::AddFunction("ipf",         rZero,       cOneFloat,                       true);
+    CBotProgram::AddFunction("message",     rMessage,    CScriptFunctions::cMessage,      true);
+}
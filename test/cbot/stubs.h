@@ -0,0 +1,75 @@
+/*
+ * This file is part of the Colobot: Gold Edition source code
+ * Copyright (C) 2001-2016, Daniel Roux, EPSITEC SA & TerranovaTeam
+ * http://epsitec.ch; http://colobot.info; http://github.com/colobot
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://gnu.org/licenses
+ */
+
+
+/**
+ * \file test/cbot/stubs.h
+ * \brief Deterministic stand-ins for the functions the game gives to CBot programs
+ *
+ * They let robot programs be compiled and executed without the game: the
+ * categories of objects, the classes "point" and "object", and functions
+ * like radar(), move() or goto() are declared and checked as in the game.
+ * The robot lives in an empty world where radar() always finds an object and
+ * actions succeed immediately, only advancing the time returned by abstime().
+ */
+
+#pragma once
+
+#include "CBot/CBot.h"
+
+#include <map>
+
+/**
+ * \brief Robot executing a program, to be given as user pointer to CBot::CBotProgram::Run()
+ */
+class CStubRobot
+{
+public:
+    CStubRobot();
+    ~CStubRobot();
+
+    CStubRobot(const CStubRobot&) = delete;
+    CStubRobot& operator=(const CStubRobot&) = delete;
+
+    //! Returns the "this" object of the programs of the robot
+    CBot::CBotVar* GetBotVar() { return m_botVar; }
+    //! Returns the object of the world with the given category
+    CBot::CBotVar* GetObject(int category);
+
+    //! Moves the robot to the given position
+    void MoveTo(float x, float y);
+    //! Returns the position of the robot
+    void GetPosition(float& x, float& y);
+
+    //! Simulated time, in seconds
+    float   time = 0.0f;
+    //! Number of messages displayed by the programs
+    long    messages = 0;
+    //! Print the messages on the standard output
+    bool    printMessages = true;
+
+private:
+    CBot::CBotVar*  m_botVar;
+    std::map<int, CBot::CBotVar*> m_objects;
+};
+
+/**
+ * \brief Adds the stubs to the CBot engine, after CBot::CBotProgram::Init()
+ */
+void InitStubs();
@@ -122,3 +122,36 @@ TEST_F(CBotTokenUT, BasicProgram)
         {"}",           ID_CLBLK},
     });
 }
+
+TEST_F(CBotTokenUT, OperatorsAndConstants)
+{
+    CBotToken::DefineNum("TestConstant", 42);
+    ExecuteTest("a >>= b >> 2 ** TestConstant %= c", {
+        {"a",            TokenTypVar},
+        {">>=",          ID_ASSASR},
+        {"b",            TokenTypVar},
+        {">>",           ID_SR},
+        {"2",            TokenTypNum},
+        {"**",           ID_POWER},
+        {"TestConstant", TokenTypDef},
+        {"%=",           ID_ASSMODULO},
+        {"c",            TokenTypVar},
+    });
+    EXPECT_FALSE(CBotToken::DefineNum("TestConstant", 43));
+}
+
+TEST_F(CBotTokenUT, Positions)
+{
+    auto tokens = CBotToken::CompileTokens("int /* x */ a = \"s t\"; // end\nb");
+    ASSERT_TRUE(tokens != nullptr);
+    std::vector<std::pair<int, int>> positions = { {0, 3}, {12, 13}, {14, 15}, {16, 21}, {21, 22}, {30, 31} };
+    CBotToken* token = tokens.get()->GetNext();
+    for (const auto& pos : positions)
+    {
+        ASSERT_TRUE(token != nullptr);
+        EXPECT_EQ(token->GetStart(), pos.first) << token->GetString();
+        EXPECT_EQ(token->GetEnd(), pos.second) << token->GetString();
+        token = token->GetNext();
+    }
+    EXPECT_TRUE(token == nullptr);
+}
@@ -18,9 +18,14 @@
  */
 
 #include "CBot/CBot.h"
+#include "CBot/CBotCallCache.h"
+#include "CBot/CBotVar/CBotVarClass.h"
+#include "CBot/CBotVar/CBotVarPointer.h"
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <stdexcept>
+#include <thread>
 
 using namespace CBot;
 
@@ -198,12 +203,14 @@ private:
     }
 
 protected:
-    std::unique_ptr<CBotProgram> ExecuteTest(const std::string& code, CBotError expectedError = CBotNoErr)
+    std::unique_ptr<CBotProgram> ExecuteTest(const std::string& code, CBotError expectedError = CBotNoErr, bool bytecode = false, bool optimize = false)
     {
         CBotError expectedCompileError = expectedError < 6000 ? expectedError : CBotNoErr;
         CBotError expectedRuntimeError = expectedError >= 6000 ? expectedError : CBotNoErr;
 
         auto program = std::unique_ptr<CBotProgram>(new CBotProgram());
+        program->SetBytecodeEnabled(bytecode);
+        program->SetOptimizeEnabled(optimize);
         std::vector<std::string> tests;
         program->Compile(code, tests);
 
@@ -524,6 +531,28 @@ TEST_F(CBotUT, Arrays)
     );
 }
 
+TEST_F(CBotUT, ArraysLarge)
+{
+    ExecuteTest(
+        "extern void Grid()\n"
+        "{\n"
+        "    int grid[][];\n"
+        "    for (int y = 99; y >= 0; y--)\n"
+        "        for (int x = 0; x < 100; x++)\n"
+        "            grid[y][x] = x + 100 * y;\n"
+        "    ASSERT(sizeof(grid) == 100);\n"
+        "    ASSERT(sizeof(grid[42]) == 100);\n"
+        "    int sum = 0;\n"
+        "    for (int i = 0; i < sizeof(grid); i++) sum += grid[i][i];\n"
+        "    ASSERT(sum == 499950);\n"
+        "    int row[] = grid[7];\n"
+        "    row[150] = 1;\n"
+        "    ASSERT(sizeof(grid[7]) == 151);\n"
+        "    ASSERT(grid[7][99] == 799);\n"
+        "}\n"
+    );
+}
+
 // TODO: BAD! WRONG! NOOOOO!!! :<
 TEST_F(CBotUT, DISABLED_ArraysInClasses)
 {
@@ -604,6 +633,45 @@ TEST_F(CBotUT, FunctionRecursion)
     );
 }
 
+TEST_F(CBotUT, FunctionLocalVariables)
+{
+    ExecuteTest(
+        "int fib(int n)\n"
+        "{\n"
+        "    int a = n;\n"
+        "    if (n >= 2)\n"
+        "    {\n"
+        "        int b = fib(n-1);\n"
+        "        a = b + fib(n-2);\n"
+        "    }\n"
+        "    return a;\n"
+        "}\n"
+        "\n"
+        "extern void FunctionLocalVariables()\n"
+        "{\n"
+        "    int total = 0;\n"
+        "    for (int i = 0; i < 10; i++)\n"
+        "    {\n"
+        "        int sq = i * i;\n"
+        "        {\n"
+        "            int twice = sq * 2;\n"
+        "            total += twice;\n"
+        "        }\n"
+        "    }\n"
+        "    ASSERT(total == 570);\n"
+        "    for (int i = 0; i < 3; i++)\n"
+        "    {\n"
+        "        int first;\n"
+        "        if (i == 0) first = 5;\n"
+        "        else first = i;\n"
+        "        total += first;\n"
+        "    }\n"
+        "    ASSERT(total == 578);\n"
+        "    ASSERT(fib(15) == 610);\n"
+        "}\n"
+    );
+}
+
 TEST_F(CBotUT, FunctionRecursionStackOverflow)
 {
     ExecuteTest(
@@ -635,6 +703,66 @@ TEST_F(CBotUT, FunctionOverloading)
     );
 }
 
+TEST_F(CBotUT, CallCacheComparesArgumentTypes)
+{
+    std::unique_ptr<CBotVar> intVar(CBotVar::Create("", CBotTypInt));
+    std::unique_ptr<CBotVar> floatVar(CBotVar::Create("", CBotTypFloat));
+    CBotVar* intArgs[] = { intVar.get(), intVar.get(), nullptr };
+    CBotVar* floatArgs[] = { intVar.get(), floatVar.get(), nullptr };
+    CBotVar* shortArgs[] = { intVar.get(), nullptr };
+
+    CBotCallCache cache;
+    CBotCallTarget found;
+    found.Reset(intArgs);
+    found.ident = 42;
+    cache.Store(found);
+
+    CBotCallTarget target;
+    EXPECT_FALSE(cache.Load(floatArgs, target));
+    EXPECT_FALSE(cache.Load(shortArgs, target));
+    ASSERT_TRUE(cache.Load(intArgs, target));
+    EXPECT_EQ(42, target.ident);
+
+    CBotCallCache::Invalidate();
+    EXPECT_FALSE(cache.Load(intArgs, target));
+}
+
+TEST_F(CBotUT, RepeatedCalls)
+{
+    ExecuteTest(
+        "int twice(int a)\n"
+        "{\n"
+        "    return 2 * a;\n"
+        "}\n"
+        "float twice(float a)\n"
+        "{\n"
+        "    return 3 * a;\n"
+        "}\n"
+        "public class TestBase\n"
+        "{\n"
+        "    int Get(int a) { return a + 1; }\n"
+        "}\n"
+        "public class TestChild extends TestBase\n"
+        "{\n"
+        "    int Other(int a) { return Get(a) * 10; }\n"
+        "}\n"
+        "\n"
+        "extern void RepeatedCalls()\n"
+        "{\n"
+        "    int sum = 0;\n"
+        "    float fsum = 0;\n"
+        "    TestChild c = new TestChild();\n"
+        "    for (int i = 0; i < 10; i++)\n"
+        "    {\n"
+        "        sum += twice(i) + c.Get(i) + c.Other(i);\n"
+        "        fsum += twice(1.5);\n"
+        "    }\n"
+        "    ASSERT(sum == 695);\n"
+        "    ASSERT(fsum == 45);\n"
+        "}\n"
+    );
+}
+
 TEST_F(CBotUT, FunctionRedefined)
 {
     ExecuteTest(
@@ -709,6 +837,368 @@ TEST_F(CBotUT, PublicFunctions)
     );
 }
 
+TEST_F(CBotUT, IncrementalCompile)
+{
+    auto program = std::unique_ptr<CBotProgram>(new CBotProgram());
+    auto compileAndRun = [&program](const std::string& code) -> CBotError
+    {
+        std::vector<std::string> tests;
+        CBotError error;
+        int cursor1, cursor2;
+        if (!program->Compile(code, tests))
+        {
+            program->GetError(error, cursor1, cursor2);
+            return error;
+        }
+        program->Start(tests[0]);
+        while (!program->Run());
+        program->GetError(error, cursor1, cursor2);
+        return error;
+    };
+
+    const std::string twice =
+        "int Twice(int a)\n"
+        "{\n"
+        "    return a * 2;\n"
+        "}\n";
+    const std::string test =
+        "extern void Incremental()\n"
+        "{\n"
+        "    ASSERT(Twice(Value()) == Expected());\n"
+        "}\n";
+    EXPECT_EQ(CBotNoErr, compileAndRun("int Value() { return 1; }\nint Expected() { return 2; }\n" + twice + test));
+
+    // Only Value() and Expected() change, the other functions are kept but moved
+    const std::string code = "// changed\nint Value() { return 2; }\nint Expected() { return 4; }\n" + twice + test;
+    EXPECT_EQ(CBotNoErr, compileAndRun(code));
+    int start, stop;
+    ASSERT_TRUE(program->GetPosition("Twice", start, stop, GetPosNom, GetPosBloc));
+    EXPECT_EQ(static_cast<int>(code.find("Twice")), start);
+    EXPECT_EQ(static_cast<int>(code.find("}", code.find("Twice")) + 1), stop);
+
+    // Removing a declaration compiles the callers again
+    EXPECT_EQ(CBotErrUndefCall, compileAndRun("int Expected() { return 4; }\n" + twice + test));
+    EXPECT_EQ(CBotNoErr, compileAndRun(code));
+}
+
+TEST_F(CBotUT, SharedCompiledFunctions)
+{
+    const std::string code =
+        "int Twice(int a)\n"
+        "{\n"
+        "    return a * 2;\n"
+        "}\n"
+        "extern void SharedFunctions()\n"
+        "{\n"
+        "    int[] a;\n"
+        "    for (int i = 0; i < 10; i++) a[i] = Twice(i);\n"
+        "    ASSERT(a[9] == 18);\n"
+        "    ASSERT(Twice(-21) == -42);\n"
+        "}\n";
+
+    // The second program reuses the functions compiled for the first one
+    auto first = ExecuteTest(code);
+    auto second = ExecuteTest(code);
+
+    // and keeps them alive after the first one is gone
+    first.reset();
+    std::vector<std::string> tests;
+    ASSERT_TRUE(second->Compile(code, tests));
+    ASSERT_EQ(1u, tests.size());
+    second->Start(tests[0]);
+    while (!second->Run());
+    CBotError error;
+    int cursor1, cursor2;
+    second->GetError(error, cursor1, cursor2);
+    EXPECT_EQ(CBotNoErr, error);
+
+    // Bytecode is part of the key, so this compiles again
+    ExecuteTest(code, CBotNoErr, true);
+}
+
+static CBotTypResult cUserDependent(CBotVar* &var, void* user)
+{
+    // accepts a parameter only if the user says so
+    bool bParam = user != nullptr && *static_cast<bool*>(user);
+    if (var == nullptr) return bParam ? CBotTypResult(CBotErrLowParam) : CBotTypResult(CBotTypVoid);
+    if (!bParam) return CBotTypResult(CBotErrOverParam);
+    var = var->GetNext();
+    return CBotTypResult(CBotTypVoid);
+}
+
+static bool rUserDependent(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    return true;
+}
+
+TEST_F(CBotUT, SharedCompiledFunctionsCompileKey)
+{
+    CBotProgram::AddFunction("UserDependent", rUserDependent, cUserDependent);
+    const std::string code =
+        "extern void CompileKey()\n"
+        "{\n"
+        "    UserDependent(1);\n"
+        "}\n";
+
+    bool bParam = true;
+    bool bNoParam = false;
+    std::vector<std::string> functions;
+    CBotProgram first;
+    first.SetCompileKey(1);
+    EXPECT_TRUE(first.Compile(code, functions, &bParam));
+
+    // Another key compiles again, with the other user
+    CBotProgram second;
+    second.SetCompileKey(2);
+    EXPECT_FALSE(second.Compile(code, functions, &bNoParam));
+    CBotError error;
+    int cursor1, cursor2;
+    second.GetError(error, cursor1, cursor2);
+    EXPECT_EQ(CBotErrOverParam, error);
+
+    // The same key shares the functions of the first program
+    CBotProgram third;
+    third.SetCompileKey(1);
+    EXPECT_TRUE(third.Compile(code, functions, &bParam));
+}
+
+TEST_F(CBotUT, OptimizedCompile)
+{
+    const std::string code =
+        "int Value() { return 5; }\n"
+        "extern void ConstantFolding()\n"
+        "{\n"
+        "    ASSERT(2 * 3 + 1 == 7);\n"
+        "    ASSERT(-5 + Value() == 0);\n"
+        "    ASSERT(7 / 2 == 3.5);\n"
+        "    ASSERT(!(1 > 2) && true);\n"
+        "    float f = 1.5 * 2;\n"
+        "    ASSERT(f == 3);\n"
+        "}\n"
+        "extern void ConstantConditions()\n"
+        "{\n"
+        "    int a = 0;\n"
+        "    if (false) { a = 1; } else { a = 2; }\n"
+        "    ASSERT(a == 2);\n"
+        "    if (1 < 2) a = 3; else a = 4;\n"
+        "    ASSERT(a == 3);\n"
+        "    if (false) a = 5;\n"
+        "    ASSERT(a == 3);\n"
+        "}\n"
+        "int Unreachable()\n"
+        "{\n"
+        "    return 1;\n"
+        "    ASSERT(false);\n"
+        "}\n"
+        "extern void UnreachableCode()\n"
+        "{\n"
+        "    ASSERT(Unreachable() == 1);\n"
+        "}\n";
+    ExecuteTest(code);
+    ExecuteTest(code, CBotNoErr, false, true);
+    ExecuteTest(code, CBotNoErr, true, true);
+
+    // Step by step, the folded and removed code doesn't stop, the other instructions stop at the same places
+    const std::string stepped =
+        "extern void Stepped()\n"
+        "{\n"
+        "    int a = 2 * 3 + 1;\n"
+        "    if (false) { a = 1; }\n"
+        "    a = a + 1;\n"
+        "}\n";
+    auto Steps = [&stepped](bool optimize)
+    {
+        std::vector<std::string> steps;
+        std::unique_ptr<CBotProgram> program(new CBotProgram());
+        program->SetOptimizeEnabled(optimize);
+        std::vector<std::string> functions;
+        EXPECT_TRUE(program->Compile(stepped, functions));
+        EXPECT_TRUE(program->Start(functions[0]));
+        std::string name;
+        int start, end;
+        while (!program->Run(nullptr, 0))
+        {
+            EXPECT_TRUE(program->GetRunPos(name, start, end));
+            steps.push_back(stepped.substr(start, end - start) + "@" + std::to_string(start));
+        }
+        EXPECT_EQ(CBotNoErr, program->GetError());
+        return steps;
+    };
+    std::vector<std::string> plain = Steps(false);
+    std::vector<std::string> optimized = Steps(true);
+    EXPECT_EQ(13u, plain.size());
+    EXPECT_LT(optimized.size(), plain.size());
+
+    // 2 * 3 + 1 stops once, as a whole
+    const std::string folded = "2 * 3 + 1@" + std::to_string(stepped.find("2 * 3"));
+    EXPECT_EQ(0, std::count(plain.begin(), plain.end(), folded));
+    EXPECT_EQ(1, std::count(optimized.begin(), optimized.end(), folded));
+
+    // if (false) is removed, it stops only without the optimizations
+    const std::string removed = "if@" + std::to_string(stepped.find("if"));
+    EXPECT_EQ(1, std::count(plain.begin(), plain.end(), removed));
+    EXPECT_EQ(0, std::count(optimized.begin(), optimized.end(), removed));
+
+    // the other steps are the same, in the same order
+    optimized.erase(std::remove(optimized.begin(), optimized.end(), folded), optimized.end());
+    auto next = plain.begin();
+    for (const std::string& step : optimized)
+    {
+        next = std::find(next, plain.end(), step);
+        ASSERT_NE(plain.end(), next) << "Unexpected step " << step;
+        ++next;
+    }
+    EXPECT_EQ(std::vector<std::string>(plain.end() - 4, plain.end()),
+              std::vector<std::string>(optimized.end() - 4, optimized.end()));
+
+    // Errors are still reported, at compile time in dead code and at run time for folded operations
+    ExecuteTest(
+        "extern void DeadCodeError()\n"
+        "{\n"
+        "    if (false) { int a = \"text\" * 2; }\n"
+        "}\n",
+        CBotErrBadType2, false, true
+    );
+    ExecuteTest(
+        "extern void FoldedDivisionByZero()\n"
+        "{\n"
+        "    int a = 1 / 0;\n"
+        "}\n",
+        CBotErrZeroDiv, false, true
+    );
+}
+
+TEST_F(CBotUT, Profiler)
+{
+    const std::string code =
+        "int Hot(int n)\n"
+        "{\n"
+        "    int s = 0;\n"
+        "    for (int i = 0; i < n; i++) s += i;\n"
+        "    return s;\n"
+        "}\n"
+        "extern void Profiled()\n"
+        "{\n"
+        "    for (int i = 0; i < 20; i++) Hot(100);\n"
+        "}\n";
+
+    CBotProfiler profiler;
+    std::unique_ptr<CBotProgram> program{new CBotProgram()};
+    program->SetProfiler(&profiler);
+    std::vector<std::string> tests;
+    ASSERT_TRUE(program->Compile(code, tests));
+    program->Start(tests[0]);
+    while (!program->Run());
+    EXPECT_EQ(CBotNoErr, program->GetError());
+
+    // Most of the steps are spent in the loop of Hot()
+    ASSERT_GT(profiler.GetTotal().samples, 10);
+    EXPECT_GT(profiler.GetFunctions().at("Hot").steps, profiler.GetTotal().steps / 2);
+    auto lines = profiler.GetLines(code);
+    auto hottest = std::max_element(lines.begin(), lines.end(), [](const std::pair<const int, CBotProfiler::Entry>& a, const std::pair<const int, CBotProfiler::Entry>& b)
+    {
+        return a.second.steps < b.second.steps;
+    });
+    ASSERT_NE(lines.end(), hottest);
+    EXPECT_EQ(4, hottest->first);
+
+    std::stringstream collapsed;
+    profiler.WriteCollapsedStacks(collapsed, code, "test");
+    EXPECT_NE(std::string::npos, collapsed.str().find("test;Profiled:9;Hot:4 "));
+
+    profiler.Clear();
+    EXPECT_EQ(0, profiler.GetTotal().samples);
+    EXPECT_TRUE(profiler.GetFunctions().empty());
+}
+
+TEST_F(CBotUT, SaveRestoreState)
+{
+    const std::string code =
+        "extern void SaveRestore()\n"
+        "{\n"
+        "    int big = 100000;\n"
+        "    float f = 2.5;\n"
+        "    string s = \"Colobot\";\n"
+        "    for (int i = 0; i < 200; i++) big++;\n"
+        "    ASSERT(big == 100200);\n"
+        "    ASSERT(f == 2.5);\n"
+        "    ASSERT(s == \"Colobot\");\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> program{new CBotProgram()};
+    std::vector<std::string> tests;
+    ASSERT_TRUE(program->Compile(code, tests));
+    program->Start(tests[0]);
+    ASSERT_FALSE(program->Run(nullptr, 50));
+
+    CBotWriter ostr;
+    ASSERT_TRUE(program->SaveState(ostr));
+    program.reset();
+
+    // the state is restored in a new program, which continues from the middle of the loop
+    std::unique_ptr<CBotProgram> restored{new CBotProgram()};
+    ASSERT_TRUE(restored->Compile(code, tests));
+    CBotReader istr(ostr.GetData().data(), ostr.GetData().size());
+    EXPECT_FALSE(istr.IsLegacy());
+    ASSERT_TRUE(restored->RestoreState(istr));
+    EXPECT_TRUE(istr.IsEnd());
+    while (!restored->Run());
+    EXPECT_EQ(CBotNoErr, restored->GetError());
+
+    // a header with another version is rejected, and not read with another layout
+    for (unsigned short version : { CBotReader::VERSION_LEGACY, CBotWriter::VERSION + 1 })
+    {
+        std::string data = ostr.GetData();
+        data[4] = static_cast<char>(version);
+        data[5] = static_cast<char>(version >> 8);
+        CBotReader bad(data.data(), data.size());
+        EXPECT_TRUE(bad.IsFailed());
+        EXPECT_FALSE(bad.IsLegacy());
+        EXPECT_FALSE(restored->RestoreState(bad));
+    }
+}
+
+TEST_F(CBotUT, SaveStateFormat)
+{
+    // blocks can be skipped without reading them
+    CBotWriter ostr;
+    std::size_t block = ostr.BeginBlock();
+    WriteString(ostr, "skipped");
+    ostr.EndBlock(block);
+    WriteLong(ostr, -5);
+    WriteFloat(ostr, 1.5f);
+
+    CBotReader istr(ostr.GetData().data(), ostr.GetData().size());
+    EXPECT_EQ(CBotWriter::VERSION, istr.GetVersion());
+    EXPECT_FALSE(istr.IsFailed());
+    CBotReader skipped;
+    ASSERT_TRUE(istr.ReadBlock(skipped));
+    long l;
+    float f;
+    ASSERT_TRUE(ReadLong(istr, l));
+    ASSERT_TRUE(ReadFloat(istr, f));
+    EXPECT_EQ(-5, l);
+    EXPECT_EQ(1.5f, f);
+    EXPECT_TRUE(istr.IsEnd());
+    std::string s;
+    EXPECT_FALSE(ReadString(istr, s));
+
+    // data without header is read as written by fWrite() with native sizes
+    std::string legacy;
+    long version = 1;
+    unsigned short length = 3;
+    legacy.append(reinterpret_cast<const char*>(&version), sizeof(long));
+    legacy.append(reinterpret_cast<const char*>(&length), sizeof(unsigned short));
+    legacy.append("bot");
+    CBotReader old(legacy.data(), legacy.size());
+    EXPECT_TRUE(old.IsLegacy());
+    ASSERT_TRUE(ReadLong(old, l));
+    EXPECT_EQ(1, l);
+    ASSERT_TRUE(ReadString(old, s));
+    EXPECT_EQ("bot", s);
+    EXPECT_TRUE(old.IsEnd());
+}
+
 TEST_F(CBotUT, ClassConstructor)
 {
     ExecuteTest(
@@ -795,6 +1285,39 @@ TEST_F(CBotUT, ClassNullPointer)
     );
 }
 
+TEST_F(CBotUT, InstanceCounters)
+{
+    const std::string code =
+        "public class Node {\n"
+        "    public static Node kept = null;\n"
+        "    public Node next = null;\n"
+        "    public void Keep() { kept = this; }\n"
+        "}\n"
+        "extern void InstanceCounters()\n"
+        "{\n"
+        "    Node list = null;\n"
+        "    for (int i = 0; i < 100; i++) {\n"
+        "        Node n = new Node();\n"
+        "        n.next = list;\n"
+        "        list = n;\n"
+        "    }\n"
+        "    for (int i = 0; i < 50; i++) list = list.next;\n"
+        "    list.Keep();\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> program{new CBotProgram()};
+    std::vector<std::string> tests;
+    ASSERT_TRUE(program->Compile(code, tests));
+    long created = program->GetContext()->GetCreatedInstanceCount();
+    program->Start(tests[0]);
+    while (!program->Run());
+    EXPECT_EQ(CBotNoErr, program->GetError());
+
+    // Only the rest of the list, kept in the static field, is left
+    EXPECT_EQ(100, program->GetContext()->GetCreatedInstanceCount() - created);
+    EXPECT_EQ(50, program->GetContext()->GetInstanceCount());
+}
+
 // TODO: This doesn't work
 TEST_F(CBotUT, DISABLED_ClassDestructorNaming)
 {
@@ -925,6 +1448,229 @@ TEST_F(CBotUT, DISABLED_BadStringAdd_Issue535)
     );
 }
 
+TEST_F(CBotUT, IntrinsicClassValues)
+{
+    // like the class "point" of the game
+    std::unique_ptr<CBotClass> point(CBotClass::Create("point", nullptr, true));
+    point->AddItem("x", CBotTypFloat);
+    point->AddItem("y", CBotTypFloat);
+    point->AddItem("z", CBotTypFloat);
+
+    long live = CBotVar::GetLiveCount();
+    ExecuteTest(
+        "point Shift(point p, float d)\n"
+        "{\n"
+        "    p.x += d;\n"
+        "    return p;\n"
+        "}\n"
+        "extern void TestIntrinsicValues()\n"
+        "{\n"
+        "    point a;\n"
+        "    a.x = 1; a.y = 2; a.z = 3;\n"
+        "    point b = a;\n"
+        "    b.x = 10;\n"
+        "    ASSERT(a.x == 1 && b.x == 10 && b.y == 2);\n"
+        "    for (int i = 0; i < 100; i++)\n"
+        "    {\n"
+        "        point c = Shift(b, 1);\n"
+        "        ASSERT(c.x == b.x + 1);\n"
+        "        b = c;\n"
+        "    }\n"
+        "    ASSERT(b.x == 110 && b.z == 3);\n"
+        "    a = b;\n"
+        "    b.z = 0;\n"
+        "    ASSERT(a.x == 110 && a.z == 3);\n"
+        "}\n"
+    );
+    EXPECT_EQ(live, CBotVar::GetLiveCount());
+
+    // the values are held inline on the stack, only the variables create their members
+    auto Created = [](const std::string& code)
+    {
+        std::unique_ptr<CBotProgram> program(new CBotProgram());
+        std::vector<std::string> functions;
+        EXPECT_TRUE(program->Compile(code, functions));
+        EXPECT_TRUE(program->Start(functions[0]));
+        long created = CBotVar::GetCreatedCount();
+        while (!program->Run());
+        EXPECT_EQ(CBotNoErr, program->GetError());
+        return CBotVar::GetCreatedCount() - created;
+    };
+    EXPECT_LE(Created(
+        "extern void TestIntrinsicAssign()\n"
+        "{\n"
+        "    point a;\n"
+        "    point b;\n"
+        "    a.x = 1;\n"
+        "    for (int i = 0; i < 1000; i++) b = a;\n"
+        "    ASSERT(b.x == 1);\n"
+        "}\n"), 100);
+    EXPECT_LE(Created(
+        "extern void TestIntrinsicDeclare()\n"
+        "{\n"
+        "    point a;\n"
+        "    a.x = 1;\n"
+        "    for (int i = 0; i < 1000; i++) { point b = a; }\n"
+        "}\n"), 4 * 1000 + 100);
+    EXPECT_LE(Created(
+        "point Origin()\n"
+        "{\n"
+        "    point p;\n"
+        "    p.x = 0; p.y = 0; p.z = 0;\n"
+        "    return p;\n"
+        "}\n"
+        "extern void TestIntrinsicReturn()\n"
+        "{\n"
+        "    point a;\n"
+        "    for (int i = 0; i < 1000; i++) a = Origin();\n"
+        "    ASSERT(a.x == 0 && a.z == 0);\n"
+        "}\n"), 4 * 1000 + 100);
+    EXPECT_EQ(live, CBotVar::GetLiveCount());
+}
+
+TEST_F(CBotUT, InstanceIdentifiers)
+{
+    std::unique_ptr<CBotClass> item(CBotClass::Create("item", nullptr));
+    CBotTypResult type(CBotTypClass, "item");
+
+    // creating a variable of a class type makes a pointer to a new instance
+    std::unique_ptr<CBotVarPointer> pointer(static_cast<CBotVarPointer*>(CBotVar::Create("", type)));
+    long handle = pointer->GetIdent();
+    EXPECT_EQ(pointer->GetPointer(), CBotVarClass::Find(handle));
+    pointer.reset();                                // destroys the instance
+    EXPECT_EQ(nullptr, CBotVarClass::Find(handle));
+
+    // the handle of a destroyed instance doesn't find the instances created after it
+    int found = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        std::unique_ptr<CBotVar> other(CBotVar::Create("", type));
+        if (CBotVarClass::Find(handle) != nullptr) found++;
+    }
+    EXPECT_EQ(0, found);
+
+    // a copy doesn't take the identifier away from the original
+    std::unique_ptr<CBotVar> original(CBotVar::Create("", type));
+    original->SetIdent(1234);
+    {
+        std::unique_ptr<CBotVar> copy(CBotVar::Create("", type));
+        copy->GetPointer()->Copy(original.get());
+    }
+    EXPECT_EQ(original->GetPointer(), CBotVarClass::Find(1234));
+}
+
+namespace
+{
+CBotVar* g_thing = nullptr;
+int g_wholeUpdates = 0;
+int g_itemUpdates = 0;
+
+CBotTypResult cGetThing(CBotVar* &var, void* user)
+{
+    if (var != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypPointer, "thing");
+}
+
+bool rGetThing(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetPointer(g_thing);
+    return true;
+}
+
+void uThing(CBotVar* thisVar, void* user)
+{
+    g_wholeUpdates++;
+    for (CBotVar* item = thisVar->GetItemList(); item != nullptr; item = item->GetNext())
+        item->SetValInt(1);
+}
+
+void uThingA(CBotVar* thisVar, CBotVar* item, void* user)
+{
+    g_itemUpdates++;
+    item->SetValInt(10);
+}
+} // namespace
+
+TEST_F(CBotUT, UpdateFieldsOneByOne)
+{
+    std::unique_ptr<CBotClass> thing(CBotClass::Create("thing", nullptr));
+    thing->AddItem("a", CBotTypInt);
+    thing->AddItem("b", CBotTypInt);
+    thing->SetUpdateFunc(uThing);
+    EXPECT_TRUE(thing->SetUpdateFunc("a", uThingA));
+    EXPECT_FALSE(thing->SetUpdateFunc("c", uThingA));
+    CBotProgram::AddFunction("GetThing", rGetThing, cGetThing);
+
+    int user = 0;
+    g_thing = CBotVar::Create("", CBotTypResult(CBotTypClass, "thing"));
+    g_thing->SetUserPtr(&user);
+    g_wholeUpdates = g_itemUpdates = 0;
+
+    ExecuteTest(
+        "extern void TestUpdateFields()\n"
+        "{\n"
+        "    thing t = GetThing();\n"
+        "    for (int i = 0; i < 3; i++) ASSERT(t.a == 10);\n"
+        "    thing u = t;\n"
+        "    ASSERT(u.a == 10);\n"
+        "    ASSERT(t.b == 1);\n"
+        "}\n"
+    );
+    // only reading the instance itself (u = t) and the field without its own function updated the whole instance
+    EXPECT_EQ(4, g_itemUpdates);
+    EXPECT_EQ(2, g_wholeUpdates);
+
+    delete g_thing;
+    g_thing = nullptr;
+}
+
+namespace
+{
+CBotTypResult cMakeArray(CBotVar* &var, void* user)
+{
+    if (var == nullptr) return CBotTypResult(CBotErrLowParam);
+    if (var->GetType() != CBotTypInt) return CBotTypResult(CBotErrBadNum);
+    if (var->GetNext() != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypArrayPointer, CBotTypResult(CBotTypInt));
+}
+
+bool rMakeArray(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    int n = var->GetValInt();
+    result->SetInit(CBotVar::InitType::DEF);
+    // growing then shrinking keeps the first elements
+    if (!result->SetItemCount(n * 2) || !result->SetItemCount(n)) return true;
+    int i = 0;
+    for (CBotVar* item = result->GetItemList(); item != nullptr; item = item->GetNext())
+        item->SetValInt(i++);
+    return true;
+}
+} // namespace
+
+TEST_F(CBotUT, BuildArrayInOnePass)
+{
+    CBotProgram::AddFunction("MakeArray", rMakeArray, cMakeArray);
+
+    long live = CBotVar::GetLiveCount();
+    ExecuteTest(
+        "extern void TestMakeArray()\n"
+        "{\n"
+        "    int[] a = MakeArray(1000);\n"
+        "    ASSERT(sizeof(a) == 1000);\n"
+        "    ASSERT(a[0] == 0 && a[500] == 500 && a[999] == 999);\n"
+        "    a[1000] = 1000;\n"
+        "    ASSERT(sizeof(a) == 1001 && a[1000] == 1000);\n"
+        "    a = MakeArray(3);\n"
+        "    ASSERT(sizeof(a) == 3 && a[2] == 2);\n"
+        "    int[] b = MakeArray(0);\n"
+        "    ASSERT(sizeof(b) == 0);\n"
+        "    b = MakeArray(6000);\n"
+        "    ASSERT(sizeof(b) == 0);\n"
+        "}\n"
+    );
+    EXPECT_EQ(live, CBotVar::GetLiveCount());
+}
+
 TEST_F(CBotUT, String)
 {
     ExecuteTest(
@@ -940,6 +1686,40 @@ TEST_F(CBotUT, String)
     );
 }
 
+TEST_F(CBotUT, StringConcatenation)
+{
+    ExecuteTest(
+        "extern void StringConcatenationLoop()\n"
+        "{\n"
+        "    string s = \"\";\n"
+        "    for (int i = 0; i < 1000; i++) s += \"x\";\n"
+        "    ASSERT(strlen(s) == 1000);\n"
+        "    for (int i = 0; i < 1000; i++) s = s + \"y\";\n"
+        "    ASSERT(strlen(s) == 2000);\n"
+        "    ASSERT(strmid(s, 998, 4) == \"xxyy\");\n"
+        "    ASSERT(strfind(s, \"y\") == 1000);\n"
+        "}\n"
+        "extern void StringConcatenationShared()\n"
+        "{\n"
+        "    string a = \"Colo\";\n"
+        "    string b = a;\n"
+        "    string c = a + \"bot\";\n"
+        "    string d = a + \"nel\";\n"
+        "    string e = b + \"ssus\";\n"
+        "    ASSERT(a == \"Colo\");\n"
+        "    ASSERT(b == \"Colo\");\n"
+        "    ASSERT(c == \"Colobot\");\n"
+        "    ASSERT(d == \"Colonel\");\n"
+        "    ASSERT(e == \"Colossus\");\n"
+        "    a += \"r\";\n"
+        "    ASSERT(a == \"Color\");\n"
+        "    ASSERT(b == \"Colo\");\n"
+        "    ASSERT(a + a == \"ColorColor\");\n"
+        "    ASSERT(1 + a == \"1Color\");\n"
+        "}\n"
+    );
+}
+
 // TODO: not implemented, see issue #694
 TEST_F(CBotUT, DISABLED_StringAsArray)
 {
@@ -1070,3 +1850,930 @@ TEST_F(CBotUT, TestArrayFunctionReturn)
         "}\n"
     );
 }
+
+TEST_F(CBotUT, Bytecode)
+{
+    const std::string code =
+        "extern void BytecodeMath()\n"
+        "{\n"
+        "    int i = 7;\n"
+        "    float f = 2.5;\n"
+        "    bool b = true;\n"
+        "    ASSERT(i + 3 * 2 == 13);\n"
+        "    ASSERT(i / 2 == 3.5);\n"
+        "    ASSERT(i % 4 == 3);\n"
+        "    ASSERT(i * f == 17.5);\n"
+        "    ASSERT(-i + 10 == 3);\n"
+        "    ASSERT((~i) == -8);\n"
+        "    ASSERT(2 ** 10 == 1024);\n"
+        "    ASSERT((i << 2) == 28);\n"
+        "    ASSERT((i >> 1) == 3);\n"
+        "    ASSERT((i & 3) == 3 && (i | 8) == 15 && (i ^ 1) == 6);\n"
+        "    ASSERT(b && !(i < 5) || false);\n"
+        "    ASSERT((b ^ false) == true);\n"
+        "    int j = i / 2;\n"
+        "    ASSERT(j == 3);\n"
+        "}\n"
+        "\n"
+        "extern void BytecodeShortCircuit()\n"
+        "{\n"
+        "    int zero = 0;\n"
+        "    ASSERT(zero == 0 || 1 / zero == 1);\n"
+        "    ASSERT(!(zero != 0 && 1 / zero == 1));\n"
+        "}\n"
+        "\n"
+        "extern void BytecodeNan()\n"
+        "{\n"
+        "    float a = nan;\n"
+        "    ASSERT(a == nan);\n"
+        "    ASSERT(!(a != nan));\n"
+        "}\n";
+
+    ExecuteTest(code, CBotNoErr, false);
+    ExecuteTest(code, CBotNoErr, true);
+
+    ExecuteTest(
+        "extern void BytecodeDivideByZero()\n"
+        "{\n"
+        "    int a = 0;\n"
+        "    float b = 5 / a + 1;\n"
+        "}\n",
+        CBotErrZeroDiv, true
+    );
+
+    ExecuteTest(
+        "extern void BytecodeUndefinedVar()\n"
+        "{\n"
+        "    int a;\n"
+        "    int b = a + 1;\n"
+        "}\n",
+        CBotErrNotInit, true
+    );
+}
+
+TEST_F(CBotUT, BytecodeSameTimer)
+{
+    const std::string code =
+        "extern void BytecodeSameTimer()\n"
+        "{\n"
+        "    int x = 0;\n"
+        "    for (int i = 0; i < 100 && x > -10; i++) x = x + i * 2 - 1;\n"
+        "    ASSERT(x == 9800);\n"
+        "}\n";
+
+    int runs[2];
+    for (int bytecode = 0; bytecode < 2; bytecode++)
+    {
+        std::unique_ptr<CBotProgram> program(new CBotProgram());
+        program->SetBytecodeEnabled(bytecode != 0);
+        std::vector<std::string> functions;
+        ASSERT_TRUE(program->Compile(code, functions));
+        ASSERT_TRUE(program->Start(functions[0]));
+
+        runs[bytecode] = 1;
+        while (!program->Run(nullptr, 10)) runs[bytecode]++;
+        EXPECT_EQ(CBotNoErr, program->GetError());
+    }
+
+    // both engines must be suspended at the same points
+    EXPECT_EQ(runs[0], runs[1]);
+    EXPECT_GT(runs[0], 10);
+}
+
+TEST_F(CBotUT, BytecodeLoops)
+{
+    const std::string code =
+        "extern void BytecodeLoopStatements()\n"
+        "{\n"
+        "    int s = 0;\n"
+        "    for (int i = 0; i < 5; i++)\n"
+        "    {\n"
+        "        if (i == 3) continue;\n"
+        "        int k = i * 2;\n"
+        "        float g = k / 4;\n"
+        "        s += k;\n"
+        "        ++s;\n"
+        "        while (true) { s--; break; }\n"
+        "        ASSERT(g * 4 == k);\n"
+        "    }\n"
+        "    ASSERT(s == 14);\n"
+        "}\n"
+        "\n"
+        "extern void BytecodeLoopLabels()\n"
+        "{\n"
+        "    int s = 0;\n"
+        "    outer: while (s < 100)\n"
+        "    {\n"
+        "        do { s += 7; if (s > 70) break outer; } while (s % 3 != 0);\n"
+        "    }\n"
+        "    ASSERT(s == 77);\n"
+        "    int n = 0;\n"
+        "    rows: for (int i = 0; i < 4; i++)\n"
+        "    {\n"
+        "        for (int j = 0; j < 4; j++)\n"
+        "        {\n"
+        "            if (j > i) continue rows;\n"
+        "            n++;\n"
+        "        }\n"
+        "    }\n"
+        "    ASSERT(n == 10);\n"
+        "}\n"
+        "\n"
+        "extern void BytecodeLoopTree()\n"
+        "{\n"
+        "    int n = 0;\n"
+        "    string str = \"\";\n"
+        "    int[] a;\n"
+        "    for (int i = 0; i < 6; i++)\n"
+        "    {\n"
+        "        str += \"x\";\n"
+        "        a[i] = i;\n"
+        "        n += a[i] + abs(-i);\n"
+        "        for (int j = 0; j < i; j++) { if (j % 2 == 0) n--; else { int q = j; n += q; } }\n"
+        "    }\n"
+        "    ASSERT(n == 31);\n"
+        "    ASSERT(strlen(str) == 6);\n"
+        "    bool b = false;\n"
+        "    float f = 0;\n"
+        "    do f += 0.5; while (f < 3);\n"
+        "    while (n > 0) { b = !b; if (b) n -= 2; else n++; }\n"
+        "    ASSERT(n == 0 && f == 3);\n"
+        "}\n";
+
+    ExecuteTest(code, CBotNoErr, false);
+    ExecuteTest(code, CBotNoErr, true);
+
+    ExecuteTest(
+        "extern void BytecodeLoopError()\n"
+        "{\n"
+        "    int s = 0;\n"
+        "    for (int i = 0; i < 5; i++) s += 10 / (i - 3);\n"
+        "}\n",
+        CBotErrZeroDiv, true
+    );
+
+    ExecuteTest(
+        "extern void BytecodeLoopNotInit()\n"
+        "{\n"
+        "    int u;\n"
+        "    int s = 0;\n"
+        "    while (s < 5) { s++; u++; }\n"
+        "}\n",
+        CBotErrNotInit, true
+    );
+}
+
+TEST_F(CBotUT, BytecodeLoopSaveRestore)
+{
+    const std::string code =
+        "extern void BytecodeLoopSaveRestore()\n"
+        "{\n"
+        "    int s = 0;\n"
+        "    string str = \"\";\n"
+        "    for (int i = 0; i < 8; i++)\n"
+        "    {\n"
+        "        int k = i;\n"
+        "        while (k > 0) { s += k; k -= 3; }\n"
+        "        if (i % 2 == 0) continue;\n"
+        "        str += \"x\";\n"
+        "    }\n"
+        "    ASSERT(s == 39);\n"
+        "    ASSERT(strlen(str) == 4);\n"
+        "}\n";
+
+    auto compile = [&](bool bytecode)
+    {
+        std::unique_ptr<CBotProgram> program(new CBotProgram());
+        program->SetBytecodeEnabled(bytecode);
+        std::vector<std::string> functions;
+        EXPECT_TRUE(program->Compile(code, functions));
+        return program;
+    };
+
+    // saves and restores the program after each run, the steps of each run must be the same
+    for (int timer : { 1, 3, 10 })
+    {
+        std::vector<long> steps[2];
+        for (int bytecode = 0; bytecode < 2; bytecode++)
+        {
+            std::unique_ptr<CBotProgram> program = compile(bytecode != 0);
+            ASSERT_TRUE(program->Start("BytecodeLoopSaveRestore"));
+            while (true)
+            {
+                bool done = program->Run(nullptr, timer);
+                steps[bytecode].push_back(program->GetContext()->GetStepCount());
+                if (done) break;
+
+                CBotWriter ostr;
+                ASSERT_TRUE(program->SaveState(ostr));
+                program = compile(bytecode != 0);
+                CBotReader istr(ostr.GetData().data(), ostr.GetData().size());
+                ASSERT_TRUE(program->RestoreState(istr));
+            }
+            EXPECT_EQ(CBotNoErr, program->GetError());
+        }
+        EXPECT_EQ(steps[0], steps[1]) << "timer " << timer;
+        EXPECT_GT(steps[0].size(), 5u);
+    }
+
+    // a state saved in the bytecode needs the bytecode, an older one doesn't
+    for (int bytecode = 0; bytecode < 2; bytecode++)
+    {
+        std::unique_ptr<CBotProgram> program = compile(bytecode != 0);
+        ASSERT_TRUE(program->Start("BytecodeLoopSaveRestore"));
+        ASSERT_FALSE(program->Run(nullptr, 20));
+        CBotWriter ostr;
+        ASSERT_TRUE(program->SaveState(ostr));
+
+        CBotReader istr(ostr.GetData().data(), ostr.GetData().size());
+        std::unique_ptr<CBotProgram> other = compile(bytecode == 0);
+        if (bytecode != 0)
+        {
+            EXPECT_FALSE(other->RestoreState(istr));
+            continue;
+        }
+        ASSERT_TRUE(other->RestoreState(istr));
+        while (!other->Run(nullptr, 20));
+        EXPECT_EQ(CBotNoErr, other->GetError());
+    }
+
+    // step by step from the middle of the bytecode, then the tree walker continues the loop
+    std::unique_ptr<CBotProgram> program = compile(true);
+    ASSERT_TRUE(program->Start("BytecodeLoopSaveRestore"));
+    ASSERT_FALSE(program->Run(nullptr, 20));
+    int runs = 0;
+    while (!program->Run(nullptr, 0)) runs++;
+    EXPECT_EQ(CBotNoErr, program->GetError());
+    EXPECT_GT(runs, 100);
+}
+
+namespace
+{
+CBotTypResult cCall(CBotVar* &var, void* user)
+{
+    if (var != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypInt);
+}
+
+bool rCall(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValInt(1);
+    return true;
+}
+} // namespace
+
+TEST_F(CBotUT, CostOfExternalCalls)
+{
+    CBotProgram::AddFunction("CheapCall", rCall, cCall);
+    CBotProgram::AddFunction("CostlyCall", rCall, cCall, false, 500);
+
+    int runs[2];
+    long steps[2];
+    for (int costly = 0; costly < 2; costly++)
+    {
+        std::string code =
+            "extern void CallInLoop()\n"
+            "{\n"
+            "    int n = 0;\n"
+            "    for (int i = 0; i < 10; i++) n += " + std::string(costly ? "CostlyCall" : "CheapCall") + "();\n"
+            "    if (n != 10) n = 1/0;\n"
+            "}\n";
+
+        std::unique_ptr<CBotProgram> program(new CBotProgram());
+        std::vector<std::string> functions;
+        ASSERT_TRUE(program->Compile(code, functions));
+        ASSERT_TRUE(program->Start(functions[0]));
+
+        runs[costly] = 1;
+        while (!program->Run(nullptr, 100)) runs[costly]++;
+        EXPECT_EQ(CBotNoErr, program->GetError());
+        steps[costly] = program->GetContext()->GetStepCount();
+    }
+
+    // the cost beyond the timer of a run is paid by the following runs
+    EXPECT_LT(runs[0], 5);
+    EXPECT_GE(runs[1], 10 * 500 / 100);
+    EXPECT_GE(steps[1] - steps[0], 10 * 499);
+}
+
+TEST_F(CBotUT, StepByStepOnlyForItsProgram)
+{
+    const std::string code =
+        "extern void Steps()\n"
+        "{\n"
+        "    int x = 0;\n"
+        "    for (int i = 0; i < 10; i++) x += i;\n"
+        "    if (x != 45) x = 1/0;\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> stepped(new CBotProgram());
+    std::unique_ptr<CBotProgram> fast(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(stepped->Compile(code, functions));
+    ASSERT_TRUE(stepped->Start(functions[0]));
+    ASSERT_TRUE(fast->Compile(code, functions));
+    ASSERT_TRUE(fast->Start(functions[0]));
+
+    // a few steps, then the program goes on at full speed
+    for (int i = 0; i < 5; i++)
+        ASSERT_FALSE(stepped->Run(nullptr, 0));
+    EXPECT_TRUE(fast->Run(nullptr, 10000));
+    EXPECT_EQ(CBotNoErr, fast->GetError());
+    ASSERT_FALSE(stepped->Run(nullptr, 0));
+    EXPECT_TRUE(stepped->Run(nullptr, 10000));
+    EXPECT_EQ(CBotNoErr, stepped->GetError());
+
+    // step by step, every part of the loop stops once
+    ASSERT_TRUE(stepped->Start(functions[0]));
+    int runs = 1;
+    while (!stepped->Run(nullptr, 0)) runs++;
+    EXPECT_EQ(CBotNoErr, stepped->GetError());
+    EXPECT_GT(runs, 30);
+}
+
+TEST_F(CBotUT, MemoryLimitPerProgram)
+{
+    const std::string code =
+        "extern void Grow()\n"
+        "{\n"
+        "    string s = \"0123456789\";\n"
+        "    int[] a;\n"
+        "    for (int i = 0; i < 2000; i++)\n"
+        "    {\n"
+        "        a[i] = i;\n"
+        "        if (i < 12) s += s;\n"
+        "    }\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> limited(new CBotProgram());
+    std::unique_ptr<CBotProgram> free(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(limited->Compile(code, functions));
+    ASSERT_TRUE(limited->Start(functions[0]));
+    ASSERT_TRUE(free->Compile(code, functions));
+    ASSERT_TRUE(free->Start(functions[0]));
+
+    // the string alone takes 40 KB
+    limited->GetContext()->SetMemoryLimit(32 * 1024);
+    while (!limited->Run(nullptr, 1000));
+    EXPECT_EQ(CBotErrMemory, limited->GetError());
+
+    while (!free->Run(nullptr, 1000))
+        EXPECT_GT(free->GetContext()->GetMemoryUsage(), 0);
+    EXPECT_EQ(CBotNoErr, free->GetError());
+    EXPECT_GT(free->GetContext()->GetPeakMemoryUsage(), 40 * 1024);
+    EXPECT_GE(free->GetContext()->GetPeakMemoryUsage(), free->GetContext()->GetMemoryUsage());
+}
+
+TEST_F(CBotUT, MemoryLimitSharedStrings)
+{
+    const std::string code =
+        "extern void Share()\n"
+        "{\n"
+        "    string s = \"0123456789\";\n"
+        "    for (int i = 0; i < 14; i++) s += s;\n"
+        "    string[] a;\n"
+        "    for (int j = 0; j < 500; j++) a[j] = s;\n"
+        "    ASSERT(strlen(a[499]) == 163840);\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> program(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(program->Compile(code, functions));
+    ASSERT_TRUE(program->Start(functions[0]));
+
+    // the 160 KB buffer is shared by all the elements, and counted once
+    program->GetContext()->SetMemoryLimit(1024 * 1024);
+    while (!program->Run(nullptr, 1000));
+    EXPECT_EQ(CBotNoErr, program->GetError());
+    EXPECT_LT(program->GetContext()->GetPeakMemoryUsage(), 1024 * 1024);
+}
+
+TEST_F(CBotUT, ExecutionContextPerProgram)
+{
+    const std::string code =
+        "extern void Loop()\n"
+        "{\n"
+        "    int x = 0;\n"
+        "    for (int i = 0; i < 50; i++) x += i;\n"
+        "    if (x != 1225) x = 1/0;\n"
+        "}\n";
+    const std::string failing =
+        "extern void Fail()\n"
+        "{\n"
+        "    float a = 5/0;\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> slow(new CBotProgram());
+    std::unique_ptr<CBotProgram> fast(new CBotProgram());
+    std::unique_ptr<CBotProgram> error(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(slow->Compile(code, functions));
+    ASSERT_TRUE(slow->Start(functions[0]));
+    ASSERT_TRUE(fast->Compile(code, functions));
+    ASSERT_TRUE(fast->Start(functions[0]));
+    ASSERT_TRUE(error->Compile(failing, functions));
+    ASSERT_TRUE(error->Start(functions[0]));
+
+    // the timer set by a program must not leak into the others
+    ASSERT_FALSE(slow->Run(nullptr, 5));
+    EXPECT_TRUE(error->Run(nullptr, 10000));
+    EXPECT_EQ(CBotErrZeroDiv, error->GetError());
+    EXPECT_TRUE(fast->Run(nullptr, 10000));
+    EXPECT_EQ(CBotNoErr, fast->GetError());
+
+    int runs = 1;
+    while (!slow->Run()) runs++;
+    EXPECT_EQ(CBotNoErr, slow->GetError());
+    EXPECT_GT(runs, 10);
+}
+
+TEST_F(CBotUT, ProgramsOnSeveralThreads)
+{
+    const std::string code =
+        "int Fact(int n)\n"
+        "{\n"
+        "    if (n <= 1) return 1;\n"
+        "    return n * Fact(n - 1);\n"
+        "}\n"
+        "extern void Work()\n"
+        "{\n"
+        "    int[] a;\n"
+        "    for (int i = 0; i < 200; i++)\n"
+        "    {\n"
+        "        if (i % 2 == 0) continue;\n"
+        "        a[i] = Fact(i % 10);\n"
+        "        if (i > 150) break;\n"
+        "    }\n"
+        "    if (a[9] != 362880) a[0] = 1/0;\n"
+        "}\n";
+    const std::string failing =
+        "extern void Fail()\n"
+        "{\n"
+        "    for (int i = 0; i < 1000; i++) { int[] a; a[i % 10] = i; }\n"
+        "    float a = 5/0;\n"
+        "}\n";
+
+    // compilation is not thread safe, only execution is
+    const int count = 4;
+    std::unique_ptr<CBotProgram> programs[count];
+    for (int i = 0; i < count; i++)
+    {
+        programs[i].reset(new CBotProgram());
+        std::vector<std::string> functions;
+        ASSERT_TRUE(programs[i]->Compile(i % 2 == 0 ? code : failing, functions));
+        ASSERT_TRUE(programs[i]->Start(functions[0]));
+    }
+
+    std::thread threads[count];
+    for (int i = 0; i < count; i++)
+    {
+        CBotProgram* program = programs[i].get();
+        threads[i] = std::thread([program]() { while (!program->Run(nullptr, 20)); });
+    }
+    for (int i = 0; i < count; i++)
+    {
+        threads[i].join();
+        EXPECT_EQ(i % 2 == 0 ? CBotNoErr : CBotErrZeroDiv, programs[i]->GetError()) << "program " << i;
+    }
+}
+
+namespace
+{
+int g_countCalls = 0;
+
+CBotTypResult cCount(CBotVar* &var, void* user)
+{
+    if (var != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypVoid);
+}
+
+bool rCount(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    g_countCalls++;
+    return true;
+}
+} // namespace
+
+TEST_F(CBotUT, RunParallelYieldsBeforeMainThreadCalls)
+{
+    CBotProgram::AddFunction("Count", rCount, cCount);
+    g_countCalls = 0;
+
+    const std::string code =
+        "extern void Work()\n"
+        "{\n"
+        "    float x = 0;\n"
+        "    for (int i = 0; i < 5; i++)\n"
+        "    {\n"
+        "        x += sqrt(16) + strlen(\"abc\");\n"
+        "        Count();\n"
+        "    }\n"
+        "    if (x != 35) x = 1/0;\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> program(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(program->Compile(code, functions));
+    ASSERT_TRUE(program->CanRunParallel());
+    ASSERT_TRUE(program->Start(functions[0]));
+
+    // safe functions are called from the worker, Count() is left for the main thread
+    CBotProgram* p = program.get();
+    bool finished = true;
+    std::thread worker([p, &finished]() { finished = p->RunParallel(nullptr, 10000); });
+    worker.join();
+    EXPECT_FALSE(finished);
+    EXPECT_TRUE(program->IsWaitingForMainThread());
+    EXPECT_EQ(0, g_countCalls);
+
+    int yields = 0;
+    while (!finished)
+    {
+        if (program->IsWaitingForMainThread())
+        {
+            yields++;
+            finished = program->ContinueRun();
+        }
+        else
+        {
+            finished = program->RunParallel(nullptr, 10000);
+        }
+    }
+    EXPECT_EQ(CBotNoErr, program->GetError());
+    EXPECT_EQ(5, g_countCalls);
+    EXPECT_EQ(1, yields);   // the rest of the timer is used on the main thread
+}
+
+namespace
+{
+// Executes the program like the game does with the programs executed in parallel
+bool RunParallelToEnd(CBotProgram* program)
+{
+    bool finished = false;
+    while (!finished)
+    {
+        if (!program->CanRunParallel())
+        {
+            finished = program->Run(nullptr, 100);
+            continue;
+        }
+        CBotProgram::BeginParallelRound();
+        std::thread worker([program, &finished]() { finished = program->RunParallel(nullptr, 100); });
+        worker.join();
+        if (!finished && program->IsWaitingForMainThread()) finished = program->ContinueRun();
+    }
+    return program->GetError() == CBotNoErr;
+}
+} // namespace
+
+TEST_F(CBotUT, RunParallelFallbackOnlyForSharedData)
+{
+    const std::string definitions =
+        "public class Data\n"
+        "{\n"
+        "    static int count = 0;\n"
+        "    int value = 1;\n"
+        "    void Add() { value++; }\n"
+        "    void Count() { count++; }\n"
+        "    synchronized void Locked() {}\n"
+        "}\n"
+        "public class Temp\n"
+        "{\n"
+        "    void ~Temp() {}\n"
+        "}\n"
+        "public int Twice(int x) { return 2 * x; }\n"
+        "extern void Definitions() {}\n";
+    const std::string users[] = {
+        "extern void Plain() { Data d(); d.Add(); if (Twice(d.value) != 4) d.value = 1/0; }\n",
+        "extern void Static() { Data d(); d.Count(); }\n",
+        "extern void Synchronized() { Data d(); d.Locked(); }\n",
+        "extern void Destructor() { Temp t = new Temp(); }\n",
+    };
+    const bool parallel[] = { true, false, false, false };
+
+    std::unique_ptr<CBotProgram> defined(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(defined->Compile(definitions, functions));
+
+    for (int i = 0; i < 4; i++)
+    {
+        std::unique_ptr<CBotProgram> program(new CBotProgram());
+        ASSERT_TRUE(program->Compile(users[i], functions));
+        ASSERT_TRUE(program->Start(functions[0]));
+        EXPECT_TRUE(program->CanRunParallel());
+        EXPECT_TRUE(RunParallelToEnd(program.get())) << users[i];
+        // only the programs which use what is shared with the others stop running in parallel
+        EXPECT_EQ(parallel[i], program->CanRunParallel()) << users[i];
+        ASSERT_TRUE(program->Start(functions[0]));
+        EXPECT_TRUE(program->CanRunParallel());
+    }
+}
+
+namespace
+{
+//! A small game for SerialAndParallelRunsMatch: robots read the values of things,
+//! their actions change the values at the end of the frame
+struct TestWorld
+{
+    std::vector<int> values;
+    std::vector<std::pair<int, int>> pending;
+    std::vector<std::string> log;
+    int frame = 0;
+};
+TestWorld g_world;
+std::vector<CBotVar*> g_worldThings;
+
+CBotTypResult cOneIntToThing(CBotVar* &var, void* user)
+{
+    if (var == nullptr) return CBotTypResult(CBotErrLowParam);
+    if (var->GetType() != CBotTypInt) return CBotTypResult(CBotErrBadNum);
+    if (var->GetNext() != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypPointer, "thing");
+}
+
+bool rWorldThing(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetPointer(g_worldThings[var->GetValInt()]);
+    return true;
+}
+
+void uWorldThing(CBotVar* thisVar, void* user)
+{
+    thisVar->GetItem("value")->SetValInt(g_world.values[*static_cast<int*>(user)]);
+}
+
+CBotTypResult cMe(CBotVar* &var, void* user)
+{
+    if (var != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypInt);
+}
+
+bool rMe(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    result->SetValInt(*static_cast<int*>(user));
+    return true;
+}
+
+CBotTypResult cAct(CBotVar* &var, void* user)
+{
+    if (var == nullptr) return CBotTypResult(CBotErrLowParam);
+    if (var->GetType() != CBotTypInt) return CBotTypResult(CBotErrBadNum);
+    if (var->GetNext() != nullptr) return CBotTypResult(CBotErrOverParam);
+    return CBotTypResult(CBotTypVoid);
+}
+
+bool rAct(CBotVar* var, CBotVar* result, int& exception, void* user)
+{
+    int id = *static_cast<int*>(user);
+    int value = var->GetValInt();
+    g_world.log.push_back(std::to_string(g_world.frame) + ":" + std::to_string(id) + ":" + std::to_string(value));
+    g_world.pending.emplace_back(id, value);
+    return true;
+}
+
+const int WORLD_ROBOTS = 6;
+
+/**
+ * Plays the game until all the robots are done, like CRobotMain does: either with Run() in
+ * robot order, or with RunParallel() on several threads and then everything left for the main
+ * thread in robot order. Returns what the robots did.
+ */
+std::vector<std::string> PlayWorld(bool parallel, std::vector<bool>& canRunParallel)
+{
+    const std::string robot =
+        "extern void Robot()\n"
+        "{\n"
+        "    int me = Me();\n"
+        "    for (int i = 0; i < 15; i++)\n"
+        "    {\n"
+        "        int sum = 0;\n"
+        "        for (int j = 0; j < 6; j++)\n"
+        "        {\n"
+        "            thing t = Thing(j);\n"
+        "            sum += t.value * (j + me);\n"
+        "        }\n"
+        "        Act(sum % 11 - 5 + me);\n"
+        "        for (int k = 0; k < me * 5; k++) sum += k;\n"
+        "    }\n"
+        "}\n";
+    const std::string counting =
+        "public class Counter\n"
+        "{\n"
+        "    static int total = 0;\n"
+        "}\n"
+        "extern void Counting()\n"
+        "{\n"
+        "    int me = Me();\n"
+        "    Counter c();\n"
+        "    for (int i = 0; i < 15; i++)\n"
+        "    {\n"
+        "        thing t = Thing(me);\n"
+        "        c.total += t.value;\n"
+        "        Act(c.total % 13);\n"
+        "    }\n"
+        "}\n";
+
+    g_world = TestWorld();
+    g_world.values = { 3, 1, 4, 1, 5, 9 };
+    int ids[WORLD_ROBOTS];
+    for (int i = 0; i < WORLD_ROBOTS; i++)
+    {
+        ids[i] = i;
+        g_worldThings.push_back(CBotVar::Create("", CBotTypResult(CBotTypClass, "thing")));
+        g_worldThings.back()->SetUserPtr(&ids[i]);
+    }
+
+    std::unique_ptr<CBotProgram> programs[WORLD_ROBOTS];
+    bool running[WORLD_ROBOTS];
+    for (int i = 0; i < WORLD_ROBOTS; i++)
+    {
+        programs[i].reset(new CBotProgram());
+        std::vector<std::string> functions;
+        EXPECT_TRUE(programs[i]->Compile(i == WORLD_ROBOTS - 1 ? counting : robot, functions));
+        EXPECT_TRUE(programs[i]->Start(functions[0]));
+        running[i] = true;
+    }
+
+    for (int frame = 0; frame < 1000 && std::count(running, running + WORLD_ROBOTS, true) > 0; frame++)
+    {
+        g_world.frame = frame;
+        bool finished[WORLD_ROBOTS] = {};
+        bool ranParallel[WORLD_ROBOTS] = {};
+        if (parallel)
+        {
+            CBotProgram::BeginParallelRound();
+            std::vector<std::thread> workers;
+            for (int i = 0; i < WORLD_ROBOTS; i++)
+            {
+                if (!running[i] || !programs[i]->CanRunParallel()) continue;
+                ranParallel[i] = true;
+                CBotProgram* program = programs[i].get();
+                int timer = 40 + 17 * i;
+                workers.emplace_back([program, &ids, i, timer, &finished]() { finished[i] = program->RunParallel(&ids[i], timer); });
+            }
+            for (std::thread& worker : workers) worker.join();
+        }
+
+        for (int i = 0; i < WORLD_ROBOTS; i++)
+        {
+            if (!running[i]) continue;
+            if (!ranParallel[i])
+                finished[i] = programs[i]->Run(&ids[i], 40 + 17 * i);
+            else if (!finished[i] && programs[i]->IsWaitingForMainThread())
+                finished[i] = programs[i]->ContinueRun(&ids[i]);
+            if (finished[i])
+            {
+                EXPECT_EQ(CBotNoErr, programs[i]->GetError());
+                running[i] = false;
+            }
+        }
+
+        for (auto& change : g_world.pending)
+            g_world.values[(change.first + change.second + 6) % 6] += change.second;
+        g_world.pending.clear();
+    }
+    EXPECT_EQ(0, std::count(running, running + WORLD_ROBOTS, true));
+
+    canRunParallel.clear();
+    for (int i = 0; i < WORLD_ROBOTS; i++)
+        canRunParallel.push_back(programs[i]->CanRunParallel());
+
+    for (CBotVar* thing : g_worldThings) delete thing;
+    g_worldThings.clear();
+    return g_world.log;
+}
+} // namespace
+
+TEST_F(CBotUT, SerialAndParallelRunsMatch)
+{
+    std::unique_ptr<CBotClass> thing(CBotClass::Create("thing", nullptr));
+    thing->AddItem("value", CBotTypInt);
+    thing->SetUpdateFunc(uWorldThing);
+    CBotProgram::AddFunction("Thing", rWorldThing, cOneIntToThing, true);
+    CBotProgram::AddFunction("Me", rMe, cMe, true);
+    CBotProgram::AddFunction("Act", rAct, cAct);
+
+    std::vector<bool> canRunParallel;
+    std::vector<std::string> serial = PlayWorld(false, canRunParallel);
+    EXPECT_EQ(WORLD_ROBOTS * 15u, serial.size());
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(serial, PlayWorld(true, canRunParallel));
+    }
+    // only the program using a static field fell back to the main thread
+    EXPECT_EQ(std::vector<bool>({ true, true, true, true, true, false }), canRunParallel);
+}
+
+TEST_F(CBotUT, PrimitiveExpressionsDontCreateVariables)
+{
+    const std::string code =
+        "extern void Loop()\n"
+        "{\n"
+        "    int x = 0;\n"
+        "    float f = 0;\n"
+        "    bool b = false;\n"
+        "    for (int i = 0; i < 1000; i++)\n"
+        "    {\n"
+        "        x += i * 2;\n"
+        "        f = -(f + 0.5) * 2;\n"
+        "        b = !b && (i % 3 == 0 || x > 10);\n"
+        "        if (x < 0) x = 1/0;\n"
+        "    }\n"
+        "    if (x != 999000) x = 1/0;\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> program(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(program->Compile(code, functions));
+    ASSERT_TRUE(program->Start(functions[0]));
+
+    long created = CBotVar::GetCreatedCount();
+    long live = CBotVar::GetLiveCount();
+    while (!program->Run());
+    EXPECT_EQ(CBotNoErr, program->GetError());
+
+    // only the local variables themselves, not one per operation
+    EXPECT_LT(CBotVar::GetCreatedCount() - created, 10);
+    EXPECT_EQ(live, CBotVar::GetLiveCount());
+}
+
+TEST_F(CBotUT, OperationsOnTypedOperands)
+{
+    const std::string code =
+        "int Two()\n"
+        "{\n"
+        "    return 2;\n"
+        "}\n"
+        "extern void TestOperations()\n"
+        "{\n"
+        "    int i = 7; int j = 2;\n"
+        "    float f = 0.5;\n"
+        "    bool t = true; bool u = false;\n"
+        "    string s = \"a\";\n"
+        "    ASSERT(i / j == 3.5);\n"
+        "    ASSERT(!(i / j == 3));\n"
+        "    ASSERT(i / j * j == 7);\n"
+        "    ASSERT((i / j) % 2 == 1.5);\n"
+        "    ASSERT(i / j + 1 == 4.5);\n"
+        "    ASSERT(1 + i / j == 4.5);\n"
+        "    ASSERT(-(i / j) * 2 == -7);\n"
+        "    ASSERT((i / Two()) * 2 == 7);\n"
+        "    ASSERT(i / 2 * Two() == 7);\n"
+        "    ASSERT(7 / 2 * j == 7);\n"
+        "    ASSERT((i / j + 1) * 2 == 9);\n"
+        "    ASSERT(i % j == 1);\n"
+        "    ASSERT(i * f == 3.5);\n"
+        "    ASSERT(f * i == 3.5);\n"
+        "    ASSERT(i - j < i + f);\n"
+        "    ASSERT((i >> 1) == 3);\n"
+        "    ASSERT((t & !u) == (t ^ u));\n"
+        "    ASSERT(t != u && !(t == u));\n"
+        "    ASSERT(s + i + j == \"a72\");\n"
+        "    ASSERT(i + j + s == \"9a\");\n"
+        "    ASSERT(s + t + j == \"atrue2\");\n"
+        "}\n";
+    ExecuteTest(code);
+    ExecuteTest(code, CBotNoErr, true);
+    ExecuteTest(code, CBotNoErr, false, true);
+
+    ExecuteTest(
+        "extern void DivideByZeroVariable()\n"
+        "{\n"
+        "    int i = 7; int j = 0;\n"
+        "    int k = i % j;\n"
+        "}\n",
+        CBotErrZeroDiv
+    );
+}
+
+TEST_F(CBotUT, StackFramesAreRecycled)
+{
+    const std::string code =
+        "int Depth(int n)\n"
+        "{\n"
+        "    if (n == 0) return 0;\n"
+        "    return 1 + Depth(n - 1);\n"
+        "}\n"
+        "extern void Recursion()\n"
+        "{\n"
+        "    if (Depth(50) != 50) int a = 1/0;\n"
+        "}\n";
+
+    std::unique_ptr<CBotProgram> program(new CBotProgram());
+    std::vector<std::string> functions;
+    ASSERT_TRUE(program->Compile(code, functions));
+    CBotExecutionContext* context = program->GetContext();
+
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(program->Start(functions[0]));
+        EXPECT_EQ(1, context->GetFrameCount());
+        while (!program->Run());
+        EXPECT_EQ(CBotNoErr, program->GetError());
+        EXPECT_EQ(1, context->GetFrameCount());     // only the base level is left until Stop()
+    }
+    program->Stop();
+    EXPECT_EQ(0, context->GetFrameCount());
+    EXPECT_GT(context->GetPeakFrameCount(), 50 * 2);
+}